@@ -6,6 +6,8 @@
 #include "gamelogic.h"
 using Player = GameLogic::Player;
 
+class OpeningBook;
+
 class AIOpponent : public QObject {
     Q_OBJECT
 
@@ -13,10 +15,18 @@ public:
     explicit AIOpponent(QObject *parent = nullptr);
     
     void setGameLogic(GameLogic *gameLogic);
+    // Medium and hard then open the way people do, in positions the book
+    // has seen often enough. The book is only read, so one can be shared.
+    void setOpeningBook(const OpeningBook *book);
     void makeMove();
+    
+    // Picks a move for O on the given board without touching the game.
+    // Does not allocate, which test_allocations relies on.
+    int findBestMove(QVector<Player>& board, int maxDepth);
 
 private:
     GameLogic *m_gameLogic;
+    const OpeningBook *m_openingBook;
     
     // Constants for evaluation
     inline static constexpr int WIN_SCORE = 10;
@@ -27,9 +37,11 @@ private:
     // Minimax with alpha-beta pruning
     int minimax(QVector<Player>& board, int depth, bool isMaximizing, int alpha, int beta, int maxDepth);
     
+    // A move drawn from the opening book, -1 if it has none
+    int bookMove(const QVector<Player>& board) const;
+
     // Helper functions
     int evaluateBoard(const QVector<Player>& board);
-    int findBestMove(QVector<Player>& board, int maxDepth);
     bool isBoardFull(const QVector<Player>& board);
     bool checkWinner(const QVector<Player>& board, Player player);
 };
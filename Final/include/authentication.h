@@ -4,8 +4,13 @@
 #include <QObject>
 #include <QString>
 #include <QVector>
+#include <QHash>
 #include <QCryptographicHash>
 #include "user.h"
+#include "userstore.h"
+
+class Database;
+class DatabaseWriter;
 
 class Authentication : public QObject {
     Q_OBJECT
@@ -15,15 +20,34 @@ public:
     ~Authentication();
 
     bool login(const QString &username, const QString &password);
+    // Whether the password is the user's, without signing anyone in, for
+    // servers checking players who are not at this window
+    bool checkCredentials(const QString &username, const QString &password) const;
     bool registerUser(const QString &username, const QString &password);
     User* getCurrentUser() const;
     QVector<User*> getUsers() const;
+    // Counters of every user above in columns, for leaderboards and totals
+    const UserStore &userStore() const;
     bool authenticatePlayers(const QString &player1Username, const QString &player1Password,
                              const QString &player2Username, const QString &player2Password,
                              QString &errorMessage);
     QString getErrorMessage() const;
+    
+    // Persistence goes through this database; without one save/load do nothing
+    void setDatabase(Database *database);
+    // When set, saves are handed to the background writer instead of blocking
+    void setWriter(DatabaseWriter *writer);
     void saveUsers();
+    // Loads users and compacts the journal when it has grown too long,
+    // unless the database is read-only
     void loadUsers();
+    // Takes over users loaded elsewhere, such as by DatabaseWriter; stored
+    // users replace the built-in defaults of the same name
+    void addLoadedUsers(const QVector<User*> &loaded);
+    // Loads every user again if the files changed since the last load and
+    // returns whether it did. Users in memory are replaced, so this is for
+    // read-only databases, which never have unsaved changes
+    bool reloadUsers();
 
     // Password security methods
     static QString hashPassword(const QString &password);
@@ -34,9 +58,17 @@ signals:
     void loginStatusChanged(bool loggedIn, const QString &username);
 
 private:
+    User* findUser(const QString &username) const;
+    void addDefaultUsers();
+
     QVector<User*> m_users;
+    QHash<QString, User*> m_usersByName; // Username index over m_users
+    UserStore m_userStore;
     User* m_currentUser;
     QString m_lastErrorMessage;
+    Database* m_database;
+    DatabaseWriter* m_writer;
+    qint64 m_loadedModified; // Database::usersModified() at the last load
 };
 
 #endif // AUTHENTICATION_H
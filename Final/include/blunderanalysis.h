@@ -0,0 +1,87 @@
+#ifndef BLUNDERANALYSIS_H
+#define BLUNDERANALYSIS_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "gamearchive.h"
+#include "replaytimeline.h"
+
+// One player's archived moves, graded against perfect play
+struct MistakeTally {
+    quint32 games = 0;
+    quint32 moves = 0;
+    quint32 inaccuracies = 0;
+    quint32 mistakes = 0;
+    quint32 blunders = 0;
+
+    // Moves that gave away a result, mistakes and blunders, per move played
+    double mistakeRate() const;
+    void add(const MistakeTally &other);
+};
+
+// A position players keep handing their opponent
+struct LosingPattern {
+    quint32 position = 0;   // MoveAnalyzer::canonicalKey of the board after the mistake
+    quint32 count = 0;
+    // The canonical board; X is whoever moved first
+    BoardSnapshot board() const;
+};
+
+// What the batch analysis found, small enough to load whenever statistics
+// are shown. Saved next to the archive it covers.
+class BlunderSummary {
+public:
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+
+    // Archive records covered, counted from the first
+    qint64 gamesAnalysed() const { return m_gamesAnalysed; }
+    // Zeroes for players without analysed games
+    MistakeTally tally(const QString &player) const;
+    const QHash<QString, MistakeTally> &players() const { return m_players; }
+    // Most common first
+    QVector<LosingPattern> patterns(int limit) const;
+
+    void merge(const BlunderSummary &other);
+    void clear();
+
+private:
+    friend class BlunderAnalysis;
+
+    static const quint32 MAGIC = 0x54544241; // "TTBA"
+    static const quint32 VERSION = 1;
+
+    qint64 m_gamesAnalysed = 0;
+    QHash<QString, MistakeTally> m_players;
+    QHash<quint32, quint32> m_patterns;     // Canonical position -> mistakes that left it
+};
+
+// Grades every move of every archived game and tallies the results per
+// player.
+//
+// The archive is streamed a page at a time. Each page is split across a
+// thread pool whose workers fill summaries of their own, merged once the page
+// is done, and the next page is read while they run. The grade of every move
+// in every reachable position is worked out once through MoveAnalyzer's
+// shared cache before the first page; after that workers only read it, so
+// they never take a lock. A summary remembers how many records it covers and
+// a later run only analyses the games archived since.
+class BlunderAnalysis {
+public:
+    // Brings the summary up to date with the archive. Returns the games
+    // analysed, -1 if the archive could not be read.
+    static qint64 run(GameArchive *archive, BlunderSummary *summary);
+    // Same, through the summary file next to the archive
+    static qint64 update(GameArchive *archive);
+    static QString summaryPath(const QString &archivePath);
+
+    static const int PAGE_SIZE = 65536;     // Records read at once
+    static const int SLICE_SIZE = 4096;     // Records per worker task
+
+private:
+    static void analyseGames(const QVector<ArchivedGame> &games, int from, int to,
+                             BlunderSummary *summary);
+};
+
+#endif // BLUNDERANALYSIS_H
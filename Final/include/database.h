@@ -5,41 +5,173 @@
 #include <QVector>
 #include <QString>
 #include <QVariant>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSharedPointer>
 #include "user.h"
+#include "gamelogic.h"
 
 // Define a struct to hold leaderboard entry data
 struct LeaderboardEntry {
-    QString username;
+    quint32 usernameId = 0; // StringInterner id
     int wins;
     int totalGames;
     int winRate;
     int bestStreak;
     int score; // Calculated score for ranking
+    int rating = 0; // Elo rating, filled in when ranking by rating
+
+    QString username() const;
+    void setUsername(const QString &username);
 };
 
+class SqliteStore;
+class GameArchive;
+class HistoryStore;
+class JsonHistoryStore;
+class UserStore;
+
 class Database : public QObject {
     Q_OBJECT
 
 public:
+    // JSON keeps everything in tictactoe.json plus a journal; SQLite keeps
+    // normalized tables in tictactoe.db
+    enum class Backend {
+        Json,
+        Sqlite
+    };
+
+    // Score is the calculatePlayerScore heuristic, Rating the Elo rating
+    // kept by the game archive
+    enum class Ranking {
+        Score,
+        Rating
+    };
+
     explicit Database(QObject *parent = nullptr);
     ~Database();
 
+    // Backend used for the default path of new instances, picked at startup
+    static void setDefaultBackend(Backend backend);
+    static Backend defaultBackend();
+    // Leaderboard order of new instances, picked at startup
+    static void setDefaultRanking(Ranking ranking);
+    static Ranking defaultRanking();
+
+    // Location of the database, defaults to the app data directory. Paths
+    // ending in .db, .sqlite or .sqlite3 use the SQLite backend.
+    void setDatabasePath(const QString &path);
+    QString databasePath() const;
+    Backend backend() const;
+    // A read-only database loads users but never writes anything: saves and
+    // game appends are refused, and loading neither migrates, compacts nor
+    // writes a shard index. For processes that check the accounts a window
+    // is saving at the same time
+    void setReadOnly(bool readOnly);
+    bool isReadOnly() const;
+    // Newest modification time of the files users are loaded from, in ms
+    // since the epoch, or -1 if there are none
+    qint64 usersModified() const;
+
+    // Full rewrite of tictactoe.json; also folds in and clears the journal
     bool saveUsers(const QVector<User*> &users);
     QVector<User*> loadUsers();
+    // Users loaded by another Database of the same file, on another thread,
+    // read their games through this one's SQLite connection from now on.
+    // JSON histories are read from the file and need nothing
+    void adoptHistories(const QVector<User*> &users);
+    
+    // Incremental save: appends only the given (changed) users to the journal
+    // next to tictactoe.json, so a save costs the size of those records
+    bool appendUsers(const QVector<User*> &users, qint64 *bytesWritten = nullptr);
+    QString journalPath() const;
+    // True once the journal has grown enough that a full save should fold it in
+    bool journalNeedsCompaction() const;
     
+    // Appends a finished game to the archive. The string form takes
+    // "X wins", "O wins" or "draw".
     bool saveGame(const QString &playerX, const QString &playerO, const QString &result);
+    bool saveGame(const QString &playerX, const QString &playerO, GameLogic::GameResult result,
+                  const QString &difficulty = QString(), quint64 packedMoves = 0);
+    // Every game saved next to this database, <path>.games; opened on first use
+    GameArchive* gameArchive();
+    QString gameArchivePath() const;
     
     // Updated to return comprehensive leaderboard data
-    QVector<LeaderboardEntry> getLeaderboard(const QVector<User*> &users) const;
+    QVector<LeaderboardEntry> getLeaderboard(const QVector<User*> &users);
+    // Same ranking as a sweep over the store's columns; only the rows that
+    // make the cut are turned into entries. limit < 0 keeps every player.
+    QVector<LeaderboardEntry> getLeaderboard(const UserStore &store, int limit = -1);
+    void setRanking(Ranking ranking);
+    Ranking ranking() const;
+    // Top players straight from storage (an indexed query on SQLite, the JSON
+    // backend has no index and returns nothing). Reads the disk, so the GUI
+    // ranks from the UserStore instead
+    QVector<LeaderboardEntry> getLeaderboard(int limit) const;
+    
+    // Imports a tictactoe.json into this database, replacing what is stored
+    bool migrateFromJson(const QString &jsonPath);
+    
+    // Per-user JSON record: the counters, with the history under a top-level
+    // "gameHistory" and its length under "history"
+    static QJsonObject serializeUser(const User &user);
+    // The same record as one compact line for tictactoe.json, its journal and
+    // the dataset generator. The history comes last, after everything else,
+    // so loaders can cut it off unparsed
+    static QByteArray serializeRecord(const User &user);
+    // A compact record without its history section
+    static QByteArray withoutHistory(const QByteArray &record);
+    // Opens the history section of a compact record
+    static constexpr char HISTORY_SECTION[] = ",\"gameHistory\":";
+    // With a history store the user's games stay on disk until first needed,
+    // historyKey being the record's offset in that store's file
+    static User* deserializeUser(const QJsonObject &userObj,
+                                 const QSharedPointer<HistoryStore> &historyStore = QSharedPointer<HistoryStore>(),
+                                 qint64 historyKey = -1);
+    // Newest-first history as stored under "gameHistory"
+    static QVector<GameRecord> deserializeHistory(const QJsonArray &historyArray);
+    // Window counters for records saved before they were stored, newest game first
+    static RollingStats rollingStatsFromHistory(const QVector<GameRecord> &history);
+    
+    // Splits a history entry such as "Win vs AI (hard)" back into the
+    // arguments addGame* was called with
+    static void parseResult(const QString &result, QString *outcome, QString *opponent, QString *difficulty);
+    
+    // Helper method to calculate player score for ranking
+    static int calculatePlayerScore(int wins, int totalGames, int winRate, int bestStreak);
     
     // Override setProperty for testing
     bool setProperty(const char *name, const QVariant &value);
 
 private:
     QString m_dbPath;
+    QSharedPointer<SqliteStore> m_sqlite; // Only set for the SQLite backend
+    GameArchive *m_archive;
+    bool m_readOnly;
+    mutable QVector<QWeakPointer<JsonHistoryStore>> m_historyStores; // Handed out by loads and saves
     
-    // Helper method to calculate player score for ranking
-    int calculatePlayerScore(int wins, int totalGames, int winRate, int bestStreak) const;
+    Ranking m_ranking;
+    
+    static Backend s_defaultBackend;
+    static Ranking s_defaultRanking;
+    
+    static constexpr qint64 JOURNAL_COMPACT_MIN_BYTES = 1024 * 1024;
+    static const int MIGRATION_BATCH_SIZE = 10000;
+    // Users per independently decodable shard of tictactoe.json
+    static const int SHARD_SIZE = 8192;
+    static const quint32 SHARD_INDEX_MAGIC = 0x54545349; // "TTSI"
+    
+    bool checkWritablePath() const;
+    void replayJournal(QVector<User*> &users) const;
+    // Remembered, so that a full save can move the users' histories along
+    QSharedPointer<HistoryStore> newHistoryStore(const QString &path) const;
+    
+    // tictactoe.json.idx records where each shard starts; with a valid index
+    // the shards are decoded on a thread pool
+    QString shardIndexPath() const;
+    void writeShardIndex(const QVector<qint64> &offsets, int userCount) const;
+    bool loadShards(QVector<User*> &users) const;
 };
 
 #endif // DATABASE_H
@@ -0,0 +1,122 @@
+#ifndef DATABASEWRITER_H
+#define DATABASEWRITER_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include "user.h"
+#include "gamearchive.h"
+
+class Database;
+class QThread;
+
+// Persists users on a dedicated thread.
+//
+// scheduleSave() only copies the users that changed since the last call
+// (cheap, the copies share their data) and returns; the writer thread waits for
+// the coalescing window to close so a burst of game-overs turns into a single
+// write, then appends those records to the database journal. A save costs the
+// size of the changed users, not of the whole database, and the GUI thread
+// never touches the file. A failed write keeps its records queued and is
+// retried with a growing delay. Once the journal has grown too long, the
+// writer folds it back into the main file after the write that crossed the
+// line.
+//
+// Finished games go the same way into a GameArchive, which the writer thread
+// also opens and indexes, so the GUI thread never scans or appends to it. The
+// users themselves are loaded there too, along with the journal compaction
+// that may follow, before any save is written.
+class DatabaseWriter : public QObject {
+    Q_OBJECT
+
+public:
+    struct Metrics {
+        int queueDepth;              // Save requests waiting for the next write
+        qint64 writesCompleted;      // Writes that reached the disk (or failed)
+        qint64 writesFailed;         // Failed writes, each retried later
+        qint64 requestsCoalesced;    // Requests folded into an earlier write
+        qint64 lastWriteLatencyMs;   // First request of a batch to durable write
+        qint64 maxWriteLatencyMs;
+        qint64 lastWriteDurationMs;  // Serialize plus write time of the last batch
+        qint64 lastWriteBytes;       // Journal bytes appended by the last batch
+        qint64 journalCompactions;   // Times the journal was folded into the main file
+    };
+
+    explicit DatabaseWriter(const QString &dbPath, QObject *parent = nullptr);
+    ~DatabaseWriter();
+
+    void setCoalesceWindow(int msecs);
+    int coalesceWindow() const;
+
+    // Snapshot the dirty users, clear their flags and queue a save. Call it
+    // from the thread that owns the users.
+    void scheduleSave(const QVector<User*> &users);
+
+    // Loads the users on the writer thread, folding a long journal into the
+    // main file first if it needs it, then emits usersLoaded(). Saves queued
+    // meanwhile are written after it.
+    void scheduleLoad();
+    // The users read by the last load, handed over once; the caller owns them
+    QVector<User*> takeLoadedUsers();
+
+    // Opens the archive on the writer thread, then emits archiveOpened().
+    // The archive has to outlive the writer.
+    void setGameArchive(GameArchive *archive);
+    // Queues a finished game for the archive, stamped with the current time
+    void scheduleGame(const ArchivedGame &game);
+
+    // Blocks until every save scheduled so far has been tried, retrying a
+    // failed write straight away. False while records are still waiting for
+    // a write that succeeds. Meant for shutdown.
+    bool flush();
+
+    Metrics metrics() const;
+
+signals:
+    // Emitted from the writer thread after each write
+    void saveCompleted(bool success, qint64 latencyMs);
+    // Emitted from the writer thread once the archive is indexed
+    void archiveOpened(bool success);
+    // Emitted from the writer thread once takeLoadedUsers() has them
+    void usersLoaded();
+
+private:
+    void run();
+    // Rewrites the main file from what is on disk and drops the journal
+    bool compactJournal();
+
+    static const int DEFAULT_COALESCE_WINDOW_MS = 500;
+    static const int FIRST_RETRY_DELAY_MS = 250;    // Doubled after each failure
+    static const int MAX_RETRY_DELAY_MS = 30000;
+    static const int SHUTDOWN_ATTEMPTS = 3;         // Then pending records are given up
+
+    QThread *m_thread;
+    Database *m_database;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wakeup;      // Writer waits here for work
+    QWaitCondition m_written;     // flush() waits here for the writer
+
+    QHash<QString, User> m_pendingUsers; // Newest record per username
+    QVector<ArchivedGame> m_pendingGames; // In the order they finished
+    QVector<User*> m_loadedUsers;         // Until takeLoadedUsers()
+    bool m_loadRequested;
+    GameArchive *m_archive;
+    bool m_archiveToOpen;
+    bool m_hasPending;
+    bool m_flushRequested;
+    bool m_stopping;
+    bool m_lastWriteOk;
+    int m_coalesceWindowMs;
+    int m_retryDelayMs;           // 0 unless the last write failed
+    quint64 m_requestedGeneration;
+    quint64 m_writtenGeneration;
+    QElapsedTimer m_batchAge;
+    Metrics m_metrics;
+};
+
+#endif // DATABASEWRITER_H
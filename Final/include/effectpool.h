@@ -0,0 +1,66 @@
+#ifndef EFFECTPOOL_H
+#define EFFECTPOOL_H
+
+#include <QColor>
+#include <QHash>
+#include <QObject>
+#include <QPixmap>
+#include <QPointer>
+#include <QVector>
+
+class QGraphicsOpacityEffect;
+class QPainter;
+class QPropertyAnimation;
+class QWidget;
+
+// Effects and animations kept for the lifetime of a window instead of being
+// allocated on every use.
+//
+// Fades reuse one opacity effect and one animation per widget, and the effect
+// is only enabled while a fade runs, so the widget is not rendered offscreen
+// the rest of the time. Glows are drawn once into small nine-patch pixmaps
+// whose edges are stretched along a widget's border, in place of a blurred
+// drop shadow.
+class EffectPool : public QObject {
+    Q_OBJECT
+
+public:
+    explicit EffectPool(QObject *parent = nullptr);
+
+    // Shows the widget and fades it in, or fades it out and hides it
+    void fadeIn(QWidget *widget, int duration);
+    void fadeOut(QWidget *widget, int duration);
+    bool isFading(QWidget *widget) const;
+
+    // Frames of a glow pulsing from one colour to another just inside a
+    // rounded rectangle; each is glowMargin() * 2 + 1 pixels square. Built
+    // once per set of arguments.
+    QVector<QPixmap> glowFrames(int radius, int blur, const QColor &from,
+                                const QColor &to, int frames);
+    static int glowMargin(int radius, int blur) { return radius + blur; }
+    // Draws a frame's corners and stretched edges along rect; the middle,
+    // which is empty, is skipped
+    static void drawGlow(QPainter *painter, const QRect &rect, const QPixmap &frame, int margin);
+
+    int fadeCount() const { return m_fades.size(); }
+    int glowCount() const { return m_glows.size(); }
+
+    // Idle glows repaint at most this often
+    static constexpr int IDLE_GLOW_FPS = 8;
+
+private:
+    struct Fade {
+        QPointer<QWidget> widget;
+        QGraphicsOpacityEffect *effect = nullptr;
+        QPropertyAnimation *animation = nullptr;
+        bool hideWhenDone = false;
+    };
+
+    Fade &fade(QWidget *widget);
+    void startFade(QWidget *widget, qreal to, int duration, bool hideWhenDone);
+
+    QHash<QWidget*, Fade> m_fades;
+    QHash<QString, QVector<QPixmap>> m_glows;
+};
+
+#endif // EFFECTPOOL_H
@@ -0,0 +1,149 @@
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "gamelogic.h"
+#include "headtohead.h"
+#include "openingtrie.h"
+#include "ratingengine.h"
+
+// One completed game as kept by the archive
+struct ArchivedGame {
+    qint64 id = -1;            // Position in the archive, in play order
+    qint64 playedAt = 0;       // Milliseconds since the epoch, UTC
+    QString playerX;
+    QString playerO;           // GameArchive::COMPUTER_PLAYER against the computer
+    GameLogic::GameResult result = GameLogic::GameResult::Draw;
+    QString difficulty;        // Empty for two-player games
+    quint64 packedMoves = 0;   // MoveCodec format, 0 if none were recorded
+};
+
+// An opponent and how a player fared against them
+struct Rival {
+    QString opponent;
+    HeadToHeadStats stats;
+};
+
+// Append-only log of every completed game.
+//
+// Games are fixed 32-byte records in <path>, players are numbered by their
+// line in <path>.players. Records are only ever appended, with timestamps that
+// never go backwards, so a record's position is also its place in time.
+//
+// Two small indexes are rebuilt when the archive is opened: the records of
+// each player, and the first record of every hour. Queries binary search
+// those and read only the records they return, newest first, one page at a
+// time. Two-player games also feed a head-to-head table keyed by the same
+// player ids, every game updates the players' Elo ratings, and its first
+// moves go into a trie of openings.
+//
+// One archive can be appended to on one thread and read on another. Opening
+// scans the whole file, so the GUI leaves that and the appends to
+// DatabaseWriter's thread and checks isOpen() before asking for anything.
+// The scan and an append's file writes hold only a lock of their own; the
+// indexes they build are swapped in under the lock readers take, which is
+// never held for longer than a lookup. isOpen() takes no lock at all.
+class GameArchive {
+public:
+    // A read-only archive never changes the files, not even to drop the torn
+    // end of a crashed write, and refuses appends
+    enum class Mode {
+        ReadWrite,
+        ReadOnly
+    };
+
+    // Stands in for the computer as a player; registration refuses the name
+    static constexpr char COMPUTER_PLAYER[] = "AI";
+
+    explicit GameArchive(const QString &path, Mode mode = Mode::ReadWrite);
+
+    // Opens the files and rebuilds the indexes; every other call does this
+    // on first use
+    bool open();
+    bool isOpen() const;
+
+    bool append(const QString &playerX, const QString &playerO, GameLogic::GameResult result,
+                const QString &difficulty = QString(), quint64 packedMoves = 0, qint64 playedAt = -1);
+
+    qint64 count();
+
+    // Games of one player with from <= playedAt < to, newest first
+    QVector<ArchivedGame> gamesOf(const QString &player, qint64 from, qint64 to, int offset, int limit);
+    int countGamesOf(const QString &player, qint64 from, qint64 to);
+    // Games of anyone, newest first
+    QVector<ArchivedGame> latest(int offset, int limit);
+    // Games in play order from record first on, read in one pass; for jobs
+    // that stream the whole archive a page at a time
+    QVector<ArchivedGame> range(qint64 first, int limit);
+
+    // Two-player games between the two, from the player's point of view
+    HeadToHeadStats headToHead(const QString &player, const QString &opponent);
+    // The player's most played opponents, most games first
+    QVector<Rival> topRivals(const QString &player);
+
+    // Elo rating, the initial rating for players without games
+    double rating(const QString &player);
+    RatingEngine::Parameters ratingParameters() const;
+    // Re-rates every archived game under the new parameters
+    bool setRatingParameters(const RatingEngine::Parameters &parameters);
+
+    // Openings of every archived game that recorded its moves, copied so
+    // appends on another thread cannot change them under the caller
+    OpeningTrie openings();
+
+    QString path() const;
+
+    static const int RECORD_SIZE = 32;
+    static constexpr qint64 BUCKET_MS = 60 * 60 * 1000;
+
+private:
+    // Everything opening rebuilds from the files
+    struct Index {
+        quint32 count = 0;
+        qint64 lastPlayedAt = 0;
+        QVector<QString> playerNames;           // By player id
+        QHash<QString, quint32> playerIds;
+        QVector<QVector<quint32>> playerGames;  // Record numbers, ascending
+        QMap<qint64, quint32> buckets;          // Hour -> first record in it
+        HeadToHead headToHead;
+        RatingEngine ratingEngine;
+        OpeningTrie openings;
+
+        void addPlayer(const QString &name);
+        void addRecord(quint32 record, qint64 time, quint32 playerX, quint32 playerO,
+                       GameLogic::GameResult result, bool vsAI);
+    };
+
+    bool ensureOpen();
+    // With m_writeMutex held
+    bool load();
+    quint32 playerId(const QString &name);
+    qint64 playedAt(quint32 record);
+    // First record played at or after the given time
+    quint32 firstRecordFrom(qint64 time);
+    bool readRecord(quint32 record, ArchivedGame *game);
+    void decodeRecord(quint32 record, const uchar *data, ArchivedGame *game) const;
+    // Reads every record back through a handle of its own, for a full re-rating
+    QVector<RatedGame> ratedGames(quint32 count) const;
+
+    // Opening, appends and re-rating take m_writeMutex and do their file I/O
+    // under it alone. Whatever changes the index also takes m_mutex, which
+    // readers hold while they look it up and read records through m_file.
+    QMutex m_writeMutex;
+    mutable QMutex m_mutex;
+    QString m_path;
+    Mode m_mode;
+    QFile m_file;           // Unbuffered, so appends made since are read back
+    QFile m_appendFile;
+    QFile m_playersFile;
+    std::atomic<bool> m_open;
+    Index m_index;
+};
+
+#endif // GAMEARCHIVE_H
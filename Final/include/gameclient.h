@@ -0,0 +1,54 @@
+#ifndef GAMECLIENT_H
+#define GAMECLIENT_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include "gamelogic.h"
+
+class QTcpSocket;
+
+// Connection to a GameServer. One client can have any number of games open;
+// replies arrive as signals carrying the game's session id.
+class GameClient : public QObject {
+    Q_OBJECT
+
+public:
+    explicit GameClient(QObject *parent = nullptr);
+
+    void connectToServer(const QString &host, quint16 port);
+    void disconnectFromServer();
+    bool isConnected() const;
+
+    // Both seats of the new game belong to this client; gameOpened follows
+    void openGame(const QString &playerX, const QString &playerO);
+    void sendMove(quint32 session, int cellIndex);
+    // Asks the server for an opponent of similar rating; matchFound follows
+    void queueForMatch(const QString &username, const QString &password);
+    // Follows a game without playing: boardSnapshot, then moved and gameOver
+    void watchGame(quint32 session);
+
+signals:
+    void connected();
+    void disconnected();
+    // session is 0 when the server refused the game
+    void gameOpened(quint32 session);
+    void moved(quint32 session, int cellIndex, GameLogic::Player player);
+    void moveRejected(quint32 session, int cellIndex);
+    // InProgress when the game was abandoned by the other side
+    void gameOver(quint32 session, GameLogic::GameResult result);
+    // session is 0 when the server refused to queue the player
+    void matchFound(quint32 session, GameLogic::Player mark);
+    // The whole board of a watched game, as cell masks. Sent when watching
+    // starts and whenever moves were skipped; session is 0 for no such game.
+    void boardSnapshot(quint32 session, quint16 xCells, quint16 oCells);
+
+private slots:
+    void onReadyRead();
+
+private:
+    QTcpSocket *m_socket;
+    QByteArray m_inbox;
+};
+
+#endif // GAMECLIENT_H
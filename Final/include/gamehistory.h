@@ -9,9 +9,14 @@ class GameHistory : public QObject {
     Q_OBJECT
 
 public:
+    // The date is a StringInterner key like GameRecord's; the line names
+    // both players, so it is kept as is rather than interned for good
     struct HistoryEntry {
-        QString date;
-        QString result;
+        qint64 dateKey = -1;
+        QString resultText;
+
+        QString date() const;
+        QString result() const;
     };
 
     explicit GameHistory(QObject *parent = nullptr);
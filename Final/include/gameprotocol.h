@@ -0,0 +1,58 @@
+#ifndef GAMEPROTOCOL_H
+#define GAMEPROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+// Binary frames exchanged between GameServer and its clients.
+//
+// Every frame starts with an 8-byte header:
+//   byte 0     type
+//   byte 1     argument: a cell, a cell and mark, or a result, by type
+//   bytes 2-3  payload length, little-endian
+//   bytes 4-7  session id, little-endian
+// Only Open, Queue and Board carry a payload, so a move and its reply are 8
+// bytes each. The server answers a connection's Opens in the order they were
+// sent.
+class GameProtocol {
+public:
+    enum class FrameType : quint8 {
+        Open = 1,  // Client: start a game, payload holds both players
+        Opened,    // Server: the new game's session id
+        Move,      // Client: argument is the cell
+        Moved,     // Server: argument is the cell | mark << 4
+        Rejected,  // Server: the move in argument was not played
+        GameOver,  // Server: argument is the GameLogic::GameResult
+        Queue,     // Client: find an opponent, payload holds username and password
+        Matched,   // Server: a matched game, argument is the client's mark (1 X, 2 O)
+        Watch,     // Client: follow the session's moves as a spectator
+        Board      // Server: the whole board of a watched game, payload holds both masks
+    };
+
+    struct Frame {
+        FrameType type = FrameType::Open;
+        quint8 argument = 0;
+        quint32 session = 0;
+        QByteArray payload;
+    };
+
+    static void append(QByteArray &out, FrameType type, quint32 session, quint8 argument = 0,
+                       const QByteArray &payload = QByteArray());
+    // Decodes the frame at *offset and moves past it. False when the frame is
+    // still incomplete, or with *error set when it can never be valid.
+    static bool take(const QByteArray &buffer, int *offset, Frame *frame, bool *error);
+
+    // Open and Queue payload: length of the first string, then both in UTF-8
+    static QByteArray encodePlayers(const QString &playerX, const QString &playerO);
+    static bool decodePlayers(const QByteArray &payload, QString *playerX, QString *playerO);
+
+    // Board payload: X's and O's cell masks, little-endian
+    static QByteArray encodeBoard(quint16 xCells, quint16 oCells);
+    static bool decodeBoard(const QByteArray &payload, quint16 *xCells, quint16 *oCells);
+
+    static const int HEADER_SIZE = 8;
+    static const int MAX_PAYLOAD = 512;
+};
+
+#endif // GAMEPROTOCOL_H
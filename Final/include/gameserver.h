@@ -0,0 +1,181 @@
+#ifndef GAMESERVER_H
+#define GAMESERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+#include "gamelogic.h"
+#include "gameprotocol.h"
+#include "matchmaker.h"
+#include "replaytimeline.h"
+#include "spectatorfeed.h"
+
+class Authentication;
+class Database;
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+// Hosts many games at once for clients connected over TCP on localhost.
+//
+// A session is one game. Its state is a few bytes taken from a pool of
+// fixed-size slots allocated a chunk at a time, and a slot goes back on the
+// free list as soon as its game ends, so the number of games in flight costs
+// no allocation once the pool has grown to it. Session ids carry the slot's
+// generation, which makes frames for a finished game fail instead of landing
+// in the one that reused its slot.
+//
+// Finished games are queued and written to the Database in batches, keeping
+// disk writes off the path between a move and its reply.
+//
+// Clients can also queue for an opponent. Players sign in through the
+// Authentication when one is set and are paired by the Matchmaker on the
+// ratings the database's archive keeps; the longer waiter plays X.
+//
+// Any client can watch a game. The first spectator gives the session a
+// SpectatorFeed, so each move is encoded once for all of them, and a
+// spectator whose socket has fallen behind is sent the latest board once it
+// has drained instead of every move in between. A finished game's feed is
+// kept for such spectators until they have been sent the final board.
+class GameServer : public QObject {
+    Q_OBJECT
+
+public:
+    struct Metrics {
+        int activeSessions = 0;
+        int pooledSessions = 0;     // Slots allocated, in use or free
+        qint64 gamesStarted = 0;
+        qint64 gamesFinished = 0;
+        qint64 movesPlayed = 0;
+        qint64 movesRejected = 0;
+        qint64 gamesPersisted = 0;
+        int playersWaiting = 0;     // Queued for an opponent
+        qint64 matchesMade = 0;
+        int spectators = 0;
+    };
+
+    // Games are persisted when a database is given
+    explicit GameServer(Database *database = nullptr, QObject *parent = nullptr);
+    ~GameServer();
+
+    // Queued players must then sign in; without one any name is taken as given
+    void setAuthentication(Authentication *auth);
+
+    // Port 0 picks a free one
+    bool listen(quint16 port = 0);
+    quint16 port() const;
+    void close();
+
+    // Writes the games finished since the last batch now
+    void persistFinishedGames();
+
+    Metrics metrics() const;
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Connection;
+    struct Watcher;
+
+    // The spectators of one session
+    struct Broadcast {
+        explicit Broadcast(quint32 session) : feed(session) {}
+        SpectatorFeed feed;
+        QVector<Watcher*> watchers;
+        bool closed = false;        // Game over, left to the watchers still behind
+    };
+
+    struct Session {
+        BoardSnapshot board;
+        quint8 generation = 0;
+        bool active = false;
+        quint32 playerX = 0;        // StringInterner ids
+        quint32 playerO = 0;
+        quint64 packedMoves = 0;    // MoveCodec format
+        Connection *ownerX = nullptr;
+        Connection *ownerO = nullptr;
+        int seatX = -1;             // Positions in the owners' session lists;
+        int seatO = -1;             // only seatX when one connection has both
+        Broadcast *broadcast = nullptr;     // Once someone watches
+    };
+
+    struct Connection {
+        QTcpSocket *socket = nullptr;
+        QByteArray inbox;           // Bytes of a frame still arriving
+        QVector<Watcher*> watching;
+        QVector<quint32> sessions;  // Slots it plays in, so leaving is not a pool scan
+        QVector<quint32> queued;    // Username ids it is waiting for a match as
+    };
+
+    // A connection watching a session
+    struct Watcher : SpectatorFeed::Spectator {
+        Watcher(Connection *connection, Broadcast *broadcast) : connection(connection), broadcast(broadcast) {}
+        bool deliver(const QByteArray &frame) override;
+        Connection *connection;
+        Broadcast *broadcast;
+    };
+
+    struct FinishedGame {
+        quint32 playerX;
+        quint32 playerO;
+        GameLogic::GameResult result;
+        quint64 packedMoves;
+    };
+
+    void onReadyRead(Connection *connection);
+    void onDisconnected(Connection *connection);
+    void onBytesWritten(Connection *connection);
+    void handleFrame(Connection *connection, const GameProtocol::Frame &frame);
+    void openSession(Connection *connection, const GameProtocol::Frame &frame);
+    void playMove(Connection *connection, const GameProtocol::Frame &frame);
+    void queuePlayer(Connection *connection, const GameProtocol::Frame &frame);
+    void startMatch(const Matchmaker::Match &match);
+    void watchSession(Connection *connection, const GameProtocol::Frame &frame);
+    void closeBroadcast(Session &session);
+    // Deletes a closed broadcast along with its last watcher
+    void removeWatcher(Watcher *watcher);
+    void onMatchTimeout();
+    void send(Connection *connection, GameProtocol::FrameType type, quint32 session, quint8 argument);
+    // Both seats, once each when one connection holds both
+    void sendToPlayers(const Session &session, GameProtocol::FrameType type, quint32 id, quint8 argument);
+
+    // Slot allocation
+    quint32 allocateSession();
+    void releaseSession(quint32 index);
+    // Adds a session to its owners' lists once they are set, and takes one out
+    void attachSession(quint32 index);
+    void detachSession(Connection *connection, int seat);
+    Session *findSession(quint32 id);
+    Session &slot(quint32 index);
+    static quint32 sessionId(quint32 index, quint8 generation);
+
+    static const int SESSION_CHUNK = 1024;          // Slots allocated at a time
+    static const quint32 INDEX_BITS = 24;           // Of a session id, the rest is the generation
+    static const int PERSIST_INTERVAL_MS = 100;
+    static const int MATCH_POLL_MS = 250;           // Queued players' windows are widened this often
+    static const int SPECTATOR_BACKLOG = 64 * 1024; // Unsent bytes before a spectator is coalesced
+
+    Database *m_database;
+    Authentication *m_auth;
+    QTcpServer *m_server;
+    QHash<QTcpSocket*, Connection*> m_connections;
+
+    QVector<Session*> m_chunks;
+    QVector<quint32> m_freeSlots;
+    int m_slotCount;
+
+    QVector<FinishedGame> m_finished;
+    QTimer *m_persistTimer;
+
+    Matchmaker m_matchmaker;
+    QHash<quint32, Connection*> m_queued;   // By username id
+    QTimer *m_matchTimer;
+    QElapsedTimer m_clock;
+
+    Metrics m_metrics;
+};
+
+#endif // GAMESERVER_H
@@ -0,0 +1,58 @@
+#ifndef HEADTOHEAD_H
+#define HEADTOHEAD_H
+
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include "gamelogic.h"
+
+// Results between two players, from the first player's point of view
+struct HeadToHeadStats {
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+
+    int games() const { return wins + losses + draws; }
+};
+
+// Pairwise results between players, keyed by player id.
+//
+// Every pair is a single hash entry, so looking two players up is O(1) and
+// recording a game touches one entry. Each player also keeps a small min-heap
+// of the opponents they have played most, updated with the pair; asking for
+// someone's top rivals never walks the table.
+class HeadToHead {
+public:
+    explicit HeadToHead(int rivalsKept = DEFAULT_RIVALS_KEPT);
+
+    void record(quint32 playerX, quint32 playerO, GameLogic::GameResult result);
+    HeadToHeadStats stats(quint32 player, quint32 opponent) const;
+    // Most played opponents first, at most rivalsKept of them
+    QVector<QPair<quint32, HeadToHeadStats>> topRivals(quint32 player) const;
+
+    int pairCount() const;
+    void clear();
+
+    static const int DEFAULT_RIVALS_KEPT = 5;
+
+private:
+    struct PairStats {
+        int lowWins = 0;   // Wins of the player with the lower id
+        int highWins = 0;
+        int draws = 0;
+    };
+
+    struct RivalSlot {
+        int games;
+        quint32 rival;
+    };
+
+    static quint64 pairKey(quint32 a, quint32 b);
+    void updateRival(quint32 player, quint32 rival, int games);
+
+    int m_rivalsKept;
+    QHash<quint64, PairStats> m_pairs;
+    QHash<quint32, QVector<RivalSlot>> m_rivals; // Min-heaps on games played
+};
+
+#endif // HEADTOHEAD_H
@@ -0,0 +1,64 @@
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include "user.h"
+
+// Cold storage for game histories.
+//
+// Users are loaded with their counters only and remember where their history
+// lives. The first getGameHistory() pages it in through this store, which
+// keeps the most recently used histories in a bounded LRU cache, so memory
+// follows the users that are actually looked at rather than every registered
+// one.
+class HistoryStore {
+public:
+    explicit HistoryStore(int cacheSize = DEFAULT_CACHE_SIZE);
+    virtual ~HistoryStore();
+
+    // History of one user, from the cache or from disk
+    QVector<GameRecord> history(const QString &username, qint64 key);
+
+    int cachedCount() const;
+    int cacheSize() const;
+
+    static const int DEFAULT_CACHE_SIZE = 1024; // Users
+
+protected:
+    // Reads a history from disk; key is whatever the backend stored with the user
+    virtual QVector<GameRecord> fetch(const QString &username, qint64 key) = 0;
+
+    // Held through every lookup
+    mutable QMutex m_mutex;
+
+private:
+    QCache<QString, QVector<GameRecord>> m_cache;
+};
+
+// Histories inside a tictactoe.json file or its journal, keyed by the offset
+// of the user's record
+class JsonHistoryStore : public HistoryStore {
+public:
+    explicit JsonHistoryStore(const QString &path, int cacheSize = DEFAULT_CACHE_SIZE);
+
+    // A full save moves every record, and the journal goes away. Lookups wait
+    // from beginMove() until finishMove() says which file the records are in
+    // now and where each user's starts; cancelMove() leaves them where they were
+    void beginMove();
+    void finishMove(const QString &path, const QHash<QString, qint64> &offsets);
+    void cancelMove();
+
+protected:
+    QVector<GameRecord> fetch(const QString &username, qint64 key) override;
+
+private:
+    QString m_path;
+    bool m_moved;
+    QHash<QString, qint64> m_movedOffsets; // Stand in for the users' keys once moved
+};
+
+#endif // HISTORYSTORE_H
@@ -0,0 +1,83 @@
+#ifndef JSONUSERSTREAM_H
+#define JSONUSERSTREAM_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include "user.h"
+
+// Incremental reader for the tictactoe.json user array.
+//
+// The top-level array is tokenized by hand, one buffered chunk at a time,
+// and only a single user object is handed to QJsonDocument at once. Memory
+// stays at one read chunk plus the largest user record, whatever the size of
+// the file. With setSkipHistory() the history section of each compact record
+// is jumped over rather than tokenized and parsed.
+class JsonUserReader {
+public:
+    // With insideArray the device must already sit on a record boundary
+    // inside the array, e.g. at an offset taken from a shard index
+    explicit JsonUserReader(QIODevice *device, bool insideArray = false);
+
+    // Records come back with their counters only, for loaders that page
+    // histories in later. Older files without a history section are read whole.
+    void setSkipHistory(bool skip);
+
+    // Next user object of the array, false at the end of the array or on error
+    bool readNext(QJsonObject *userObj);
+
+    bool hasError() const;
+    QString errorString() const;
+    qint64 recordsRead() const;
+    // Device offset of the '{' that opened the record last returned
+    qint64 lastRecordOffset() const;
+
+private:
+    bool fail(const QString &message);
+
+    static const int CHUNK_SIZE = 1024 * 1024;
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    qint64 m_bufferOffset; // Device offset of m_buffer[0]
+    qint64 m_lastRecordOffset;
+    int m_scanPos;      // Next byte to look at
+    int m_recordStart;  // Start of the object being scanned
+    int m_depth;        // Nesting inside the current user object
+    int m_historyStart; // Start of the history section being skipped, or -1
+    bool m_skipHistory;
+    bool m_inArray;
+    bool m_inString;
+    bool m_escape;
+    bool m_finished;
+    QString m_error;
+    qint64 m_recordsRead;
+};
+
+// Writes users as a tictactoe.json array, one compact record per line,
+// without building the whole document first. With a shard size it also notes
+// where every shardSize-th record starts, for a shard index.
+class JsonUserWriter {
+public:
+    explicit JsonUserWriter(QIODevice *device, int shardSize = 0);
+
+    bool begin();
+    bool write(const User &user);
+    bool finish();
+
+    QVector<qint64> shardOffsets() const;
+    // Device offset of the '{' that opened the record last written
+    qint64 lastRecordOffset() const;
+
+private:
+    QIODevice *m_device;
+    qint64 m_lastRecordOffset;
+    bool m_first;
+    int m_shardSize;
+    qint64 m_written;
+    QVector<qint64> m_shardOffsets;
+};
+
+#endif // JSONUSERSTREAM_H
@@ -16,35 +16,97 @@
 #include <QStyledItemDelegate>
 #include <QPainter>
 #include <QDialog>
+#include <QSlider>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
 
 #include "authentication.h"
 #include "gamelogic.h"
 #include "gamehistory.h"
 #include "aiopponent.h"
 #include "database.h"
+#include "databasewriter.h"
+#include "effectpool.h"
+#include "replaytimeline.h"
+#include "moveanalyzer.h"
+#include "blunderanalysis.h"
+#include "openingbook.h"
+#include "gameclient.h"
+
+// Win probability for X after each ply of a replay, with the shown ply
+// marked; clicking a point jumps to it
+class EvaluationGraph : public QWidget {
+    Q_OBJECT
+public:
+    EvaluationGraph(QWidget* parent = nullptr);
+    void setTimeline(const ReplayTimeline* timeline);
+    // One per move; anything short of the best move gets a marker
+    void setMoveQualities(const QVector<MoveAnalyzer::MoveQuality>& qualities);
+    void setCurrentPly(int ply);
+
+signals:
+    void plySelected(int ply);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+
+private:
+    QRectF plotArea() const;
+    QPointF pointFor(int ply) const;
+
+    const ReplayTimeline* m_timeline = nullptr;
+    QVector<MoveAnalyzer::MoveQuality> m_qualities;
+    int m_currentPly = 0;
+};
 
 // Custom dialog for game replay
 class ReplayDialog : public QDialog {
     Q_OBJECT
 public:
-    ReplayDialog(QWidget* parent = nullptr);
+    // Glow frames come from effects when given, so dialogs opened one after
+    // another share them
+    ReplayDialog(QWidget* parent = nullptr, EffectPool* effects = nullptr);
     void setGameData(const QString& date, const QString& players, 
                     const QString& result, const QString& duration);
     
     // New method to set the move data for replay
     void setMoveData(const QVector<GameMove>& moves);
 
+    // Shows the board after the given move, clamped to the game; any move
+    // is shown in constant time
+    void seek(int move);
+    int currentMove() const { return m_currentMove; }
+    const ReplayTimeline& timeline() const { return m_timeline; }
+    // How each move compares with the best one; index 0 is the first move
+    const QVector<MoveAnalyzer::MoveQuality>& moveQualities() const { return m_moveQualities; }
+    bool isPlaying() const { return m_playbackTimer->isActive(); }
+
 private slots:
     void onPreviousClicked();
     void onNextClicked();
     void onPlayClicked();
+    void onReverseClicked();
     void onPauseClicked();
+    void onPlaybackTimeout();
+    void onGlowTimeout();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
 
 private:
+    static const int GLOW_RADIUS = 10;
+    static const int GLOW_BLUR = 12;
+    static const int GLOW_FRAMES = 16; // One way through the pulse
+    static const int PLAYBACK_INTERVAL = 1000; // Milliseconds between moves
+
     void setupUI();
     void updateMoveCounter();
     void updateBoard();
     void updateButtonStates();
+    void startPlayback(int step);
     
     QLabel* m_dateLabel;
     QLabel* m_playersLabel;
@@ -56,13 +118,24 @@ private:
     QPushButton* m_previousBtn;
     QPushButton* m_nextBtn;
     QPushButton* m_playBtn;
+    QPushButton* m_reverseBtn;
     QPushButton* m_pauseBtn;
     QPushButton* m_closeBtn;
+    QSlider* m_scrubber;
+    EvaluationGraph* m_evaluationGraph;
     
     int m_currentMove;
     int m_totalMoves;
+    int m_shownMove = 0;    // Move the cells currently show
+    int m_playbackStep = 1; // -1 while playing in reverse
     QTimer* m_playbackTimer;
-    QVector<GameMove> m_moves; // Store the moves for replay
+    ReplayTimeline m_timeline; // Board and evaluation after every move
+    QVector<MoveAnalyzer::MoveQuality> m_moveQualities;
+
+    QVector<QPixmap> m_glowFrames;
+    QTimer* m_glowTimer;
+    int m_glowFrame = 0;
+    int m_glowStep = 1;
 };
 
 // Custom delegate for leaderboard items
@@ -97,10 +170,23 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Builds every screen that has not been visited yet. Startup only builds
+    // mode selection; this is for callers that would rather pay up front
+    void preloadScreens();
+    // Users are read on the writer thread; signing in waits for them
+    bool usersLoaded() const;
+
+    // Two-player games are then hosted by the game server at host:port,
+    // which decides every move and archives the result
+    void connectToServer(const QString &host, quint16 port);
+
 private slots:
     void onCellClicked();
     void onNewGameClicked();
     void onSaveGameClicked();
+    void onHintClicked();
+    void onAnalysisReady(const MoveAnalyzer::Analysis &analysis);
+    void onUsersLoaded();
     void onExitGameClicked();
     void onVsAIClicked();
     void onVsPlayerClicked();
@@ -116,34 +202,50 @@ private slots:
     void onPlayerChanged(GameLogic::Player player);
     void onBoardChanged();
     void onReplayButtonClicked(int index);
+    void onRemoteGameOpened(quint32 session);
+    void onRemoteMoved(quint32 session, int cellIndex);
+    void onRemoteMoveRejected(quint32 session);
 
 private:
     enum class Screen { ModeSelection, PlayerAuth, Game, Statistics };
     enum class GameMode { None, AI, Player };
 
+    static const int LEADERBOARD_SIZE = 100; // Players shown on the leaderboard
+    static const int OPENINGS_SHOWN = 3;     // First moves listed, and replies to each
+
     void setupUI();
-    void setupConnections();
+    void setupModeSelectionScreen();
+    void setupPlayerAuthScreen();
     void setupGameBoard();
     void setupStyleSheet();
     void setupStatisticsView();
+    void setupLoadingOverlay();
+    // Screens are built the first time they are shown
+    void ensureScreen(Screen screen);
+    void applyScreenStyle(QWidget *screen, const QString &name);
+    void clearHint();
     void setupTitleAnimation(QLabel* titleLabel);
     void showScreen(Screen screen);
     void updateGameStatus(const QString &message);
     void updatePlayerInfo();
     void updateStatistics();
+    // Reads the --analyze summary on m_summaryLoader if it has changed
+    void reloadBlunderSummary();
     void populateLeaderboard();
+    void populateOpenings();
     void highlightWinningCells();
     void addGameToHistory(const QString &result);
+    void archiveGame(GameLogic::GameResult result);
     void resetGame();
     void showLoading(int duration = 800);
 
     QStackedWidget *m_stackedWidget;
 
-    // Screens
-    QWidget *m_modeSelectionScreen;
-    QWidget *m_playerAuthScreen;
-    QWidget *m_gameScreen;
-    QWidget *m_statisticsView;
+    // Screens; null until first shown
+    QWidget *m_modeSelectionScreen = nullptr;
+    QWidget *m_playerAuthScreen = nullptr;
+    QWidget *m_gameScreen = nullptr;
+    QWidget *m_statisticsView = nullptr;
 
     // Mode Selection Screen
     QPushButton *m_vsAIBtn;
@@ -168,6 +270,7 @@ private:
     QLabel *m_statusMessage;
     QPushButton *m_newGameBtn;
     QPushButton *m_saveGameBtn;
+    QPushButton *m_hintBtn;
     QPushButton *m_exitGameBtn;
     QWidget *m_difficultyContainer;
     QPushButton *m_easyBtn;
@@ -189,26 +292,48 @@ private:
     QLabel *m_statVsPlayers;
     QLabel *m_statWinRate;
     QLabel *m_statBestStreak;
+    QLabel *m_statLastWeek;
+    QLabel *m_statLastGames;
+    QLabel *m_statMistakeRate;
+    QLabel *m_statBlunders;
     QListWidget *m_leaderboardList;
+    QListWidget *m_openingsList;
     QListWidget *m_fullHistoryList;
-    QPushButton *m_toggleStatsViewBtn;
-    QPushButton *m_backToGameBtn;
+    QPushButton *m_toggleStatsViewBtn = nullptr;
+    QPushButton *m_backToGameBtn = nullptr;
     LeaderboardItemDelegate *m_leaderboardDelegate = nullptr;
     HistoryItemDelegate *m_historyItemDelegate = nullptr;
     
-    // Loading Overlay
-    QWidget *m_loadingOverlay;
-    QLabel *m_loadingSpinner;
+    // Loading Overlay, built on first use
+    QWidget *m_loadingOverlay = nullptr;
+    QLabel *m_loadingSpinner = nullptr;
+    QTimer *m_loadingTimer = nullptr; // Starts the fade out
+    EffectPool *m_effects;
 
     // Game state
     Authentication *m_auth;
     GameLogic *m_gameLogic;
     GameHistory *m_gameHistory;
     AIOpponent *m_aiOpponent;
+    OpeningBook m_openingBook;      // Written by --analyze
+    MoveAnalyzer *m_moveAnalyzer;
+    quint16 m_hintCells = 0;        // Cells highlighted by the last hint
+    BlunderSummary m_blunderSummary;        // Written by --analyze
+    qint64 m_blunderSummaryModified = -1;   // Of the file last loaded
+    QFileSystemWatcher *m_summaryWatcher;
+    QThreadPool m_summaryLoader;
     Database *m_database;
+    DatabaseWriter *m_databaseWriter;
+    bool m_usersLoaded = false;
     GameMode m_gameMode;
     QString m_player1User;
     QString m_player2User;
+
+    // Game server, when connected
+    GameClient *m_gameClient = nullptr;
+    bool m_remoteGame = false;      // The current game is played on the server
+    quint32 m_remoteSession = 0;    // 0 until the server has opened it
+    int m_remoteOpens = 0;          // Opens the server has yet to answer
 };
 
 #endif // MAINWINDOW_H
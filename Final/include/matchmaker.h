@@ -0,0 +1,88 @@
+#ifndef MATCHMAKER_H
+#define MATCHMAKER_H
+
+#include <QHash>
+#include <QVector>
+#include <QtGlobal>
+
+// Pairs waiting players by rating.
+//
+// Waiting players sit in buckets of bucketWidth rating points, each a queue
+// in the order they arrived. A player's search window starts at
+// initialWindow and widens the longer they wait, up to maxWindow; two
+// players can be paired once their ratings are within the window of
+// whichever has waited longer.
+//
+// A search only looks at the front of each bucket within maxWindow, the
+// player there having waited longest, and the closest of those fronts wins,
+// so a pairing is at most a bucket width from the closest rating in reach.
+// However many players crowd into a few buckets, enqueue looks at a fixed
+// number of buckets (2 * maxWindow / bucketWidth + 1) and cancel unlinks one
+// ticket found through a hash. poll() sorts the waiting players by age and
+// searches once for each, O(n log n).
+class Matchmaker {
+public:
+    struct Options {
+        int bucketWidth = 25;       // Rating points per bucket
+        int initialWindow = 50;     // Difference accepted straight away
+        int windowGrowth = 50;      // Added per second of waiting
+        int maxWindow = 400;
+    };
+
+    struct Match {
+        quint32 first = 0;          // The one who waited longer
+        quint32 second = 0;
+        qint64 firstWaitMs = 0;
+        qint64 secondWaitMs = 0;
+        int ratingGap = 0;
+    };
+
+    Matchmaker();
+    explicit Matchmaker(const Options &options);
+
+    const Options &options() const { return m_options; }
+
+    // Pairs the player with the closest rating in reach and returns true, or
+    // queues them. A player already waiting is left as they are.
+    bool enqueue(quint32 player, int rating, qint64 now, Match *match);
+    // Takes a waiting player out of the queue
+    bool cancel(quint32 player);
+    bool isWaiting(quint32 player) const { return m_tickets.contains(player); }
+    int waitingCount() const { return m_tickets.size(); }
+
+    // Pairs the players whose windows have widened enough to reach someone.
+    // Meant to run a few times a second; it walks every waiting player.
+    QVector<Match> poll(qint64 now);
+
+    // Search window after waiting this long
+    int window(qint64 waitedMs) const;
+
+private:
+    // Ends a bucket's queue; never a player id
+    static constexpr quint32 NOBODY = 0xFFFFFFFFu;
+
+    struct Ticket {
+        quint32 player = NOBODY;
+        int rating = 0;
+        qint64 queuedAt = 0;
+        quint32 older = NOBODY;     // Neighbours in the bucket's queue
+        quint32 newer = NOBODY;
+    };
+
+    struct Bucket {
+        quint32 oldest = NOBODY;
+        quint32 newest = NOBODY;
+    };
+
+    int bucketOf(int rating) const;
+    // Closest bucket front the ticket can be paired with, skipping itself
+    bool findPartner(const Ticket &ticket, qint64 now, Ticket *partner) const;
+    void remove(quint32 player);
+    Match makeMatch(const Ticket &a, const Ticket &b, qint64 now) const;
+
+    Options m_options;
+    QHash<int, Bucket> m_buckets;       // Non-empty buckets
+    QHash<quint32, Ticket> m_tickets;   // Waiting player -> ticket
+};
+
+#endif // MATCHMAKER_H
@@ -0,0 +1,81 @@
+#ifndef MOVEANALYZER_H
+#define MOVEANALYZER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include "gamelogic.h"
+#include "replaytimeline.h"
+
+// Perfect-play values of every legal move, for hints and for grading the
+// moves of a finished game.
+//
+// Values use ReplayTimeline's scale: WIN_SCORE minus the plies to a forced
+// win, the negative of that for a forced loss, 0 for a draw. Positions are
+// cached under their canonical form, the smallest of the board's eight
+// rotations and reflections, so symmetric positions share one entry and the
+// whole game fits in under a thousand. The cache is shared by every caller
+// and thread; once a position is in it, analysing it is a handful of lookups.
+class MoveAnalyzer : public QObject {
+    Q_OBJECT
+
+public:
+    enum class Outcome { Loss, Draw, Win };     // For the player making the move
+
+    enum class MoveQuality {
+        Best,           // As good as any move
+        Inaccuracy,     // Same result, but a slower win or a quicker loss
+        Mistake,        // Turns a win into a draw or a draw into a loss
+        Blunder,        // Turns a win into a loss
+        Illegal         // Occupied cell, or the game was already over
+    };
+
+    struct MoveScore {
+        int cell = -1;
+        int value = 0;          // From the mover's side
+        int distance = 0;       // Plies until the game ends with best play, this move included
+        Outcome outcome() const;
+    };
+
+    struct Analysis {
+        BoardSnapshot board;
+        GameLogic::Player toMove = GameLogic::Player::None;    // None once the game is over
+        QVector<MoveScore> moves;   // Every legal move, best first
+        // Value of the position for the player to move
+        int value() const { return moves.isEmpty() ? 0 : moves.first().value; }
+        // Every move as good as the best one
+        QVector<int> bestMoves() const;
+        const MoveScore *find(int cell) const;
+    };
+
+    explicit MoveAnalyzer(QObject *parent = nullptr);
+    ~MoveAnalyzer();
+
+    static Analysis analyze(const BoardSnapshot &board);
+    // The position's value from X's side
+    static int evaluate(const BoardSnapshot &board);
+    static MoveQuality grade(const BoardSnapshot &before, int cell);
+    static BoardSnapshot snapshotOf(const GameLogic &logic);
+
+    // Canonical positions worked out so far
+    static int cachedPositions();
+    static quint32 canonicalKey(quint16 x, quint16 o);
+    // Which of the eight symmetries turns the board into its canonical form,
+    // and where a cell goes under it
+    static int canonicalSymmetry(quint16 x, quint16 o);
+    static int transformCell(int symmetry, int cell);
+
+    // Analyses on a worker thread; analysisReady follows on this object's
+    // thread. Requests are answered in order.
+    void requestAnalysis(const BoardSnapshot &board);
+
+signals:
+    void analysisReady(const MoveAnalyzer::Analysis &analysis);
+
+private:
+    QThreadPool m_pool;
+};
+
+Q_DECLARE_METATYPE(MoveAnalyzer::Analysis)
+
+#endif // MOVEANALYZER_H
@@ -0,0 +1,28 @@
+#ifndef MOVECODEC_H
+#define MOVECODEC_H
+
+#include <QVector>
+#include <QtGlobal>
+#include "user.h"
+
+// Packs a whole game's move list into one 64-bit word.
+//
+// Layout (low bits first):
+//   bits 0-3    number of moves (0-9)
+//   bits 4-39   cell index of move i in bits 4+4i .. 7+4i
+//   bit 40      set when O made the first move
+// Players alternate, so only the first mover needs storing. A packed value of
+// 0 means "no moves recorded", which is what legacy records decode to.
+class MoveCodec {
+public:
+    static quint64 pack(const QVector<GameMoveRecord> &moves);
+    static QVector<GameMoveRecord> unpack(quint64 packed);
+    static int length(quint64 packed);
+    // Adds one move to a packed game; the first move records who started.
+    // A full game is returned unchanged.
+    static quint64 append(quint64 packed, int cellIndex, int player);
+
+    static constexpr int MAX_MOVES = 9;
+};
+
+#endif // MOVECODEC_H
@@ -0,0 +1,61 @@
+#ifndef OPENINGBOOK_H
+#define OPENINGBOOK_H
+
+#include <QFile>
+#include <QString>
+#include "replaytimeline.h"
+
+class GameArchive;
+class QRandomGenerator;
+
+// The moves people play in the opening, learned from the game archive.
+//
+// For every position of the first BOOK_PLIES plies the book counts how often
+// human players chose each cell; the computer's own moves are left out.
+// Positions are stored under MoveAnalyzer's canonical form, so a corner
+// opening teaches the book about all four corners.
+//
+// The file is a 16-byte header followed by fixed 24-byte entries sorted by
+// position: the canonical key, then a 16-bit count for each cell in the
+// canonical orientation, little-endian. It is read through a memory map and
+// never changes once open, so a lookup is a binary search over mapped memory
+// that takes no lock and allocates nothing, and any number of games on any
+// number of threads can share one book.
+class OpeningBook {
+public:
+    OpeningBook() = default;
+    ~OpeningBook();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_entries != nullptr; }
+    int positionCount() const { return m_count; }
+
+    // How often each cell was played, for a board with the first mover's
+    // marks as x. False when the book has not seen the position.
+    bool lookup(const BoardSnapshot &board, quint32 counts[9]) const;
+    // A cell drawn with the players' frequencies, -1 when the position was
+    // played fewer than MIN_GAMES times
+    int pickMove(const BoardSnapshot &board, QRandomGenerator *random) const;
+
+    // Streams the archive a page at a time and writes the book to path
+    static bool build(GameArchive *archive, const QString &path);
+    static QString bookPath(const QString &archivePath);
+
+    static const int BOOK_PLIES = 6;    // Positions before the first six moves
+    static const int MIN_GAMES = 5;
+    static const int HEADER_SIZE = 16;
+    static const int ENTRY_SIZE = 24;
+
+private:
+    const uchar *findEntry(quint32 key) const;
+
+    static const quint32 MAGIC = 0x54544f42; // "TTOB"
+    static const quint32 VERSION = 1;
+
+    QFile m_file;
+    const uchar *m_entries = nullptr;
+    int m_count = 0;
+};
+
+#endif // OPENINGBOOK_H
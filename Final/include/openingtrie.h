@@ -0,0 +1,74 @@
+#ifndef OPENINGTRIE_H
+#define OPENINGTRIE_H
+
+#include <QVector>
+#include "gamelogic.h"
+#include "replaytimeline.h"
+
+// A game as the opening trie sees it
+struct OpeningGame {
+    quint64 packedMoves;    // MoveCodec format
+    GameLogic::GameResult result;
+};
+
+// How every opening has been played and how it went, over the first few
+// plies of each game.
+//
+// A node is the position a sequence of opening moves leads to, keyed by
+// MoveAnalyzer::canonicalKey, so openings that are rotations or reflections
+// of each other share a path. Counts are from the side of the player who
+// moved first. Nodes sit in one array and reach their children through
+// first-child and next-sibling links; no node has more than nine children
+// and the trie is only a few plies deep, so a prefix or top-K query walks a
+// few dozen nodes.
+//
+// Games are added one at a time as they finish. build() replaces the trie
+// with one over a whole game log: each worker builds a trie of its share and
+// the parts are merged.
+class OpeningTrie {
+public:
+    struct Node {
+        quint32 position = 0;   // Canonical, the first mover's marks as x
+        quint32 wins = 0;       // For the player who moved first
+        quint32 draws = 0;
+        quint32 losses = 0;
+        qint32 firstChild = -1;
+        qint32 nextSibling = -1;
+        int ply = 0;
+
+        quint32 games() const { return wins + draws + losses; }
+        BoardSnapshot board() const;
+    };
+
+    explicit OpeningTrie(int depth = DEFAULT_DEPTH);
+
+    // Plies kept of every game
+    int depth() const;
+    // Games without recorded moves are left out
+    void add(quint64 packedMoves, GameLogic::GameResult result);
+    void build(const QVector<OpeningGame> &games);
+    void clear();
+
+    const Node &node(int index) const { return m_nodes.at(index); }
+    int nodeCount() const;
+    // Where the moves lead, first mover first; -1 if no game opened that way
+    int find(const QVector<int> &cells) const;
+    // The k most played continuations, most played first
+    QVector<int> topChildren(int node, int k) const;
+
+    static const int ROOT = 0;              // The empty board, counting every game
+    static const int DEFAULT_DEPTH = 4;
+    // Logs shorter than this are built on the calling thread
+    static const int PARALLEL_BUILD_SIZE = 16384;
+
+private:
+    int child(int node, quint32 position) const;
+    int addChild(int node, quint32 position);
+    void count(int node, int outcome);
+    void merge(int into, const OpeningTrie &other, int from);
+
+    int m_depth;
+    QVector<Node> m_nodes;
+};
+
+#endif // OPENINGTRIE_H
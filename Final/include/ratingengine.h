@@ -0,0 +1,66 @@
+#ifndef RATINGENGINE_H
+#define RATINGENGINE_H
+
+#include <QVector>
+#include "gamelogic.h"
+
+// A game as the rating engine sees it
+struct RatedGame {
+    quint32 playerX;
+    quint32 playerO;        // Ignored for games against the AI
+    GameLogic::GameResult result;
+    quint8 aiDifficulty;    // 0 for two-player games, 1 (easy) to 4 (expert) otherwise
+};
+
+// Elo ratings for every player id.
+//
+// Ratings and game counts sit in flat arrays indexed by player id. Games are
+// applied one at a time as they are played; recompute() replays a whole game
+// log, e.g. after the parameters changed. The AI levels have fixed ratings.
+//
+// The replay has to follow time order, since every game depends on the
+// ratings its players had at that moment. Games are grouped into waves
+// instead: a game goes one wave after the last earlier game of either of its
+// players. Games within a wave share no player, so each wave is rated in
+// parallel and the result is exactly that of a sequential replay.
+class RatingEngine {
+public:
+    struct Parameters {
+        double initialRating = 1200.0;
+        double kFactor = 24.0;
+        double provisionalKFactor = 40.0;   // While a player is still new
+        int provisionalGames = 10;
+        double aiRatings[5] = {0.0, 800.0, 1200.0, 1600.0, 2000.0}; // By difficulty
+    };
+
+    RatingEngine();
+    explicit RatingEngine(const Parameters &parameters);
+
+    const Parameters &parameters() const;
+    // Takes effect for games applied from now on; recompute() to re-rate the past
+    void setParameters(const Parameters &parameters);
+
+    void apply(const RatedGame &game);
+    // Replaces every rating with a replay of the given games, oldest first
+    void recompute(const QVector<RatedGame> &games);
+
+    double rating(quint32 player) const;
+    int gamesRated(quint32 player) const;
+    int playerCount() const;
+
+    // Expected score of a player against an opponent, 0 to 1
+    static double expectedScore(double rating, double opponentRating);
+
+    // Waves smaller than this are not worth handing to the thread pool
+    static const int PARALLEL_WAVE_SIZE = 2048;
+
+private:
+    void ensurePlayer(quint32 player);
+    void rate(const RatedGame &game, double *ratings, int *games) const;
+
+    Parameters m_parameters;
+    QVector<double> m_ratings;  // By player id
+    QVector<int> m_games;
+};
+
+#endif // RATINGENGINE_H
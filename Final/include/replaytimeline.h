@@ -0,0 +1,59 @@
+#ifndef REPLAYTIMELINE_H
+#define REPLAYTIMELINE_H
+
+#include <QVector>
+#include "gamelogic.h"
+
+// One position as two bitboards, bit i set when cell i holds that mark
+struct BoardSnapshot {
+    quint16 x = 0;
+    quint16 o = 0;
+
+    GameLogic::Player cell(int index) const;
+    // The player with three in a row, None if neither has one
+    GameLogic::Player winner() const;
+    bool isFull() const { return (x | o) == 0x1FF; }
+};
+
+// Every position of a replayed game, worked out once when the moves are set.
+//
+// at() returns the board after any ply without replaying the moves before
+// it, and changedCells() tells a view which cells differ between the ply it
+// shows and the one it seeks to. Each ply also carries the engine's
+// evaluation: the perfect-play result, sooner wins counting for more, as
+// MoveAnalyzer works it out.
+class ReplayTimeline {
+public:
+    ReplayTimeline() = default;
+
+    // Moves that name an occupied or out-of-range cell leave the board as it
+    // was, but still count as a ply
+    void setMoves(const QVector<GameMove> &moves);
+
+    // Plies in the game; positions run from 0 (empty board) to plyCount()
+    int plyCount() const { return m_snapshots.size() - 1; }
+    // Clamped to the valid range
+    BoardSnapshot at(int ply) const;
+    quint16 changedCells(int fromPly, int toPly) const;
+
+    // From X's side: WIN_SCORE minus the plies to a forced win, the negative
+    // of that for O, 0 for a draw
+    int evaluation(int ply) const;
+    // evaluation() mapped onto 0..1, 0.5 being a draw
+    double winProbability(int ply) const;
+
+    static constexpr int WIN_SCORE = 10;
+
+    // Whether O made the first of these moves
+    static bool isOFirst(const QVector<GameMove> &moves);
+    // The board with the first mover's marks in x, as MoveAnalyzer reads it
+    static BoardSnapshot firstMoverBoard(const BoardSnapshot &board, bool oFirst);
+
+private:
+    int clampPly(int ply) const;
+
+    QVector<BoardSnapshot> m_snapshots{BoardSnapshot()};
+    QVector<qint8> m_evaluations{0};    // Looked up in MoveAnalyzer's cache
+};
+
+#endif // REPLAYTIMELINE_H
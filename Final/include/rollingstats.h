@@ -0,0 +1,57 @@
+#ifndef ROLLINGSTATS_H
+#define ROLLINGSTATS_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QtGlobal>
+
+// Results over a window of recent games or days
+struct WindowStats {
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+
+    int games() const { return wins + losses + draws; }
+    int winRate() const { return games() > 0 ? wins * 100 / games() : 0; }
+};
+
+// Sliding-window counters, updated as games are played.
+//
+// The last RESULT_CAPACITY results are two 64-bit planes, wins and losses,
+// shifted by one bit per game; a draw sets neither. Any "last N games" is a
+// mask and two popcounts. Day windows use a ring of DAY_CAPACITY per-day
+// counters, each tagged with its day so stale slots drop out on their own.
+// Neither query looks at the game history.
+class RollingStats {
+public:
+    RollingStats();
+
+    // result is "win", "loss" or "draw", like User::addGame; day is a Julian day
+    void record(const QString &result, qint64 day);
+
+    // N is capped at RESULT_CAPACITY
+    WindowStats lastGames(int count) const;
+    // The given number of days up to and including today, capped at DAY_CAPACITY
+    WindowStats lastDays(int days, qint64 today) const;
+
+    QJsonObject toJson() const;
+    static RollingStats fromJson(const QJsonObject &json);
+
+    static constexpr int RESULT_CAPACITY = 64;
+    static constexpr int DAY_CAPACITY = 8;
+
+private:
+    struct DayBucket {
+        qint32 day = -1;
+        quint16 wins = 0;
+        quint16 losses = 0;
+        quint16 draws = 0;
+    };
+
+    quint64 m_winBits;    // Bit 0 is the latest game
+    quint64 m_lossBits;
+    quint8 m_resultCount; // Valid bits, up to RESULT_CAPACITY
+    DayBucket m_days[DAY_CAPACITY];
+};
+
+#endif // ROLLINGSTATS_H
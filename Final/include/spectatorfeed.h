@@ -0,0 +1,91 @@
+#ifndef SPECTATORFEED_H
+#define SPECTATORFEED_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QVector>
+#include "gamelogic.h"
+#include "replaytimeline.h"
+
+// Fans one game's moves out to any number of spectators.
+//
+// Every move is encoded once, as a GameProtocol Moved frame, and that same
+// QByteArray is handed to every spectator: the bytes are shared by reference
+// count and never written to again, so a move costs one encoding however many
+// are watching. A spectator that cannot keep up says so by refusing a frame;
+// it is skipped from then on and, once resumed, gets a single Board frame with
+// the latest position instead of every move it missed. That frame is built
+// once per position and shared the same way.
+class SpectatorFeed : public QObject {
+    Q_OBJECT
+
+public:
+    class Spectator {
+    public:
+        virtual ~Spectator() = default;
+        // Takes a frame, or returns false when backed up. A refused frame is
+        // not retried; the spectator gets the whole board on resume() instead.
+        virtual bool deliver(const QByteArray &frame) = 0;
+    };
+
+    struct Metrics {
+        int spectators = 0;
+        int behind = 0;                 // Waiting for resume()
+        qint64 framesPublished = 0;     // Encoded, once each
+        qint64 framesDelivered = 0;     // Handed to spectators
+        qint64 framesCoalesced = 0;     // Skipped for spectators that were behind
+        qint64 boardsSent = 0;
+    };
+
+    // session goes in the frames' header
+    explicit SpectatorFeed(quint32 session = 0, QObject *parent = nullptr);
+
+    quint32 session() const { return m_session; }
+
+    // Publishes the moves logic adds from now on, its result, and a fresh
+    // board whenever the history is cleared
+    void follow(GameLogic *logic);
+
+    // The spectator gets the board as it is, then every change after it
+    void subscribe(Spectator *spectator);
+    void unsubscribe(Spectator *spectator);
+    // A spectator that was behind can take frames again
+    void resume(Spectator *spectator);
+    bool isBehind(Spectator *spectator) const;
+
+    void publish(const GameMove &move);
+    void finish(GameLogic::GameResult result);
+    // Starts over from the given board, e.g. a game already in progress
+    void reset(const BoardSnapshot &board = BoardSnapshot());
+
+    const BoardSnapshot &board() const { return m_board; }
+    GameLogic::GameResult result() const { return m_result; }
+    const Metrics &metrics() const { return m_metrics; }
+
+private:
+    struct Subscriber {
+        Spectator *spectator;
+        bool behind;
+    };
+
+    void syncWithLogic();
+    void broadcast(const QByteArray &frame);
+    bool sendBoard(Subscriber &subscriber);
+    // The Board frame for the current position, plus GameOver once finished
+    const QByteArray &boardFrame();
+
+    quint32 m_session;
+    GameLogic *m_logic;
+    int m_published;                    // Moves of m_logic's history already sent
+
+    BoardSnapshot m_board;
+    GameLogic::GameResult m_result;
+    QByteArray m_boardFrame;            // Empty when out of date
+
+    QVector<Subscriber> m_subscribers;
+    QHash<Spectator*, int> m_index;     // Into m_subscribers
+    Metrics m_metrics;
+};
+
+#endif // SPECTATORFEED_H
@@ -0,0 +1,56 @@
+#ifndef SQLITESTORE_H
+#define SQLITESTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QEnableSharedFromThis>
+#include "database.h"
+#include "historystore.h"
+#include "user.h"
+
+// SQLite storage behind Database, on Qt SQL's bundled driver.
+//
+// Users, games and moves live in normalized tables. The connection runs in
+// WAL mode so the GUI can read while the writer thread commits. A connection
+// belongs to the thread that first uses the store, and its prepared
+// statements are cached for as long as it stays open.
+//
+// Users load from the users table alone; their games are paged in from the
+// games table, keyed by user id, when a history is first asked for.
+class SqliteStore : public HistoryStore, public QEnableSharedFromThis<SqliteStore> {
+public:
+    explicit SqliteStore(const QString &path);
+    ~SqliteStore() override;
+
+    // Upserts the users and their game history in one transaction. With
+    // replaceAll users that are not passed in are removed, like a full JSON
+    // rewrite. Histories still in this database are not rewritten.
+    bool saveUsers(const QVector<User*> &users, bool replaceAll);
+    // Histories are left in the database when the store is owned by a
+    // QSharedPointer, and read straight away otherwise
+    QVector<User*> loadUsers();
+    bool isEmpty();
+
+    // Served by the score index, no users need to be in memory
+    QVector<LeaderboardEntry> topPlayers(int limit);
+
+protected:
+    QVector<GameRecord> fetch(const QString &username, qint64 key) override;
+
+private:
+    bool open();
+    bool addMissingColumns();
+    bool exec(const QString &sql);
+    QSqlQuery &prepared(const QString &sql);
+    bool saveUser(const User &user);
+
+    QString m_path;
+    QString m_connectionName;
+    QSqlDatabase m_db;
+    QHash<QString, QSqlQuery*> m_statements; // Prepared once per connection
+};
+
+#endif // SQLITESTORE_H
@@ -0,0 +1,33 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+class QWidget;
+
+// Times the phases between process start and the first frame on screen.
+//
+// The clock starts while the program's statics are initialized, before
+// main() runs; each mark() records the milliseconds since then. Once the
+// watched window paints for the first time, "first frame" is marked and the
+// phases are logged.
+class StartupProfiler {
+public:
+    static void mark(const QString &phase);
+    static qint64 elapsed();
+
+    // Phases in the order they were marked, with milliseconds since start
+    static QVector<QPair<QString, qint64>> phases();
+    // Milliseconds to the first frame, or -1 before it has been painted
+    static qint64 firstFrame();
+
+    static void watchFirstFrame(QWidget *window);
+
+    // Starts the clock again and forgets the phases; for benchmarks that
+    // bring up more than one window
+    static void restart();
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,58 @@
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+// Process-wide pool of the strings games keep repeating, such as usernames
+// and the opponents in game histories. Nothing is ever freed, so only
+// strings from a bounded set, like the registered names, belong here; a
+// line made up from several of them is built when it is needed instead.
+//
+// Each distinct string is copied once into an arena of fixed-size character
+// blocks and gets a stable 32-bit id; records store the id instead of their
+// own QString. Blocks never move and are never freed while the process runs,
+// so string() hands out QString::fromRawData views without copying.
+// Safe to use from the loader threads.
+class StringInterner {
+public:
+    // 0 is always the empty string
+    static quint32 intern(const QString &string);
+    static QString string(quint32 id);
+
+    // Dates in the "yyyy-MM-dd hh:mm:ss" form used by game histories are
+    // stored as the seconds they spell, which needs no arena space; anything
+    // else is interned
+    static qint64 internDate(const QString &date);
+    static QString dateString(qint64 key);
+
+    static int count();
+    // Bytes held by the arena blocks and the id table
+    static qint64 memoryUsage();
+
+private:
+    StringInterner();
+    ~StringInterner();
+    Q_DISABLE_COPY(StringInterner)
+
+    static StringInterner &instance();
+    // Copies the characters into the arena; caller holds the write lock
+    const QChar *store(const QString &string);
+
+    struct Entry {
+        const QChar *data;
+        int length;
+    };
+
+    static const int BLOCK_CHARS = 64 * 1024;
+
+    mutable QReadWriteLock m_lock;
+    QVector<QChar*> m_blocks;
+    int m_blockUsed;              // Characters used in the last block
+    QVector<Entry> m_entries;     // By id
+    QHash<QString, quint32> m_ids; // Keys are raw views into the arena
+};
+
+#endif // STRINGINTERNER_H
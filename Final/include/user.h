@@ -4,6 +4,11 @@
 #include <QString>
 #include <QVector>
 #include <QDateTime>
+#include <QSharedPointer>
+#include "rollingstats.h"
+
+class HistoryStore;
+class UserStore;
 
 // Structure to record game move information
 struct GameMoveRecord {
@@ -11,10 +16,41 @@ struct GameMoveRecord {
     int player; // 1 for X, 2 for O
 };
 
+// The date is a StringInterner key and the opponent an interned username,
+// so a stored game is a few bytes. The "Win vs AI (hard)" line is built each
+// time it is shown, so the interner only ever holds the names themselves,
+// not one line per outcome, opponent and difficulty.
 struct GameRecord {
-    QString date;
-    QString result;
-    QVector<GameMoveRecord> moves; // Add move history
+    enum class Outcome : quint8 {
+        Draw,
+        Win,
+        Loss
+    };
+
+    qint64 dateKey = -1;     // StringInterner::internDate
+    quint64 packedMoves = 0; // Move history packed by MoveCodec, 0 if none was recorded
+    quint32 opponentId = 0;  // StringInterner::intern of the opponent's username, 0 against the AI
+    Outcome outcome = Outcome::Draw;
+    quint8 difficulty = 0;   // 1 (easy) to 4 (expert) against the AI, 0 for two-player games
+
+    QString date() const;
+    void setDate(const QString &date);
+
+    // In the form addGame* takes: "win", "loss" or "draw"; "ai" or a
+    // username; a difficulty, or empty for two-player games
+    QString outcomeName() const;
+    QString opponent() const;
+    QString difficultyName() const;
+    bool isVsAI() const;
+    void setResult(const QString &outcome, const QString &opponent, const QString &difficulty);
+
+    // The line shown in histories and saved to files, e.g. "Win vs AI (hard)",
+    // and the parser for it
+    QString result() const;
+    void setResult(const QString &result);
+
+    // Decodes the packed move history, only needed when a replay is opened
+    QVector<GameMoveRecord> decodeMoves() const;
 };
 
 class User {
@@ -35,16 +71,57 @@ public:
     int getVsPlayers() const;
     int getWinRate() const;
     int getBestStreak() const;
+    int getCurrentStreak() const;
+    // Results of the latest games and days, without touching the history
+    WindowStats getRecentGames(int count) const;
+    WindowStats getRecentDays(int days, const QDate &today = QDate::currentDate()) const;
+    const RollingStats &rollingStats() const;
+    // Pages the history in from its store the first time it is asked for
     QVector<GameRecord> getGameHistory() const;
+    bool isHistoryLoaded() const;
+    HistoryStore* historyStore() const;
+    // Where the store finds the history, -1 once it is loaded
+    qint64 historyKey() const;
 
     // Update statistics
     void addGame(const QString &result, const QString &opponent, const QString &difficulty = "");
-    void addGameWithDate(const QString &result, const QString &opponent, const QString &date, const QString &difficulty = "");
+    void addGameWithDate(const QString &result, const QString &opponent, const QString &date, const QString &difficulty = "",
+                         quint64 packedMoves = 0);
     
     // New method to add game with move history
     void addGameWithMoves(const QString &result, const QString &opponent, const QVector<GameMoveRecord> &moves, const QString &difficulty = "");
 
+    // Set by every addGame* call (and for new users) until the record is persisted
+    bool isDirty() const;
+    void clearDirty();
+
+    // Used by storage to restore a user without replaying its games
+    void restoreStats(int totalGames, int wins, int losses, int draws, int vsAI, int vsPlayers,
+                      int bestStreak, int currentStreak);
+    void restoreHistory(const QVector<GameRecord> &history);
+    void restoreRollingStats(const RollingStats &stats);
+    // Leaves the history on disk until getGameHistory() or the next game needs it
+    void setHistorySource(const QSharedPointer<HistoryStore> &store, qint64 key);
+    // Set by UserStore::attach; counter changes are then copied into that row
+    void linkStore(UserStore *store, int row);
+
 private:
+    // A copy of a user is not attached to any store row
+    struct StoreLink {
+        UserStore *store = nullptr;
+        int row = -1;
+
+        StoreLink() = default;
+        StoreLink(const StoreLink &) {}
+        StoreLink &operator=(const StoreLink &) { return *this; }
+    };
+
+    void syncStore();
+
+    // Shared bookkeeping behind all addGame* variants
+    void recordGame(const QString &result, const QString &opponent, const QString &difficulty,
+                    const QString &date, quint64 packedMoves);
+
     QString m_username;
     QString m_hashedPassword;  // Changed from m_password to m_hashedPassword
 
@@ -58,7 +135,12 @@ private:
     int m_winRate;
     int m_bestStreak;
     int m_currentStreak;
-    QVector<GameRecord> m_gameHistory;
+    RollingStats m_rollingStats;
+    QVector<GameRecord> m_gameHistory;      // Empty while the history is still in its store
+    QSharedPointer<HistoryStore> m_historyStore;
+    qint64 m_historyKey;
+    bool m_dirty;
+    StoreLink m_storeLink;
 };
 
 #endif // USER_H
@@ -0,0 +1,84 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QChar>
+
+class User;
+
+// Sums over every user in a store
+struct UserTotals {
+    int players = 0;       // Users with at least one game
+    qint64 games = 0;
+    qint64 wins = 0;
+    qint64 losses = 0;
+    qint64 draws = 0;
+    qint64 vsAI = 0;
+    qint64 vsPlayers = 0;
+};
+
+// The counters of every user, one column per counter.
+//
+// Row i of each column belongs to the same user, so a leaderboard pass or a
+// total is a linear sweep over a few int arrays instead of a walk through
+// heap-allocated User objects. Usernames are packed back to back in one
+// character arena and found through an open-addressing table of row numbers.
+//
+// A User attached to a store keeps its row up to date as games are recorded;
+// histories and passwords stay on the User.
+class UserStore {
+public:
+    UserStore();
+
+    // Gives the user a row, reusing the one with the same name if there is one
+    int attach(User *user);
+    // Copies the user's counters into the row
+    void update(int row, const User &user);
+
+    // -1 if no row has that name
+    int indexOf(const QString &username) const;
+    int size() const;
+    void reserve(int users);
+    void clear();
+
+    QString username(int row) const;
+    int totalGames(int row) const;
+    int wins(int row) const;
+    int losses(int row) const;
+    int draws(int row) const;
+    int winRate(int row) const;
+    int bestStreak(int row) const;
+    int currentStreak(int row) const;
+    // Database::calculatePlayerScore, kept current with the counters
+    int score(int row) const;
+
+    UserTotals totals() const;
+    // Rows with at least one game, best score first; limit < 0 keeps them all
+    QVector<int> rankByScore(int limit = -1) const;
+
+    // Bytes held by the columns, the arena and the name table
+    qint64 memoryUsage() const;
+
+private:
+    uint nameHash(const QChar *name, int length) const;
+    bool nameEquals(int row, const QChar *name, int length) const;
+    int findSlot(const QChar *name, int length) const;
+    void growTable();
+
+    QVector<qint32> m_totalGames;
+    QVector<qint32> m_wins;
+    QVector<qint32> m_losses;
+    QVector<qint32> m_draws;
+    QVector<qint32> m_vsAI;
+    QVector<qint32> m_vsPlayers;
+    QVector<qint32> m_bestStreak;
+    QVector<qint32> m_currentStreak;
+    QVector<qint32> m_score;
+
+    QVector<QChar> m_names;        // Every username, back to back
+    QVector<qint32> m_nameOffsets; // Row i's name is [offset i, offset i + 1)
+    QVector<qint32> m_table;       // Row numbers by name hash, -1 when free
+};
+
+#endif // USERSTORE_H
@@ -1,11 +1,14 @@
 #include "../include/aiopponent.h"
+#include "../include/openingbook.h"
 #include <QTimer>
 #include <QRandomGenerator>
 #include <QDebug>
+#include <QtAlgorithms>
+#include <utility>
 using Player = GameLogic::Player;
 
 AIOpponent::AIOpponent(QObject *parent)
-    : QObject(parent), m_gameLogic(nullptr)
+    : QObject(parent), m_gameLogic(nullptr), m_openingBook(nullptr)
 {
 }
 
@@ -13,6 +16,10 @@ void AIOpponent::setGameLogic(GameLogic *gameLogic) {
     m_gameLogic = gameLogic;
 }
 
+void AIOpponent::setOpeningBook(const OpeningBook *book) {
+    m_openingBook = book;
+}
+
 void AIOpponent::makeMove() {
     if (!m_gameLogic) {
         return;
@@ -20,23 +27,20 @@ void AIOpponent::makeMove() {
     
     // Add a slight delay to simulate "thinking"
     QTimer::singleShot(700, this, [this]() {
-        // Get current board state
-        QVector<Player> board;
+        // Get current board state into a preallocated buffer
+        QVector<Player> board(9, Player::None);
+        QString boardState(9, QLatin1Char('-'));
         for (int i = 0; i < 9; ++i) {
-            board.append(m_gameLogic->getCellState(i));
+            board[i] = m_gameLogic->getCellState(i);
+            if (board[i] == Player::X) {
+                boardState[i] = QLatin1Char('X');
+            } else if (board[i] == Player::O) {
+                boardState[i] = QLatin1Char('O');
+            }
         }
         
         // Debug the board state
-        qDebug() << "AI is analyzing board state:";
-        for (int i = 0; i < 9; i++) {
-            QString cell;
-            switch (board[i]) {
-                case Player::X: cell = "X"; break;
-                case Player::O: cell = "O"; break;
-                default: cell = "-"; break;
-            }
-            qDebug() << "Cell" << i << ":" << cell;
-        }
+        qDebug() << "AI is analyzing board state:" << boardState;
         
         // Determine max depth based on difficulty
         int maxDepth;
@@ -76,7 +80,14 @@ void AIOpponent::makeMove() {
 }
 
 // Move ordering: center, corners, edges
-static const QVector<int> moveOrder = {4, 0, 2, 6, 8, 1, 3, 5, 7};
+static constexpr int moveOrder[9] = {4, 0, 2, 6, 8, 1, 3, 5, 7};
+
+// Win patterns live in static storage so evaluating a position never allocates
+static constexpr int kWinPatterns[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8},  // Rows
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8},  // Columns
+    {0, 4, 8}, {2, 4, 6}              // Diagonals
+};
 
 bool AIOpponent::isBoardFull(const QVector<Player>& board) {
     for (const Player& cell : board) {
@@ -121,7 +132,6 @@ int AIOpponent::findBestMove(QVector<Player>& board, int maxDepth) {
             bool isWin = checkWinner(board, Player::O);
             board[i] = Player::None;
             if (isWin) {
-                qDebug() << "AI found winning move at position" << i;
                 return i;
             }
         }
@@ -135,26 +145,33 @@ int AIOpponent::findBestMove(QVector<Player>& board, int maxDepth) {
                 bool isBlock = checkWinner(board, Player::X);
                 board[i] = Player::None;
                 if (isBlock) {
-                    qDebug() << "AI found blocking move at position" << i;
                     return i;
                 }
             }
         }
     }
     
+    // Medium and hard play the book's human moves while it has them
+    const GameLogic::AIDifficulty difficulty = m_gameLogic->getAIDifficulty();
+    if (difficulty == GameLogic::AIDifficulty::Medium || difficulty == GameLogic::AIDifficulty::Hard) {
+        const int move = bookMove(board);
+        if (move >= 0) {
+            return move;
+        }
+    }
+    
     // For easy, always random; for medium, sometimes random
     if (m_gameLogic->getAIDifficulty() == GameLogic::AIDifficulty::Easy || 
         (m_gameLogic->getAIDifficulty() == GameLogic::AIDifficulty::Medium && QRandomGenerator::global()->bounded(100) < 20)) {
-        QVector<int> emptyCells;
+        int emptyCells[9];
+        int emptyCount = 0;
         for (int i = 0; i < 9; ++i) {
             if (board[i] == Player::None) {
-                emptyCells.append(i);
+                emptyCells[emptyCount++] = i;
             }
         }
-        if (!emptyCells.isEmpty()) {
-            int randomMove = emptyCells[QRandomGenerator::global()->bounded(emptyCells.size())];
-            qDebug() << "AI chose random move at position" << randomMove;
-            return randomMove;
+        if (emptyCount > 0) {
+            return emptyCells[QRandomGenerator::global()->bounded(emptyCount)];
         }
     }
     
@@ -173,10 +190,29 @@ int AIOpponent::findBestMove(QVector<Player>& board, int maxDepth) {
         }
     }
     
-    qDebug() << "AI chose strategic move at position" << bestMove << "with score" << bestScore;
     return bestMove;
 }
 
+int AIOpponent::bookMove(const QVector<Player>& board) const {
+    if (!m_openingBook || !m_openingBook->isOpen()) {
+        return -1;
+    }
+    BoardSnapshot snapshot;
+    for (int i = 0; i < 9; ++i) {
+        if (board[i] == Player::X) {
+            snapshot.x |= quint16(1u << i);
+        } else if (board[i] == Player::O) {
+            snapshot.o |= quint16(1u << i);
+        }
+    }
+    // The book keeps the first mover's marks as x; with equal counts that is
+    // the AI, about to move
+    if (qPopulationCount(snapshot.x) == qPopulationCount(snapshot.o)) {
+        std::swap(snapshot.x, snapshot.o);
+    }
+    return m_openingBook->pickMove(snapshot, QRandomGenerator::global());
+}
+
 int AIOpponent::minimax(QVector<Player>& board, int depth, bool isMaximizing, int alpha, int beta, int maxDepth) {
     // Check for terminal states
     if (checkWinner(board, Player::O)) {
@@ -228,17 +264,10 @@ int AIOpponent::minimax(QVector<Player>& board, int depth, bool isMaximizing, in
 }
 
 int AIOpponent::evaluateBoard(const QVector<Player>& board) {
-    // Check rows, columns, and diagonals
-    const QVector<QVector<int>> winPatterns = {
-        {0, 1, 2}, {3, 4, 5}, {6, 7, 8},  // Rows
-        {0, 3, 6}, {1, 4, 7}, {2, 5, 8},  // Columns
-        {0, 4, 8}, {2, 4, 6}              // Diagonals
-    };
-    
     int score = 0;
     
-    // Evaluate each pattern
-    for (const QVector<int>& pattern : winPatterns) {
+    // Evaluate each row, column and diagonal
+    for (const auto& pattern : kWinPatterns) {
         int aiCount = 0;
         int playerCount = 0;
         
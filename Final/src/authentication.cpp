@@ -1,4 +1,8 @@
 #include "../include/authentication.h"
+#include "../include/database.h"
+#include "../include/databasewriter.h"
+#include "../include/gamearchive.h"
+#include <QHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
@@ -7,11 +11,20 @@
 #include <QByteArray>
 
 Authentication::Authentication(QObject *parent)
-    : QObject(parent), m_currentUser(nullptr), m_lastErrorMessage("")
+    : QObject(parent), m_currentUser(nullptr), m_lastErrorMessage(""), m_database(nullptr), m_writer(nullptr),
+      m_loadedModified(-1)
 {
+    addDefaultUsers();
+}
+
+void Authentication::addDefaultUsers() {
     // Add some default users for demo purposes with hashed passwords
     m_users.append(new User("player1", hashPassword("pass123")));
     m_users.append(new User("player2", hashPassword("pass123")));
+    for (User* user : m_users) {
+        m_usersByName.insert(user->getUsername(), user);
+        m_userStore.attach(user);
+    }
 }
 
 Authentication::~Authentication() {
@@ -29,12 +42,11 @@ bool Authentication::login(const QString &username, const QString &password) {
         return false;
     }
 
-    for (User* user : m_users) {
-        if (user->getUsername() == username && user->checkPassword(password)) {
-            m_currentUser = user;
-            emit loginStatusChanged(true, username);
-            return true;
-        }
+    User* user = findUser(username);
+    if (user && user->checkPassword(password)) {
+        m_currentUser = user;
+        emit loginStatusChanged(true, username);
+        return true;
     }
     m_lastErrorMessage = "Invalid username or password";
     m_currentUser = nullptr;
@@ -42,6 +54,14 @@ bool Authentication::login(const QString &username, const QString &password) {
     return false;
 }
 
+bool Authentication::checkCredentials(const QString &username, const QString &password) const {
+    if (username.isEmpty() || password.isEmpty()) {
+        return false;
+    }
+    const User* user = findUser(username);
+    return user && user->checkPassword(password);
+}
+
 bool Authentication::registerUser(const QString &username, const QString &password) {
     // Check for empty credentials
     if (username.isEmpty() || password.isEmpty()) {
@@ -50,18 +70,26 @@ bool Authentication::registerUser(const QString &username, const QString &passwo
         return false;
     }
     
+    // The archive records the computer under this name
+    if (username.compare(QLatin1String(GameArchive::COMPUTER_PLAYER), Qt::CaseInsensitive) == 0) {
+        m_lastErrorMessage = "That username is reserved";
+        qDebug() << "\n! Registration failed: Username" << username << "is reserved";
+        return false;
+    }
+
     // Check if user already exists
-    for (User* user : m_users) {
-        if (user->getUsername() == username) {
-            m_lastErrorMessage = "Username already exists";
-            qDebug() << "\n! Registration failed: Username" << username << "already exists";
-            return false;
-        }
+    if (findUser(username)) {
+        m_lastErrorMessage = "Username already exists";
+        qDebug() << "\n! Registration failed: Username" << username << "already exists";
+        return false;
     }
 
     // Create new user with hashed password
     QString hashedPassword = hashPassword(password);
-    m_users.append(new User(username, hashedPassword));
+    User* user = new User(username, hashedPassword);
+    m_users.append(user);
+    m_usersByName.insert(username, user);
+    m_userStore.attach(user);
     
     // Output registration details
     qDebug() << "\n==========================================";
@@ -83,19 +111,20 @@ QVector<User*> Authentication::getUsers() const {
     return m_users;
 }
 
+const UserStore &Authentication::userStore() const {
+    return m_userStore;
+}
+
 bool Authentication::authenticatePlayers(const QString &player1Username, const QString &player1Password,
                                          const QString &player2Username, const QString &player2Password,
                                          QString &errorMessage) {
-    User* player1 = nullptr;
-    User* player2 = nullptr;
-
-    for (User* user : m_users) {
-        if (user->getUsername() == player1Username && user->checkPassword(player1Password)) {
-            player1 = user;
-        }
-        if (user->getUsername() == player2Username && user->checkPassword(player2Password)) {
-            player2 = user;
-        }
+    User* player1 = findUser(player1Username);
+    User* player2 = findUser(player2Username);
+    if (player1 && !player1->checkPassword(player1Password)) {
+        player1 = nullptr;
+    }
+    if (player2 && !player2->checkPassword(player2Password)) {
+        player2 = nullptr;
     }
 
     if (!player1) {
@@ -166,14 +195,95 @@ QString Authentication::generateSalt() {
     return salt;
 }
 
+void Authentication::setDatabase(Database *database) {
+    m_database = database;
+}
+
+void Authentication::setWriter(DatabaseWriter *writer) {
+    m_writer = writer;
+}
+
 void Authentication::saveUsers() {
-    // For simplicity, this method is not implemented
-    // In a real application, you would save users to a file or database
+    if (m_writer) {
+        m_writer->scheduleSave(m_users);
+    } else if (m_database) {
+        // Only users touched since the last save are written
+        QVector<User*> dirty;
+        for (User* user : m_users) {
+            if (user->isDirty()) {
+                dirty.append(user);
+            }
+        }
+        if (m_database->appendUsers(dirty)) {
+            for (User* user : dirty) {
+                user->clearDirty();
+            }
+        }
+    }
 }
 
 void Authentication::loadUsers() {
-    // For simplicity, this method is not implemented
-    // In a real application, you would load users from a file or database
+    if (!m_database) {
+        return;
+    }
+    
+    // Taken first, so a save landing during the load is seen next time
+    m_loadedModified = m_database->usersModified();
+    addLoadedUsers(m_database->loadUsers());
+    
+    // Fold a long journal back into the main file. Never from a read-only
+    // database: another process may be appending to that journal
+    if (!m_database->isReadOnly() && m_database->journalNeedsCompaction() && m_database->saveUsers(m_users)) {
+        for (User* user : m_users) {
+            user->clearDirty();
+        }
+    }
+}
+
+void Authentication::addLoadedUsers(const QVector<User*> &loaded) {
+    // Single pass over the loaded users
+    m_users.reserve(m_users.size() + loaded.size());
+    m_usersByName.reserve(m_users.size() + loaded.size());
+    m_userStore.reserve(m_users.size() + loaded.size());
+    for (User* user : loaded) {
+        User* old = m_usersByName.value(user->getUsername(), nullptr);
+        if (old) {
+            // Only the handful of defaults can collide, so a scan is fine here
+            if (m_currentUser == old) {
+                m_currentUser = user;
+            }
+            m_users[m_users.indexOf(old)] = user;
+            delete old;
+        } else {
+            m_users.append(user);
+        }
+        m_usersByName.insert(user->getUsername(), user);
+        // A replaced default keeps its row
+        m_userStore.attach(user);
+    }
+}
+
+bool Authentication::reloadUsers() {
+    if (!m_database || m_database->usersModified() == m_loadedModified) {
+        return false;
+    }
+
+    const QString currentUsername = m_currentUser ? m_currentUser->getUsername() : QString();
+    m_currentUser = nullptr;
+    for (User* user : m_users) {
+        delete user;
+    }
+    m_users.clear();
+    m_usersByName.clear();
+    m_userStore.clear();
+    addDefaultUsers();
+    loadUsers();
+    m_currentUser = findUser(currentUsername);
+    return true;
+}
+
+User* Authentication::findUser(const QString &username) const {
+    return m_usersByName.value(username, nullptr);
 }
 
 QString Authentication::getErrorMessage() const {
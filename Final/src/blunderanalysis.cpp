@@ -0,0 +1,301 @@
+#include "../include/blunderanalysis.h"
+#include "../include/moveanalyzer.h"
+#include "../include/movecodec.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtAlgorithms>
+#include <algorithm>
+
+double MistakeTally::mistakeRate() const {
+    return moves == 0 ? 0.0 : double(mistakes + blunders) / moves;
+}
+
+void MistakeTally::add(const MistakeTally &other) {
+    games += other.games;
+    moves += other.moves;
+    inaccuracies += other.inaccuracies;
+    mistakes += other.mistakes;
+    blunders += other.blunders;
+}
+
+BoardSnapshot LosingPattern::board() const {
+    BoardSnapshot snapshot;
+    snapshot.x = quint16((position >> 9) & 0x1FF);
+    snapshot.o = quint16(position & 0x1FF);
+    return snapshot;
+}
+
+// File layout, QDataStream: magic, version, records covered, then each
+// player's name and five counts, then each pattern's position and count
+bool BlunderSummary::load(const QString &path) {
+    clear();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 gamesAnalysed = 0;
+    quint32 playerCount = 0;
+    in >> magic >> version >> gamesAnalysed >> playerCount;
+    if (in.status() != QDataStream::Ok || magic != MAGIC || version != VERSION) {
+        qDebug() << "Ignoring unreadable blunder summary:" << path;
+        return false;
+    }
+    m_players.reserve(int(playerCount));
+    for (quint32 i = 0; i < playerCount && in.status() == QDataStream::Ok; ++i) {
+        QString name;
+        MistakeTally tally;
+        in >> name >> tally.games >> tally.moves >> tally.inaccuracies >> tally.mistakes >> tally.blunders;
+        m_players.insert(name, tally);
+    }
+    quint32 patternCount = 0;
+    in >> patternCount;
+    for (quint32 i = 0; i < patternCount && in.status() == QDataStream::Ok; ++i) {
+        quint32 position = 0;
+        quint32 count = 0;
+        in >> position >> count;
+        m_patterns.insert(position, count);
+    }
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Ignoring truncated blunder summary:" << path;
+        clear();
+        return false;
+    }
+    m_gamesAnalysed = gamesAnalysed;
+    return true;
+}
+
+bool BlunderSummary::save(const QString &path) const {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write blunder summary:" << path;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << MAGIC << VERSION << m_gamesAnalysed << quint32(m_players.size());
+    for (auto it = m_players.constBegin(); it != m_players.constEnd(); ++it) {
+        const MistakeTally &tally = it.value();
+        out << it.key() << tally.games << tally.moves << tally.inaccuracies << tally.mistakes << tally.blunders;
+    }
+    out << quint32(m_patterns.size());
+    for (auto it = m_patterns.constBegin(); it != m_patterns.constEnd(); ++it) {
+        out << it.key() << it.value();
+    }
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "Failed to write blunder summary:" << path;
+        return false;
+    }
+    return true;
+}
+
+MistakeTally BlunderSummary::tally(const QString &player) const {
+    return m_players.value(player);
+}
+
+QVector<LosingPattern> BlunderSummary::patterns(int limit) const {
+    QVector<LosingPattern> patterns;
+    patterns.reserve(m_patterns.size());
+    for (auto it = m_patterns.constBegin(); it != m_patterns.constEnd(); ++it) {
+        LosingPattern pattern;
+        pattern.position = it.key();
+        pattern.count = it.value();
+        patterns.append(pattern);
+    }
+    // Ties by position, so the order does not depend on the hash
+    std::sort(patterns.begin(), patterns.end(), [](const LosingPattern &a, const LosingPattern &b) {
+        return a.count != b.count ? a.count > b.count : a.position < b.position;
+    });
+    if (limit >= 0 && limit < patterns.size()) {
+        patterns.resize(limit);
+    }
+    return patterns;
+}
+
+void BlunderSummary::merge(const BlunderSummary &other) {
+    for (auto it = other.m_players.constBegin(); it != other.m_players.constEnd(); ++it) {
+        m_players[it.key()].add(it.value());
+    }
+    for (auto it = other.m_patterns.constBegin(); it != other.m_patterns.constEnd(); ++it) {
+        m_patterns[it.key()] += it.value();
+    }
+}
+
+void BlunderSummary::clear() {
+    m_gamesAnalysed = 0;
+    m_players.clear();
+    m_patterns.clear();
+}
+
+// The grade of every cell in every unfinished position, four bits a cell,
+// keyed by (first mover's cells << 9) | the other player's. A few thousand
+// entries, read without locking once built.
+static void addGrades(const BoardSnapshot &board, QHash<quint32, quint64> *grades) {
+    const quint32 key = (quint32(board.x) << 9) | board.o;
+    if (grades->contains(key) || board.winner() != GameLogic::Player::None || board.isFull()) {
+        return;
+    }
+    const bool xMoves = qPopulationCount(board.x) == qPopulationCount(board.o);
+    quint64 packed = 0;
+    for (int cell = 0; cell < 9; ++cell) {
+        packed |= quint64(MoveAnalyzer::grade(board, cell)) << (4 * cell);
+    }
+    grades->insert(key, packed);
+
+    for (int cell = 0; cell < 9; ++cell) {
+        const quint16 bit = quint16(1u << cell);
+        if ((board.x | board.o) & bit) {
+            continue;
+        }
+        BoardSnapshot child = board;
+        if (xMoves) {
+            child.x |= bit;
+        } else {
+            child.o |= bit;
+        }
+        addGrades(child, grades);
+    }
+}
+
+static const QHash<quint32, quint64> &gradeTable() {
+    static const QHash<quint32, quint64> table = [] {
+        QHash<quint32, quint64> grades;
+        addGrades(BoardSnapshot(), &grades);
+        return grades;
+    }();
+    return table;
+}
+
+void BlunderAnalysis::analyseGames(const QVector<ArchivedGame> &games, int from, int to,
+                                   BlunderSummary *summary) {
+    const QHash<quint32, quint64> &grades = gradeTable();
+    for (int i = from; i < to; ++i) {
+        const ArchivedGame &game = games.at(i);
+        const QVector<GameMoveRecord> moves = MoveCodec::unpack(game.packedMoves);
+        if (moves.isEmpty()) {
+            continue; // Archived before moves were recorded
+        }
+
+        // The first mover's marks go in x, so games O opened read like any other
+        const int firstPlayer = moves.first().player;
+        const bool vsAI = !game.difficulty.isEmpty();
+        const QString *players[2] = {&game.playerX, &game.playerO};
+        if (firstPlayer != 1) {
+            std::swap(players[0], players[1]);
+        }
+        // The computer's moves say nothing about a player
+        const bool counted[2] = {!vsAI || players[0] != &game.playerO, !vsAI || players[1] != &game.playerO};
+        MistakeTally sides[2];
+
+        BoardSnapshot board;
+        for (int ply = 0; ply < moves.size(); ++ply) {
+            const auto grade = grades.constFind((quint32(board.x) << 9) | board.o);
+            const int cell = moves.at(ply).cellIndex;
+            const quint16 bit = quint16(1u << cell);
+            if (grade == grades.constEnd() || cell > 8 || ((board.x | board.o) & bit)) {
+                break; // Moves past the end of the game or onto a taken cell
+            }
+            if (ply % 2 == 0) {
+                board.x |= bit;
+            } else {
+                board.o |= bit;
+            }
+
+            if (!counted[ply % 2]) {
+                continue;
+            }
+            MistakeTally *tally = sides + ply % 2;
+            tally->moves++;
+            switch (MoveAnalyzer::MoveQuality((grade.value() >> (4 * cell)) & 0xF)) {
+            case MoveAnalyzer::MoveQuality::Inaccuracy:
+                tally->inaccuracies++;
+                break;
+            case MoveAnalyzer::MoveQuality::Mistake:
+                tally->mistakes++;
+                summary->m_patterns[MoveAnalyzer::canonicalKey(board.x, board.o)]++;
+                break;
+            case MoveAnalyzer::MoveQuality::Blunder:
+                tally->blunders++;
+                summary->m_patterns[MoveAnalyzer::canonicalKey(board.x, board.o)]++;
+                break;
+            default:
+                break;
+            }
+        }
+
+        for (int side = 0; side < 2; ++side) {
+            if (!counted[side]) {
+                continue;
+            }
+            sides[side].games = 1;
+            summary->m_players[*players[side]].add(sides[side]);
+        }
+    }
+}
+
+qint64 BlunderAnalysis::run(GameArchive *archive, BlunderSummary *summary) {
+    const qint64 total = archive->count();
+    if (summary->m_gamesAnalysed > total) {
+        summary->clear(); // Not this archive's summary
+    }
+    gradeTable();
+
+    const int threads = qMax(1, QThread::idealThreadCount());
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    const qint64 first = summary->m_gamesAnalysed;
+    qint64 next = first;
+    QVector<ArchivedGame> page = archive->range(next, PAGE_SIZE);
+    while (!page.isEmpty()) {
+        next += page.size();
+
+        // Every slice has a summary of its own, so workers share nothing
+        const int sliceCount = (page.size() + SLICE_SIZE - 1) / SLICE_SIZE;
+        QVector<BlunderSummary> slices(sliceCount);
+        const QVector<ArchivedGame> *games = &page;
+        for (int slice = 0; slice < sliceCount; ++slice) {
+            const int from = slice * SLICE_SIZE;
+            const int to = qMin(int(page.size()), from + SLICE_SIZE);
+            BlunderSummary *out = slices.data() + slice;
+            pool.start([games, from, to, out]() {
+                analyseGames(*games, from, to, out);
+            });
+        }
+        // Reading on while the workers run
+        QVector<ArchivedGame> following = next < total ? archive->range(next, PAGE_SIZE) : QVector<ArchivedGame>();
+        pool.waitForDone();
+
+        for (const BlunderSummary &slice : slices) {
+            summary->merge(slice);
+        }
+        summary->m_gamesAnalysed = next;
+        page.swap(following);
+    }
+    if (summary->m_gamesAnalysed < total) {
+        qDebug() << "Stopped analysing the game archive at record" << summary->m_gamesAnalysed << "of" << total;
+        return -1;
+    }
+    return summary->m_gamesAnalysed - first;
+}
+
+qint64 BlunderAnalysis::update(GameArchive *archive) {
+    const QString path = summaryPath(archive->path());
+    BlunderSummary summary;
+    summary.load(path);
+    const qint64 analysed = run(archive, &summary);
+    if (analysed < 0 || !summary.save(path)) {
+        return -1;
+    }
+    return analysed;
+}
+
+QString BlunderAnalysis::summaryPath(const QString &archivePath) {
+    return archivePath + ".analysis";
+}
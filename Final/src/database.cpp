@@ -1,18 +1,34 @@
 #include "../include/database.h"
+#include "../include/authentication.h"
+#include "../include/sqlitestore.h"
+#include "../include/jsonuserstream.h"
+#include "../include/historystore.h"
+#include "../include/gamearchive.h"
+#include "../include/userstore.h"
+#include "../include/stringinterner.h"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QStandardPaths>
+#include <QHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
 #include <QDebug>
 #include <algorithm>
 #include <QMetaObject>
 #include <QMetaProperty>
 
+Database::Backend Database::s_defaultBackend = Database::Backend::Json;
+Database::Ranking Database::s_defaultRanking = Database::Ranking::Score;
+
 Database::Database(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), m_archive(nullptr), m_readOnly(false), m_ranking(s_defaultRanking)
 {
     QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir dir(appDataPath);
@@ -21,13 +37,92 @@ Database::Database(QObject *parent)
         dir.mkpath(".");
     }
     
-    m_dbPath = appDataPath + "/tictactoe.json";
+    setDatabasePath(appDataPath + (s_defaultBackend == Backend::Sqlite ? "/tictactoe.db" : "/tictactoe.json"));
 }
 
 Database::~Database() {
+    // Users loaded from SQLite keep the store alive for their histories
+    delete m_archive;
 }
 
-bool Database::saveUsers(const QVector<User*> &users) {
+void Database::setDefaultBackend(Backend backend) {
+    s_defaultBackend = backend;
+}
+
+Database::Backend Database::defaultBackend() {
+    return s_defaultBackend;
+}
+
+void Database::setDefaultRanking(Ranking ranking) {
+    s_defaultRanking = ranking;
+}
+
+Database::Ranking Database::defaultRanking() {
+    return s_defaultRanking;
+}
+
+QString LeaderboardEntry::username() const {
+    return StringInterner::string(usernameId);
+}
+
+void LeaderboardEntry::setUsername(const QString &username) {
+    usernameId = StringInterner::intern(username);
+}
+
+QVector<LeaderboardEntry> Database::getLeaderboard(const UserStore &store, int limit) {
+    auto entryFor = [&store](int row) {
+        LeaderboardEntry entry;
+        entry.setUsername(store.username(row));
+        entry.wins = store.wins(row);
+        entry.totalGames = store.totalGames(row);
+        entry.winRate = store.winRate(row);
+        entry.bestStreak = store.bestStreak(row);
+        entry.score = store.score(row);
+        return entry;
+    };
+    
+    QVector<LeaderboardEntry> leaderboard;
+    if (m_ranking == Ranking::Rating) {
+        // Ratings live in the archive, so every player needs an entry
+        const QVector<int> rows = store.rankByScore();
+        leaderboard.reserve(rows.size());
+        for (int row : rows) {
+            LeaderboardEntry entry = entryFor(row);
+            entry.rating = qRound(gameArchive()->rating(entry.username()));
+            leaderboard.append(entry);
+        }
+        std::stable_sort(leaderboard.begin(), leaderboard.end(),
+                         [](const LeaderboardEntry &a, const LeaderboardEntry &b) {
+                             return a.rating > b.rating;
+                         });
+        if (limit >= 0 && limit < leaderboard.size()) {
+            leaderboard.resize(limit);
+        }
+        return leaderboard;
+    }
+    
+    const QVector<int> rows = store.rankByScore(limit);
+    leaderboard.reserve(rows.size());
+    for (int row : rows) {
+        leaderboard.append(entryFor(row));
+    }
+    return leaderboard;
+}
+
+void Database::setRanking(Ranking ranking) {
+    m_ranking = ranking;
+}
+
+Database::Ranking Database::ranking() const {
+    return m_ranking;
+}
+
+bool Database::checkWritablePath() const {
+    if (m_readOnly) {
+        qDebug() << "Database opened read-only:" << m_dbPath;
+        return false;
+    }
+
     // Check if path is valid
     QFileInfo fileInfo(m_dbPath);
     QDir directory = fileInfo.dir();
@@ -58,80 +153,273 @@ bool Database::saveUsers(const QVector<User*> &users) {
         return false;
     }
     
-    QJsonArray usersArray;
+    return true;
+}
+
+bool Database::saveUsers(const QVector<User*> &users) {
+    if (!checkWritablePath()) {
+        return false;
+    }
     
-    const auto& usersRef = users;
-    for (const User* user : usersRef) {
-        QJsonObject userObj;
-        userObj["username"] = user->getUsername();
-        // We can't access the password directly, so we'll skip saving it
-        // userObj["password"] = user->getPassword(); // In a real app, this should be hashed
-        
-        QJsonObject stats;
-        stats["totalGames"] = user->getTotalGames();
-        stats["wins"] = user->getWins();
-        stats["losses"] = user->getLosses();
-        stats["draws"] = user->getDraws();
-        stats["vsAI"] = user->getVsAI();
-        stats["vsPlayers"] = user->getVsPlayers();
-        stats["winRate"] = user->getWinRate();
-        stats["bestStreak"] = user->getBestStreak();
-        
-        QJsonArray historyArray;
-        const auto& gameHistory = user->getGameHistory();
-        for (const GameRecord &record : gameHistory) {
-            QJsonObject historyObj;
-            historyObj["date"] = record.date;
-            historyObj["result"] = record.result;
-            historyArray.append(historyObj);
-        }
-        
-        stats["gameHistory"] = historyArray;
-        userObj["stats"] = stats;
-        
-        usersArray.append(userObj);
+    if (m_sqlite) {
+        return m_sqlite->saveUsers(users, true);
     }
     
-    QJsonDocument doc(usersArray);
-    QFile file(m_dbPath);
+    // QSaveFile writes to a temporary file and renames it over the database on
+    // commit(), so a crash mid-write never leaves a truncated file behind
+    QSaveFile file(m_dbPath);
     
     if (!file.open(QIODevice::WriteOnly)) {
         qDebug() << "Failed to open database file for writing:" << m_dbPath;
         return false;
     }
     
-    // For large datasets, write in chunks to avoid memory issues
-    QByteArray jsonData = doc.toJson();
-    qint64 bytesWritten = 0;
-    qint64 totalSize = jsonData.size();
-    qint64 chunkSize = 1024 * 1024; // 1MB chunks
+    // Users are serialized one at a time, no document is built in memory
+    JsonUserWriter writer(&file, SHARD_SIZE);
+    QVector<qint64> recordOffsets;
+    recordOffsets.reserve(users.size());
+    bool ok = writer.begin();
+    for (int i = 0; ok && i < users.size(); ++i) {
+        ok = writer.write(*users.at(i));
+        recordOffsets.append(writer.lastRecordOffset());
+    }
+    ok = ok && writer.finish();
     
-    for (qint64 pos = 0; pos < totalSize; pos += chunkSize) {
-        QByteArray chunk = jsonData.mid(pos, qMin(chunkSize, totalSize - pos));
-        qint64 written = file.write(chunk);
-        if (written == -1) {
-            qDebug() << "Failed to write chunk to database file:" << m_dbPath;
-            file.close();
-            return false;
+    if (!ok) {
+        qDebug() << "Failed to write complete data to database file:" << m_dbPath;
+        file.cancelWriting();
+        return false;
+    }
+    
+    // Users loaded earlier still point into the old file and the journal.
+    // Their stores are held while the files are swapped and then follow the
+    // records, so no lookup reads one file at the other's offsets
+    QVector<QSharedPointer<JsonHistoryStore>> movedStores;
+    for (const QWeakPointer<JsonHistoryStore> &weak : m_historyStores) {
+        if (QSharedPointer<JsonHistoryStore> store = weak.toStrongRef()) {
+            movedStores.append(store);
+        }
+    }
+    m_historyStores.clear();
+    QHash<QString, qint64> movedOffsets;
+    if (!movedStores.isEmpty()) {
+        movedOffsets.reserve(users.size());
+        for (int i = 0; i < users.size(); ++i) {
+            movedOffsets.insert(users.at(i)->getUsername(), recordOffsets.at(i));
         }
-        bytesWritten += written;
+    }
+    for (const auto &store : movedStores) {
+        store->beginMove();
     }
     
-    if (bytesWritten != totalSize) {
-        qDebug() << "Failed to write complete data to database file:" << m_dbPath;
-        file.close();
+    if (!file.commit()) {
+        qDebug() << "Failed to commit database file:" << m_dbPath;
+        for (const auto &store : movedStores) {
+            store->cancelMove();
+            m_historyStores.append(store);
+        }
         return false;
     }
     
-    file.flush();
-    file.close();
+    // Everything in the journal is part of the new snapshot now
+    QFile::remove(journalPath());
+    for (const auto &store : movedStores) {
+        store->finishMove(m_dbPath, movedOffsets);
+        m_historyStores.append(store);
+    }
+    
+    writeShardIndex(writer.shardOffsets(), users.size());
+    
+    // Histories not paged in yet now live at new offsets in the new snapshot
+    QSharedPointer<HistoryStore> historyStore = newHistoryStore(m_dbPath);
+    for (int i = 0; i < users.size(); ++i) {
+        if (!users.at(i)->isHistoryLoaded()) {
+            users.at(i)->setHistorySource(historyStore, recordOffsets.at(i));
+        }
+    }
+    return true;
+}
+
+QSharedPointer<HistoryStore> Database::newHistoryStore(const QString &path) const {
+    QSharedPointer<JsonHistoryStore> store(new JsonHistoryStore(path));
+    m_historyStores.erase(std::remove_if(m_historyStores.begin(), m_historyStores.end(),
+                                         [](const QWeakPointer<JsonHistoryStore> &weak) { return weak.isNull(); }),
+                          m_historyStores.end());
+    m_historyStores.append(store);
+    return store;
+}
+
+bool Database::appendUsers(const QVector<User*> &users, qint64 *bytesWritten) {
+    if (bytesWritten) {
+        *bytesWritten = 0;
+    }
+    if (users.isEmpty()) {
+        return true;
+    }
+    if (!checkWritablePath()) {
+        return false;
+    }
+    
+    if (m_sqlite) {
+        // Upserted in one transaction; SQLite does not report bytes written
+        return m_sqlite->saveUsers(users, false);
+    }
+    
+    // One compact record per line; a later line for the same user wins on load
+    QByteArray data;
+    for (const User* user : users) {
+        data += serializeRecord(*user);
+        data += '\n';
+    }
+    
+    QFile file(journalPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open database journal for writing:" << journalPath();
+        return false;
+    }
+    
+    if (file.write(data) != data.size() || !file.flush()) {
+        qDebug() << "Failed to append to database journal:" << journalPath();
+        return false;
+    }
+    
+    if (bytesWritten) {
+        *bytesWritten = data.size();
+    }
     return true;
 }
 
+QString Database::journalPath() const {
+    return m_dbPath + ".journal";
+}
+
+qint64 Database::usersModified() const {
+    // SQLite commits land in its write-ahead log first
+    const QString companion = m_sqlite ? m_dbPath + "-wal" : journalPath();
+    qint64 modified = -1;
+    for (const QString &path : {m_dbPath, companion}) {
+        const QFileInfo info(path);
+        if (info.exists()) {
+            modified = qMax(modified, info.lastModified().toMSecsSinceEpoch());
+        }
+    }
+    return modified;
+}
+
+bool Database::journalNeedsCompaction() const {
+    if (m_sqlite) {
+        return false; // WAL checkpoints on its own
+    }
+    const qint64 journalSize = QFileInfo(journalPath()).size();
+    const qint64 snapshotSize = QFileInfo(m_dbPath).size();
+    return journalSize > qMax(JOURNAL_COMPACT_MIN_BYTES, snapshotSize / 2);
+}
+
+void Database::setDatabasePath(const QString &path) {
+    m_dbPath = path;
+    
+    delete m_archive;
+    m_archive = nullptr;
+    m_sqlite.reset();
+    // Stores of the old file stay with it
+    m_historyStores.clear();
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "db" || suffix == "sqlite" || suffix == "sqlite3") {
+        m_sqlite.reset(new SqliteStore(path));
+    }
+}
+
+QString Database::databasePath() const {
+    return m_dbPath;
+}
+
+Database::Backend Database::backend() const {
+    return m_sqlite ? Backend::Sqlite : Backend::Json;
+}
+
+void Database::setReadOnly(bool readOnly) {
+    m_readOnly = readOnly;
+}
+
+bool Database::isReadOnly() const {
+    return m_readOnly;
+}
+
+bool Database::migrateFromJson(const QString &jsonPath) {
+    if (!QFile::exists(jsonPath)) {
+        qDebug() << "No JSON database to migrate from:" << jsonPath;
+        return false;
+    }
+    
+    if (!m_sqlite) {
+        Database source;
+        source.setDatabasePath(jsonPath);
+        const QVector<User*> users = source.loadUsers();
+        const bool ok = saveUsers(users);
+        for (User* user : users) {
+            delete user;
+        }
+        return ok;
+    }
+    
+    // Stream the snapshot into SQLite in batches, so only one batch of users
+    // is ever in memory
+    QFile file(jsonPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Failed to open JSON database for migration:" << jsonPath;
+        return false;
+    }
+    
+    JsonUserReader reader(&file);
+    QVector<User*> batch;
+    batch.reserve(MIGRATION_BATCH_SIZE);
+    bool firstBatch = true;
+    bool ok = true;
+    auto flushBatch = [&]() {
+        ok = ok && m_sqlite->saveUsers(batch, firstBatch);
+        firstBatch = false;
+        for (User* user : batch) {
+            delete user;
+        }
+        batch.clear();
+    };
+    
+    QJsonObject userObj;
+    while (ok && reader.readNext(&userObj)) {
+        batch.append(deserializeUser(userObj));
+        if (batch.size() == MIGRATION_BATCH_SIZE) {
+            flushBatch();
+        }
+    }
+    flushBatch();
+    file.close();
+    
+    if (reader.hasError()) {
+        qDebug() << "Error parsing JSON:" << reader.errorString();
+        ok = false;
+    }
+    
+    // Then the changes journaled since that snapshot, in order
+    QFile journal(jsonPath + ".journal");
+    if (ok && journal.open(QIODevice::ReadOnly)) {
+        while (ok && !journal.atEnd()) {
+            QJsonDocument doc = QJsonDocument::fromJson(journal.readLine());
+            if (doc.isObject()) {
+                batch.append(deserializeUser(doc.object()));
+                flushBatch();
+            }
+        }
+        journal.close();
+    }
+    
+    qDebug() << (ok ? "Migrated" : "Failed to migrate") << reader.recordsRead() << "users from" << jsonPath;
+    return ok;
+}
+
 // Override the setProperty method to handle test cases
 bool Database::setProperty(const char *name, const QVariant &value) {
     if (qstrcmp(name, "m_dbPath") == 0) {
-        m_dbPath = value.toString();
+        setDatabasePath(value.toString());
         return true;
     }
     return QObject::setProperty(name, value);
@@ -146,112 +434,421 @@ QVector<User*> Database::loadUsers() {
     if (m_dbPath.isEmpty() || !fileInfo.dir().exists()) {
         qDebug() << "Invalid database path for loading:" << m_dbPath;
         // Create default users if no database exists
-        users.append(new User("player1", "pass123"));
-        users.append(new User("player2", "pass123"));
+        users.append(new User("player1", Authentication::hashPassword("pass123")));
+        users.append(new User("player2", Authentication::hashPassword("pass123")));
         return users;
     }
     
-    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+    if (m_sqlite) {
+        // First start on SQLite picks up the JSON database left next to it
+        const QString legacyPath = fileInfo.dir().filePath("tictactoe.json");
+        if (!m_readOnly && m_sqlite->isEmpty() && QFile::exists(legacyPath)) {
+            migrateFromJson(legacyPath);
+        }
+        users = m_sqlite->loadUsers();
+    } else if (file.exists() && !loadShards(users)) {
+        // No usable shard index: stream one user at a time and note where the
+        // shards start, so the next load can decode them in parallel
+        if (file.open(QIODevice::ReadOnly)) {
+            JsonUserReader reader(&file);
+            reader.setSkipHistory(true);
+            QSharedPointer<HistoryStore> historyStore = newHistoryStore(m_dbPath);
+            QVector<qint64> shardOffsets;
+            QJsonObject userObj;
+            while (reader.readNext(&userObj)) {
+                if (users.size() % SHARD_SIZE == 0) {
+                    shardOffsets.append(reader.lastRecordOffset());
+                }
+                users.append(deserializeUser(userObj, historyStore, reader.lastRecordOffset()));
+            }
+            file.close();
+            
+            if (reader.hasError()) {
+                qDebug() << "Error parsing JSON:" << reader.errorString();
+                for (User* user : users) {
+                    delete user;
+                }
+                users.clear();
+                // Return default users on parse error
+                users.append(new User("player1", Authentication::hashPassword("pass123")));
+                users.append(new User("player2", Authentication::hashPassword("pass123")));
+                return users;
+            }
+            
+            if (!m_readOnly) {
+                writeShardIndex(shardOffsets, users.size());
+            }
+        }
+    }
+    
+    if (!m_sqlite) {
+        replayJournal(users);
+    }
+    
+    if (users.isEmpty()) {
         // Create default users if no database exists
-        users.append(new User("player1", "pass123"));
-        users.append(new User("player2", "pass123"));
+        users.append(new User("player1", Authentication::hashPassword("pass123")));
+        users.append(new User("player2", Authentication::hashPassword("pass123")));
         
         // No default demo user - leaderboard will be populated with real player data
-        
-        return users;
     }
     
-    // For large files, read in chunks
-    QByteArray jsonData;
-    qint64 chunkSize = 1024 * 1024; // 1MB chunks
-    while (!file.atEnd()) {
-        jsonData += file.read(chunkSize);
+    return users;
+}
+
+void Database::adoptHistories(const QVector<User*> &users) {
+    if (!m_sqlite) {
+        return;
+    }
+    for (User* user : users) {
+        if (!user->isHistoryLoaded() && user->historyStore() != m_sqlite.data()) {
+            user->setHistorySource(m_sqlite, user->historyKey());
+        }
+    }
+}
+
+QString Database::shardIndexPath() const {
+    return m_dbPath + ".idx";
+}
+
+void Database::writeShardIndex(const QVector<qint64> &offsets, int userCount) const {
+    const QFileInfo info(m_dbPath);
+    QSaveFile file(shardIndexPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write shard index:" << shardIndexPath();
+        return;
+    }
+    
+    // Tied to the exact file it describes; any other writer invalidates it
+    QDataStream out(&file);
+    out << SHARD_INDEX_MAGIC << info.size() << info.lastModified().toMSecsSinceEpoch()
+        << qint32(userCount) << qint32(SHARD_SIZE) << offsets;
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qDebug() << "Failed to write shard index:" << shardIndexPath();
+    }
+}
+
+bool Database::loadShards(QVector<User*> &users) const {
+    QFile indexFile(shardIndexPath());
+    if (!indexFile.open(QIODevice::ReadOnly)) {
+        return false;
     }
     
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
+    quint32 magic = 0;
+    qint64 fileSize = 0;
+    qint64 modified = 0;
+    qint32 userCount = 0;
+    qint32 shardSize = 0;
+    QVector<qint64> offsets;
+    QDataStream in(&indexFile);
+    in >> magic >> fileSize >> modified >> userCount >> shardSize >> offsets;
+    indexFile.close();
     
-    if (parseError.error != QJsonParseError::NoError) {
-        qDebug() << "Error parsing JSON:" << parseError.errorString();
-        file.close();
-        // Return default users on parse error
-        users.append(new User("player1", "pass123"));
-        users.append(new User("player2", "pass123"));
-        return users;
+    const QFileInfo info(m_dbPath);
+    if (in.status() != QDataStream::Ok || magic != SHARD_INDEX_MAGIC || shardSize <= 0
+        || fileSize != info.size() || modified != info.lastModified().toMSecsSinceEpoch()
+        || offsets.size() != (userCount + shardSize - 1) / shardSize) {
+        qDebug() << "Shard index is stale, loading sequentially:" << shardIndexPath();
+        return false;
+    }
+    
+    // Every worker owns one slot, so decoding needs no locking at all
+    QVector<QVector<User*>> shardUsers(offsets.size());
+    QVector<char> shardOk(offsets.size(), 0);
+    
+    // Histories stay in the file, the store is shared by every shard
+    const QSharedPointer<HistoryStore> historyStore = newHistoryStore(m_dbPath);
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    for (int shard = 0; shard < offsets.size(); ++shard) {
+        const qint64 offset = offsets.at(shard);
+        const int count = qMin(shardSize, userCount - shard * shardSize);
+        QVector<User*> *out = shardUsers.data() + shard;
+        char *ok = shardOk.data() + shard;
+        const QString path = m_dbPath;
+        pool.start([path, historyStore, offset, count, out, ok]() {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+                return;
+            }
+            JsonUserReader reader(&file, true);
+            reader.setSkipHistory(true);
+            QJsonObject userObj;
+            out->reserve(count);
+            while (out->size() < count && reader.readNext(&userObj)) {
+                out->append(deserializeUser(userObj, historyStore, reader.lastRecordOffset()));
+            }
+            *ok = out->size() == count ? 1 : 0;
+        });
     }
+    pool.waitForDone();
     
-    QJsonArray usersArray = doc.array();
+    // Single pass to stitch the shards back together in file order
+    bool ok = true;
+    for (char shardDone : shardOk) {
+        ok = ok && shardDone;
+    }
+    if (ok) {
+        users.reserve(users.size() + userCount);
+    }
+    for (const QVector<User*> &shard : shardUsers) {
+        for (User* user : shard) {
+            if (ok) {
+                users.append(user);
+            } else {
+                delete user;
+            }
+        }
+    }
+    if (!ok) {
+        qDebug() << "Sharded load failed, loading sequentially:" << m_dbPath;
+    }
+    return ok;
+}
+
+void Database::replayJournal(QVector<User*> &users) const {
+    QFile journal(journalPath());
+    if (!journal.exists() || !journal.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    QHash<QString, int> index;
+    index.reserve(users.size());
+    for (int i = 0; i < users.size(); ++i) {
+        index.insert(users.at(i)->getUsername(), i);
+    }
     
-    const auto& usersArrayRef = usersArray;
-    for (const QJsonValue &value : usersArrayRef) {
-        QJsonObject userObj = value.toObject();
+    // Records that make it into memory only keep their journal offset
+    const QSharedPointer<HistoryStore> historyStore = newHistoryStore(journalPath());
+    while (!journal.atEnd()) {
+        const qint64 offset = journal.pos();
+        const QByteArray line = journal.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        
+        // The history stays in the journal until it is asked for
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(withoutHistory(line), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            // Most likely a record torn by a crash mid-append
+            qDebug() << "Skipping unreadable journal record:" << parseError.errorString();
+            continue;
+        }
         
-        QString username = userObj["username"].toString();
-        // We can't access the password directly, so we'll use an empty password
-        // The User constructor will need to handle this appropriately
-        User* user = new User(username, "defaultpassword");  // Use a default password
+        User* user = deserializeUser(doc.object(), historyStore, offset);
+        auto it = index.constFind(user->getUsername());
+        if (it != index.constEnd()) {
+            delete users.at(it.value());
+            users[it.value()] = user;
+        } else {
+            index.insert(user->getUsername(), users.size());
+            users.append(user);
+        }
+    }
+    journal.close();
+}
+
+QJsonObject Database::serializeUser(const User &user) {
+    QJsonObject userObj;
+    userObj["username"] = user.getUsername();
+    // Only the salted hash is stored, never the password itself
+    userObj["passwordHash"] = user.getHashedPassword();
+    
+    QJsonObject stats;
+    stats["totalGames"] = user.getTotalGames();
+    stats["wins"] = user.getWins();
+    stats["losses"] = user.getLosses();
+    stats["draws"] = user.getDraws();
+    stats["vsAI"] = user.getVsAI();
+    stats["vsPlayers"] = user.getVsPlayers();
+    stats["winRate"] = user.getWinRate();
+    stats["bestStreak"] = user.getBestStreak();
+    stats["currentStreak"] = user.getCurrentStreak();
+    stats["recent"] = user.rollingStats().toJson();
+    
+    QJsonArray historyArray;
+    const auto& gameHistory = user.getGameHistory();
+    for (const GameRecord &record : gameHistory) {
+        QJsonObject historyObj;
+        historyObj["date"] = record.date();
+        historyObj["result"] = record.result();
+        if (record.packedMoves != 0) {
+            // 41 bits of packed moves fit exactly in a JSON double
+            historyObj["moves"] = static_cast<double>(record.packedMoves);
+        }
+        historyArray.append(historyObj);
+    }
+    
+    userObj["stats"] = stats;
+    userObj["history"] = historyArray.size();
+    userObj["gameHistory"] = historyArray;
+    return userObj;
+}
+
+QByteArray Database::serializeRecord(const User &user) {
+    QJsonObject userObj = serializeUser(user);
+    const QJsonValue history = userObj.take("gameHistory");
+    
+    // QJsonDocument sorts keys, so the history is spliced on by hand
+    QByteArray record = QJsonDocument(userObj).toJson(QJsonDocument::Compact);
+    record.chop(1);
+    record += HISTORY_SECTION;
+    record += QJsonDocument(history.toArray()).toJson(QJsonDocument::Compact);
+    record += '}';
+    return record;
+}
+
+QByteArray Database::withoutHistory(const QByteArray &record) {
+    // Compact JSON escapes every quote inside a string, so the section's
+    // opening can only be the real one
+    const int section = record.indexOf(HISTORY_SECTION);
+    if (section < 0) {
+        return record;
+    }
+    return record.left(section) + '}';
+}
+
+User* Database::deserializeUser(const QJsonObject &userObj, const QSharedPointer<HistoryStore> &historyStore,
+                                qint64 historyKey) {
+    QString username = userObj["username"].toString();
+    // Files written before hashes were persisted fall back to a default password
+    QString passwordHash = userObj["passwordHash"].toString();
+    if (passwordHash.isEmpty()) {
+        passwordHash = "defaultpassword";
+    }
+    User* user = new User(username, passwordHash);
+    
+    if (userObj.contains("stats")) {
+        QJsonObject stats = userObj["stats"].toObject();
+        // Older files keep the history inside the stats, and have no count;
+        // loaders leave the history section out, so only the count is there
+        const bool historyApart = userObj.contains("history");
+        QJsonArray historyArray = (historyApart ? userObj : stats)["gameHistory"].toArray();
+        const int historyGames = historyApart ? userObj["history"].toInt() : historyArray.size();
         
-        if (userObj.contains("stats")) {
-            QJsonObject stats = userObj["stats"].toObject();
+        if (stats.contains("totalGames")) {
+            // Counters come straight from disk; older files lack the current
+            // streak, which is the run of wins at the top of the history
+            int currentStreak = stats["currentStreak"].toInt();
+            if (!stats.contains("currentStreak")) {
+                while (currentStreak < historyArray.size()
+                       && historyArray.at(currentStreak).toObject()["result"].toString().startsWith("Win")) {
+                    currentStreak++;
+                }
+            }
+            user->restoreStats(stats["totalGames"].toInt(), stats["wins"].toInt(), stats["losses"].toInt(),
+                               stats["draws"].toInt(), stats["vsAI"].toInt(), stats["vsPlayers"].toInt(),
+                               stats["bestStreak"].toInt(), currentStreak);
+            
+            if (stats.contains("recent")) {
+                user->restoreRollingStats(RollingStats::fromJson(stats["recent"].toObject()));
+            } else {
+                // Older files: seed the windows from whatever history there is
+                user->restoreRollingStats(rollingStatsFromHistory(deserializeHistory(historyArray)));
+            }
             
-            // Load game history
-            if (stats.contains("gameHistory")) {
-                QJsonArray historyArray = stats["gameHistory"].toArray();
+            if (historyStore && historyGames > 0) {
+                user->setHistorySource(historyStore, historyKey);
+            } else {
+                user->restoreHistory(deserializeHistory(historyArray));
+            }
+        } else {
+            // No counters stored: rebuild them by replaying the history,
+            // oldest first so the newest ends up on top
+            for (int i = historyArray.size() - 1; i >= 0; --i) {
+                QJsonObject historyObj = historyArray.at(i).toObject();
                 
-                const auto& historyArrayRef = historyArray;
-                for (const QJsonValue &historyValue : historyArrayRef) {
-                    QJsonObject historyObj = historyValue.toObject();
-                    
-                    QString date = historyObj["date"].toString();
-                    QString result = historyObj["result"].toString();
-                    
-                    // Parse result to determine game type and outcome
-                    if (result.contains("vs AI")) {
-                        QString difficulty = "medium";
-                        if (result.contains("easy")) {
-                            difficulty = "easy";
-                        } else if (result.contains("hard")) {
-                            difficulty = "hard";
-                        } else if (result.contains("expert")) {
-                            difficulty = "expert";
-                        }
-                        
-                        if (result.startsWith("Win")) {
-                            user->addGameWithDate("win", "ai", date, difficulty);
-                        } else if (result.startsWith("Loss")) {
-                            user->addGameWithDate("loss", "ai", date, difficulty);
-                        } else {
-                            user->addGameWithDate("draw", "ai", date, difficulty);
-                        }
-                    } else {
-                        QString opponent = result.section("vs ", 1);
-                        
-                        if (result.startsWith("Win")) {
-                            user->addGameWithDate("win", opponent, date);
-                        } else if (result.startsWith("Loss")) {
-                            user->addGameWithDate("loss", opponent, date);
-                        } else {
-                            user->addGameWithDate("draw", opponent, date);
-                        }
-                    }
-                }
+                QString date = historyObj["date"].toString();
+                QString result = historyObj["result"].toString();
+                // Kept packed; decoded only when a replay is opened
+                quint64 moves = static_cast<quint64>(historyObj["moves"].toDouble());
+                
+                QString outcome, opponent, difficulty;
+                parseResult(result, &outcome, &opponent, &difficulty);
+                user->addGameWithDate(outcome, opponent, date, difficulty, moves);
             }
         }
-        
-        users.append(user);
     }
     
-    file.close();
-    return users;
+    // Freshly loaded, nothing to write back yet
+    user->clearDirty();
+    return user;
+}
+
+QVector<GameRecord> Database::deserializeHistory(const QJsonArray &historyArray) {
+    QVector<GameRecord> history;
+    history.reserve(historyArray.size());
+    for (const QJsonValue &value : historyArray) {
+        const QJsonObject historyObj = value.toObject();
+        GameRecord record;
+        record.setDate(historyObj["date"].toString());
+        record.setResult(historyObj["result"].toString());
+        // Kept packed; decoded only when a replay is opened
+        record.packedMoves = static_cast<quint64>(historyObj["moves"].toDouble());
+        history.append(record);
+    }
+    return history;
+}
+
+RollingStats Database::rollingStatsFromHistory(const QVector<GameRecord> &history) {
+    RollingStats recent;
+    for (int i = history.size() - 1; i >= 0; --i) {
+        const QString outcome = history.at(i).outcomeName();
+        const QDate day = QDate::fromString(history.at(i).date().left(10), "yyyy-MM-dd");
+        recent.record(outcome, day.isValid() ? day.toJulianDay() : 0);
+    }
+    return recent;
+}
+
+void Database::parseResult(const QString &result, QString *outcome, QString *opponent, QString *difficulty) {
+    GameRecord record;
+    record.setResult(result);
+    *outcome = record.outcomeName();
+    *opponent = record.opponent();
+    *difficulty = record.difficultyName();
 }
 
 bool Database::saveGame(const QString &playerX, const QString &playerO, const QString &result) {
-    // In a real application, this would save the game to a database
-    // For this demo, we'll just return true
-    return true;
+    GameLogic::GameResult outcome;
+    if (result.startsWith("X", Qt::CaseInsensitive)) {
+        outcome = GameLogic::GameResult::XWins;
+    } else if (result.startsWith("O", Qt::CaseInsensitive)) {
+        outcome = GameLogic::GameResult::OWins;
+    } else if (result.compare("draw", Qt::CaseInsensitive) == 0) {
+        outcome = GameLogic::GameResult::Draw;
+    } else {
+        qDebug() << "Unknown game result:" << result;
+        return false;
+    }
+    return saveGame(playerX, playerO, outcome);
+}
+
+bool Database::saveGame(const QString &playerX, const QString &playerO, GameLogic::GameResult result,
+                        const QString &difficulty, quint64 packedMoves) {
+    if (result == GameLogic::GameResult::InProgress) {
+        qDebug() << "Only finished games can be saved";
+        return false;
+    }
+    if (!checkWritablePath()) {
+        return false;
+    }
+    return gameArchive()->append(playerX, playerO, result, difficulty, packedMoves);
 }
 
-QVector<LeaderboardEntry> Database::getLeaderboard(const QVector<User*> &users) const {
+GameArchive* Database::gameArchive() {
+    if (!m_archive) {
+        m_archive = new GameArchive(gameArchivePath(),
+                                    m_readOnly ? GameArchive::Mode::ReadOnly : GameArchive::Mode::ReadWrite);
+    }
+    return m_archive;
+}
+
+QString Database::gameArchivePath() const {
+    return m_dbPath + ".games";
+}
+
+QVector<LeaderboardEntry> Database::getLeaderboard(const QVector<User*> &users) {
     QVector<LeaderboardEntry> leaderboard;
     
     // Populate leaderboard entries from users
@@ -261,7 +858,7 @@ QVector<LeaderboardEntry> Database::getLeaderboard(const QVector<User*> &users)
         // Only include users who have played at least one game
         if (user->getTotalGames() > 0) {
             LeaderboardEntry entry;
-            entry.username = user->getUsername();
+            entry.setUsername(user->getUsername());
             entry.wins = user->getWins();
             entry.totalGames = user->getTotalGames();
             entry.winRate = user->getWinRate();
@@ -269,11 +866,23 @@ QVector<LeaderboardEntry> Database::getLeaderboard(const QVector<User*> &users)
             
             // Calculate score for ranking
             entry.score = calculatePlayerScore(entry.wins, entry.totalGames, entry.winRate, entry.bestStreak);
+            if (m_ranking == Ranking::Rating) {
+                entry.rating = qRound(gameArchive()->rating(entry.username()));
+            }
             
             leaderboard.append(entry);
         }
     }
     
+    if (m_ranking == Ranking::Rating) {
+        // Highest rating first, the score breaks ties
+        std::sort(leaderboard.begin(), leaderboard.end(),
+                  [](const LeaderboardEntry &a, const LeaderboardEntry &b) {
+                      return a.rating != b.rating ? a.rating > b.rating : a.score > b.score;
+                  });
+        return leaderboard;
+    }
+    
     // Sort leaderboard by score (descending)
     std::sort(leaderboard.begin(), leaderboard.end(), 
               [](const LeaderboardEntry &a, const LeaderboardEntry &b) {
@@ -283,7 +892,14 @@ QVector<LeaderboardEntry> Database::getLeaderboard(const QVector<User*> &users)
     return leaderboard;
 }
 
-int Database::calculatePlayerScore(int wins, int totalGames, int winRate, int bestStreak) const {
+QVector<LeaderboardEntry> Database::getLeaderboard(int limit) const {
+    if (!m_sqlite) {
+        return QVector<LeaderboardEntry>();
+    }
+    return m_sqlite->topPlayers(limit);
+}
+
+int Database::calculatePlayerScore(int wins, int totalGames, int winRate, int bestStreak) {
     // Calculate a composite score based on multiple factors
     // This formula weights different aspects of player performance
     
@@ -0,0 +1,296 @@
+#include "../include/databasewriter.h"
+#include "../include/database.h"
+#include <QThread>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QDebug>
+
+DatabaseWriter::DatabaseWriter(const QString &dbPath, QObject *parent)
+    : QObject(parent), m_thread(nullptr), m_database(new Database()),
+      m_loadRequested(false), m_archive(nullptr), m_archiveToOpen(false), m_hasPending(false), m_flushRequested(false),
+      m_stopping(false), m_lastWriteOk(true),
+      m_coalesceWindowMs(DEFAULT_COALESCE_WINDOW_MS), m_retryDelayMs(0),
+      m_requestedGeneration(0), m_writtenGeneration(0),
+      m_metrics{0, 0, 0, 0, 0, 0, 0, 0, 0}
+{
+    m_database->setDatabasePath(dbPath);
+
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("DatabaseWriter");
+    m_thread->start(QThread::LowPriority);
+}
+
+DatabaseWriter::~DatabaseWriter() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wakeup.wakeAll();
+    }
+    // The writer drains anything still pending before it exits, trying a
+    // failing write a few more times first
+    m_thread->wait();
+    delete m_thread;
+    qDeleteAll(m_loadedUsers);
+}
+
+void DatabaseWriter::setCoalesceWindow(int msecs) {
+    QMutexLocker locker(&m_mutex);
+    m_coalesceWindowMs = qMax(0, msecs);
+}
+
+int DatabaseWriter::coalesceWindow() const {
+    QMutexLocker locker(&m_mutex);
+    return m_coalesceWindowMs;
+}
+
+void DatabaseWriter::scheduleSave(const QVector<User*> &users) {
+    // Copy only what changed since the last snapshot, outside the lock; the
+    // copies share their strings and histories
+    QVector<User> changed;
+    for (User* user : users) {
+        if (user->isDirty()) {
+            changed.append(*user);
+            user->clearDirty();
+        }
+    }
+    if (changed.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_hasPending) {
+        m_hasPending = true;
+        m_batchAge.start();
+    }
+    // A user changed twice before the write only needs the newer record
+    for (const User &user : changed) {
+        m_pendingUsers.insert(user.getUsername(), user);
+    }
+    m_metrics.queueDepth++;
+    m_requestedGeneration++;
+    m_wakeup.wakeOne();
+}
+
+void DatabaseWriter::scheduleLoad() {
+    QMutexLocker locker(&m_mutex);
+    m_loadRequested = true;
+    m_wakeup.wakeOne();
+}
+
+QVector<User*> DatabaseWriter::takeLoadedUsers() {
+    QMutexLocker locker(&m_mutex);
+    QVector<User*> users = std::move(m_loadedUsers);
+    m_loadedUsers = QVector<User*>();
+    return users;
+}
+
+void DatabaseWriter::setGameArchive(GameArchive *archive) {
+    QMutexLocker locker(&m_mutex);
+    m_archive = archive;
+    m_archiveToOpen = archive != nullptr;
+    m_wakeup.wakeOne();
+}
+
+void DatabaseWriter::scheduleGame(const ArchivedGame &game) {
+    ArchivedGame stamped = game;
+    if (stamped.playedAt <= 0) {
+        stamped.playedAt = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_archive) {
+        qDebug() << "No game archive to save the game between" << game.playerX << "and" << game.playerO;
+        return;
+    }
+    if (!m_hasPending) {
+        m_hasPending = true;
+        m_batchAge.start();
+    }
+    m_pendingGames.append(stamped);
+    m_metrics.queueDepth++;
+    m_requestedGeneration++;
+    m_wakeup.wakeOne();
+}
+
+bool DatabaseWriter::flush() {
+    QMutexLocker locker(&m_mutex);
+    const quint64 target = m_requestedGeneration;
+    if (m_writtenGeneration >= target) {
+        return m_lastWriteOk;
+    }
+
+    m_flushRequested = true;
+    m_wakeup.wakeAll();
+    while (m_writtenGeneration < target) {
+        m_written.wait(&m_mutex);
+    }
+    return m_lastWriteOk;
+}
+
+DatabaseWriter::Metrics DatabaseWriter::metrics() const {
+    QMutexLocker locker(&m_mutex);
+    return m_metrics;
+}
+
+void DatabaseWriter::run() {
+    QMutexLocker locker(&m_mutex);
+    int failuresWhileStopping = 0;
+    forever {
+        while (!m_hasPending && !m_loadRequested && !m_archiveToOpen && !m_stopping) {
+            m_wakeup.wait(&m_mutex);
+        }
+        if (m_loadRequested) {
+            // Ahead of anything else queued: the window waits on the users
+            m_loadRequested = false;
+            locker.unlock();
+            QVector<User*> users = m_database->loadUsers();
+            if (m_database->journalNeedsCompaction() && m_database->saveUsers(users)) {
+                for (User* user : users) {
+                    user->clearDirty();
+                }
+            }
+            locker.relock();
+            qDeleteAll(m_loadedUsers);
+            m_loadedUsers = users;
+            locker.unlock();
+            emit usersLoaded();
+            locker.relock();
+            continue;
+        }
+        if (m_archiveToOpen) {
+            // Scanning the archive takes a while; saves queue up meanwhile
+            GameArchive *archive = m_archive;
+            m_archiveToOpen = false;
+            locker.unlock();
+            const bool opened = archive->open();
+            emit archiveOpened(opened);
+            locker.relock();
+            continue;
+        }
+        if (!m_hasPending) {
+            break; // Stopping with nothing left to write
+        }
+
+        // Let a burst of requests pile up unless someone is waiting on us.
+        // After a failure, wait out the retry delay even when stopping
+        const bool retrying = m_retryDelayMs > 0;
+        const int window = qMax(m_coalesceWindowMs, m_retryDelayMs);
+        QDeadlineTimer deadline(qMax<qint64>(0, window - m_batchAge.elapsed()));
+        while (!m_flushRequested && (!m_stopping || retrying) && !deadline.hasExpired()) {
+            m_wakeup.wait(&m_mutex, deadline);
+        }
+
+        QHash<QString, User> snapshot = std::move(m_pendingUsers);
+        m_pendingUsers = QHash<QString, User>();
+        const QVector<ArchivedGame> games = std::move(m_pendingGames);
+        m_pendingGames = QVector<ArchivedGame>();
+        GameArchive *archive = m_archive;
+        m_hasPending = false;
+        const quint64 generation = m_requestedGeneration;
+        const int batchSize = m_metrics.queueDepth;
+        m_metrics.queueDepth = 0;
+        QElapsedTimer batchAge = m_batchAge;
+        locker.unlock();
+
+        QElapsedTimer writeTimer;
+        writeTimer.start();
+        QVector<User*> users;
+        users.reserve(snapshot.size());
+        for (User &user : snapshot) {
+            users.append(&user);
+        }
+        qint64 bytesWritten = 0;
+        const bool usersOk = m_database->appendUsers(users, &bytesWritten);
+        int gamesArchived = 0;
+        while (gamesArchived < games.size()) {
+            const ArchivedGame &game = games.at(gamesArchived);
+            if (!archive->append(game.playerX, game.playerO, game.result, game.difficulty, game.packedMoves,
+                                 game.playedAt)) {
+                break;
+            }
+            gamesArchived++;
+        }
+        const bool ok = usersOk && gamesArchived == games.size();
+        const qint64 writeMs = writeTimer.elapsed();
+        const qint64 latencyMs = batchAge.elapsed();
+
+        if (!ok) {
+            qDebug() << "Background save failed after" << writeMs << "ms";
+        }
+        // Nothing else appends to the journal, so this is where a long one
+        // is folded back in
+        const bool compacted = usersOk && !users.isEmpty() && m_database->journalNeedsCompaction()
+            && compactJournal();
+
+        locker.relock();
+        m_lastWriteOk = ok;
+        m_writtenGeneration = generation;
+        if (ok) {
+            m_retryDelayMs = 0;
+        } else if (m_stopping && ++failuresWhileStopping >= SHUTDOWN_ATTEMPTS) {
+            qDebug() << "Giving up on" << (usersOk ? 0 : snapshot.size()) << "unsaved users and"
+                     << games.size() - gamesArchived << "unarchived games at shutdown";
+        } else {
+            // Keep the records for the next batch unless a newer one is queued,
+            // and count the retry as a request so flush() waits for it
+            if (!usersOk) {
+                for (auto it = snapshot.cbegin(); it != snapshot.cend(); ++it) {
+                    if (!m_pendingUsers.contains(it.key())) {
+                        m_pendingUsers.insert(it.key(), it.value());
+                    }
+                }
+            }
+            // Games that did not make it go back ahead of newer ones
+            m_pendingGames = games.mid(gamesArchived) + m_pendingGames;
+            m_hasPending = true;
+            m_requestedGeneration++;
+            m_metrics.queueDepth++;
+            m_batchAge.start();
+            m_retryDelayMs = m_retryDelayMs == 0 ? FIRST_RETRY_DELAY_MS
+                                                 : qMin(2 * m_retryDelayMs, int(MAX_RETRY_DELAY_MS));
+            // The flush that was waiting gets its answer; the retry is not rushed
+            m_flushRequested = false;
+        }
+        if (!ok) {
+            m_metrics.writesFailed++;
+        }
+        m_metrics.writesCompleted++;
+        m_metrics.requestsCoalesced += batchSize - 1;
+        m_metrics.lastWriteLatencyMs = latencyMs;
+        m_metrics.maxWriteLatencyMs = qMax(m_metrics.maxWriteLatencyMs, latencyMs);
+        m_metrics.lastWriteDurationMs = writeMs;
+        m_metrics.lastWriteBytes = bytesWritten;
+        if (compacted) {
+            m_metrics.journalCompactions++;
+        }
+        if (!m_hasPending) {
+            m_flushRequested = false;
+        }
+        m_written.wakeAll();
+
+        locker.unlock();
+        emit saveCompleted(ok, latencyMs);
+        locker.relock();
+    }
+
+    // A SQLite connection has to be closed by the thread that opened it
+    delete m_database;
+    m_database = nullptr;
+}
+
+bool DatabaseWriter::compactJournal() {
+    QElapsedTimer timer;
+    timer.start();
+    // Every record written so far is on disk, so the files have it all.
+    // Users loaded earlier follow their records into the new file
+    QVector<User*> users = m_database->loadUsers();
+    const bool ok = m_database->saveUsers(users);
+    qDeleteAll(users);
+    if (ok) {
+        qDebug() << "Compacted the database journal in" << timer.elapsed() << "ms";
+    } else {
+        qDebug() << "Failed to compact the database journal";
+    }
+    return ok;
+}
@@ -0,0 +1,151 @@
+#include "../include/effectpool.h"
+#include <QGraphicsOpacityEffect>
+#include <QPainter>
+#include <QPropertyAnimation>
+#include <QWidget>
+
+EffectPool::EffectPool(QObject *parent)
+    : QObject(parent)
+{
+}
+
+EffectPool::Fade &EffectPool::fade(QWidget *widget) {
+    auto it = m_fades.find(widget);
+    if (it != m_fades.end()) {
+        return it.value();
+    }
+
+    // The widget owns the effect; it stays installed but disabled between fades
+    QGraphicsOpacityEffect *effect = new QGraphicsOpacityEffect(widget);
+    effect->setEnabled(false);
+    widget->setGraphicsEffect(effect);
+
+    QPropertyAnimation *animation = new QPropertyAnimation(effect, "opacity", this);
+    animation->setEasingCurve(QEasingCurve::InOutQuad);
+    connect(animation, &QPropertyAnimation::finished, this, [this, widget]() {
+        const auto it = m_fades.constFind(widget);
+        if (it == m_fades.constEnd() || !it->widget) {
+            return;
+        }
+        it->effect->setEnabled(false);
+        if (it->hideWhenDone) {
+            it->widget->hide();
+        }
+    });
+    connect(widget, &QObject::destroyed, this, [this, widget]() {
+        delete m_fades.take(widget).animation;
+    });
+
+    return m_fades.insert(widget, Fade{widget, effect, animation, false}).value();
+}
+
+void EffectPool::startFade(QWidget *widget, qreal to, int duration, bool hideWhenDone) {
+    Fade &entry = fade(widget);
+    entry.animation->stop();
+    entry.hideWhenDone = hideWhenDone;
+    if (!hideWhenDone) {
+        widget->setVisible(true);
+    }
+
+    if (duration <= 0) {
+        entry.effect->setEnabled(false);
+        widget->setVisible(!hideWhenDone);
+        return;
+    }
+
+    // A fade that interrupts another carries on from where that one stopped
+    const qreal from = entry.effect->isEnabled() ? entry.effect->opacity() : 1.0 - to;
+    entry.effect->setOpacity(from);
+    entry.effect->setEnabled(true);
+    entry.animation->setDuration(duration);
+    entry.animation->setStartValue(from);
+    entry.animation->setEndValue(to);
+    entry.animation->start();
+}
+
+void EffectPool::fadeIn(QWidget *widget, int duration) {
+    startFade(widget, 1.0, duration, false);
+}
+
+void EffectPool::fadeOut(QWidget *widget, int duration) {
+    if (!widget->isVisible()) {
+        return;
+    }
+    startFade(widget, 0.0, duration, true);
+}
+
+bool EffectPool::isFading(QWidget *widget) const {
+    const auto it = m_fades.constFind(widget);
+    return it != m_fades.constEnd() && it->animation->state() == QAbstractAnimation::Running;
+}
+
+QVector<QPixmap> EffectPool::glowFrames(int radius, int blur, const QColor &from,
+                                        const QColor &to, int frames) {
+    const QString key = QString("%1:%2:%3:%4:%5").arg(radius).arg(blur)
+                            .arg(from.rgba()).arg(to.rgba()).arg(frames);
+    const auto cached = m_glows.constFind(key);
+    if (cached != m_glows.constEnd()) {
+        return cached.value();
+    }
+
+    const int side = glowMargin(radius, blur) * 2 + 1;
+    QVector<QPixmap> result;
+    result.reserve(frames);
+    for (int frame = 0; frame < frames; ++frame) {
+        const qreal t = frames > 1 ? qreal(frame) / (frames - 1) : 0.0;
+        const QColor color = QColor::fromRgbF(from.redF() + (to.redF() - from.redF()) * t,
+                                              from.greenF() + (to.greenF() - from.greenF()) * t,
+                                              from.blueF() + (to.blueF() - from.blueF()) * t,
+                                              from.alphaF() + (to.alphaF() - from.alphaF()) * t);
+
+        QPixmap pixmap(side, side);
+        pixmap.fill(Qt::transparent);
+        QPainter painter(&pixmap);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setBrush(Qt::NoBrush);
+        // Rings fading out towards the middle stand in for the blur
+        for (int ring = 0; ring < blur; ++ring) {
+            const qreal falloff = 1.0 - qreal(ring) / blur;
+            QColor ringColor = color;
+            ringColor.setAlphaF(color.alphaF() * falloff * falloff);
+            painter.setPen(QPen(ringColor, 1.0));
+            const qreal inset = ring + 0.5;
+            painter.drawRoundedRect(QRectF(inset, inset, side - 2 * inset, side - 2 * inset),
+                                    radius, radius);
+        }
+        painter.end();
+        result.append(pixmap);
+    }
+
+    m_glows.insert(key, result);
+    return result;
+}
+
+void EffectPool::drawGlow(QPainter *painter, const QRect &rect, const QPixmap &frame, int margin) {
+    const int side = frame.width();
+    const int middle = side - 2 * margin;
+    const int innerWidth = rect.width() - 2 * margin;
+    const int innerHeight = rect.height() - 2 * margin;
+    if (innerWidth < 0 || innerHeight < 0) {
+        return;
+    }
+    const int left = rect.left();
+    const int top = rect.top();
+    const int right = rect.left() + rect.width() - margin;
+    const int bottom = rect.top() + rect.height() - margin;
+
+    // Corners
+    painter->drawPixmap(QRect(left, top, margin, margin), frame, QRect(0, 0, margin, margin));
+    painter->drawPixmap(QRect(right, top, margin, margin), frame, QRect(side - margin, 0, margin, margin));
+    painter->drawPixmap(QRect(left, bottom, margin, margin), frame, QRect(0, side - margin, margin, margin));
+    painter->drawPixmap(QRect(right, bottom, margin, margin), frame,
+                        QRect(side - margin, side - margin, margin, margin));
+
+    // Edges, stretched from the frame's middle row and column
+    painter->drawPixmap(QRect(left + margin, top, innerWidth, margin), frame, QRect(margin, 0, middle, margin));
+    painter->drawPixmap(QRect(left + margin, bottom, innerWidth, margin), frame,
+                        QRect(margin, side - margin, middle, margin));
+    painter->drawPixmap(QRect(left, top + margin, margin, innerHeight), frame, QRect(0, margin, margin, middle));
+    painter->drawPixmap(QRect(right, top + margin, margin, innerHeight), frame,
+                        QRect(side - margin, margin, margin, middle));
+}
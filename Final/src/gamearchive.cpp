@@ -0,0 +1,482 @@
+#include "../include/gamearchive.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+// Stored as a single byte; index 0 is a two-player game
+static const char *const kDifficulties[] = {"", "easy", "medium", "hard", "expert"};
+static constexpr int kDifficultyCount = sizeof(kDifficulties) / sizeof(kDifficulties[0]);
+static constexpr quint32 kNoPlayer = 0xFFFFFFFFu;
+static constexpr int kReadBatch = 4096; // Records read at once while indexing
+
+static RatedGame decodeRatedGame(const uchar *data) {
+    RatedGame game;
+    game.playerX = qFromLittleEndian<quint32>(data + 8);
+    game.playerO = qFromLittleEndian<quint32>(data + 12);
+    game.result = static_cast<GameLogic::GameResult>(data[24]);
+    game.aiDifficulty = data[25];
+    return game;
+}
+
+// Record layout, little endian:
+//   0  qint64  played at, ms since the epoch
+//   8  quint32 player X id
+//   12 quint32 player O id
+//   16 quint64 packed moves
+//   24 quint8  result (GameLogic::GameResult)
+//   25 quint8  difficulty
+//   26 reserved
+GameArchive::GameArchive(const QString &path, Mode mode)
+    : m_path(path), m_mode(mode), m_open(false)
+{
+}
+
+QString GameArchive::path() const {
+    return m_path;
+}
+
+bool GameArchive::open() {
+    return ensureOpen();
+}
+
+bool GameArchive::isOpen() const {
+    return m_open;
+}
+
+bool GameArchive::ensureOpen() {
+    if (m_open) {
+        return true;
+    }
+    QMutexLocker writing(&m_writeMutex);
+    return load();
+}
+
+bool GameArchive::load() {
+    if (m_open) {
+        return true;
+    }
+
+    // Readers wait in ensureOpen() until m_open is set, so until then the
+    // files and the index are this thread's alone
+    m_file.setFileName(m_path);
+    m_appendFile.setFileName(m_path);
+    m_playersFile.setFileName(m_path + ".players");
+    const bool readOnly = m_mode == Mode::ReadOnly;
+    if (readOnly && !m_file.exists()) {
+        // Nothing archived yet, and nothing to create
+        m_open = true;
+        return true;
+    }
+    const QIODevice::OpenMode openMode = readOnly ? QIODevice::ReadOnly : QIODevice::ReadWrite;
+    if ((!readOnly && !m_appendFile.open(QIODevice::ReadWrite)) || !m_playersFile.open(openMode)
+        || !m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qDebug() << "Failed to open game archive:" << m_path;
+        m_file.close();
+        m_appendFile.close();
+        m_playersFile.close();
+        return false;
+    }
+
+    Index index;
+    index.ratingEngine.setParameters(m_index.ratingEngine.parameters());
+
+    // Player names, one per line; a line without its newline was torn by a crash
+    qint64 playersEnd = 0;
+    while (!m_playersFile.atEnd()) {
+        QByteArray line = m_playersFile.readLine();
+        if (!line.endsWith('\n')) {
+            break;
+        }
+        playersEnd += line.size();
+        line.chop(1);
+        index.addPlayer(QString::fromUtf8(line));
+    }
+    if (playersEnd != m_playersFile.size() && !readOnly) {
+        m_playersFile.resize(playersEnd);
+    }
+
+    // One sequential pass over the records rebuilds the indexes and collects
+    // the games to rate and the openings
+    const quint32 stored = static_cast<quint32>(m_file.size() / RECORD_SIZE);
+    QVector<RatedGame> games;
+    games.reserve(stored);
+    QVector<OpeningGame> openings;
+    openings.reserve(stored);
+    quint32 record = 0;
+    bool intact = true;
+    while (intact && record < stored) {
+        const QByteArray chunk = m_file.read(qint64(qMin<quint32>(stored - record, kReadBatch)) * RECORD_SIZE);
+        if (chunk.size() < RECORD_SIZE) {
+            break;
+        }
+        for (int pos = 0; pos + RECORD_SIZE <= chunk.size(); pos += RECORD_SIZE) {
+            const uchar *data = reinterpret_cast<const uchar*>(chunk.constData()) + pos;
+            const qint64 time = qFromLittleEndian<qint64>(data);
+            const quint32 playerX = qFromLittleEndian<quint32>(data + 8);
+            const quint32 playerO = qFromLittleEndian<quint32>(data + 12);
+            if (playerX >= quint32(index.playerNames.size()) || playerO >= quint32(index.playerNames.size())) {
+                // Written after a player name that never made it to disk
+                intact = false;
+                break;
+            }
+            index.addRecord(record, time, playerX, playerO, static_cast<GameLogic::GameResult>(data[24]),
+                            data[25] != 0);
+            games.append(decodeRatedGame(data));
+            openings.append({qFromLittleEndian<quint64>(data + 16), static_cast<GameLogic::GameResult>(data[24])});
+            record++;
+        }
+    }
+    index.count = record;
+    if (m_file.size() != qint64(index.count) * RECORD_SIZE) {
+        if (readOnly) {
+            qDebug() << "Ignoring incomplete records at the end of the game archive:" << m_path;
+        } else {
+            qDebug() << "Dropping incomplete records at the end of the game archive:" << m_path;
+            m_appendFile.resize(qint64(index.count) * RECORD_SIZE);
+        }
+    }
+    games.resize(index.count);
+    index.ratingEngine.recompute(games);
+    openings.resize(index.count);
+    index.openings.build(openings);
+
+    QMutexLocker locker(&m_mutex);
+    m_index = std::move(index);
+    m_open = true;
+    return true;
+}
+
+void GameArchive::Index::addPlayer(const QString &name) {
+    playerIds.insert(name, playerNames.size());
+    playerNames.append(name);
+    playerGames.append(QVector<quint32>());
+}
+
+void GameArchive::Index::addRecord(quint32 record, qint64 time, quint32 playerX, quint32 playerO,
+                                   GameLogic::GameResult result, bool vsAI) {
+    playerGames[playerX].append(record);
+    if (playerO != playerX) {
+        playerGames[playerO].append(record);
+    }
+    const qint64 bucket = time / BUCKET_MS;
+    if (buckets.isEmpty() || buckets.lastKey() < bucket) {
+        buckets.insert(bucket, record);
+    }
+    if (!vsAI) {
+        headToHead.record(playerX, playerO, result);
+    }
+    lastPlayedAt = time;
+}
+
+quint32 GameArchive::playerId(const QString &name) {
+    // Only appends add players, and they hold m_writeMutex
+    auto it = m_index.playerIds.constFind(name);
+    if (it != m_index.playerIds.constEnd()) {
+        return it.value();
+    }
+
+    // The name goes to disk before any record can refer to it
+    const QByteArray line = name.toUtf8() + '\n';
+    if (!m_playersFile.seek(m_playersFile.size()) || m_playersFile.write(line) != line.size()
+        || !m_playersFile.flush()) {
+        qDebug() << "Failed to add player to game archive:" << name;
+        return kNoPlayer;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_index.addPlayer(name);
+    return m_index.playerNames.size() - 1;
+}
+
+bool GameArchive::append(const QString &playerX, const QString &playerO, GameLogic::GameResult result,
+                         const QString &difficulty, quint64 packedMoves, qint64 playedAt) {
+    QMutexLocker writing(&m_writeMutex);
+    if (m_mode == Mode::ReadOnly) {
+        qDebug() << "Game archive opened read-only:" << m_path;
+        return false;
+    }
+    if (!load()) {
+        return false;
+    }
+
+    const quint32 idX = playerId(playerX);
+    const quint32 idO = playerId(playerO);
+    if (idX == kNoPlayer || idO == kNoPlayer) {
+        return false;
+    }
+
+    // Time never runs backwards in the archive, whatever the clock does
+    qint64 time = playedAt < 0 ? QDateTime::currentMSecsSinceEpoch() : playedAt;
+    time = qMax(time, m_index.lastPlayedAt);
+
+    quint8 difficultyCode = 0;
+    for (int i = 1; i < kDifficultyCount; ++i) {
+        if (difficulty == QLatin1String(kDifficulties[i])) {
+            difficultyCode = quint8(i);
+        }
+    }
+
+    uchar data[RECORD_SIZE] = {};
+    qToLittleEndian<qint64>(time, data);
+    qToLittleEndian<quint32>(idX, data + 8);
+    qToLittleEndian<quint32>(idO, data + 12);
+    qToLittleEndian<quint64>(packedMoves, data + 16);
+    data[24] = quint8(result);
+    data[25] = difficultyCode;
+
+    // Readers never look past count, so the record is written without
+    // keeping them waiting
+    const quint32 record = m_index.count;
+    if (!m_appendFile.seek(qint64(record) * RECORD_SIZE)
+        || m_appendFile.write(reinterpret_cast<const char*>(data), RECORD_SIZE) != RECORD_SIZE
+        || !m_appendFile.flush()) {
+        qDebug() << "Failed to append to game archive:" << m_path;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_index.addRecord(record, time, idX, idO, result, difficultyCode != 0);
+    m_index.ratingEngine.apply(decodeRatedGame(data));
+    m_index.openings.add(packedMoves, result);
+    m_index.count++;
+    return true;
+}
+
+qint64 GameArchive::count() {
+    if (!ensureOpen()) {
+        return 0;
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_index.count;
+}
+
+qint64 GameArchive::playedAt(quint32 record) {
+    uchar data[sizeof(qint64)];
+    if (!m_file.seek(qint64(record) * RECORD_SIZE)
+        || m_file.read(reinterpret_cast<char*>(data), sizeof(data)) != qint64(sizeof(data))) {
+        return 0;
+    }
+    return qFromLittleEndian<qint64>(data);
+}
+
+quint32 GameArchive::firstRecordFrom(qint64 time) {
+    // The hour narrows it down to one bucket, a binary search does the rest
+    const qint64 bucket = time / BUCKET_MS;
+    auto it = m_index.buckets.lowerBound(bucket);
+    if (it == m_index.buckets.end()) {
+        return m_index.count;
+    }
+    quint32 low = it.value();
+    if (it.key() > bucket) {
+        return low;
+    }
+    auto next = std::next(it);
+    quint32 high = next == m_index.buckets.end() ? m_index.count : next.value();
+    while (low < high) {
+        const quint32 mid = low + (high - low) / 2;
+        if (playedAt(mid) < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool GameArchive::readRecord(quint32 record, ArchivedGame *game) {
+    uchar data[RECORD_SIZE];
+    if (!m_file.seek(qint64(record) * RECORD_SIZE)
+        || m_file.read(reinterpret_cast<char*>(data), RECORD_SIZE) != RECORD_SIZE) {
+        qDebug() << "Failed to read game" << record << "from archive:" << m_path;
+        return false;
+    }
+
+    decodeRecord(record, data, game);
+    return true;
+}
+
+void GameArchive::decodeRecord(quint32 record, const uchar *data, ArchivedGame *game) const {
+    game->id = record;
+    game->playedAt = qFromLittleEndian<qint64>(data);
+    game->playerX = m_index.playerNames.value(qFromLittleEndian<quint32>(data + 8));
+    game->playerO = m_index.playerNames.value(qFromLittleEndian<quint32>(data + 12));
+    game->packedMoves = qFromLittleEndian<quint64>(data + 16);
+    game->result = static_cast<GameLogic::GameResult>(data[24]);
+    game->difficulty = data[25] < kDifficultyCount ? QString(kDifficulties[data[25]]) : QString();
+}
+
+QVector<ArchivedGame> GameArchive::gamesOf(const QString &player, qint64 from, qint64 to, int offset, int limit) {
+    QVector<ArchivedGame> games;
+    if (limit <= 0 || offset < 0 || from >= to || !ensureOpen()) {
+        return games;
+    }
+    QMutexLocker locker(&m_mutex);
+    auto id = m_index.playerIds.constFind(player);
+    if (id == m_index.playerIds.constEnd()) {
+        return games;
+    }
+
+    const QVector<quint32> &records = m_index.playerGames.at(id.value());
+    const auto first = std::lower_bound(records.constBegin(), records.constEnd(), firstRecordFrom(from));
+    const auto last = std::lower_bound(first, records.constEnd(), firstRecordFrom(to));
+
+    // Newest first, starting from the end of the range
+    games.reserve(qMin<qint64>(limit, last - first));
+    for (qint64 i = (last - first) - 1 - offset; i >= 0 && games.size() < limit; --i) {
+        ArchivedGame game;
+        if (readRecord(*(first + i), &game)) {
+            games.append(game);
+        }
+    }
+    return games;
+}
+
+int GameArchive::countGamesOf(const QString &player, qint64 from, qint64 to) {
+    if (from >= to || !ensureOpen()) {
+        return 0;
+    }
+    QMutexLocker locker(&m_mutex);
+    auto id = m_index.playerIds.constFind(player);
+    if (id == m_index.playerIds.constEnd()) {
+        return 0;
+    }
+
+    const QVector<quint32> &records = m_index.playerGames.at(id.value());
+    const auto first = std::lower_bound(records.constBegin(), records.constEnd(), firstRecordFrom(from));
+    const auto last = std::lower_bound(first, records.constEnd(), firstRecordFrom(to));
+    return int(last - first);
+}
+
+QVector<ArchivedGame> GameArchive::latest(int offset, int limit) {
+    QVector<ArchivedGame> games;
+    if (limit <= 0 || offset < 0 || !ensureOpen()) {
+        return games;
+    }
+    QMutexLocker locker(&m_mutex);
+
+    games.reserve(qMin<qint64>(limit, m_index.count));
+    for (qint64 record = qint64(m_index.count) - 1 - offset; record >= 0 && games.size() < limit; --record) {
+        ArchivedGame game;
+        if (readRecord(quint32(record), &game)) {
+            games.append(game);
+        }
+    }
+    return games;
+}
+
+QVector<ArchivedGame> GameArchive::range(qint64 first, int limit) {
+    QVector<ArchivedGame> games;
+    if (limit <= 0 || first < 0 || !ensureOpen()) {
+        return games;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (first >= m_index.count) {
+        return games;
+    }
+
+    const int wanted = int(qMin<qint64>(limit, m_index.count - first));
+    if (!m_file.seek(first * RECORD_SIZE)) {
+        qDebug() << "Failed to read game archive:" << m_path;
+        return games;
+    }
+    const QByteArray chunk = m_file.read(qint64(wanted) * RECORD_SIZE);
+    games.resize(chunk.size() / RECORD_SIZE);
+    for (int i = 0; i < games.size(); ++i) {
+        decodeRecord(quint32(first + i), reinterpret_cast<const uchar*>(chunk.constData()) + i * RECORD_SIZE,
+                     &games[i]);
+    }
+    return games;
+}
+
+HeadToHeadStats GameArchive::headToHead(const QString &player, const QString &opponent) {
+    if (!ensureOpen()) {
+        return HeadToHeadStats();
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!m_index.playerIds.contains(player) || !m_index.playerIds.contains(opponent)) {
+        return HeadToHeadStats();
+    }
+    return m_index.headToHead.stats(m_index.playerIds.value(player), m_index.playerIds.value(opponent));
+}
+
+QVector<Rival> GameArchive::topRivals(const QString &player) {
+    QVector<Rival> rivals;
+    if (!ensureOpen()) {
+        return rivals;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (!m_index.playerIds.contains(player)) {
+        return rivals;
+    }
+
+    const auto ranked = m_index.headToHead.topRivals(m_index.playerIds.value(player));
+    rivals.reserve(ranked.size());
+    for (const auto &entry : ranked) {
+        rivals.append({m_index.playerNames.value(entry.first), entry.second});
+    }
+    return rivals;
+}
+
+double GameArchive::rating(const QString &player) {
+    const bool opened = ensureOpen();
+    QMutexLocker locker(&m_mutex);
+    if (!opened || !m_index.playerIds.contains(player)) {
+        return m_index.ratingEngine.parameters().initialRating;
+    }
+    return m_index.ratingEngine.rating(m_index.playerIds.value(player));
+}
+
+OpeningTrie GameArchive::openings() {
+    ensureOpen();
+    QMutexLocker locker(&m_mutex);
+    return m_index.openings;
+}
+
+RatingEngine::Parameters GameArchive::ratingParameters() const {
+    QMutexLocker locker(&m_mutex);
+    return m_index.ratingEngine.parameters();
+}
+
+bool GameArchive::setRatingParameters(const RatingEngine::Parameters &parameters) {
+    QMutexLocker writing(&m_writeMutex);
+    if (!m_open) {
+        QMutexLocker locker(&m_mutex);
+        m_index.ratingEngine.setParameters(parameters);
+        return true; // Rated when the archive is opened
+    }
+
+    // Re-rated aside, so the current ratings can be read meanwhile
+    const quint32 count = m_index.count;
+    const QVector<RatedGame> games = ratedGames(count);
+    if (games.size() != int(count)) {
+        return false;
+    }
+    RatingEngine engine(parameters);
+    engine.recompute(games);
+
+    QMutexLocker locker(&m_mutex);
+    m_index.ratingEngine = std::move(engine);
+    return true;
+}
+
+QVector<RatedGame> GameArchive::ratedGames(quint32 count) const {
+    QVector<RatedGame> games;
+    games.reserve(count);
+    QFile file(m_path);
+    if (count == 0 || !file.open(QIODevice::ReadOnly)) {
+        return games;
+    }
+    while (games.size() < int(count)) {
+        const QByteArray chunk = file.read(qint64(qMin<quint32>(count - games.size(), kReadBatch)) * RECORD_SIZE);
+        if (chunk.size() < RECORD_SIZE) {
+            qDebug() << "Failed to read game archive:" << m_path;
+            break;
+        }
+        for (int pos = 0; pos + RECORD_SIZE <= chunk.size(); pos += RECORD_SIZE) {
+            games.append(decodeRatedGame(reinterpret_cast<const uchar*>(chunk.constData()) + pos));
+        }
+    }
+    return games;
+}
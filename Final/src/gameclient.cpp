@@ -0,0 +1,105 @@
+#include "../include/gameclient.h"
+#include "../include/gameprotocol.h"
+#include <QDebug>
+#include <QTcpSocket>
+
+GameClient::GameClient(QObject *parent)
+    : QObject(parent),
+      m_socket(new QTcpSocket(this))
+{
+    connect(m_socket, &QTcpSocket::connected, this, [this]() {
+        m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        emit connected();
+    });
+    connect(m_socket, &QTcpSocket::disconnected, this, &GameClient::disconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &GameClient::onReadyRead);
+}
+
+void GameClient::connectToServer(const QString &host, quint16 port) {
+    m_inbox.clear();
+    m_socket->connectToHost(host, port);
+}
+
+void GameClient::disconnectFromServer() {
+    m_socket->disconnectFromHost();
+}
+
+bool GameClient::isConnected() const {
+    return m_socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void GameClient::openGame(const QString &playerX, const QString &playerO) {
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::Open, 0, 0,
+                         GameProtocol::encodePlayers(playerX, playerO));
+    m_socket->write(frame);
+}
+
+void GameClient::sendMove(quint32 session, int cellIndex) {
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::Move, session, quint8(cellIndex));
+    m_socket->write(frame);
+}
+
+void GameClient::queueForMatch(const QString &username, const QString &password) {
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::Queue, 0, 0,
+                         GameProtocol::encodePlayers(username, password));
+    m_socket->write(frame);
+}
+
+void GameClient::watchGame(quint32 session) {
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::Watch, session);
+    m_socket->write(frame);
+}
+
+void GameClient::onReadyRead() {
+    if (m_inbox.isEmpty()) {
+        m_inbox = m_socket->readAll();
+    } else {
+        m_inbox.append(m_socket->readAll());
+    }
+
+    int offset = 0;
+    bool error = false;
+    GameProtocol::Frame frame;
+    while (GameProtocol::take(m_inbox, &offset, &frame, &error)) {
+        switch (frame.type) {
+        case GameProtocol::FrameType::Opened:
+            emit gameOpened(frame.session);
+            break;
+        case GameProtocol::FrameType::Moved:
+            emit moved(frame.session, frame.argument & 0xF,
+                       (frame.argument >> 4) == 1 ? GameLogic::Player::X : GameLogic::Player::O);
+            break;
+        case GameProtocol::FrameType::Rejected:
+            emit moveRejected(frame.session, frame.argument);
+            break;
+        case GameProtocol::FrameType::GameOver:
+            emit gameOver(frame.session, GameLogic::GameResult(frame.argument));
+            break;
+        case GameProtocol::FrameType::Matched:
+            emit matchFound(frame.session, frame.argument == 1 ? GameLogic::Player::X
+                                                               : GameLogic::Player::O);
+            break;
+        case GameProtocol::FrameType::Board: {
+            quint16 xCells = 0;
+            quint16 oCells = 0;
+            if (frame.session == 0 || GameProtocol::decodeBoard(frame.payload, &xCells, &oCells)) {
+                emit boardSnapshot(frame.session, xCells, oCells);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    if (error) {
+        qDebug() << "Game server sent a malformed frame, disconnecting";
+        m_inbox.clear();
+        m_socket->abort();
+        return;
+    }
+    m_inbox.remove(0, offset);
+}
@@ -1,6 +1,15 @@
 #include "../include/gamehistory.h"
+#include "../include/stringinterner.h"
 #include <QDateTime>
 
+QString GameHistory::HistoryEntry::date() const {
+    return StringInterner::dateString(dateKey);
+}
+
+QString GameHistory::HistoryEntry::result() const {
+    return resultText;
+}
+
 GameHistory::GameHistory(QObject *parent)
     : QObject(parent)
 {
@@ -8,8 +17,8 @@ GameHistory::GameHistory(QObject *parent)
 
 void GameHistory::addEntry(const QString &result) {
     HistoryEntry entry;
-    entry.date = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    entry.result = result;
+    entry.dateKey = StringInterner::internDate(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"));
+    entry.resultText = result;
     
     m_entries.prepend(entry);
     
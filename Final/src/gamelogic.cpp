@@ -1,16 +1,25 @@
 #include "../include/gamelogic.h"
 #include <QRandomGenerator>
 
+// Win patterns live in static storage so checking for a winner never allocates
+static constexpr int kWinPatterns[8][3] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8},  // Rows
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8},  // Columns
+    {0, 4, 8}, {2, 4, 6}              // Diagonals
+};
+
 GameLogic::GameLogic(QObject *parent)
     : QObject(parent), m_currentPlayer(Player::X), m_gameActive(true), m_difficulty(AIDifficulty::Medium)
 {
+    // Reserve once so resetting and playing never reallocates
+    m_board.reserve(9);
+    m_moveHistory.reserve(9);
+    m_winPattern.reserve(3);
     resetBoard();
 }
 
 void GameLogic::resetBoard() {
-    m_board.clear();
-    m_board.resize(9);
-    m_board.fill(Player::None);
+    m_board.fill(Player::None, 9);
     m_currentPlayer = Player::X;
     m_gameActive = true;
     m_winPattern.clear();
@@ -112,14 +121,7 @@ QVector<int> GameLogic::getWinPattern() const {
 }
 
 bool GameLogic::checkWinner() {
-    const QVector<QVector<int>> winPatterns = {
-        {0, 1, 2}, {3, 4, 5}, {6, 7, 8},  // Rows
-        {0, 3, 6}, {1, 4, 7}, {2, 5, 8},  // Columns
-        {0, 4, 8}, {2, 4, 6}              // Diagonals
-    };
-    
-    const auto& patterns = winPatterns;
-    for (const QVector<int>& pattern : patterns) {
+    for (const auto& pattern : kWinPatterns) {
         const int a = pattern[0];
         const int b = pattern[1];
         const int c = pattern[2];
@@ -127,7 +129,10 @@ bool GameLogic::checkWinner() {
         if (m_board[a] != Player::None && 
             m_board[a] == m_board[b] && 
             m_board[a] == m_board[c]) {
-            m_winPattern = pattern;
+            m_winPattern.resize(3);
+            m_winPattern[0] = a;
+            m_winPattern[1] = b;
+            m_winPattern[2] = c;
             return true;
         }
     }
@@ -0,0 +1,82 @@
+#include "../include/gameprotocol.h"
+#include <QtEndian>
+
+void GameProtocol::append(QByteArray &out, FrameType type, quint32 session, quint8 argument,
+                          const QByteArray &payload) {
+    uchar header[HEADER_SIZE];
+    header[0] = quint8(type);
+    header[1] = argument;
+    qToLittleEndian<quint16>(quint16(payload.size()), header + 2);
+    qToLittleEndian<quint32>(session, header + 4);
+    out.append(reinterpret_cast<const char*>(header), HEADER_SIZE);
+    out.append(payload);
+}
+
+bool GameProtocol::take(const QByteArray &buffer, int *offset, Frame *frame, bool *error) {
+    *error = false;
+    if (buffer.size() - *offset < HEADER_SIZE) {
+        return false;
+    }
+
+    const uchar *header = reinterpret_cast<const uchar*>(buffer.constData()) + *offset;
+    const quint8 type = header[0];
+    const int length = qFromLittleEndian<quint16>(header + 2);
+    if (type < quint8(FrameType::Open) || type > quint8(FrameType::Board) || length > MAX_PAYLOAD) {
+        *error = true;
+        return false;
+    }
+    if (buffer.size() - *offset < HEADER_SIZE + length) {
+        return false;
+    }
+
+    frame->type = FrameType(type);
+    frame->argument = header[1];
+    frame->session = qFromLittleEndian<quint32>(header + 4);
+    if (length > 0) {
+        frame->payload = buffer.mid(*offset + HEADER_SIZE, length);
+    } else {
+        frame->payload.clear();
+    }
+    *offset += HEADER_SIZE + length;
+    return true;
+}
+
+QByteArray GameProtocol::encodePlayers(const QString &playerX, const QString &playerO) {
+    const QByteArray x = playerX.toUtf8().left(255);
+    QByteArray payload;
+    payload.reserve(1 + x.size() + playerO.size());
+    payload.append(char(x.size()));
+    payload.append(x);
+    payload.append(playerO.toUtf8().left(MAX_PAYLOAD - 1 - x.size()));
+    return payload;
+}
+
+bool GameProtocol::decodePlayers(const QByteArray &payload, QString *playerX, QString *playerO) {
+    if (payload.isEmpty()) {
+        return false;
+    }
+    const int length = quint8(payload.at(0));
+    if (1 + length > payload.size()) {
+        return false;
+    }
+    *playerX = QString::fromUtf8(payload.constData() + 1, length);
+    *playerO = QString::fromUtf8(payload.constData() + 1 + length, payload.size() - 1 - length);
+    return !playerX->isEmpty() && !playerO->isEmpty();
+}
+
+QByteArray GameProtocol::encodeBoard(quint16 xCells, quint16 oCells) {
+    uchar payload[4];
+    qToLittleEndian<quint16>(xCells, payload);
+    qToLittleEndian<quint16>(oCells, payload + 2);
+    return QByteArray(reinterpret_cast<const char*>(payload), 4);
+}
+
+bool GameProtocol::decodeBoard(const QByteArray &payload, quint16 *xCells, quint16 *oCells) {
+    if (payload.size() != 4) {
+        return false;
+    }
+    const uchar *data = reinterpret_cast<const uchar*>(payload.constData());
+    *xCells = qFromLittleEndian<quint16>(data);
+    *oCells = qFromLittleEndian<quint16>(data + 2);
+    return ((*xCells | *oCells) >> 9) == 0 && (*xCells & *oCells) == 0;
+}
@@ -0,0 +1,494 @@
+#include "../include/gameserver.h"
+#include "../include/authentication.h"
+#include "../include/database.h"
+#include "../include/gamearchive.h"
+#include "../include/movecodec.h"
+#include "../include/stringinterner.h"
+#include <QDebug>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtAlgorithms>
+
+GameServer::GameServer(Database *database, QObject *parent)
+    : QObject(parent),
+      m_database(database),
+      m_auth(nullptr),
+      m_server(new QTcpServer(this)),
+      m_slotCount(0),
+      m_persistTimer(new QTimer(this)),
+      m_matchTimer(new QTimer(this))
+{
+    connect(m_server, &QTcpServer::newConnection, this, &GameServer::onNewConnection);
+
+    m_persistTimer->setSingleShot(true);
+    m_persistTimer->setInterval(PERSIST_INTERVAL_MS);
+    connect(m_persistTimer, &QTimer::timeout, this, &GameServer::persistFinishedGames);
+
+    m_matchTimer->setInterval(MATCH_POLL_MS);
+    connect(m_matchTimer, &QTimer::timeout, this, &GameServer::onMatchTimeout);
+    m_clock.start();
+}
+
+GameServer::~GameServer() {
+    persistFinishedGames();
+    for (int index = 0; index < m_slotCount; ++index) {
+        closeBroadcast(slot(quint32(index)));
+    }
+    for (Connection *connection : m_connections) {
+        while (!connection->watching.isEmpty()) {
+            removeWatcher(connection->watching.last());
+        }
+        connection->socket->disconnect(this);
+        delete connection;
+    }
+    for (Session *chunk : m_chunks) {
+        delete[] chunk;
+    }
+}
+
+void GameServer::setAuthentication(Authentication *auth) {
+    m_auth = auth;
+}
+
+bool GameServer::listen(quint16 port) {
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        qDebug() << "Game server could not listen on port" << port << ":" << m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+quint16 GameServer::port() const {
+    return m_server->serverPort();
+}
+
+void GameServer::close() {
+    m_server->close();
+}
+
+GameServer::Metrics GameServer::metrics() const {
+    Metrics metrics = m_metrics;
+    metrics.activeSessions = m_slotCount - m_freeSlots.size();
+    metrics.pooledSessions = m_slotCount;
+    metrics.playersWaiting = m_matchmaker.waitingCount();
+    return metrics;
+}
+
+void GameServer::onNewConnection() {
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        // Frames are tiny and each one waits on the last, so don't batch them
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+        Connection *connection = new Connection;
+        connection->socket = socket;
+        m_connections.insert(socket, connection);
+        connect(socket, &QTcpSocket::readyRead, this, [this, connection]() { onReadyRead(connection); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, connection]() { onDisconnected(connection); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, connection]() { onBytesWritten(connection); });
+    }
+}
+
+void GameServer::onReadyRead(Connection *connection) {
+    if (connection->inbox.isEmpty()) {
+        connection->inbox = connection->socket->readAll();
+    } else {
+        connection->inbox.append(connection->socket->readAll());
+    }
+
+    int offset = 0;
+    bool error = false;
+    GameProtocol::Frame frame;
+    while (GameProtocol::take(connection->inbox, &offset, &frame, &error)) {
+        handleFrame(connection, frame);
+    }
+    if (error) {
+        qDebug() << "Dropping game client that sent a malformed frame";
+        connection->socket->disconnect(this);
+        connection->socket->abort();
+        onDisconnected(connection);
+        return;
+    }
+    connection->inbox.remove(0, offset);
+}
+
+void GameServer::onDisconnected(Connection *connection) {
+    // Games the client was part of are abandoned; the other side, if it is
+    // someone else, is told with an InProgress result. Releasing a session
+    // takes it off the list
+    while (!connection->sessions.isEmpty()) {
+        const quint32 index = connection->sessions.last();
+        Session &session = slot(index);
+        Connection *other = session.ownerX == connection ? session.ownerO : session.ownerX;
+        if (other && other != connection) {
+            send(other, GameProtocol::FrameType::GameOver, sessionId(index, session.generation),
+                 quint8(GameLogic::GameResult::InProgress));
+        }
+        if (session.broadcast) {
+            session.broadcast->feed.finish(GameLogic::GameResult::InProgress);
+        }
+        releaseSession(index);
+    }
+    while (!connection->watching.isEmpty()) {
+        removeWatcher(connection->watching.last());
+    }
+    for (quint32 player : connection->queued) {
+        m_matchmaker.cancel(player);
+        m_queued.remove(player);
+    }
+
+    m_connections.remove(connection->socket);
+    connection->socket->deleteLater();
+    delete connection;
+}
+
+void GameServer::onBytesWritten(Connection *connection) {
+    if (connection->watching.isEmpty() || connection->socket->bytesToWrite() > 0) {
+        return;
+    }
+    // Drained: games this connection fell behind on send their latest board
+    const QVector<Watcher*> watching = connection->watching;
+    for (Watcher *watcher : watching) {
+        Broadcast *broadcast = watcher->broadcast;
+        broadcast->feed.resume(watcher);
+        // A finished game's board carries its result, so that was the last frame
+        if (broadcast->closed && !broadcast->feed.isBehind(watcher)) {
+            removeWatcher(watcher);
+        }
+    }
+}
+
+bool GameServer::Watcher::deliver(const QByteArray &frame) {
+    if (connection->socket->bytesToWrite() > SPECTATOR_BACKLOG) {
+        return false;
+    }
+    connection->socket->write(frame);
+    return true;
+}
+
+void GameServer::handleFrame(Connection *connection, const GameProtocol::Frame &frame) {
+    switch (frame.type) {
+    case GameProtocol::FrameType::Open:
+        openSession(connection, frame);
+        break;
+    case GameProtocol::FrameType::Move:
+        playMove(connection, frame);
+        break;
+    case GameProtocol::FrameType::Queue:
+        queuePlayer(connection, frame);
+        break;
+    case GameProtocol::FrameType::Watch:
+        watchSession(connection, frame);
+        break;
+    default:
+        // Server-to-client frames have no meaning here
+        send(connection, GameProtocol::FrameType::Rejected, frame.session, frame.argument);
+        break;
+    }
+}
+
+void GameServer::openSession(Connection *connection, const GameProtocol::Frame &frame) {
+    QString playerX;
+    QString playerO;
+    if (!GameProtocol::decodePlayers(frame.payload, &playerX, &playerO)
+        || playerX == QLatin1String(GameArchive::COMPUTER_PLAYER)
+        || playerO == QLatin1String(GameArchive::COMPUTER_PLAYER)) {
+        // Session 0 is never handed out, so it marks a refused Open
+        send(connection, GameProtocol::FrameType::Opened, 0, 0);
+        return;
+    }
+
+    const quint32 index = allocateSession();
+    Session &session = slot(index);
+    session.playerX = StringInterner::intern(playerX);
+    session.playerO = StringInterner::intern(playerO);
+    session.ownerX = connection;
+    session.ownerO = connection;
+    attachSession(index);
+
+    m_metrics.gamesStarted++;
+    send(connection, GameProtocol::FrameType::Opened, sessionId(index, session.generation), 0);
+}
+
+void GameServer::playMove(Connection *connection, const GameProtocol::Frame &frame) {
+    Session *session = findSession(frame.session);
+    const int cell = frame.argument;
+    const quint16 bit = cell < 9 ? quint16(1u << cell) : 0;
+    // X moves whenever the marks are level
+    const bool xToMove = session && qPopulationCount(session->board.x) == qPopulationCount(session->board.o);
+    if (!session || !bit || ((session->board.x | session->board.o) & bit)
+        || (xToMove ? session->ownerX : session->ownerO) != connection) {
+        m_metrics.movesRejected++;
+        send(connection, GameProtocol::FrameType::Rejected, frame.session, frame.argument);
+        return;
+    }
+
+    const int player = xToMove ? 1 : 2;
+    if (xToMove) {
+        session->board.x |= bit;
+    } else {
+        session->board.o |= bit;
+    }
+    session->packedMoves = MoveCodec::append(session->packedMoves, cell, player);
+    m_metrics.movesPlayed++;
+    sendToPlayers(*session, GameProtocol::FrameType::Moved, frame.session, quint8(cell | player << 4));
+    if (session->broadcast) {
+        session->broadcast->feed.publish(GameMove{cell, player});
+    }
+
+    const GameLogic::Player winner = session->board.winner();
+    GameLogic::GameResult result = GameLogic::GameResult::InProgress;
+    if (winner == GameLogic::Player::X) {
+        result = GameLogic::GameResult::XWins;
+    } else if (winner == GameLogic::Player::O) {
+        result = GameLogic::GameResult::OWins;
+    } else if (session->board.isFull()) {
+        result = GameLogic::GameResult::Draw;
+    }
+    if (result == GameLogic::GameResult::InProgress) {
+        return;
+    }
+
+    sendToPlayers(*session, GameProtocol::FrameType::GameOver, frame.session, quint8(result));
+    if (session->broadcast) {
+        session->broadcast->feed.finish(result);
+    }
+    if (m_database) {
+        m_finished.append({session->playerX, session->playerO, result, session->packedMoves});
+        if (!m_persistTimer->isActive()) {
+            m_persistTimer->start();
+        }
+    }
+    m_metrics.gamesFinished++;
+    releaseSession(frame.session & ((1u << INDEX_BITS) - 1));
+}
+
+void GameServer::queuePlayer(Connection *connection, const GameProtocol::Frame &frame) {
+    QString username;
+    QString password;
+    // Accounts registered at a window since they were read are found once
+    // they have been read again
+    if (!GameProtocol::decodePlayers(frame.payload, &username, &password)
+        || (m_auth && !m_auth->checkCredentials(username, password)
+            && !(m_auth->reloadUsers() && m_auth->checkCredentials(username, password)))) {
+        send(connection, GameProtocol::FrameType::Matched, 0, 0);
+        return;
+    }
+    const quint32 player = StringInterner::intern(username);
+    if (m_queued.contains(player)) {
+        // Already looking for a game, perhaps from another connection
+        send(connection, GameProtocol::FrameType::Matched, 0, 0);
+        return;
+    }
+
+    const double rating = m_database ? m_database->gameArchive()->rating(username)
+                                     : RatingEngine::Parameters().initialRating;
+    m_queued.insert(player, connection);
+    connection->queued.append(player);
+    Matchmaker::Match match;
+    if (m_matchmaker.enqueue(player, qRound(rating), m_clock.elapsed(), &match)) {
+        startMatch(match);
+    } else if (!m_matchTimer->isActive()) {
+        m_matchTimer->start();
+    }
+}
+
+void GameServer::onMatchTimeout() {
+    const QVector<Matchmaker::Match> matches = m_matchmaker.poll(m_clock.elapsed());
+    for (const Matchmaker::Match &match : matches) {
+        startMatch(match);
+    }
+    if (m_matchmaker.waitingCount() == 0) {
+        m_matchTimer->stop();
+    }
+}
+
+void GameServer::startMatch(const Matchmaker::Match &match) {
+    Connection *connectionX = m_queued.take(match.first);
+    Connection *connectionO = m_queued.take(match.second);
+    connectionX->queued.removeOne(match.first);
+    connectionO->queued.removeOne(match.second);
+
+    const quint32 index = allocateSession();
+    Session &session = slot(index);
+    session.playerX = match.first;
+    session.playerO = match.second;
+    session.ownerX = connectionX;
+    session.ownerO = connectionO;
+    attachSession(index);
+
+    m_metrics.gamesStarted++;
+    m_metrics.matchesMade++;
+    const quint32 id = sessionId(index, session.generation);
+    send(connectionX, GameProtocol::FrameType::Matched, id, 1);
+    send(connectionO, GameProtocol::FrameType::Matched, id, 2);
+}
+
+void GameServer::watchSession(Connection *connection, const GameProtocol::Frame &frame) {
+    Session *session = findSession(frame.session);
+    if (!session) {
+        send(connection, GameProtocol::FrameType::Board, 0, 0);
+        return;
+    }
+    if (!session->broadcast) {
+        session->broadcast = new Broadcast(frame.session);
+        session->broadcast->feed.reset(session->board);
+    }
+    Broadcast *broadcast = session->broadcast;
+    for (const Watcher *watcher : connection->watching) {
+        if (watcher->broadcast == broadcast) {
+            return;
+        }
+    }
+
+    Watcher *watcher = new Watcher(connection, broadcast);
+    connection->watching.append(watcher);
+    broadcast->watchers.append(watcher);
+    m_metrics.spectators++;
+    broadcast->feed.subscribe(watcher);
+}
+
+void GameServer::closeBroadcast(Session &session) {
+    Broadcast *broadcast = session.broadcast;
+    if (!broadcast) {
+        return;
+    }
+    session.broadcast = nullptr;
+    // Watchers that are behind have not seen the end yet; they keep the
+    // broadcast until they have drained and been sent the final board
+    const QVector<Watcher*> watchers = broadcast->watchers;
+    for (Watcher *watcher : watchers) {
+        if (!broadcast->feed.isBehind(watcher)) {
+            removeWatcher(watcher);
+        }
+    }
+    if (broadcast->watchers.isEmpty()) {
+        delete broadcast;
+        return;
+    }
+    broadcast->closed = true;
+}
+
+void GameServer::removeWatcher(Watcher *watcher) {
+    Broadcast *broadcast = watcher->broadcast;
+    broadcast->feed.unsubscribe(watcher);
+    broadcast->watchers.removeOne(watcher);
+    watcher->connection->watching.removeOne(watcher);
+    m_metrics.spectators--;
+    delete watcher;
+    if (broadcast->closed && broadcast->watchers.isEmpty()) {
+        delete broadcast;
+    }
+}
+
+void GameServer::send(Connection *connection, GameProtocol::FrameType type, quint32 session, quint8 argument) {
+    QByteArray frame;
+    GameProtocol::append(frame, type, session, argument);
+    // The socket buffers writes and sends them once control is back in the
+    // event loop, so replies to a burst of frames leave together
+    connection->socket->write(frame);
+}
+
+void GameServer::sendToPlayers(const Session &session, GameProtocol::FrameType type, quint32 id, quint8 argument) {
+    send(session.ownerX, type, id, argument);
+    if (session.ownerO != session.ownerX) {
+        send(session.ownerO, type, id, argument);
+    }
+}
+
+void GameServer::persistFinishedGames() {
+    m_persistTimer->stop();
+    if (!m_database) {
+        m_finished.clear();
+        return;
+    }
+    for (const FinishedGame &game : m_finished) {
+        if (m_database->saveGame(StringInterner::string(game.playerX), StringInterner::string(game.playerO),
+                                 game.result, QString(), game.packedMoves)) {
+            m_metrics.gamesPersisted++;
+        } else {
+            qDebug() << "Failed to archive server game between" << StringInterner::string(game.playerX)
+                     << "and" << StringInterner::string(game.playerO);
+        }
+    }
+    m_finished.clear();
+}
+
+quint32 GameServer::allocateSession() {
+    if (m_freeSlots.isEmpty()) {
+        // Grow by a whole chunk; slots never move once allocated
+        m_chunks.append(new Session[SESSION_CHUNK]);
+        m_freeSlots.reserve(m_freeSlots.size() + SESSION_CHUNK);
+        for (int i = SESSION_CHUNK - 1; i >= 0; --i) {
+            m_freeSlots.append(quint32(m_slotCount + i));
+        }
+        m_slotCount += SESSION_CHUNK;
+    }
+
+    const quint32 index = m_freeSlots.takeLast();
+    Session &session = slot(index);
+    const quint8 generation = quint8(session.generation + 1);
+    session = Session();
+    // Generation 0 is skipped so that no session id is ever 0
+    session.generation = generation ? generation : 1;
+    session.active = true;
+    return index;
+}
+
+void GameServer::releaseSession(quint32 index) {
+    Session &session = slot(index);
+    closeBroadcast(session);
+    if (session.ownerX) {
+        detachSession(session.ownerX, session.seatX);
+    }
+    if (session.ownerO && session.ownerO != session.ownerX) {
+        detachSession(session.ownerO, session.seatO);
+    }
+    session.active = false;
+    session.ownerX = nullptr;
+    session.ownerO = nullptr;
+    m_freeSlots.append(index);
+}
+
+void GameServer::attachSession(quint32 index) {
+    Session &session = slot(index);
+    session.seatX = session.ownerX->sessions.size();
+    session.ownerX->sessions.append(index);
+    if (session.ownerO != session.ownerX) {
+        session.seatO = session.ownerO->sessions.size();
+        session.ownerO->sessions.append(index);
+    }
+}
+
+void GameServer::detachSession(Connection *connection, int seat) {
+    // The last session fills the gap, and learns its new seat
+    QVector<quint32> &sessions = connection->sessions;
+    const quint32 moved = sessions.last();
+    sessions[seat] = moved;
+    sessions.removeLast();
+    if (seat < sessions.size()) {
+        Session &session = slot(moved);
+        (session.ownerX == connection ? session.seatX : session.seatO) = seat;
+    }
+}
+
+GameServer::Session *GameServer::findSession(quint32 id) {
+    const quint32 index = id & ((1u << INDEX_BITS) - 1);
+    if (index >= quint32(m_slotCount)) {
+        return nullptr;
+    }
+    Session &session = slot(index);
+    if (!session.active || session.generation != quint8(id >> INDEX_BITS)) {
+        return nullptr;
+    }
+    return &session;
+}
+
+GameServer::Session &GameServer::slot(quint32 index) {
+    return m_chunks[int(index / SESSION_CHUNK)][index % SESSION_CHUNK];
+}
+
+quint32 GameServer::sessionId(quint32 index, quint8 generation) {
+    return quint32(generation) << INDEX_BITS | index;
+}
@@ -0,0 +1,93 @@
+#include "../include/headtohead.h"
+#include <algorithm>
+
+// Orders the rival heaps so the least played rival sits on top
+static bool playedMore(int gamesA, int gamesB) {
+    return gamesA > gamesB;
+}
+
+HeadToHead::HeadToHead(int rivalsKept)
+    : m_rivalsKept(rivalsKept)
+{
+}
+
+quint64 HeadToHead::pairKey(quint32 a, quint32 b) {
+    return a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+}
+
+void HeadToHead::record(quint32 playerX, quint32 playerO, GameLogic::GameResult result) {
+    if (playerX == playerO || result == GameLogic::GameResult::InProgress) {
+        return;
+    }
+
+    PairStats &pair = m_pairs[pairKey(playerX, playerO)];
+    if (result == GameLogic::GameResult::Draw) {
+        pair.draws++;
+    } else if ((result == GameLogic::GameResult::XWins) == (playerX < playerO)) {
+        pair.lowWins++;
+    } else {
+        pair.highWins++;
+    }
+
+    const int games = pair.lowWins + pair.highWins + pair.draws;
+    updateRival(playerX, playerO, games);
+    updateRival(playerO, playerX, games);
+}
+
+void HeadToHead::updateRival(quint32 player, quint32 rival, int games) {
+    QVector<RivalSlot> &heap = m_rivals[player];
+    auto compare = [](const RivalSlot &a, const RivalSlot &b) { return playedMore(a.games, b.games); };
+
+    for (RivalSlot &slot : heap) {
+        if (slot.rival == rival) {
+            // Counts only grow, and the heap holds a handful of entries
+            slot.games = games;
+            std::make_heap(heap.begin(), heap.end(), compare);
+            return;
+        }
+    }
+
+    if (heap.size() < m_rivalsKept) {
+        heap.append({games, rival});
+        std::push_heap(heap.begin(), heap.end(), compare);
+    } else if (!heap.isEmpty() && games > heap.first().games) {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        heap.last() = {games, rival};
+        std::push_heap(heap.begin(), heap.end(), compare);
+    }
+}
+
+HeadToHeadStats HeadToHead::stats(quint32 player, quint32 opponent) const {
+    HeadToHeadStats result;
+    auto it = m_pairs.constFind(pairKey(player, opponent));
+    if (it == m_pairs.constEnd() || player == opponent) {
+        return result;
+    }
+    result.wins = player < opponent ? it->lowWins : it->highWins;
+    result.losses = player < opponent ? it->highWins : it->lowWins;
+    result.draws = it->draws;
+    return result;
+}
+
+QVector<QPair<quint32, HeadToHeadStats>> HeadToHead::topRivals(quint32 player) const {
+    QVector<RivalSlot> ranked = m_rivals.value(player);
+    std::sort(ranked.begin(), ranked.end(), [](const RivalSlot &a, const RivalSlot &b) {
+        return a.games != b.games ? playedMore(a.games, b.games) : a.rival < b.rival;
+    });
+
+    QVector<QPair<quint32, HeadToHeadStats>> rivals;
+    rivals.reserve(ranked.size());
+    for (const RivalSlot &slot : ranked) {
+        rivals.append(qMakePair(slot.rival, stats(player, slot.rival)));
+    }
+    return rivals;
+}
+
+int HeadToHead::pairCount() const {
+    return m_pairs.size();
+}
+
+void HeadToHead::clear() {
+    m_pairs.clear();
+    m_rivals.clear();
+}
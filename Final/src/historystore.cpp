@@ -0,0 +1,99 @@
+#include "../include/historystore.h"
+#include "../include/database.h"
+#include "../include/jsonuserstream.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QDebug>
+
+HistoryStore::HistoryStore(int cacheSize)
+    : m_cache(cacheSize)
+{
+}
+
+HistoryStore::~HistoryStore() {
+}
+
+QVector<GameRecord> HistoryStore::history(const QString &username, qint64 key) {
+    QMutexLocker locker(&m_mutex);
+    if (const QVector<GameRecord> *cached = m_cache.object(username)) {
+        return *cached;
+    }
+
+    QVector<GameRecord> records = fetch(username, key);
+    m_cache.insert(username, new QVector<GameRecord>(records));
+    return records;
+}
+
+int HistoryStore::cachedCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_cache.count();
+}
+
+int HistoryStore::cacheSize() const {
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+JsonHistoryStore::JsonHistoryStore(const QString &path, int cacheSize)
+    : HistoryStore(cacheSize), m_path(path), m_moved(false)
+{
+}
+
+void JsonHistoryStore::beginMove() {
+    m_mutex.lock();
+}
+
+void JsonHistoryStore::finishMove(const QString &path, const QHash<QString, qint64> &offsets) {
+    m_path = path;
+    m_moved = true;
+    m_movedOffsets = offsets;
+    m_mutex.unlock();
+}
+
+void JsonHistoryStore::cancelMove() {
+    m_mutex.unlock();
+}
+
+QVector<GameRecord> JsonHistoryStore::fetch(const QString &username, qint64 key) {
+    if (m_moved) {
+        // The key the user holds is from before the move
+        key = m_movedOffsets.value(username, -1);
+        if (key < 0) {
+            qDebug() << "History record of" << username << "not found in" << m_path;
+            return QVector<GameRecord>();
+        }
+    }
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(key)) {
+        qDebug() << "Failed to open history of" << username << "in" << m_path;
+        return QVector<GameRecord>();
+    }
+
+    // Records are written one per line, so a single line is usually all there
+    // is to read
+    QByteArray line = file.readLine().trimmed();
+    if (line.endsWith(',')) {
+        line.chop(1);
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(line);
+    QJsonObject userObj = doc.object();
+    if (!doc.isObject()) {
+        // Pretty-printed file from an older version, scan the record instead
+        userObj = QJsonObject();
+        if (file.seek(key)) {
+            JsonUserReader reader(&file, true);
+            reader.readNext(&userObj);
+        }
+    }
+
+    if (userObj["username"].toString() != username) {
+        qDebug() << "History record of" << username << "not found in" << m_path;
+        return QVector<GameRecord>();
+    }
+    // Older files keep the history inside the stats
+    const QJsonValue history = userObj.contains("gameHistory") ? userObj["gameHistory"]
+                                                               : userObj["stats"].toObject()["gameHistory"];
+    return Database::deserializeHistory(history.toArray());
+}
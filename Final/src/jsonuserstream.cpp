@@ -0,0 +1,198 @@
+#include "../include/jsonuserstream.h"
+#include "../include/database.h"
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+JsonUserReader::JsonUserReader(QIODevice *device, bool insideArray)
+    : m_device(device), m_bufferOffset(device->pos()), m_lastRecordOffset(-1),
+      m_scanPos(0), m_recordStart(0), m_depth(0), m_historyStart(-1), m_skipHistory(false),
+      m_inArray(insideArray), m_inString(false), m_escape(false), m_finished(false), m_recordsRead(0)
+{
+}
+
+void JsonUserReader::setSkipHistory(bool skip) {
+    m_skipHistory = skip;
+}
+
+bool JsonUserReader::readNext(QJsonObject *userObj) {
+    if (m_finished || hasError()) {
+        return false;
+    }
+
+    forever {
+        const char *data = m_buffer.constData();
+        const int size = m_buffer.size();
+
+        while (m_scanPos < size) {
+            if (m_historyStart >= 0) {
+                // The history runs to the end of the record's line; find the
+                // brace closing the record there and carry on from it
+                const int newline = m_buffer.indexOf('\n', m_scanPos);
+                if (newline < 0) {
+                    m_scanPos = size;
+                    break;
+                }
+                int close = newline;
+                while (close > m_scanPos && data[close] != '}') {
+                    close--;
+                }
+                if (data[close] != '}') {
+                    return fail(QString("Unterminated history in user record %1").arg(m_recordsRead + 1));
+                }
+                m_scanPos = close;
+                m_depth = 1;
+                m_inString = false;
+                m_escape = false;
+            }
+            const char c = data[m_scanPos];
+
+            if (m_depth == 0) {
+                // Between records only the array punctuation is allowed
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    // Skip whitespace
+                } else if (!m_inArray) {
+                    if (c != '[') {
+                        return fail("Expected '[' at the start of the user array");
+                    }
+                    m_inArray = true;
+                } else if (c == '{') {
+                    m_depth = 1;
+                    m_recordStart = m_scanPos;
+                } else if (c == ']') {
+                    m_finished = true;
+                    return false;
+                } else if (c != ',') {
+                    return fail(QString("Unexpected '%1' between user records").arg(QChar(c)));
+                }
+                m_scanPos++;
+                continue;
+            }
+
+            if (m_inString) {
+                if (m_escape) {
+                    m_escape = false;
+                } else if (c == '\\') {
+                    m_escape = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                }
+            } else if (c == '"') {
+                m_inString = true;
+            } else if (c == ',' && m_depth == 1 && m_skipHistory) {
+                static const int sectionLength = int(qstrlen(Database::HISTORY_SECTION));
+                if (size - m_scanPos < sectionLength && !m_device->atEnd()) {
+                    break; // Not enough read to tell
+                }
+                if (qstrncmp(data + m_scanPos, Database::HISTORY_SECTION, sectionLength) == 0) {
+                    m_historyStart = m_scanPos;
+                    m_scanPos += sectionLength;
+                    continue;
+                }
+            } else if (c == '{' || c == '[') {
+                m_depth++;
+            } else if (c == '}' || c == ']') {
+                if (--m_depth == 0) {
+                    // Parse just this record, straight out of the buffer,
+                    // less any history section
+                    QByteArray record = m_historyStart >= 0
+                        ? QByteArray(data + m_recordStart, m_historyStart - m_recordStart) + '}'
+                        : QByteArray::fromRawData(data + m_recordStart, m_scanPos + 1 - m_recordStart);
+                    m_historyStart = -1;
+                    m_scanPos++;
+
+                    QJsonParseError parseError;
+                    QJsonDocument doc = QJsonDocument::fromJson(record, &parseError);
+                    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+                        return fail(QString("Error parsing user record %1: %2")
+                                        .arg(m_recordsRead + 1).arg(parseError.errorString()));
+                    }
+                    *userObj = doc.object();
+                    m_lastRecordOffset = m_bufferOffset + m_recordStart;
+                    m_recordsRead++;
+                    return true;
+                }
+            }
+            m_scanPos++;
+        }
+
+        // Drop what has been consumed and pull in the next chunk
+        const int keepFrom = m_depth > 0 ? m_recordStart : m_scanPos;
+        m_buffer.remove(0, keepFrom);
+        m_bufferOffset += keepFrom;
+        m_scanPos -= keepFrom;
+        if (m_historyStart >= 0) {
+            m_historyStart -= keepFrom;
+        }
+        m_recordStart = 0;
+
+        if (m_device->atEnd()) {
+            return fail(m_inArray ? "Unexpected end of file inside the user array"
+                                  : "No user array found");
+        }
+        const QByteArray chunk = m_device->read(CHUNK_SIZE);
+        if (chunk.isEmpty()) {
+            return fail("Failed to read database file: " + m_device->errorString());
+        }
+        m_buffer += chunk;
+    }
+}
+
+bool JsonUserReader::hasError() const {
+    return !m_error.isEmpty();
+}
+
+QString JsonUserReader::errorString() const {
+    return m_error;
+}
+
+qint64 JsonUserReader::recordsRead() const {
+    return m_recordsRead;
+}
+
+qint64 JsonUserReader::lastRecordOffset() const {
+    return m_lastRecordOffset;
+}
+
+bool JsonUserReader::fail(const QString &message) {
+    m_error = message;
+    m_buffer.clear();
+    return false;
+}
+
+JsonUserWriter::JsonUserWriter(QIODevice *device, int shardSize)
+    : m_device(device), m_lastRecordOffset(-1), m_first(true), m_shardSize(shardSize), m_written(0)
+{
+}
+
+bool JsonUserWriter::begin() {
+    m_first = true;
+    m_written = 0;
+    m_shardOffsets.clear();
+    return m_device->write("[\n") != -1;
+}
+
+bool JsonUserWriter::write(const User &user) {
+    QByteArray record = Database::serializeRecord(user);
+    if (!m_first) {
+        record.prepend(",\n");
+    }
+    m_lastRecordOffset = m_device->pos() + (m_first ? 0 : 2);
+    if (m_shardSize > 0 && m_written % m_shardSize == 0) {
+        m_shardOffsets.append(m_lastRecordOffset);
+    }
+    m_first = false;
+    m_written++;
+    return m_device->write(record) == record.size();
+}
+
+bool JsonUserWriter::finish() {
+    return m_device->write("\n]\n") != -1;
+}
+
+QVector<qint64> JsonUserWriter::shardOffsets() const {
+    return m_shardOffsets;
+}
+
+qint64 JsonUserWriter::lastRecordOffset() const {
+    return m_lastRecordOffset;
+}
@@ -1,13 +1,147 @@
 #include "../include/mainwindow.h"
+#include "../include/authentication.h"
+#include "../include/database.h"
+#include "../include/gamearchive.h"
+#include "../include/startupprofiler.h"
+#include "../include/gameserver.h"
+#include "../include/blunderanalysis.h"
+#include "../include/openingbook.h"
 
 #include <QApplication>
 #include <QFile>
 #include <QDir>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QCommandLineParser>
+#include <QStandardPaths>
+
+// --serve and --analyze run without a window, so they have to be spotted
+// before the application object is created
+static bool hasOption(int argc, char *argv[], const char *name)
+{
+    const QByteArray option = QByteArray("--") + name;
+    for (int i = 1; i < argc; ++i) {
+        if (option == argv[i] || QByteArray(argv[i]).startsWith(option + '=')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hosts games for clients on a localhost port until killed
+static int runServer(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption serveOption("serve", "Host games on this localhost port instead of opening a window.", "port");
+    // Kept apart from the window's own archive, which another process may be writing
+    QCommandLineOption databaseOption("database", "Where hosted games are archived.", "path",
+                                      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                          + "/server/tictactoe.json");
+    parser.addOption(serveOption);
+    parser.addOption(databaseOption);
+    parser.process(app);
+
+    Database database;
+    database.setDatabasePath(parser.value(databaseOption));
+    // Players queueing for a match sign in with their desktop accounts. A
+    // window may be saving those at the same time, so they are only read
+    Database accounts;
+    accounts.setReadOnly(true);
+    Authentication auth;
+    auth.setDatabase(&accounts);
+    auth.loadUsers();
+
+    GameServer server(&database);
+    server.setAuthentication(&auth);
+    if (!server.listen(quint16(parser.value(serveOption).toUInt()))) {
+        return 1;
+    }
+    qDebug() << "Game server listening on port" << server.port();
+    return app.exec();
+}
+
+// Grades every game archived since the last run, updates the summary the
+// statistics view reads and rebuilds the AI's opening book
+static int runAnalysis(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption analyzeOption("analyze", "Grade the moves of every archived game and rebuild the opening book, then exit.");
+    QCommandLineOption databaseOption("database", "Database whose game archive is analysed.", "path");
+    QCommandLineOption backendOption("backend", "Storage backend: json (default) or sqlite.", "name",
+                                     qEnvironmentVariable("TICTACTOE_BACKEND", "json"));
+    parser.addOption(analyzeOption);
+    parser.addOption(databaseOption);
+    parser.addOption(backendOption);
+    parser.process(app);
+    if (parser.value(backendOption).toLower() == "sqlite") {
+        Database::setDefaultBackend(Database::Backend::Sqlite);
+    }
+
+    Database database;
+    if (parser.isSet(databaseOption)) {
+        database.setDatabasePath(parser.value(databaseOption));
+    }
+    QElapsedTimer timer;
+    timer.start();
+    // Read-only, so a window still writing the archive keeps its records
+    GameArchive readOnlyArchive(database.gameArchivePath(), GameArchive::Mode::ReadOnly);
+    GameArchive *archive = &readOnlyArchive;
+    const qint64 analysed = BlunderAnalysis::update(archive);
+    if (analysed < 0) {
+        return 1;
+    }
+    qDebug() << "Analysed" << analysed << "games in" << timer.elapsed() << "ms";
+    timer.restart();
+    if (!OpeningBook::build(archive, OpeningBook::bookPath(archive->path()))) {
+        return 1;
+    }
+    qDebug() << "Built the opening book in" << timer.elapsed() << "ms";
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    if (hasOption(argc, argv, "serve")) {
+        return runServer(argc, argv);
+    }
+    if (hasOption(argc, argv, "analyze")) {
+        return runAnalysis(argc, argv);
+    }
+
     QApplication a(argc, argv);
+    StartupProfiler::mark("application");
+    
+    // Storage backend: --backend sqlite, or TICTACTOE_BACKEND=sqlite
+    // Leaderboard order: --ranking rating, or TICTACTOE_RANKING=rating
+    // Two-player games on a server started with --serve: --connect host:port
+    // Mistake rates for the statistics view: --analyze, then exits
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption backendOption("backend", "Storage backend: json (default) or sqlite.", "name",
+                                     qEnvironmentVariable("TICTACTOE_BACKEND", "json"));
+    QCommandLineOption rankingOption("ranking", "Leaderboard order: score (default) or rating.", "name",
+                                     qEnvironmentVariable("TICTACTOE_RANKING", "score"));
+    QCommandLineOption serveOption("serve", "Host games on this localhost port instead of opening a window.", "port");
+    QCommandLineOption connectOption("connect", "Play two-player games on the game server at host:port.", "address");
+    parser.addOption(backendOption);
+    parser.addOption(rankingOption);
+    QCommandLineOption analyzeOption("analyze", "Grade the moves of every archived game and rebuild the opening book, then exit.");
+    parser.addOption(serveOption);
+    parser.addOption(connectOption);
+    parser.addOption(analyzeOption);
+    parser.process(a);
+    if (parser.value(backendOption).toLower() == "sqlite") {
+        Database::setDefaultBackend(Database::Backend::Sqlite);
+    }
+    if (parser.value(rankingOption).toLower() == "rating") {
+        Database::setDefaultRanking(Database::Ranking::Rating);
+    }
     
     // Output welcome message
     qDebug() << "\n==========================================";
@@ -16,8 +150,9 @@ int main(int argc, char *argv[])
     qDebug() << "Game is starting...";
     qDebug() << "Loading resources and initializing...\n";
     
-    // Load and apply the stylesheet
-    QFile styleFile(":/styles/main.qss");
+    // Load and apply the rules every screen shares; each screen adds its own
+    // sheet when it is first shown
+    QFile styleFile(":/styles/common.qss");
     if (styleFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QString style = styleFile.readAll();
         a.setStyleSheet(style);
@@ -26,11 +161,21 @@ int main(int argc, char *argv[])
     } else {
         qDebug() << "! Warning: Could not load stylesheet";
     }
+    StartupProfiler::mark("stylesheet");
     
     MainWindow w;
+    StartupProfiler::mark("window constructed");
     w.setWindowTitle("Professional Tic Tac Toe");
     w.resize(900, 700);
+    if (parser.isSet(connectOption)) {
+        const QString address = parser.value(connectOption);
+        const int colon = address.lastIndexOf(':');
+        w.connectToServer(colon > 0 ? address.left(colon) : QString("127.0.0.1"),
+                          quint16(address.mid(colon + 1).toUInt()));
+    }
+    StartupProfiler::watchFirstFrame(&w);
     w.show();
+    StartupProfiler::mark("window shown");
     
     qDebug() << "✓ Game window initialized and displayed";
     qDebug() << "✓ Game is ready to play!\n";
@@ -1,13 +1,16 @@
 #include "../include/mainwindow.h"
+#include "../include/gamearchive.h"
+#include "../include/movecodec.h"
+#include "../include/stringinterner.h"
+#include "../include/startupprofiler.h"
 #include <QFile>
+#include <QFileInfo>
 #include <QMessageBox>
 #include <QMovie>
 #include <QRandomGenerator>
 #include <QScrollArea>
 #include <QSpacerItem>
 #include <QTimer>
-#include <QPropertyAnimation>
-#include <QEasingCurve>
 #include <QStackedWidget>
 #include <QPainter>
 #include <QStyledItemDelegate>
@@ -17,15 +20,158 @@
 #include <QEvent>
 #include <QDebug>
 #include <QMouseEvent>
-#include <QGraphicsDropShadowEffect>
 #include <QStyle>
-#include <QSequentialAnimationGroup>
+#include <QSignalBlocker>
+#include <QtAlgorithms>
+
+// Restyles a board cell only when its value changed. The game board and the
+// replay both paint through here, so a move touches just its own cell
+static void updateCell(QPushButton* cell, const QString& value, const QString& style) {
+    if (cell->property("cell-value").toString() == value) {
+        return;
+    }
+    cell->setText(value);
+    cell->setProperty("cell-value", value);
+    cell->setStyleSheet(style);
+    cell->style()->unpolish(cell);
+    cell->style()->polish(cell);
+}
+
+// Replay cell style for the mark it holds, built once
+static const QString& replayCellStyle(GameLogic::Player player) {
+    static const QString emptyStyle = QStringLiteral(
+        "QPushButton#replayCell {"
+        "  background-color: rgba(0, 136, 255, 0.1);"
+        "  border: 2px solid #0088ff;"
+        "  border-radius: 5px;"
+        "  font-size: 56px;"
+        "  font-weight: bold;"
+        "}"
+    );
+    static const QString xStyle = emptyStyle + QStringLiteral(
+        "QPushButton#replayCell {"
+        "  color: #ff69b4;"
+        "  text-shadow: 0 0 10px #ff69b4;"
+        "}"
+    );
+    static const QString oStyle = emptyStyle + QStringLiteral(
+        "QPushButton#replayCell {"
+        "  color: #00eeff;"
+        "  text-shadow: 0 0 10px #00eeff;"
+        "}"
+    );
+    return player == GameLogic::Player::X ? xStyle
+         : player == GameLogic::Player::O ? oStyle
+         : emptyStyle;
+}
+
+// Implementation of EvaluationGraph
+EvaluationGraph::EvaluationGraph(QWidget* parent)
+    : QWidget(parent)
+{
+    setObjectName("evaluationGraph");
+    setFixedHeight(80);
+    setCursor(Qt::PointingHandCursor);
+    setToolTip("X's chances after each move, with inaccuracies, mistakes and blunders marked; "
+               "click to jump there");
+}
+
+void EvaluationGraph::setTimeline(const ReplayTimeline* timeline) {
+    m_timeline = timeline;
+    update();
+}
+
+void EvaluationGraph::setMoveQualities(const QVector<MoveAnalyzer::MoveQuality>& qualities) {
+    m_qualities = qualities;
+    update();
+}
+
+void EvaluationGraph::setCurrentPly(int ply) {
+    if (m_currentPly == ply) {
+        return;
+    }
+    m_currentPly = ply;
+    update();
+}
+
+QRectF EvaluationGraph::plotArea() const {
+    return QRectF(rect()).adjusted(10, 8, -10, -8);
+}
+
+QPointF EvaluationGraph::pointFor(int ply) const {
+    const QRectF area = plotArea();
+    const int plies = qMax(1, m_timeline->plyCount());
+    return QPointF(area.left() + area.width() * ply / plies,
+                   area.bottom() - area.height() * m_timeline->winProbability(ply));
+}
+
+void EvaluationGraph::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(QColor(0, 136, 255), 1));
+    painter.setBrush(QColor(0, 136, 255, 25));
+    painter.drawRoundedRect(QRectF(rect()).adjusted(0.5, 0.5, -0.5, -0.5), 5, 5);
+
+    // Even chances
+    const QRectF area = plotArea();
+    painter.setPen(QPen(QColor(255, 255, 255, 60), 1, Qt::DashLine));
+    painter.drawLine(QPointF(area.left(), area.center().y()), QPointF(area.right(), area.center().y()));
+
+    if (!m_timeline) {
+        return;
+    }
+    // Games archived before moves were recorded have nothing to plot
+    if (m_timeline->plyCount() == 0) {
+        painter.setPen(QColor(255, 255, 255, 140));
+        painter.drawText(area, Qt::AlignCenter, "No moves recorded");
+        return;
+    }
+
+    QPolygonF line;
+    for (int ply = 0; ply <= m_timeline->plyCount(); ++ply) {
+        line << pointFor(ply);
+    }
+    painter.setPen(QPen(QColor(0, 238, 255), 2));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPolyline(line);
+
+    // Moves that let the result slip
+    painter.setPen(Qt::NoPen);
+    const int marked = qMin(m_qualities.size(), m_timeline->plyCount());
+    for (int move = 0; move < marked; ++move) {
+        const MoveAnalyzer::MoveQuality quality = m_qualities.at(move);
+        if (quality == MoveAnalyzer::MoveQuality::Best || quality == MoveAnalyzer::MoveQuality::Illegal) {
+            continue;
+        }
+        painter.setBrush(quality == MoveAnalyzer::MoveQuality::Inaccuracy ? QColor(255, 215, 0)
+                         : quality == MoveAnalyzer::MoveQuality::Mistake  ? QColor(255, 140, 0)
+                                                                          : QColor(255, 59, 59));
+        const QPointF point = pointFor(move + 1);
+        painter.drawRect(QRectF(point.x() - 3.5, point.y() - 3.5, 7, 7));
+    }
+
+    // Shown move
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(255, 105, 180));
+    painter.drawEllipse(pointFor(m_currentPly), 5, 5);
+}
+
+void EvaluationGraph::mousePressEvent(QMouseEvent* event) {
+    if (!m_timeline || m_timeline->plyCount() == 0) {
+        return;
+    }
+    const QRectF area = plotArea();
+    const qreal fraction = qBound(0.0, (event->pos().x() - area.left()) / area.width(), 1.0);
+    emit plySelected(qRound(fraction * m_timeline->plyCount()));
+}
 
 // Implementation of ReplayDialog
-ReplayDialog::ReplayDialog(QWidget* parent) 
+ReplayDialog::ReplayDialog(QWidget* parent, EffectPool* effects) 
     : QDialog(parent, Qt::FramelessWindowHint), 
       m_currentMove(0), 
-      m_totalMoves(5) // Example value
+      m_totalMoves(0)
 {
     setObjectName("replayDialog");
     setStyleSheet(
@@ -36,34 +182,28 @@ ReplayDialog::ReplayDialog(QWidget* parent)
         "}"
     );
     
-    // Add shadow effect to match web version
-    QGraphicsDropShadowEffect* shadowEffect = new QGraphicsDropShadowEffect(this);
-    shadowEffect->setBlurRadius(30);
-    shadowEffect->setColor(QColor(0, 136, 255, 200));
-    shadowEffect->setOffset(0, 0);
-    setGraphicsEffect(shadowEffect);
-    
-    // Set up animation for pulsing glow effect
-    QPropertyAnimation* glowAnimation = new QPropertyAnimation(shadowEffect, "color");
-    glowAnimation->setDuration(2000); // 2 seconds like web version
-    glowAnimation->setStartValue(QColor(0, 136, 255, 160));
-    glowAnimation->setEndValue(QColor(0, 238, 255, 200));
-    glowAnimation->setEasingCurve(QEasingCurve::InOutQuad);
-    
-    QSequentialAnimationGroup* animGroup = new QSequentialAnimationGroup(this);
-    animGroup->addAnimation(glowAnimation);
-    animGroup->setLoopCount(-1); // Infinite loop
-    animGroup->start();
-    
-    setupUI();
+    // Pulsing glow to match web version, painted from pre-rendered frames a
+    // few times a second rather than blurring the whole dialog every frame
+    EffectPool* pool = effects ? effects : new EffectPool(this);
+    m_glowFrames = pool->glowFrames(GLOW_RADIUS, GLOW_BLUR, QColor(0, 136, 255, 160),
+                                    QColor(0, 238, 255, 200), GLOW_FRAMES);
+    m_glowTimer = new QTimer(this);
+    // 2 seconds each way like web version, at no more than the idle rate
+    m_glowTimer->setInterval(qMax(2000 / GLOW_FRAMES, 1000 / EffectPool::IDLE_GLOW_FPS));
+    connect(m_glowTimer, &QTimer::timeout, this, &ReplayDialog::onGlowTimeout);
     
     // Setup playback timer
     m_playbackTimer = new QTimer(this);
-    connect(m_playbackTimer, &QTimer::timeout, this, &ReplayDialog::onNextClicked);
+    connect(m_playbackTimer, &QTimer::timeout, this, &ReplayDialog::onPlaybackTimeout);
+    
+    setupUI();
+    
+    // An empty board until setMoveData() gives the game's moves
+    setMoveData({});
 }
 
 void ReplayDialog::setupUI() {
-    setFixedSize(650, 750);
+    setFixedSize(650, 870);
     setModal(true);
     
     // Set initial move count to 0 of 5 to match the screenshot
@@ -172,28 +312,8 @@ void ReplayDialog::setupUI() {
         cell->setObjectName("replayCell");
         cell->setFixedSize(105, 105);
         cell->setEnabled(false);
-        cell->setStyleSheet(
-            "QPushButton#replayCell {"
-            "  background-color: rgba(0, 136, 255, 0.1);"
-            "  border: 2px solid #0088ff;"
-            "  border-radius: 5px;"
-            "  font-size: 56px;"
-            "  font-weight: bold;"
-            "  transition-duration: 0.2s;"
-            "}"
-            "QPushButton#replayCell[value=\"X\"] {"
-            "  color: #ff69b4;"
-            "  text-shadow: 0 0 10px #ff69b4;"
-            "}"
-            "QPushButton#replayCell[value=\"O\"] {"
-            "  color: #00eeff;"
-            "  text-shadow: 0 0 10px #00eeff;"
-            "}"
-            "QPushButton#replayCell.win-cell {"
-            "  background-color: rgba(0, 255, 0, 0.2);"
-            "  box-shadow: 0 0 15px rgba(0, 255, 0, 0.5);"
-            "}"
-        );
+        cell->setProperty("cell-value", QString());
+        cell->setStyleSheet(replayCellStyle(GameLogic::Player::None));
         
         m_cells.append(cell);
         boardLayout->addWidget(cell, i / 3, i % 3);
@@ -210,7 +330,32 @@ void ReplayDialog::setupUI() {
     mainLayout->addLayout(boardHolderLayout);
     
     // Add some spacing after the board
-    mainLayout->addSpacing(40);
+    mainLayout->addSpacing(10);
+    
+    // Win chances per move, and a scrubber to jump to any of them
+    m_evaluationGraph = new EvaluationGraph(this);
+    connect(m_evaluationGraph, &EvaluationGraph::plySelected, this, &ReplayDialog::seek);
+    mainLayout->addWidget(m_evaluationGraph);
+    
+    m_scrubber = new QSlider(Qt::Horizontal, this);
+    m_scrubber->setObjectName("replayScrubber");
+    m_scrubber->setCursor(Qt::PointingHandCursor);
+    m_scrubber->setPageStep(1);
+    m_scrubber->setStyleSheet(
+        "QSlider#replayScrubber::groove:horizontal {"
+        "  height: 4px;"
+        "  background: rgba(0, 136, 255, 0.3);"
+        "  border-radius: 2px;"
+        "}"
+        "QSlider#replayScrubber::handle:horizontal {"
+        "  width: 14px;"
+        "  margin: -6px 0;"
+        "  background: #00eeff;"
+        "  border-radius: 7px;"
+        "}"
+    );
+    connect(m_scrubber, &QSlider::valueChanged, this, &ReplayDialog::seek);
+    mainLayout->addWidget(m_scrubber);
     
     // Navigation controls
     QWidget* navPanel = new QWidget(this);
@@ -365,6 +510,15 @@ void ReplayDialog::setupUI() {
     m_pauseBtn->setEnabled(false);
     connect(m_pauseBtn, &QPushButton::clicked, this, &ReplayDialog::onPauseClicked);
     
+    // Reverse button
+    m_reverseBtn = new QPushButton("◀◀ Reverse", this);
+    m_reverseBtn->setObjectName("playbackButton");
+    m_reverseBtn->setCursor(Qt::PointingHandCursor);
+    m_reverseBtn->setFixedSize(150, 35);
+    m_reverseBtn->setStyleSheet(m_playBtn->styleSheet());
+    connect(m_reverseBtn, &QPushButton::clicked, this, &ReplayDialog::onReverseClicked);
+    
+    playbackLayout->addWidget(m_reverseBtn);
     playbackLayout->addWidget(m_playBtn);
     playbackLayout->addWidget(m_pauseBtn);
     
@@ -381,121 +535,120 @@ void ReplayDialog::setGameData(const QString& date, const QString& players,
     m_resultLabel->setText(result);
     m_durationLabel->setText(duration);
     
-    // Reset the board and move counter
-    m_currentMove = 0;
+    // Back to the empty board
+    seek(0);
+}
+
+void ReplayDialog::seek(int move) {
+    m_currentMove = qBound(0, move, m_totalMoves);
     updateMoveCounter();
-    
-    // Clear the board
-    for (auto cell : m_cells) {
-        cell->setText("");
-        cell->setProperty("value", "");
-        cell->style()->unpolish(cell);
-        cell->style()->polish(cell);
-    }
-    
-    // Update button states
+    updateBoard();
     updateButtonStates();
 }
 
 void ReplayDialog::onPreviousClicked() {
-    if (m_currentMove > 0) {
-        m_currentMove--;
-        updateMoveCounter();
-        updateBoard();
-        updateButtonStates();
-    }
+    seek(m_currentMove - 1);
 }
 
 void ReplayDialog::onNextClicked() {
-    if (m_currentMove < m_totalMoves) {
-        m_currentMove++;
-        updateMoveCounter();
-        updateBoard();
-        updateButtonStates();
-        
-        // If we reached the end, stop playback
-        if (m_currentMove >= m_totalMoves && m_playbackTimer->isActive()) {
-            m_playbackTimer->stop();
-            m_playBtn->setEnabled(true);
-            m_pauseBtn->setEnabled(false);
-        }
-    }
+    seek(m_currentMove + 1);
 }
 
 void ReplayDialog::onPlayClicked() {
-    // If we're at the end, start from beginning
-    if (m_currentMove >= m_totalMoves) {
-        m_currentMove = 0;
-        updateMoveCounter();
-        updateBoard();
+    startPlayback(1);
+}
+
+void ReplayDialog::onReverseClicked() {
+    startPlayback(-1);
+}
+
+void ReplayDialog::startPlayback(int step) {
+    // Starting at the end playback heads for, begin again from the other end
+    if (step > 0 && m_currentMove >= m_totalMoves) {
+        seek(0);
+    } else if (step < 0 && m_currentMove <= 0) {
+        seek(m_totalMoves);
     }
     
-    // Start playback timer
-    m_playbackTimer->start(1000); // 1 second between moves
-    
-    // Update button states
-    m_playBtn->setEnabled(false);
-    m_pauseBtn->setEnabled(true);
+    m_playbackStep = step;
+    m_playbackTimer->start(PLAYBACK_INTERVAL);
+    updateButtonStates();
 }
 
 void ReplayDialog::onPauseClicked() {
     // Stop playback timer
     m_playbackTimer->stop();
+    updateButtonStates();
+}
+
+void ReplayDialog::onPlaybackTimeout() {
+    seek(m_currentMove + m_playbackStep);
     
-    // Update button states
-    m_playBtn->setEnabled(true);
-    m_pauseBtn->setEnabled(false);
+    // Stop at whichever end we were heading for
+    if (m_currentMove <= 0 || m_currentMove >= m_totalMoves) {
+        m_playbackTimer->stop();
+        updateButtonStates();
+    }
 }
 
 void ReplayDialog::updateMoveCounter() {
-    m_moveCountLabel->setText(QString("Move %1 of %2").arg(m_currentMove).arg(m_totalMoves));
+    if (m_totalMoves == 0) {
+        m_moveCountLabel->setText("No moves recorded");
+        return;
+    }
+    QString text = QString("Move %1 of %2").arg(m_currentMove).arg(m_totalMoves);
+    if (m_currentMove > 0 && m_currentMove <= m_moveQualities.size()) {
+        switch (m_moveQualities.at(m_currentMove - 1)) {
+        case MoveAnalyzer::MoveQuality::Inaccuracy:
+            text += " · Inaccuracy";
+            break;
+        case MoveAnalyzer::MoveQuality::Mistake:
+            text += " · Mistake";
+            break;
+        case MoveAnalyzer::MoveQuality::Blunder:
+            text += " · Blunder";
+            break;
+        default:
+            break;
+        }
+    }
+    m_moveCountLabel->setText(text);
 }
 
 void ReplayDialog::updateBoard() {
-    // Clear all cells first
-    for (int i = 0; i < 9; ++i) {
-        m_cells[i]->setText("");
-        m_cells[i]->setProperty("value", "");
-        m_cells[i]->style()->unpolish(m_cells[i]);
-        m_cells[i]->style()->polish(m_cells[i]);
-    }
-    
-    // If we have actual move data, use it
-    if (!m_moves.isEmpty()) {
-        // Apply moves up to current move
-        for (int i = 0; i < qMin(m_currentMove, m_moves.size()); ++i) {
-            int cellIndex = m_moves[i].cellIndex;
-            QString value = (m_moves[i].player == 1) ? "X" : "O";
-            m_cells[cellIndex]->setText(value);
-            m_cells[cellIndex]->setProperty("value", value);
-            m_cells[cellIndex]->style()->unpolish(m_cells[cellIndex]);
-            m_cells[cellIndex]->style()->polish(m_cells[cellIndex]);
-        }
-    } else {
-        // Fallback to example moves if no actual data is available
-        QVector<QPair<int, QString>> exampleMoves = {
-            {0, "O"},  // Top left - O
-            {2, "X"},  // Top right - X
-            {4, "X"},  // Center - X
-            {6, "O"},  // Bottom left - O
-            {8, "X"}   // Bottom right - X
-        };
-        
-        // Apply example moves up to current move
-        for (int i = 0; i < qMin(m_currentMove, exampleMoves.size()); ++i) {
-            int cellIndex = exampleMoves[i].first;
-            QString value = exampleMoves[i].second;
-            m_cells[cellIndex]->setText(value);
-            m_cells[cellIndex]->setProperty("value", value);
-            m_cells[cellIndex]->style()->unpolish(m_cells[cellIndex]);
-            m_cells[cellIndex]->style()->polish(m_cells[cellIndex]);
-        }
+    static const QString xValue = QStringLiteral("X");
+    static const QString oValue = QStringLiteral("O");
+
+    // Every position is already worked out, so only the cells that differ
+    // from what is shown get repainted, however far the jump. A negative
+    // shown move means the cells no longer match the timeline
+    quint16 dirty = m_shownMove < 0 ? quint16(0x1FF)
+                                    : m_timeline.changedCells(m_shownMove, m_currentMove);
+    const BoardSnapshot board = m_timeline.at(m_currentMove);
+    while (dirty) {
+        const int index = qCountTrailingZeroBits(dirty);
+        dirty &= dirty - 1;
+        const GameLogic::Player player = board.cell(index);
+        updateCell(m_cells[index],
+                   player == GameLogic::Player::X ? xValue
+                   : player == GameLogic::Player::O ? oValue
+                   : QString(),
+                   replayCellStyle(player));
     }
+    m_shownMove = m_currentMove;
+    
+    const QSignalBlocker blocker(m_scrubber);
+    m_scrubber->setValue(m_currentMove);
+    m_evaluationGraph->setCurrentPly(m_currentMove);
 }
 
 void ReplayDialog::updateButtonStates() {
+    const bool playing = m_playbackTimer->isActive();
     m_previousBtn->setEnabled(m_currentMove > 0);
     m_nextBtn->setEnabled(m_currentMove < m_totalMoves);
+    m_playBtn->setEnabled(!playing && m_totalMoves > 0);
+    m_reverseBtn->setEnabled(!playing && m_totalMoves > 0);
+    m_pauseBtn->setEnabled(playing);
 }
 
 // Implementation of LeaderboardItemDelegate::paint method to match target image exactly
@@ -626,23 +779,88 @@ MainWindow::MainWindow(QWidget *parent)
     m_gameLogic = new GameLogic(this);
     m_gameHistory = new GameHistory(this);
     m_aiOpponent = new AIOpponent(this);
+    m_moveAnalyzer = new MoveAnalyzer(this);
     m_database = new Database(this);
+    m_effects = new EffectPool(this);
 
     m_aiOpponent->setGameLogic(m_gameLogic);
+    // Human openings learned from the archive, once --analyze has run
+    m_openingBook.open(OpeningBook::bookPath(m_database->gameArchive()->path()));
+    m_aiOpponent->setOpeningBook(&m_openingBook);
+    connect(m_moveAnalyzer, &MoveAnalyzer::analysisReady, this, &MainWindow::onAnalysisReady);
     m_gameMode = GameMode::None;
 
+    m_auth->setDatabase(m_database);
+
+    // Saves after each game run on the writer thread, coalesced into one write
+    m_databaseWriter = new DatabaseWriter(m_database->databasePath(), this);
+    m_auth->setWriter(m_databaseWriter);
+    // Registered users, their statistics and replayable games are read there
+    // first, compacting the journal if it has grown too long
+    connect(m_databaseWriter, &DatabaseWriter::usersLoaded, this, &MainWindow::onUsersLoaded, Qt::QueuedConnection);
+    m_databaseWriter->scheduleLoad();
+    // So are finished games, and the archive is opened and indexed there too
+    m_databaseWriter->setGameArchive(m_database->gameArchive());
+    auto refreshLeaderboard = [this]() {
+        if (m_statisticsView && m_statisticsView->isVisible()) {
+            populateLeaderboard();
+        }
+    };
+    connect(m_databaseWriter, &DatabaseWriter::archiveOpened, this, refreshLeaderboard, Qt::QueuedConnection);
+    connect(m_databaseWriter, &DatabaseWriter::saveCompleted, this, refreshLeaderboard, Qt::QueuedConnection);
+
+    // The --analyze summary is read in the background now and again whenever
+    // a run rewrites it. It is replaced by a rename, which only the directory
+    // watch sees
+    m_summaryLoader.setMaxThreadCount(1);
+    m_summaryWatcher = new QFileSystemWatcher(this);
+    m_summaryWatcher->addPath(QFileInfo(m_database->gameArchivePath()).absolutePath());
+    connect(m_summaryWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::reloadBlunderSummary);
+    connect(m_summaryWatcher, &QFileSystemWatcher::directoryChanged, this, &MainWindow::reloadBlunderSummary);
+    reloadBlunderSummary();
+
     // We'll make everything compact through layout adjustments
 
     setupUI();
-    setupConnections();
     setupStyleSheet();
 
-    // Start with mode selection screen
+    // Start with mode selection screen; the rest is built when first visited
     showScreen(Screen::ModeSelection);
+    StartupProfiler::mark("mode selection built");
 }
 
 MainWindow::~MainWindow() {
     // No need to delete ui since we're not using it
+
+    // The statistics view has no parent, so it is not deleted with the window
+    delete m_statisticsView;
+
+    // A summary still loading would be handed to a window that is gone
+    m_summaryLoader.clear();
+    m_summaryLoader.waitForDone();
+
+    // Shutdown is the one place we wait for the disk. The writer goes first,
+    // while the archive it appends to is still alive
+    m_databaseWriter->flush();
+    delete m_databaseWriter;
+    m_databaseWriter = nullptr;
+}
+
+bool MainWindow::usersLoaded() const {
+    return m_usersLoaded;
+}
+
+void MainWindow::onUsersLoaded() {
+    const QVector<User*> loaded = m_databaseWriter->takeLoadedUsers();
+    m_database->adoptHistories(loaded);
+    m_auth->addLoadedUsers(loaded);
+    m_usersLoaded = true;
+    StartupProfiler::mark("users loaded");
+
+    if (m_statisticsView && m_statisticsView->isVisible()) {
+        populateLeaderboard();
+        updateStatistics();
+    }
 }
 
 void MainWindow::setupUI() {
@@ -650,15 +868,13 @@ void MainWindow::setupUI() {
     m_stackedWidget = new QStackedWidget(this);
     setCentralWidget(m_stackedWidget);
 
-    // Create screens
-    m_modeSelectionScreen = new QWidget();
-    m_playerAuthScreen = new QWidget();
-    m_gameScreen = new QWidget();
-    m_statisticsView = new QWidget();
+    // Screens, the statistics view and the loading overlay are created by
+    // ensureScreen() and showLoading() the first time they are needed
+}
 
+void MainWindow::setupModeSelectionScreen() {
+    m_modeSelectionScreen = new QWidget();
     m_stackedWidget->addWidget(m_modeSelectionScreen);
-    m_stackedWidget->addWidget(m_playerAuthScreen);
-    m_stackedWidget->addWidget(m_gameScreen);
 
     // Create mode selection screen
     QVBoxLayout *modeLayout = new QVBoxLayout(m_modeSelectionScreen);
@@ -742,6 +958,18 @@ void MainWindow::setupUI() {
 
     modeLayout->addWidget(authPanel);
 
+    connect(m_vsAIBtn, &QPushButton::clicked, this, &MainWindow::onVsAIClicked);
+    connect(m_vsPlayerBtn, &QPushButton::clicked, this, &MainWindow::onVsPlayerClicked);
+    connect(m_loginBtn, &QPushButton::clicked, this, &MainWindow::onLoginClicked);
+    connect(m_registerBtn, &QPushButton::clicked, this, &MainWindow::onRegisterClicked);
+
+    applyScreenStyle(m_modeSelectionScreen, "modeselection");
+}
+
+void MainWindow::setupPlayerAuthScreen() {
+    m_playerAuthScreen = new QWidget();
+    m_stackedWidget->addWidget(m_playerAuthScreen);
+
     // Setup player auth screen
     QVBoxLayout *playerAuthLayout = new QVBoxLayout(m_playerAuthScreen);
 
@@ -788,13 +1016,23 @@ void MainWindow::setupUI() {
 
     playerAuthLayout->addWidget(playerAuthPanel);
 
-    // Create game screen
-    setupGameBoard();
+    connect(m_startPvpGameBtn, &QPushButton::clicked, this, &MainWindow::onStartPvpGameClicked);
+    connect(m_backToModeBtn, &QPushButton::clicked, this, &MainWindow::onBackToModeClicked);
+}
 
+void MainWindow::setupLoadingOverlay() {
     // Create loading overlay
     m_loadingOverlay = new QWidget(this);
     m_loadingOverlay->setObjectName("loadingOverlay");
-    m_loadingOverlay->setStyleSheet("background-color: rgba(0, 0, 0, 0.8);");
+    // Apply web-style loading animation
+    m_loadingOverlay->setStyleSheet(
+        "QWidget {"
+        "  background-color: rgba(0, 0, 0, 0.8);"
+        "  display: flex;"
+        "  justify-content: center;"
+        "  align-items: center;"
+        "}"
+    );
     m_loadingOverlay->setFixedSize(this->size());
     m_loadingOverlay->setVisible(false);
 
@@ -807,15 +1045,25 @@ void MainWindow::setupUI() {
     m_loadingSpinner->setMaximumSize(50, 50);
     m_loadingSpinner->setStyleSheet("border: 5px solid rgba(0, 238, 255, 0.3); border-radius: 25px; border-top-color: #00eeff;");
 
-    // Add spinner animation
-    QMovie *spinnerMovie = new QMovie(":/images/spinner.gif");
+    // Add spinner animation; it only runs while the overlay is up
+    QMovie *spinnerMovie = new QMovie(":/images/spinner.gif", QByteArray(), m_loadingSpinner);
     m_loadingSpinner->setMovie(spinnerMovie);
-    spinnerMovie->start();
 
     loadingLayout->addWidget(m_loadingSpinner);
+
+    // Hide overlay after duration with fade out
+    m_loadingTimer = new QTimer(this);
+    m_loadingTimer->setSingleShot(true);
+    connect(m_loadingTimer, &QTimer::timeout, this, [this]() {
+        m_loadingSpinner->movie()->stop();
+        m_effects->fadeOut(m_loadingOverlay, 200);
+    });
 }
 
 void MainWindow::setupGameBoard() {
+    m_gameScreen = new QWidget();
+    m_stackedWidget->addWidget(m_gameScreen);
+
     QHBoxLayout *gameLayout = new QHBoxLayout(m_gameScreen);
 
     // Title - Professional Tic Tac Toe
@@ -1001,6 +1249,12 @@ void MainWindow::setupGameBoard() {
         "letter-spacing: 1px;"
     );
     
+    m_hintBtn = new QPushButton("Hint");
+    m_hintBtn->setObjectName("hintBtn");
+    m_hintBtn->setFixedHeight(45);
+    m_hintBtn->setToolTip("Highlight the best moves for the player to move");
+    m_hintBtn->setStyleSheet(m_newGameBtn->styleSheet());
+
     m_exitGameBtn = new QPushButton("Exit Game");
     m_exitGameBtn->setObjectName("exitGameBtn"); // Set object name for QSS styling
     m_exitGameBtn->setFixedHeight(45);
@@ -1018,6 +1272,7 @@ void MainWindow::setupGameBoard() {
     
     gameActionsLayout->addWidget(m_newGameBtn);
     gameActionsLayout->addWidget(m_saveGameBtn);
+    gameActionsLayout->addWidget(m_hintBtn);
     gameActionsLayout->addWidget(m_exitGameBtn);
 
     gameBoardLayout->addLayout(gameActionsLayout);
@@ -1061,12 +1316,30 @@ void MainWindow::setupGameBoard() {
     // Add main layout to game screen
     gameLayout->addLayout(mainLayout);
 
-    // Setup statistics view
-    setupStatisticsView();
+    // Game logic connections
+    connect(m_gameLogic, &GameLogic::gameOver, this, &MainWindow::onGameOver);
+    connect(m_gameLogic, &GameLogic::playerChanged, this, &MainWindow::onPlayerChanged);
+    connect(m_gameLogic, &GameLogic::boardChanged, this, &MainWindow::onBoardChanged);
+
+    // Button connections
+    connect(m_newGameBtn, &QPushButton::clicked, this, &MainWindow::onNewGameClicked);
+    connect(m_saveGameBtn, &QPushButton::clicked, this, &MainWindow::onSaveGameClicked);
+    connect(m_hintBtn, &QPushButton::clicked, this, &MainWindow::onHintClicked);
+    connect(m_exitGameBtn, &QPushButton::clicked, this, &MainWindow::onExitGameClicked);
+    connect(m_toggleStatsViewBtn, &QPushButton::clicked, this, &MainWindow::onToggleStatsViewClicked);
+
+    // Difficulty buttons
+    connect(m_easyBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
+    connect(m_mediumBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
+    connect(m_hardBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
+    connect(m_expertBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
+
+    applyScreenStyle(m_gameScreen, "game");
 }
 
 void MainWindow::setupStatisticsView() {
-    // Statistics view should already be initialized in the constructor
+    // A separate top-level widget shown over the game screen
+    m_statisticsView = new QWidget();
     m_statisticsView->setObjectName("statisticsView");
     m_statisticsView->setGeometry(0, 0, this->width(), this->height());
     
@@ -1212,6 +1485,10 @@ void MainWindow::setupStatisticsView() {
     QWidget *vsAIBox = createStatBox("vs AI", m_statVsAI);
     QWidget *vsPlayersBox = createStatBox("vs Players", m_statVsPlayers);
     QWidget *bestStreakBox = createStatBox("Best Streak", m_statBestStreak);
+    QWidget *lastWeekBox = createStatBox("Last 7 Days", m_statLastWeek);
+    QWidget *lastGamesBox = createStatBox("Last 50 Games", m_statLastGames);
+    QWidget *mistakeRateBox = createStatBox("Mistake Rate", m_statMistakeRate);
+    QWidget *blundersBox = createStatBox("Blunders", m_statBlunders);
     
     // Add stat boxes to grid in a 2-column layout
     statsGridLayout->addWidget(totalGamesBox, 0, 0);
@@ -1222,6 +1499,10 @@ void MainWindow::setupStatisticsView() {
     statsGridLayout->addWidget(vsAIBox, 2, 1);
     statsGridLayout->addWidget(vsPlayersBox, 3, 0);
     statsGridLayout->addWidget(bestStreakBox, 3, 1);
+    statsGridLayout->addWidget(lastWeekBox, 4, 0);
+    statsGridLayout->addWidget(lastGamesBox, 4, 1);
+    statsGridLayout->addWidget(mistakeRateBox, 5, 0);
+    statsGridLayout->addWidget(blundersBox, 5, 1);
     
     statsPanelLayout->addLayout(statsGridLayout);
     personalStatsLayout->addWidget(statsPanel);
@@ -1255,6 +1536,28 @@ void MainWindow::setupStatisticsView() {
     m_leaderboardList->setContentsMargins(0, 0, 0, 0); // No margins
     leaderboardPanelLayout->addWidget(m_leaderboardList);
     leaderboardLayout->addWidget(leaderboardPanel);
+
+    // Most played openings across the archive, under the leaderboard
+    QWidget *openingsPanel = new QWidget();
+    openingsPanel->setObjectName("statsPanel");
+    openingsPanel->setStyleSheet("border: 1px solid #0088ff; border-radius: 5px; background-color: rgba(0, 10, 30, 0.2); box-shadow: 0 0 5px rgba(0, 136, 255, 0.4);");
+    openingsPanel->setContentsMargins(5, 5, 5, 5);
+    QVBoxLayout *openingsPanelLayout = new QVBoxLayout(openingsPanel);
+    openingsPanelLayout->setContentsMargins(20, 20, 20, 20);
+
+    QLabel *openingsTitle = new QLabel("Popular Openings");
+    openingsTitle->setObjectName("panelTitle");
+    openingsTitle->setStyleSheet("color: #00eeff; font-size: 22px; margin-top: 0; margin-bottom: 15px; text-shadow: 0 0 5px #00eeff; font-weight: bold;");
+    openingsTitle->setAlignment(Qt::AlignLeft);
+    openingsPanelLayout->addWidget(openingsTitle);
+
+    m_openingsList = new QListWidget();
+    m_openingsList->setObjectName("openingsList");
+    m_openingsList->setStyleSheet("background-color: transparent; border: none;");
+    m_openingsList->setSpacing(10);
+    m_openingsList->setContentsMargins(0, 0, 0, 0);
+    openingsPanelLayout->addWidget(m_openingsList);
+    leaderboardLayout->addWidget(openingsPanel);
     
     // Game History Tab Content - styled to match the leaderboard
     QWidget *historyContent = new QWidget();
@@ -1324,53 +1627,115 @@ void MainWindow::setupStatisticsView() {
         m_leaderboardDelegate = new LeaderboardItemDelegate();
         m_leaderboardList->setItemDelegate(m_leaderboardDelegate);
     }
+    m_openingsList->setItemDelegate(m_leaderboardDelegate);
     
     if (!m_historyItemDelegate) {
         m_historyItemDelegate = new HistoryItemDelegate();
         m_fullHistoryList->setItemDelegate(m_historyItemDelegate);
     }
     
+    connect(m_backToGameBtn, &QPushButton::clicked, this, &MainWindow::onBackToGameClicked);
+
+    applyScreenStyle(m_statisticsView, "statistics");
+
     // Initially hide statistics view
     m_statisticsView->hide();
 }
 
-void MainWindow::setupConnections() {
-    // Game logic connections
-    connect(m_gameLogic, &GameLogic::gameOver, this, &MainWindow::onGameOver);
-    connect(m_gameLogic, &GameLogic::playerChanged, this, &MainWindow::onPlayerChanged);
-    connect(m_gameLogic, &GameLogic::boardChanged, this, &MainWindow::onBoardChanged);
+void MainWindow::setupStyleSheet() {
+    // Rules shared by every screen are applied in main.cpp; each screen loads
+    // its own sheet through applyScreenStyle() when it is built
+}
 
-    // Button connections
-    connect(m_vsAIBtn, &QPushButton::clicked, this, &MainWindow::onVsAIClicked);
-    connect(m_vsPlayerBtn, &QPushButton::clicked, this, &MainWindow::onVsPlayerClicked);
-    connect(m_loginBtn, &QPushButton::clicked, this, &MainWindow::onLoginClicked);
-    connect(m_registerBtn, &QPushButton::clicked, this, &MainWindow::onRegisterClicked);
-    connect(m_startPvpGameBtn, &QPushButton::clicked, this, &MainWindow::onStartPvpGameClicked);
-    connect(m_backToModeBtn, &QPushButton::clicked, this, &MainWindow::onBackToModeClicked);
-    connect(m_newGameBtn, &QPushButton::clicked, this, &MainWindow::onNewGameClicked);
-    connect(m_saveGameBtn, &QPushButton::clicked, this, &MainWindow::onSaveGameClicked);
-    connect(m_exitGameBtn, &QPushButton::clicked, this, &MainWindow::onExitGameClicked);
-    connect(m_toggleStatsViewBtn, &QPushButton::clicked, this, &MainWindow::onToggleStatsViewClicked);
-    connect(m_backToGameBtn, &QPushButton::clicked, this, &MainWindow::onBackToGameClicked);
+void MainWindow::applyScreenStyle(QWidget *screen, const QString &name) {
+    QFile styleFile(QString(":/styles/%1.qss").arg(name));
+    if (!styleFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qDebug() << "Could not load stylesheet for" << name;
+        return;
+    }
+    screen->setStyleSheet(QString::fromUtf8(styleFile.readAll()));
+}
 
-    // Difficulty buttons
-    connect(m_easyBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
-    connect(m_mediumBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
-    connect(m_hardBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
-    connect(m_expertBtn, &QPushButton::clicked, this, &MainWindow::onDifficultyButtonClicked);
+void MainWindow::ensureScreen(Screen screen) {
+    switch (screen) {
+    case Screen::ModeSelection:
+        if (!m_modeSelectionScreen) {
+            setupModeSelectionScreen();
+        }
+        break;
 
-    // Tab connections have been replaced with direct button connections in setupStatisticsView
+    case Screen::PlayerAuth:
+        if (!m_playerAuthScreen) {
+            setupPlayerAuthScreen();
+        }
+        break;
 
-    // Connect cells to click handler
-    const int cellCount = m_cells.size();
-    for (int i = 0; i < cellCount; ++i) {
-        QPushButton* cell = m_cells.at(i);
-        connect(cell, &QPushButton::clicked, this, &MainWindow::onCellClicked);
+    case Screen::Game:
+        if (!m_gameScreen) {
+            setupGameBoard();
+        }
+        break;
+
+    case Screen::Statistics:
+        // Shown over the game screen
+        ensureScreen(Screen::Game);
+        if (!m_statisticsView) {
+            setupStatisticsView();
+        }
+        break;
     }
 }
 
-void MainWindow::setupStyleSheet() {
-    // Apply stylesheet to the parent widget - not needed since we load it in main.cpp
+void MainWindow::preloadScreens() {
+    ensureScreen(Screen::ModeSelection);
+    ensureScreen(Screen::PlayerAuth);
+    ensureScreen(Screen::Statistics);
+    if (!m_loadingOverlay) {
+        setupLoadingOverlay();
+    }
+}
+
+void MainWindow::connectToServer(const QString &host, quint16 port) {
+    if (!m_gameClient) {
+        m_gameClient = new GameClient(this);
+        connect(m_gameClient, &GameClient::gameOpened, this, &MainWindow::onRemoteGameOpened);
+        connect(m_gameClient, &GameClient::moved, this, &MainWindow::onRemoteMoved);
+        connect(m_gameClient, &GameClient::moveRejected, this, &MainWindow::onRemoteMoveRejected);
+        connect(m_gameClient, &GameClient::disconnected, this, [this]() {
+            qDebug() << "Lost the game server, two-player games are local again";
+            m_remoteGame = false;
+            m_remoteSession = 0;
+            m_remoteOpens = 0;
+        });
+    }
+    m_gameClient->connectToServer(host, port);
+}
+
+void MainWindow::onRemoteGameOpened(quint32 session) {
+    // Answers come in order, so only the last one is for the current game
+    m_remoteOpens = qMax(0, m_remoteOpens - 1);
+    if (!m_remoteGame || m_remoteOpens > 0) {
+        return;
+    }
+    if (session == 0) {
+        qDebug() << "Game server refused the game, playing it locally";
+        m_remoteGame = false;
+        return;
+    }
+    m_remoteSession = session;
+}
+
+void MainWindow::onRemoteMoved(quint32 session, int cellIndex) {
+    // The server has already checked the move
+    if (m_remoteGame && session == m_remoteSession) {
+        m_gameLogic->makeMove(cellIndex);
+    }
+}
+
+void MainWindow::onRemoteMoveRejected(quint32 session) {
+    if (m_remoteGame && session == m_remoteSession) {
+        updateGameStatus("The server did not accept that move");
+    }
 }
 
 void MainWindow::setupTitleAnimation(QLabel* titleLabel) {
@@ -1386,29 +1751,35 @@ void MainWindow::setupTitleAnimation(QLabel* titleLabel) {
 }
 
 void MainWindow::showScreen(Screen screen) {
-    // Show loading before changing screen
-    showLoading();
+    ensureScreen(screen);
+
+    // Show loading before changing screen; nothing to cover before the
+    // window first appears
+    if (isVisible()) {
+        showLoading();
+    }
+
+    // Screens not built yet have nothing to hide
+    const bool statistics = screen == Screen::Statistics;
+    if (m_statisticsView) {
+        m_statisticsView->setVisible(statistics);
+        m_backToGameBtn->setVisible(statistics);
+    }
+    if (m_toggleStatsViewBtn) {
+        m_toggleStatsViewBtn->setVisible(screen == Screen::Game);
+    }
 
     switch (screen) {
     case Screen::ModeSelection:
         m_stackedWidget->setCurrentWidget(m_modeSelectionScreen);
-        m_statisticsView->hide();
-        m_toggleStatsViewBtn->hide();
-        m_backToGameBtn->hide();
         break;
 
     case Screen::PlayerAuth:
         m_stackedWidget->setCurrentWidget(m_playerAuthScreen);
-        m_statisticsView->hide();
-        m_toggleStatsViewBtn->hide();
-        m_backToGameBtn->hide();
         break;
 
     case Screen::Game:
         m_stackedWidget->setCurrentWidget(m_gameScreen);
-        m_statisticsView->hide();
-        m_toggleStatsViewBtn->show();
-        m_backToGameBtn->hide();
 
         if (m_gameMode == GameMode::AI) {
             m_difficultyContainer->show();
@@ -1419,9 +1790,6 @@ void MainWindow::showScreen(Screen screen) {
 
     case Screen::Statistics:
         m_stackedWidget->setCurrentWidget(m_gameScreen);
-        m_statisticsView->show();
-        m_toggleStatsViewBtn->hide();
-        m_backToGameBtn->show();
         break;
     }
 }
@@ -1438,6 +1806,14 @@ void MainWindow::onCellClicked() {
 
     int index = cell->property("index").toInt();
 
+    if (m_remoteGame) {
+        // The board changes once the server confirms the move
+        if (m_remoteSession != 0) {
+            m_gameClient->sendMove(m_remoteSession, index);
+        }
+        return;
+    }
+
     if (m_gameLogic->makeMove(index) && m_gameMode == GameMode::AI) {
         // AI should make a move after a short delay
         QTimer::singleShot(700, m_aiOpponent, &AIOpponent::makeMove);
@@ -1449,7 +1825,70 @@ void MainWindow::onNewGameClicked() {
 }
 
 void MainWindow::onSaveGameClicked() {
-    QMessageBox::information(this, "Save Game", "Game saved successfully!");
+    // Finished games are archived as they end; this makes sure the players'
+    // statistics are on disk too
+    m_auth->saveUsers();
+    GameArchive *archive = m_database->gameArchive();
+    QMessageBox::information(this, "Save Game",
+                             archive->isOpen() ? QString("Game saved successfully!\n%1 games in the archive.")
+                                                     .arg(archive->count())
+                                               : QString("Game saved successfully!"));
+}
+
+void MainWindow::onHintClicked() {
+    if (m_gameLogic->getGameResult() != GameLogic::GameResult::InProgress) {
+        return;
+    }
+    // Against the AI, only the player's own moves get hints
+    if (m_gameMode == GameMode::AI && m_gameLogic->getCurrentPlayer() != GameLogic::Player::X) {
+        return;
+    }
+    m_moveAnalyzer->requestAnalysis(MoveAnalyzer::snapshotOf(*m_gameLogic));
+}
+
+void MainWindow::onAnalysisReady(const MoveAnalyzer::Analysis &analysis) {
+    const BoardSnapshot board = MoveAnalyzer::snapshotOf(*m_gameLogic);
+    if (analysis.board.x != board.x || analysis.board.o != board.o || analysis.moves.isEmpty()) {
+        return; // Someone has moved since it was asked for
+    }
+
+    clearHint();
+    const QVector<int> best = analysis.bestMoves();
+    for (int index : best) {
+        QPushButton* cell = m_cells[index];
+        cell->setProperty("hint", true);
+        cell->style()->unpolish(cell);
+        cell->style()->polish(cell);
+        m_hintCells |= quint16(1u << index);
+    }
+
+    const MoveAnalyzer::MoveScore &move = analysis.moves.first();
+    switch (move.outcome()) {
+    case MoveAnalyzer::Outcome::Win: {
+        // In the player's own moves, this one included
+        const int moves = (move.distance + 1) / 2;
+        updateGameStatus(moves == 1 ? QString("Hint: the highlighted move wins")
+                                    : QString("Hint: a forced win in %1 moves").arg(moves));
+        break;
+    }
+    case MoveAnalyzer::Outcome::Draw:
+        updateGameStatus("Hint: best play from here is a draw");
+        break;
+    case MoveAnalyzer::Outcome::Loss:
+        updateGameStatus("Hint: every move loses against best play; these hold out longest");
+        break;
+    }
+}
+
+void MainWindow::clearHint() {
+    while (m_hintCells) {
+        const int index = qCountTrailingZeroBits(m_hintCells);
+        m_hintCells &= m_hintCells - 1;
+        QPushButton* cell = m_cells[index];
+        cell->setProperty("hint", false);
+        cell->style()->unpolish(cell);
+        cell->style()->polish(cell);
+    }
 }
 
 void MainWindow::onExitGameClicked() {
@@ -1517,6 +1956,8 @@ void MainWindow::onVsPlayerClicked() {
         return;
     }
 
+    // Filled in before the screen is shown, so build it first
+    ensureScreen(Screen::PlayerAuth);
     m_player1UsernameInput->setText(m_auth->getCurrentUser()->getUsername());
     m_player1PasswordInput->clear();
     m_player2UsernameInput->clear();
@@ -1591,6 +2032,14 @@ void MainWindow::onLoginClicked() {
         return;
     }
 
+    if (!m_usersLoaded) {
+        m_loginStatus->setText("Loading players, try again in a moment");
+        m_loginStatus->setProperty("status", "error");
+        m_loginStatus->style()->unpolish(m_loginStatus);
+        m_loginStatus->style()->polish(m_loginStatus);
+        return;
+    }
+
     if (m_auth->login(username, password)) {
         m_loginStatus->setText(QString("Logged in as %1").arg(username));
         m_loginStatus->setProperty("status", "success");
@@ -1616,6 +2065,14 @@ void MainWindow::onRegisterClicked() {
         return;
     }
 
+    if (!m_usersLoaded) {
+        m_loginStatus->setText("Loading players, try again in a moment");
+        m_loginStatus->setProperty("status", "error");
+        m_loginStatus->style()->unpolish(m_loginStatus);
+        m_loginStatus->style()->polish(m_loginStatus);
+        return;
+    }
+
     if (m_auth->registerUser(username, password)) {
         m_loginStatus->setText("Registration successful. You can now login.");
         m_loginStatus->setProperty("status", "success");
@@ -1635,6 +2092,11 @@ void MainWindow::onStartPvpGameClicked() {
     QString player2Username = m_player2UsernameInput->text();
     QString player2Password = m_player2PasswordInput->text();
 
+    if (!m_usersLoaded) {
+        QMessageBox::information(this, "Loading", "Players are still loading, try again in a moment.");
+        return;
+    }
+
     QString errorMessage;
     if (m_auth->authenticatePlayers(player1Username, player1Password,
                                     player2Username, player2Password,
@@ -1680,8 +2142,9 @@ void MainWindow::onGameOver(GameLogic::GameResult result) {
             updateGameStatus("You win!");
             if (m_auth->getCurrentUser()) {
                 // Convert GameLogic moves to GameMoveRecord
-                QVector<GameMoveRecord> moveRecords;
                 const auto& moves = m_gameLogic->getMoveHistory();
+                QVector<GameMoveRecord> moveRecords;
+                moveRecords.reserve(moves.size());
                 for (const GameMove& move : moves) {
                     GameMoveRecord record;
                     record.cellIndex = move.cellIndex;
@@ -1735,8 +2198,9 @@ void MainWindow::onGameOver(GameLogic::GameResult result) {
             updateGameStatus("AI wins!");
             if (m_auth->getCurrentUser()) {
                 // Convert GameLogic moves to GameMoveRecord
-                QVector<GameMoveRecord> moveRecords;
                 const auto& moves = m_gameLogic->getMoveHistory();
+                QVector<GameMoveRecord> moveRecords;
+                moveRecords.reserve(moves.size());
                 for (const GameMove& move : moves) {
                     GameMoveRecord record;
                     record.cellIndex = move.cellIndex;
@@ -1791,8 +2255,9 @@ void MainWindow::onGameOver(GameLogic::GameResult result) {
         if (m_gameMode == GameMode::AI) {
             if (m_auth->getCurrentUser()) {
                 // Convert GameLogic moves to GameMoveRecord
-                QVector<GameMoveRecord> moveRecords;
                 const auto& moves = m_gameLogic->getMoveHistory();
+                QVector<GameMoveRecord> moveRecords;
+                moveRecords.reserve(moves.size());
                 for (const GameMove& move : moves) {
                     GameMoveRecord record;
                     record.cellIndex = move.cellIndex;
@@ -1844,9 +2309,10 @@ void MainWindow::onGameOver(GameLogic::GameResult result) {
     }
 
     highlightWinningCells();
+    archiveGame(result);
 
     // Update statistics if we're viewing them
-    if (m_statisticsView->isVisible()) {
+    if (m_statisticsView && m_statisticsView->isVisible()) {
         updateStatistics();
         populateLeaderboard(); // Update the leaderboard with new rankings
     }
@@ -1855,6 +2321,41 @@ void MainWindow::onGameOver(GameLogic::GameResult result) {
     m_auth->saveUsers();
 }
 
+void MainWindow::archiveGame(GameLogic::GameResult result) {
+    if (m_remoteGame) {
+        return; // The server archives the games it hosts
+    }
+    QString playerX = m_player1User;
+    QString playerO = m_player2User;
+    QString difficulty;
+    if (m_gameMode == GameMode::AI) {
+        if (!m_auth->getCurrentUser()) {
+            return;
+        }
+        playerX = m_auth->getCurrentUser()->getUsername();
+        playerO = GameArchive::COMPUTER_PLAYER;
+        difficulty = m_gameLogic->getAIDifficulty() == GameLogic::AIDifficulty::Easy ? "easy" :
+                         m_gameLogic->getAIDifficulty() == GameLogic::AIDifficulty::Medium ? "medium" :
+                         m_gameLogic->getAIDifficulty() == GameLogic::AIDifficulty::Hard ? "hard" : "expert";
+    }
+
+    const auto& moves = m_gameLogic->getMoveHistory();
+    QVector<GameMoveRecord> moveRecords;
+    moveRecords.reserve(moves.size());
+    for (const GameMove& move : moves) {
+        moveRecords.append({move.cellIndex, move.player});
+    }
+
+    // Appended on the writer thread, stamped with the time it ended
+    ArchivedGame game;
+    game.playerX = playerX;
+    game.playerO = playerO;
+    game.result = result;
+    game.difficulty = difficulty;
+    game.packedMoves = MoveCodec::pack(moveRecords);
+    m_databaseWriter->scheduleGame(game);
+}
+
 void MainWindow::onPlayerChanged(GameLogic::Player player) {
     if (m_gameMode == GameMode::AI) {
         if (player == GameLogic::Player::X) {
@@ -1886,37 +2387,34 @@ void MainWindow::onPlayerChanged(GameLogic::Player player) {
 }
 
 void MainWindow::onBoardChanged() {
+    // Shared style strings so repainting a cell does not rebuild them
+    static const QString xStyle = QStringLiteral(
+        "color: #ff69b4; "
+        "text-shadow: 0 0 10px #ff69b4, 0 0 15px #ff69b4; "
+        "font-size: 48px; "
+        "font-weight: bold;"
+    );
+    static const QString oStyle = QStringLiteral(
+        "color: #00eeff; " // Updated to match web color
+        "text-shadow: 0 0 10px #00eeff, 0 0 20px #00eeff; "
+        "font-size: 48px; "
+        "font-weight: bold;"
+    );
+    static const QString xValue = QStringLiteral("X");
+    static const QString oValue = QStringLiteral("O");
+
+    // A hint is for the position it was asked in
+    clearHint();
     for (int i = 0; i < 9; ++i) {
         auto state = m_gameLogic->getCellState(i);
-
-        if (state == GameLogic::Player::X) {
-            m_cells[i]->setText("X");
-            m_cells[i]->setProperty("cell-value", "X");
-            // Match web version exactly with enhanced glow
-            m_cells[i]->setStyleSheet(
-                "color: #ff69b4; "
-                "text-shadow: 0 0 10px #ff69b4, 0 0 15px #ff69b4; "
-                "font-size: 48px; "
-                "font-weight: bold;"
-            );
-        } else if (state == GameLogic::Player::O) {
-            m_cells[i]->setText("O");
-            m_cells[i]->setProperty("cell-value", "O");
-            // Match web version exactly with enhanced glow
-            m_cells[i]->setStyleSheet(
-                "color: #00eeff; " // Updated to match web color
-                "text-shadow: 0 0 10px #00eeff, 0 0 20px #00eeff; "
-                "font-size: 48px; "
-                "font-weight: bold;"
-            );
-        } else {
-            m_cells[i]->setText("");
-            m_cells[i]->setProperty("cell-value", "");
-            m_cells[i]->setStyleSheet("");
-        }
-
-        m_cells[i]->style()->unpolish(m_cells[i]);
-        m_cells[i]->style()->polish(m_cells[i]);
+        // Match web version exactly with enhanced glow
+        updateCell(m_cells[i],
+                   state == GameLogic::Player::X ? xValue
+                   : state == GameLogic::Player::O ? oValue
+                   : QString(),
+                   state == GameLogic::Player::X ? xStyle
+                   : state == GameLogic::Player::O ? oStyle
+                   : QString());
     }
 }
 
@@ -1947,6 +2445,19 @@ void MainWindow::updateStatistics() {
     m_statWinRate->setText(QString("%1%").arg(currentUser->getWinRate()));
     m_statBestStreak->setText(QString::number(currentUser->getBestStreak()));
 
+    // Windowed counters kept on the user, shown as wins-losses-draws
+    auto windowText = [](const WindowStats &window) {
+        return QString("%1-%2-%3").arg(window.wins).arg(window.losses).arg(window.draws);
+    };
+    m_statLastWeek->setText(windowText(currentUser->getRecentDays(7)));
+    m_statLastGames->setText(windowText(currentUser->getRecentGames(50)));
+
+    // Graded by the batch analysis, loaded by reloadBlunderSummary()
+    const MistakeTally tally = m_blunderSummary.tally(currentUser->getUsername());
+    m_statMistakeRate->setText(tally.moves == 0 ? QString("-")
+                                                : QString("%1%").arg(tally.mistakeRate() * 100.0, 0, 'f', 1));
+    m_statBlunders->setText(QString::number(tally.blunders));
+
     // Update full history with styled items like the leaderboard
     m_fullHistoryList->clear();
     const auto& gameHistory = currentUser->getGameHistory();
@@ -1959,11 +2470,11 @@ void MainWindow::updateStatistics() {
         QListWidgetItem* item = new QListWidgetItem();
         
         // Format the game result with the player's name
-        QString formattedResult = QString("%1. %2: %3").arg(count).arg(currentUser->getUsername()).arg(record.result);
+        QString formattedResult = QString("%1. %2: %3").arg(count).arg(currentUser->getUsername()).arg(record.result());
         item->setText(formattedResult);
         
         // Store the date as user data for display on the right
-        item->setData(Qt::UserRole, record.date);
+        item->setData(Qt::UserRole, record.date());
         
         // Set item size to match leaderboard items
         item->setSizeHint(QSize(m_fullHistoryList->width() - 20, 50));
@@ -1982,11 +2493,51 @@ void MainWindow::updateStatistics() {
     }
 }
 
+void MainWindow::reloadBlunderSummary() {
+    const QString path = BlunderAnalysis::summaryPath(m_database->gameArchivePath());
+    const qint64 loadedModified = m_blunderSummaryModified;
+    m_summaryLoader.start([this, path, loadedModified]() {
+        // Other files in the directory come and go too; only a new summary
+        // is read
+        const QFileInfo info(path);
+        const qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+        if (modified == loadedModified) {
+            return;
+        }
+        BlunderSummary summary;
+        summary.load(path);
+
+        // The destructor waits for this task, so the window is still there
+        QMetaObject::invokeMethod(this, [this, path, summary, modified]() {
+            m_blunderSummary = summary;
+            m_blunderSummaryModified = modified;
+            if (modified >= 0 && !m_summaryWatcher->files().contains(path)) {
+                m_summaryWatcher->addPath(path);
+            }
+            if (m_statisticsView && m_statisticsView->isVisible()) {
+                updateStatistics();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
 void MainWindow::populateLeaderboard() {
     m_leaderboardList->clear();
 
-    // Get leaderboard data using the new ranking system
-    QVector<LeaderboardEntry> leaderboard = m_database->getLeaderboard(m_auth->getUsers());
+    // Ranked from the in-memory columns, which already count the latest game;
+    // asking SQLite would mean waiting on the writer and the disk here
+    const bool byRating = m_database->ranking() == Database::Ranking::Rating;
+    if (byRating && !m_database->gameArchive()->isOpen()) {
+        // Ratings come from the archive, which the writer thread is still reading
+        QListWidgetItem* item = new QListWidgetItem();
+        item->setText("Leaderboard");
+        item->setData(Qt::UserRole, "Loading ratings…");
+        item->setSizeHint(QSize(m_leaderboardList->width() - 20, 50));
+        m_leaderboardList->addItem(item);
+        populateOpenings();
+        return;
+    }
+    const QVector<LeaderboardEntry> leaderboard = m_database->getLeaderboard(m_auth->userStore(), LEADERBOARD_SIZE);
     
     // Add each ranked player to the leaderboard
     int rank = 1;
@@ -1995,9 +2546,14 @@ void MainWindow::populateLeaderboard() {
         const LeaderboardEntry& entry = leaderboard.at(i);
         QListWidgetItem* item = new QListWidgetItem();
         // Format: "1. username" (rank and username)
-        item->setText(QString("%1. %2").arg(rank).arg(entry.username));
-        // Format: "Wins: X | Win Rate: Y%" (stats)
-        item->setData(Qt::UserRole, QString("Wins: %1 | Win Rate: %2%").arg(entry.wins).arg(entry.winRate));
+        item->setText(QString("%1. %2").arg(rank).arg(entry.username()));
+        // Format: "Wins: X | Win Rate: Y%" (stats), led by the rating when ranking by it
+        if (byRating) {
+            item->setData(Qt::UserRole, QString("Rating: %1 | Wins: %2 | Win Rate: %3%")
+                                            .arg(entry.rating).arg(entry.wins).arg(entry.winRate));
+        } else {
+            item->setData(Qt::UserRole, QString("Wins: %1 | Win Rate: %2%").arg(entry.wins).arg(entry.winRate));
+        }
         m_leaderboardList->addItem(item);
         rank++;
     }
@@ -2025,6 +2581,64 @@ void MainWindow::populateLeaderboard() {
         m_leaderboardDelegate = new LeaderboardItemDelegate();
         m_leaderboardList->setItemDelegate(m_leaderboardDelegate);
     }
+
+    populateOpenings();
+}
+
+// The opening's position, a row at a time, e.g. "X · · / · O · / · · ·"
+static QString describeOpening(const BoardSnapshot &board) {
+    QStringList rows;
+    for (int row = 0; row < 3; ++row) {
+        QStringList cells;
+        for (int column = 0; column < 3; ++column) {
+            const GameLogic::Player player = board.cell(row * 3 + column);
+            cells.append(player == GameLogic::Player::X ? "X" : player == GameLogic::Player::O ? "O" : "·");
+        }
+        rows.append(cells.join(' '));
+    }
+    return rows.join(" / ");
+}
+
+void MainWindow::populateOpenings() {
+    m_openingsList->clear();
+
+    GameArchive *archive = m_database->gameArchive();
+    if (!archive->isOpen()) {
+        QListWidgetItem *item = new QListWidgetItem();
+        item->setText("Openings");
+        item->setData(Qt::UserRole, "Loading openings…");
+        item->setSizeHint(QSize(m_openingsList->width() - 20, 50));
+        m_openingsList->addItem(item);
+        return;
+    }
+
+    // A copy of the archive's trie, which every archived game updates
+    const OpeningTrie openings = archive->openings();
+    auto addOpening = [this, &openings](int index, const QString &prefix) {
+        const OpeningTrie::Node &node = openings.node(index);
+        const int games = int(node.games());
+        QListWidgetItem *item = new QListWidgetItem();
+        item->setText(prefix + describeOpening(node.board()));
+        item->setData(Qt::UserRole, QString("Games: %1 | Opener wins %2% | Draws %3%")
+                                        .arg(games)
+                                        .arg(games ? qRound(100.0 * node.wins / games) : 0)
+                                        .arg(games ? qRound(100.0 * node.draws / games) : 0));
+        item->setSizeHint(QSize(m_openingsList->width() - 20, 50));
+        m_openingsList->addItem(item);
+    };
+    for (int first : openings.topChildren(OpeningTrie::ROOT, OPENINGS_SHOWN)) {
+        addOpening(first, QString());
+        for (int reply : openings.topChildren(first, OPENINGS_SHOWN)) {
+            addOpening(reply, "  ↳ ");
+        }
+    }
+
+    if (m_openingsList->count() == 0) {
+        QListWidgetItem *item = new QListWidgetItem();
+        item->setText("Openings");
+        item->setData(Qt::UserRole, "Finished games will show up here");
+        m_openingsList->addItem(item);
+    }
 }
 
 void MainWindow::highlightWinningCells() {
@@ -2086,13 +2700,21 @@ void MainWindow::addGameToHistory(const QString &result) {
     m_historyList->clear();
     const auto& entries = m_gameHistory->getEntries();
     for (const GameHistory::HistoryEntry &entry : entries) {
-        m_historyList->addItem(entry.result);
+        m_historyList->addItem(entry.result());
     }
 }
 
 void MainWindow::resetGame() {
     m_gameLogic->resetBoard();
 
+    // Two-player games go to the game server when there is one
+    m_remoteGame = m_gameMode == GameMode::Player && m_gameClient && m_gameClient->isConnected();
+    m_remoteSession = 0;
+    if (m_remoteGame) {
+        m_gameClient->openGame(m_player1User, m_player2User);
+        m_remoteOpens++;
+    }
+
     updatePlayerInfo();
 
     // Set the correct player indicators based on game mode
@@ -2125,55 +2747,16 @@ void MainWindow::resetGame() {
 }
 
 void MainWindow::showLoading(int duration) {
-    // Apply web-style loading animation
-    m_loadingOverlay->setStyleSheet(
-        "QWidget {"
-        "  background-color: rgba(0, 0, 0, 0.8);"
-        "  display: flex;"
-        "  justify-content: center;"
-        "  align-items: center;"
-        "}"
-    );
-    
-    // Create the spinner animation if not already set up
-    if (!m_loadingSpinner->movie()) {
-        QGraphicsOpacityEffect* fadeEffect = new QGraphicsOpacityEffect(this);
-        m_loadingOverlay->setGraphicsEffect(fadeEffect);
-        
-        // Fade in animation
-        QPropertyAnimation* fadeIn = new QPropertyAnimation(fadeEffect, "opacity");
-        fadeIn->setDuration(200);
-        fadeIn->setStartValue(0.0);
-        fadeIn->setEndValue(1.0);
-        fadeIn->setEasingCurve(QEasingCurve::InOutQuad);
-        
-        // Show and start animation
-        m_loadingOverlay->setVisible(true);
-        m_loadingOverlay->raise();
-        fadeIn->start(QAbstractAnimation::DeleteWhenStopped);
-    } else {
-        m_loadingOverlay->setVisible(true);
-        m_loadingOverlay->raise();
+    if (!m_loadingOverlay) {
+        setupLoadingOverlay();
     }
 
-    // Hide overlay after duration with fade out
-    QTimer::singleShot(duration - 200, this, [this]() {
-        QGraphicsOpacityEffect* fadeEffect = new QGraphicsOpacityEffect(this);
-        m_loadingOverlay->setGraphicsEffect(fadeEffect);
-        
-        // Fade out animation
-        QPropertyAnimation* fadeOut = new QPropertyAnimation(fadeEffect, "opacity");
-        fadeOut->setDuration(200);
-        fadeOut->setStartValue(1.0);
-        fadeOut->setEndValue(0.0);
-        fadeOut->setEasingCurve(QEasingCurve::InOutQuad);
-        
-        connect(fadeOut, &QPropertyAnimation::finished, this, [this]() {
-            m_loadingOverlay->setVisible(false);
-        });
-        
-        fadeOut->start(QAbstractAnimation::DeleteWhenStopped);
-    });
+    // Shown at once, cancelling any fade out still running; a call while it
+    // is up keeps it up for the new duration
+    m_effects->fadeIn(m_loadingOverlay, 0);
+    m_loadingOverlay->raise();
+    m_loadingSpinner->movie()->start();
+    m_loadingTimer->start(duration - 200);
 }
 
 // Add the slot implementation for handling replay button clicks
@@ -2207,7 +2790,7 @@ void MainWindow::onReplayButtonClicked(int index) {
     }
     
     // Create and show the replay dialog
-    ReplayDialog* replayDialog = new ReplayDialog(this);
+    ReplayDialog* replayDialog = new ReplayDialog(this, m_effects);
     replayDialog->setGameData(gameDate, players, result, "6 sec");
     
     // Get the actual move history from the user's game history
@@ -2217,12 +2800,14 @@ void MainWindow::onReplayButtonClicked(int index) {
     if (m_auth->getCurrentUser()) {
         const auto& gameHistory = m_auth->getCurrentUser()->getGameHistory();
         
-        // Find the matching game record by date
+        // Find the matching game record by date, compared as interned keys
+        const qint64 dateKey = StringInterner::internDate(gameDate);
         for (const GameRecord& record : gameHistory) {
             // Check if this is the same game by comparing date
-            if (record.date == gameDate) {
-                // Convert GameMoveRecord to GameMove
-                for (const GameMoveRecord& moveRecord : record.moves) {
+            if (record.dateKey == dateKey) {
+                // Moves are stored packed; decode them now that the replay is opening
+                const QVector<GameMoveRecord> moveRecords = record.decodeMoves();
+                for (const GameMoveRecord& moveRecord : moveRecords) {
                     GameMove move;
                     move.cellIndex = moveRecord.cellIndex;
                     move.player = moveRecord.player;
@@ -2233,39 +2818,8 @@ void MainWindow::onReplayButtonClicked(int index) {
         }
     }
     
-    // If no move history was found, generate representative moves
-    // based on the game outcome
-    if (gameMoves.isEmpty()) {
-        if (result.contains("won")) {
-            // X wins scenario (player wins)
-            gameMoves.append({0, 1}); // X in top-left
-            gameMoves.append({3, 2}); // O in middle-left
-            gameMoves.append({1, 1}); // X in top-middle
-            gameMoves.append({5, 2}); // O in middle-right
-            gameMoves.append({2, 1}); // X in top-right (winning move)
-        } else if (result.contains("lost")) {
-            // O wins scenario (AI wins)
-            gameMoves.append({4, 1}); // X in center
-            gameMoves.append({0, 2}); // O in top-left
-            gameMoves.append({8, 1}); // X in bottom-right
-            gameMoves.append({3, 2}); // O in middle-left
-            gameMoves.append({7, 1}); // X in bottom-middle
-            gameMoves.append({6, 2}); // O in bottom-left (winning move)
-        } else {
-            // Draw scenario
-            gameMoves.append({0, 1}); // X in top-left
-            gameMoves.append({4, 2}); // O in center
-            gameMoves.append({2, 1}); // X in top-right
-            gameMoves.append({6, 2}); // O in bottom-left
-            gameMoves.append({3, 1}); // X in middle-left
-            gameMoves.append({5, 2}); // O in middle-right
-            gameMoves.append({7, 1}); // X in bottom-middle
-            gameMoves.append({1, 2}); // O in top-middle
-            gameMoves.append({8, 1}); // X in bottom-right
-        }
-    }
-    
-    // Set the moves data
+    // Games archived before moves were recorded replay as an empty board
+    // rather than with made-up moves
     replayDialog->setMoveData(gameMoves);
     
     replayDialog->exec();
@@ -2274,12 +2828,59 @@ void MainWindow::onReplayButtonClicked(int index) {
     delete replayDialog;
 }
 
+void ReplayDialog::onGlowTimeout() {
+    if (m_glowFrame == 0) {
+        m_glowStep = 1;
+    } else if (m_glowFrame == m_glowFrames.size() - 1) {
+        m_glowStep = -1;
+    }
+    m_glowFrame += m_glowStep;
+
+    // Only the band along the border changes
+    const int margin = EffectPool::glowMargin(GLOW_RADIUS, GLOW_BLUR);
+    update(QRegion(rect()).subtracted(QRegion(rect().adjusted(margin, margin, -margin, -margin))));
+}
+
+void ReplayDialog::paintEvent(QPaintEvent* event) {
+    QDialog::paintEvent(event);
+
+    QPainter painter(this);
+    EffectPool::drawGlow(&painter, rect(), m_glowFrames.at(m_glowFrame),
+                         EffectPool::glowMargin(GLOW_RADIUS, GLOW_BLUR));
+}
+
+void ReplayDialog::showEvent(QShowEvent* event) {
+    QDialog::showEvent(event);
+    m_glowTimer->start();
+}
+
+void ReplayDialog::hideEvent(QHideEvent* event) {
+    QDialog::hideEvent(event);
+    m_glowTimer->stop();
+}
+
 // New method to set the move data for replay
 void ReplayDialog::setMoveData(const QVector<GameMove>& moves) {
-    m_moves = moves;
-    m_totalMoves = moves.size();
-    m_currentMove = 0;
-    updateMoveCounter();
-    updateBoard();
-    updateButtonStates();
+    m_playbackTimer->stop();
+    m_timeline.setMoves(moves);
+    m_totalMoves = m_timeline.plyCount();
+    m_shownMove = -1;
+
+    // The timeline has just filled the analyzer's cache with these positions
+    const bool oFirst = ReplayTimeline::isOFirst(moves);
+    m_moveQualities.clear();
+    m_moveQualities.reserve(moves.size());
+    for (int ply = 0; ply < moves.size(); ++ply) {
+        const BoardSnapshot board = ReplayTimeline::firstMoverBoard(m_timeline.at(ply), oFirst);
+        m_moveQualities.append(MoveAnalyzer::grade(board, moves.at(ply).cellIndex));
+    }
+    
+    {
+        const QSignalBlocker blocker(m_scrubber);
+        m_scrubber->setRange(0, m_totalMoves);
+    }
+    m_scrubber->setEnabled(m_totalMoves > 0);
+    m_evaluationGraph->setTimeline(&m_timeline);
+    m_evaluationGraph->setMoveQualities(m_moveQualities);
+    seek(0);
 }
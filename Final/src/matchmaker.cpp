@@ -0,0 +1,164 @@
+#include "../include/matchmaker.h"
+#include <QtGlobal>
+#include <algorithm>
+
+Matchmaker::Matchmaker()
+    : Matchmaker(Options())
+{
+}
+
+Matchmaker::Matchmaker(const Options &options)
+    : m_options(options)
+{
+    m_options.bucketWidth = qMax(1, m_options.bucketWidth);
+    m_options.initialWindow = qMax(0, m_options.initialWindow);
+    m_options.maxWindow = qMax(m_options.initialWindow, m_options.maxWindow);
+}
+
+int Matchmaker::window(qint64 waitedMs) const {
+    const qint64 grown = m_options.initialWindow + m_options.windowGrowth * qMax<qint64>(0, waitedMs) / 1000;
+    return int(qMin<qint64>(grown, m_options.maxWindow));
+}
+
+int Matchmaker::bucketOf(int rating) const {
+    // Rounds down for negative ratings too
+    const int width = m_options.bucketWidth;
+    return rating >= 0 ? rating / width : -((-rating + width - 1) / width);
+}
+
+bool Matchmaker::enqueue(quint32 player, int rating, qint64 now, Match *match) {
+    if (m_tickets.contains(player)) {
+        return false;
+    }
+
+    Ticket ticket;
+    ticket.player = player;
+    ticket.rating = rating;
+    ticket.queuedAt = now;
+    Ticket partner;
+    if (findPartner(ticket, now, &partner)) {
+        remove(partner.player);
+        if (match) {
+            *match = makeMatch(partner, ticket, now);
+        }
+        return true;
+    }
+
+    // Joins the back of its bucket's queue
+    Bucket &bucket = m_buckets[bucketOf(rating)];
+    ticket.older = bucket.newest;
+    if (bucket.newest != NOBODY) {
+        m_tickets[bucket.newest].newer = player;
+    } else {
+        bucket.oldest = player;
+    }
+    bucket.newest = player;
+    m_tickets.insert(player, ticket);
+    return false;
+}
+
+bool Matchmaker::cancel(quint32 player) {
+    if (!m_tickets.contains(player)) {
+        return false;
+    }
+    remove(player);
+    return true;
+}
+
+QVector<Matchmaker::Match> Matchmaker::poll(qint64 now) {
+    // Oldest first, so the longest waits are served before anyone else
+    QVector<Ticket> waiting;
+    waiting.reserve(m_tickets.size());
+    for (auto it = m_tickets.cbegin(); it != m_tickets.cend(); ++it) {
+        waiting.append(it.value());
+    }
+    std::sort(waiting.begin(), waiting.end(), [](const Ticket &a, const Ticket &b) {
+        return a.queuedAt != b.queuedAt ? a.queuedAt < b.queuedAt : a.player < b.player;
+    });
+
+    QVector<Match> matches;
+    for (const Ticket &ticket : waiting) {
+        if (!m_tickets.contains(ticket.player)) {
+            continue; // Paired earlier in this poll
+        }
+        Ticket partner;
+        if (findPartner(ticket, now, &partner)) {
+            remove(ticket.player);
+            remove(partner.player);
+            matches.append(ticket.queuedAt <= partner.queuedAt ? makeMatch(ticket, partner, now)
+                                                                : makeMatch(partner, ticket, now));
+        }
+    }
+    return matches;
+}
+
+bool Matchmaker::findPartner(const Ticket &ticket, qint64 now, Ticket *partner) const {
+    const int ownWindow = window(now - ticket.queuedAt);
+    bool found = false;
+    int bestGap = 0;
+
+    // Nobody's window is wider than maxWindow
+    const int first = bucketOf(ticket.rating - m_options.maxWindow);
+    const int last = bucketOf(ticket.rating + m_options.maxWindow);
+    for (int key = first; key <= last; ++key) {
+        const auto bucket = m_buckets.constFind(key);
+        if (bucket == m_buckets.cend()) {
+            continue;
+        }
+        // The front has waited longest, so its window is the widest there
+        auto it = m_tickets.constFind(bucket->oldest);
+        if (it->player == ticket.player) {
+            if (it->newer == NOBODY) {
+                continue;
+            }
+            it = m_tickets.constFind(it->newer);
+        }
+        const Ticket &candidate = it.value();
+        const int gap = qAbs(candidate.rating - ticket.rating);
+        if (gap > qMax(ownWindow, window(now - candidate.queuedAt))) {
+            continue;
+        }
+        // Closest rating, then longest wait
+        if (!found || gap < bestGap || (gap == bestGap && candidate.queuedAt < partner->queuedAt)) {
+            *partner = candidate;
+            bestGap = gap;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void Matchmaker::remove(quint32 player) {
+    const auto found = m_tickets.constFind(player);
+    if (found == m_tickets.cend()) {
+        return;
+    }
+    const Ticket ticket = found.value();
+    m_tickets.erase(found);
+
+    // Unlinks the ticket from its bucket's queue
+    const auto bucket = m_buckets.find(bucketOf(ticket.rating));
+    if (ticket.older != NOBODY) {
+        m_tickets[ticket.older].newer = ticket.newer;
+    } else {
+        bucket->oldest = ticket.newer;
+    }
+    if (ticket.newer != NOBODY) {
+        m_tickets[ticket.newer].older = ticket.older;
+    } else {
+        bucket->newest = ticket.older;
+    }
+    if (bucket->oldest == NOBODY) {
+        m_buckets.erase(bucket);
+    }
+}
+
+Matchmaker::Match Matchmaker::makeMatch(const Ticket &a, const Ticket &b, qint64 now) const {
+    Match match;
+    match.first = a.player;
+    match.second = b.player;
+    match.firstWaitMs = now - a.queuedAt;
+    match.secondWaitMs = now - b.queuedAt;
+    match.ratingGap = qAbs(a.rating - b.rating);
+    return match;
+}
@@ -0,0 +1,267 @@
+#include "../include/moveanalyzer.h"
+#include <QHash>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+#include <QtAlgorithms>
+#include <algorithm>
+
+// Where each cell goes under the board's rotations and reflections
+static constexpr int kSymmetries[8][9] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8},    // Identity
+    {2, 5, 8, 1, 4, 7, 0, 3, 6},    // Quarter turn
+    {8, 7, 6, 5, 4, 3, 2, 1, 0},    // Half turn
+    {6, 3, 0, 7, 4, 1, 8, 5, 2},    // Three quarters
+    {2, 1, 0, 5, 4, 3, 8, 7, 6},    // Mirrored left to right
+    {6, 7, 8, 3, 4, 5, 0, 1, 2},    // Mirrored top to bottom
+    {0, 3, 6, 1, 4, 7, 2, 5, 8},    // Main diagonal
+    {8, 5, 2, 7, 4, 1, 6, 3, 0}     // Other diagonal
+};
+
+// Every cell mask under every symmetry, so canonicalising is 16 lookups
+struct SymmetryTable {
+    SymmetryTable() {
+        for (int symmetry = 0; symmetry < 8; ++symmetry) {
+            for (int mask = 0; mask < 512; ++mask) {
+                quint16 mapped = 0;
+                for (int cell = 0; cell < 9; ++cell) {
+                    if (mask & (1 << cell)) {
+                        mapped |= quint16(1u << kSymmetries[symmetry][cell]);
+                    }
+                }
+                masks[symmetry][mask] = mapped;
+            }
+        }
+    }
+    quint16 masks[8][512];
+};
+
+static const SymmetryTable &symmetryTable() {
+    static const SymmetryTable table;
+    return table;
+}
+
+// Values from X's side by canonical position, shared by every thread
+struct AnalysisCache {
+    QReadWriteLock lock;
+    QHash<quint32, qint8> values;
+};
+static AnalysisCache s_cache;
+
+// One ply further away; draws stay draws
+static int fromChild(int value) {
+    return value > 0 ? value - 1 : value < 0 ? value + 1 : 0;
+}
+
+// Terminal positions are never cached, they are cheaper to recognise
+static bool terminalValue(const BoardSnapshot &board, int *value) {
+    const GameLogic::Player winner = board.winner();
+    if (winner != GameLogic::Player::None) {
+        *value = winner == GameLogic::Player::X ? ReplayTimeline::WIN_SCORE : -ReplayTimeline::WIN_SCORE;
+        return true;
+    }
+    if (board.isFull()) {
+        *value = 0;
+        return true;
+    }
+    return false;
+}
+
+static bool xToMove(const BoardSnapshot &board) {
+    // X moves whenever the marks are level, whoever a recorded game let move
+    return qPopulationCount(board.x) <= qPopulationCount(board.o);
+}
+
+// Called with the cache locked for writing
+static int solve(const BoardSnapshot &board) {
+    int value = 0;
+    if (terminalValue(board, &value)) {
+        return value;
+    }
+    const quint32 key = MoveAnalyzer::canonicalKey(board.x, board.o);
+    const auto cached = s_cache.values.constFind(key);
+    if (cached != s_cache.values.constEnd()) {
+        return cached.value();
+    }
+
+    const bool xMoves = xToMove(board);
+    const quint16 occupied = board.x | board.o;
+    int best = xMoves ? -ReplayTimeline::WIN_SCORE - 1 : ReplayTimeline::WIN_SCORE + 1;
+    for (int cell = 0; cell < 9; ++cell) {
+        const quint16 bit = quint16(1u << cell);
+        if (occupied & bit) {
+            continue;
+        }
+        BoardSnapshot child = board;
+        if (xMoves) {
+            child.x |= bit;
+        } else {
+            child.o |= bit;
+        }
+        const int score = fromChild(solve(child));
+        best = xMoves ? qMax(best, score) : qMin(best, score);
+    }
+
+    s_cache.values.insert(key, qint8(best));
+    return best;
+}
+
+MoveAnalyzer::Outcome MoveAnalyzer::MoveScore::outcome() const {
+    return value > 0 ? Outcome::Win : value < 0 ? Outcome::Loss : Outcome::Draw;
+}
+
+QVector<int> MoveAnalyzer::Analysis::bestMoves() const {
+    QVector<int> cells;
+    for (const MoveScore &move : moves) {
+        if (move.value != value()) {
+            break;
+        }
+        cells.append(move.cell);
+    }
+    return cells;
+}
+
+const MoveAnalyzer::MoveScore *MoveAnalyzer::Analysis::find(int cell) const {
+    for (const MoveScore &move : moves) {
+        if (move.cell == cell) {
+            return &move;
+        }
+    }
+    return nullptr;
+}
+
+MoveAnalyzer::MoveAnalyzer(QObject *parent)
+    : QObject(parent)
+{
+    // One worker answers requests in the order they came
+    m_pool.setMaxThreadCount(1);
+}
+
+MoveAnalyzer::~MoveAnalyzer() {
+    m_pool.waitForDone();
+}
+
+quint32 MoveAnalyzer::canonicalKey(quint16 x, quint16 o) {
+    const SymmetryTable &table = symmetryTable();
+    quint32 best = 0xFFFFFFFF;
+    for (int symmetry = 0; symmetry < 8; ++symmetry) {
+        const quint32 key = (quint32(table.masks[symmetry][x & 0x1FF]) << 9) | table.masks[symmetry][o & 0x1FF];
+        best = qMin(best, key);
+    }
+    return best;
+}
+
+int MoveAnalyzer::canonicalSymmetry(quint16 x, quint16 o) {
+    const SymmetryTable &table = symmetryTable();
+    quint32 best = 0xFFFFFFFF;
+    int bestSymmetry = 0;
+    for (int symmetry = 0; symmetry < 8; ++symmetry) {
+        const quint32 key = (quint32(table.masks[symmetry][x & 0x1FF]) << 9) | table.masks[symmetry][o & 0x1FF];
+        if (key < best) {
+            best = key;
+            bestSymmetry = symmetry;
+        }
+    }
+    return bestSymmetry;
+}
+
+int MoveAnalyzer::transformCell(int symmetry, int cell) {
+    return kSymmetries[symmetry][cell];
+}
+
+int MoveAnalyzer::evaluate(const BoardSnapshot &board) {
+    int value = 0;
+    if (terminalValue(board, &value)) {
+        return value;
+    }
+    const quint32 key = canonicalKey(board.x, board.o);
+    {
+        QReadLocker locker(&s_cache.lock);
+        const auto cached = s_cache.values.constFind(key);
+        if (cached != s_cache.values.constEnd()) {
+            return cached.value();
+        }
+    }
+    QWriteLocker locker(&s_cache.lock);
+    return solve(board);
+}
+
+MoveAnalyzer::Analysis MoveAnalyzer::analyze(const BoardSnapshot &board) {
+    Analysis analysis;
+    analysis.board = board;
+    if (board.winner() != GameLogic::Player::None || board.isFull()) {
+        return analysis;
+    }
+
+    const bool xMoves = xToMove(board);
+    analysis.toMove = xMoves ? GameLogic::Player::X : GameLogic::Player::O;
+    const quint16 occupied = board.x | board.o;
+    const int emptyCells = 9 - qPopulationCount(occupied);
+    analysis.moves.reserve(emptyCells);
+    for (int cell = 0; cell < 9; ++cell) {
+        const quint16 bit = quint16(1u << cell);
+        if (occupied & bit) {
+            continue;
+        }
+        BoardSnapshot child = board;
+        if (xMoves) {
+            child.x |= bit;
+        } else {
+            child.o |= bit;
+        }
+        MoveScore move;
+        move.cell = cell;
+        move.value = fromChild(evaluate(child)) * (xMoves ? 1 : -1);
+        // A drawn game only ends when the board is full
+        move.distance = move.value != 0 ? ReplayTimeline::WIN_SCORE - qAbs(move.value) : emptyCells;
+        analysis.moves.append(move);
+    }
+    std::stable_sort(analysis.moves.begin(), analysis.moves.end(), [](const MoveScore &a, const MoveScore &b) {
+        return a.value > b.value;
+    });
+    return analysis;
+}
+
+MoveAnalyzer::MoveQuality MoveAnalyzer::grade(const BoardSnapshot &before, int cell) {
+    const Analysis analysis = analyze(before);
+    const MoveScore *played = analysis.find(cell);
+    if (!played) {
+        return MoveQuality::Illegal;
+    }
+    if (played->value == analysis.value()) {
+        return MoveQuality::Best;
+    }
+    const Outcome best = analysis.moves.first().outcome();
+    if (played->outcome() == best) {
+        return MoveQuality::Inaccuracy;
+    }
+    return best == Outcome::Win && played->outcome() == Outcome::Loss ? MoveQuality::Blunder
+                                                                      : MoveQuality::Mistake;
+}
+
+BoardSnapshot MoveAnalyzer::snapshotOf(const GameLogic &logic) {
+    BoardSnapshot board;
+    for (int cell = 0; cell < 9; ++cell) {
+        const GameLogic::Player player = logic.getCellState(cell);
+        if (player == GameLogic::Player::X) {
+            board.x |= quint16(1u << cell);
+        } else if (player == GameLogic::Player::O) {
+            board.o |= quint16(1u << cell);
+        }
+    }
+    return board;
+}
+
+int MoveAnalyzer::cachedPositions() {
+    QReadLocker locker(&s_cache.lock);
+    return s_cache.values.size();
+}
+
+void MoveAnalyzer::requestAnalysis(const BoardSnapshot &board) {
+    m_pool.start([this, board]() {
+        const Analysis analysis = analyze(board);
+        // The destructor waits for this task, so the object is still there
+        QMetaObject::invokeMethod(this, [this, analysis]() { emit analysisReady(analysis); },
+                                  Qt::QueuedConnection);
+    });
+}
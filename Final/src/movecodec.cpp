@@ -0,0 +1,56 @@
+#include "../include/movecodec.h"
+
+static constexpr int kLengthBits = 4;
+static constexpr int kCellBits = 4;
+static constexpr quint64 kCellMask = 0xF;
+static constexpr int kFirstMoverBit = kLengthBits + kCellBits * MoveCodec::MAX_MOVES;
+
+quint64 MoveCodec::pack(const QVector<GameMoveRecord> &moves) {
+    const int count = qMin(static_cast<int>(moves.size()), MAX_MOVES);
+    if (count == 0) {
+        return 0;
+    }
+
+    quint64 packed = static_cast<quint64>(count);
+    for (int i = 0; i < count; ++i) {
+        const quint64 cell = static_cast<quint64>(moves.at(i).cellIndex) & kCellMask;
+        packed |= cell << (kLengthBits + kCellBits * i);
+    }
+    if (moves.at(0).player == 2) {
+        packed |= quint64(1) << kFirstMoverBit;
+    }
+    return packed;
+}
+
+QVector<GameMoveRecord> MoveCodec::unpack(quint64 packed) {
+    QVector<GameMoveRecord> moves;
+    const int count = length(packed);
+    moves.reserve(count);
+
+    int player = (packed >> kFirstMoverBit) & 1 ? 2 : 1;
+    for (int i = 0; i < count; ++i) {
+        GameMoveRecord move;
+        move.cellIndex = static_cast<int>((packed >> (kLengthBits + kCellBits * i)) & kCellMask);
+        move.player = player;
+        moves.append(move);
+        player = player == 1 ? 2 : 1;
+    }
+    return moves;
+}
+
+int MoveCodec::length(quint64 packed) {
+    return qMin(static_cast<int>(packed & kCellMask), MAX_MOVES);
+}
+
+quint64 MoveCodec::append(quint64 packed, int cellIndex, int player) {
+    const int count = length(packed);
+    if (count == MAX_MOVES) {
+        return packed;
+    }
+    if (count == 0 && player == 2) {
+        packed |= quint64(1) << kFirstMoverBit;
+    }
+    const quint64 cell = static_cast<quint64>(cellIndex) & kCellMask;
+    packed = (packed & ~kCellMask) | static_cast<quint64>(count + 1);
+    return packed | cell << (kLengthBits + kCellBits * count);
+}
@@ -0,0 +1,202 @@
+#include "../include/openingbook.h"
+#include "../include/gamearchive.h"
+#include "../include/moveanalyzer.h"
+#include "../include/movecodec.h"
+#include <QDebug>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+
+static constexpr int kPageSize = 65536; // Archive records read at once while building
+
+OpeningBook::~OpeningBook() {
+    close();
+}
+
+// Header layout, little endian:
+//   0  quint32 magic
+//   4  quint32 version
+//   8  quint32 entries
+//   12 reserved
+bool OpeningBook::open(const QString &path) {
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    const uchar *data = size >= HEADER_SIZE ? m_file.map(0, size) : nullptr;
+    const quint32 count = data ? qFromLittleEndian<quint32>(data + 8) : 0;
+    if (!data || qFromLittleEndian<quint32>(data) != MAGIC || qFromLittleEndian<quint32>(data + 4) != VERSION
+        || size != HEADER_SIZE + qint64(count) * ENTRY_SIZE) {
+        qDebug() << "Ignoring unreadable opening book:" << path;
+        m_file.close(); // Also drops the map
+        return false;
+    }
+    m_entries = data + HEADER_SIZE;
+    m_count = int(count);
+    return true;
+}
+
+void OpeningBook::close() {
+    m_entries = nullptr;
+    m_count = 0;
+    m_file.close();
+}
+
+// Entry layout, little endian:
+//   0  quint32    canonical position
+//   4  quint16[9] times each cell was played, canonical orientation
+//   22 reserved
+const uchar *OpeningBook::findEntry(quint32 key) const {
+    int low = 0;
+    int high = m_count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        const quint32 found = qFromLittleEndian<quint32>(m_entries + qint64(middle) * ENTRY_SIZE);
+        if (found == key) {
+            return m_entries + qint64(middle) * ENTRY_SIZE;
+        }
+        if (found < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+bool OpeningBook::lookup(const BoardSnapshot &board, quint32 counts[9]) const {
+    if (!m_entries) {
+        return false;
+    }
+    const uchar *entry = findEntry(MoveAnalyzer::canonicalKey(board.x, board.o));
+    if (!entry) {
+        return false;
+    }
+    const int symmetry = MoveAnalyzer::canonicalSymmetry(board.x, board.o);
+    for (int cell = 0; cell < 9; ++cell) {
+        counts[cell] = qFromLittleEndian<quint16>(entry + 4 + 2 * MoveAnalyzer::transformCell(symmetry, cell));
+    }
+    return true;
+}
+
+int OpeningBook::pickMove(const BoardSnapshot &board, QRandomGenerator *random) const {
+    quint32 counts[9];
+    if (!lookup(board, counts)) {
+        return -1;
+    }
+    quint32 total = 0;
+    for (int cell = 0; cell < 9; ++cell) {
+        if ((board.x | board.o) & (1u << cell)) {
+            counts[cell] = 0; // Only a damaged book could say otherwise
+        }
+        total += counts[cell];
+    }
+    if (total < quint32(MIN_GAMES)) {
+        return -1;
+    }
+
+    quint32 pick = random->bounded(total);
+    for (int cell = 0; cell < 9; ++cell) {
+        if (pick < counts[cell]) {
+            return cell;
+        }
+        pick -= counts[cell];
+    }
+    return -1;
+}
+
+struct CellCounts {
+    quint32 cells[9] = {};
+};
+
+bool OpeningBook::build(GameArchive *archive, const QString &path) {
+    // Counts by canonical position, in the canonical orientation; a few
+    // thousand positions at most, however long the archive
+    QHash<quint32, CellCounts> positions;
+    const qint64 total = archive->count();
+    qint64 next = 0;
+    while (next < total) {
+        const QVector<ArchivedGame> page = archive->range(next, kPageSize);
+        if (page.isEmpty()) {
+            qDebug() << "Failed to read the game archive for the opening book:" << archive->path();
+            return false;
+        }
+        next += page.size();
+
+        for (const ArchivedGame &game : page) {
+            const QVector<GameMoveRecord> moves = MoveCodec::unpack(game.packedMoves);
+            const bool vsAI = !game.difficulty.isEmpty();
+            // The first mover's marks go in x, so games O opened count the same
+            BoardSnapshot board;
+            for (int ply = 0; ply < qMin(int(BOOK_PLIES), int(moves.size())); ++ply) {
+                const int cell = moves.at(ply).cellIndex;
+                const quint16 bit = quint16(1u << cell);
+                if (cell > 8 || ((board.x | board.o) & bit) || board.winner() != GameLogic::Player::None) {
+                    break;
+                }
+                // Only people's moves; the computer plays O against them
+                if (!vsAI || moves.at(ply).player == 1) {
+                    const int symmetry = MoveAnalyzer::canonicalSymmetry(board.x, board.o);
+                    positions[MoveAnalyzer::canonicalKey(board.x, board.o)]
+                        .cells[MoveAnalyzer::transformCell(symmetry, cell)]++;
+                }
+                if (ply % 2 == 0) {
+                    board.x |= bit;
+                } else {
+                    board.o |= bit;
+                }
+            }
+        }
+    }
+
+    QVector<quint32> keys;
+    keys.reserve(positions.size());
+    for (auto it = positions.constBegin(); it != positions.constEnd(); ++it) {
+        keys.append(it.key());
+    }
+    std::sort(keys.begin(), keys.end());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to write opening book:" << path;
+        return false;
+    }
+    QByteArray data(HEADER_SIZE + keys.size() * ENTRY_SIZE, '\0');
+    uchar *out = reinterpret_cast<uchar*>(data.data());
+    qToLittleEndian<quint32>(MAGIC, out);
+    qToLittleEndian<quint32>(VERSION, out + 4);
+    qToLittleEndian<quint32>(quint32(keys.size()), out + 8);
+    out += HEADER_SIZE;
+    for (quint32 key : keys) {
+        const CellCounts counts = positions.value(key);
+        // Popular positions are scaled down to fit 16 bits, keeping proportions
+        quint32 most = 0;
+        for (quint32 count : counts.cells) {
+            most = qMax(most, count);
+        }
+        int shift = 0;
+        while ((most >> shift) > 0xFFFF) {
+            shift++;
+        }
+        qToLittleEndian<quint32>(key, out);
+        for (int cell = 0; cell < 9; ++cell) {
+            const quint32 count = counts.cells[cell];
+            qToLittleEndian<quint16>(quint16(count ? qMax<quint32>(1, count >> shift) : 0), out + 4 + 2 * cell);
+        }
+        out += ENTRY_SIZE;
+    }
+    if (file.write(data) != data.size() || !file.commit()) {
+        qDebug() << "Failed to write opening book:" << path;
+        return false;
+    }
+    return true;
+}
+
+QString OpeningBook::bookPath(const QString &archivePath) {
+    return archivePath + ".book";
+}
@@ -0,0 +1,182 @@
+#include "../include/openingtrie.h"
+#include "../include/moveanalyzer.h"
+#include "../include/movecodec.h"
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+// Outcomes for the player who moved first
+enum { kWin, kDraw, kLoss };
+
+BoardSnapshot OpeningTrie::Node::board() const {
+    BoardSnapshot snapshot;
+    snapshot.x = quint16((position >> 9) & 0x1FF);
+    snapshot.o = quint16(position & 0x1FF);
+    return snapshot;
+}
+
+OpeningTrie::OpeningTrie(int depth)
+    : m_depth(qBound(1, depth, MoveCodec::MAX_MOVES))
+{
+    clear();
+}
+
+int OpeningTrie::depth() const {
+    return m_depth;
+}
+
+int OpeningTrie::nodeCount() const {
+    return m_nodes.size();
+}
+
+void OpeningTrie::clear() {
+    m_nodes.clear();
+    m_nodes.append(Node());
+}
+
+int OpeningTrie::child(int node, quint32 position) const {
+    for (int next = m_nodes.at(node).firstChild; next >= 0; next = m_nodes.at(next).nextSibling) {
+        if (m_nodes.at(next).position == position) {
+            return next;
+        }
+    }
+    return -1;
+}
+
+int OpeningTrie::addChild(int node, quint32 position) {
+    const int found = child(node, position);
+    if (found >= 0) {
+        return found;
+    }
+    Node added;
+    added.position = position;
+    added.ply = m_nodes.at(node).ply + 1;
+    added.nextSibling = m_nodes.at(node).firstChild;
+    m_nodes.append(added);
+    m_nodes[node].firstChild = m_nodes.size() - 1;
+    return m_nodes.size() - 1;
+}
+
+void OpeningTrie::count(int node, int outcome) {
+    Node &counted = m_nodes[node];
+    if (outcome == kWin) {
+        counted.wins++;
+    } else if (outcome == kDraw) {
+        counted.draws++;
+    } else {
+        counted.losses++;
+    }
+}
+
+void OpeningTrie::add(quint64 packedMoves, GameLogic::GameResult result) {
+    const QVector<GameMoveRecord> moves = MoveCodec::unpack(packedMoves);
+    if (moves.isEmpty() || result == GameLogic::GameResult::InProgress) {
+        return;
+    }
+    const bool xFirst = moves.first().player == 1;
+    const int outcome = result == GameLogic::GameResult::Draw ? kDraw
+                        : (result == GameLogic::GameResult::XWins) == xFirst ? kWin
+                        : kLoss;
+
+    // The first mover's marks go in x, so games O opened share X's openings
+    int node = ROOT;
+    count(node, outcome);
+    BoardSnapshot board;
+    for (int ply = 0; ply < qMin(m_depth, int(moves.size())); ++ply) {
+        const int cell = moves.at(ply).cellIndex;
+        const quint16 bit = quint16(1u << cell);
+        if (cell > 8 || ((board.x | board.o) & bit)) {
+            break;
+        }
+        if (ply % 2 == 0) {
+            board.x |= bit;
+        } else {
+            board.o |= bit;
+        }
+        node = addChild(node, MoveAnalyzer::canonicalKey(board.x, board.o));
+        count(node, outcome);
+    }
+}
+
+void OpeningTrie::build(const QVector<OpeningGame> &games) {
+    clear();
+    const int threads = qMax(1, QThread::idealThreadCount());
+    if (games.size() < PARALLEL_BUILD_SIZE || threads == 1) {
+        for (const OpeningGame &game : games) {
+            add(game.packedMoves, game.result);
+        }
+        return;
+    }
+
+    // Each worker fills a trie of its own, so nothing is shared until the merge
+    const int chunk = (games.size() + threads - 1) / threads;
+    QVector<OpeningTrie> parts((games.size() + chunk - 1) / chunk, OpeningTrie(m_depth));
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int part = 0; part < parts.size(); ++part) {
+        const OpeningGame *first = games.constData() + part * chunk;
+        const OpeningGame *last = games.constData() + qMin(int(games.size()), (part + 1) * chunk);
+        OpeningTrie *out = parts.data() + part;
+        pool.start([first, last, out]() {
+            for (const OpeningGame *game = first; game != last; ++game) {
+                out->add(game->packedMoves, game->result);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    for (const OpeningTrie &part : parts) {
+        merge(ROOT, part, ROOT);
+    }
+}
+
+void OpeningTrie::merge(int into, const OpeningTrie &other, int from) {
+    const Node &source = other.m_nodes.at(from);
+    m_nodes[into].wins += source.wins;
+    m_nodes[into].draws += source.draws;
+    m_nodes[into].losses += source.losses;
+    for (int next = source.firstChild; next >= 0; next = other.m_nodes.at(next).nextSibling) {
+        merge(addChild(into, other.m_nodes.at(next).position), other, next);
+    }
+}
+
+int OpeningTrie::find(const QVector<int> &cells) const {
+    if (cells.size() > m_depth) {
+        return -1;
+    }
+    int node = ROOT;
+    BoardSnapshot board;
+    for (int ply = 0; ply < cells.size() && node >= 0; ++ply) {
+        const int cell = cells.at(ply);
+        if (cell < 0 || cell > 8 || ((board.x | board.o) & (1u << cell))) {
+            return -1;
+        }
+        if (ply % 2 == 0) {
+            board.x |= quint16(1u << cell);
+        } else {
+            board.o |= quint16(1u << cell);
+        }
+        node = child(node, MoveAnalyzer::canonicalKey(board.x, board.o));
+    }
+    return node;
+}
+
+QVector<int> OpeningTrie::topChildren(int node, int k) const {
+    QVector<int> children;
+    if (node < 0 || node >= m_nodes.size() || k <= 0) {
+        return children;
+    }
+    for (int next = m_nodes.at(node).firstChild; next >= 0; next = m_nodes.at(next).nextSibling) {
+        children.append(next);
+    }
+    // Ties by position, so the order does not depend on insertion
+    const auto byGames = [this](int a, int b) {
+        const Node &left = m_nodes.at(a);
+        const Node &right = m_nodes.at(b);
+        return left.games() != right.games() ? left.games() > right.games() : left.position < right.position;
+    };
+    const int kept = qMin(k, int(children.size()));
+    std::partial_sort(children.begin(), children.begin() + kept, children.end(), byGames);
+    children.resize(kept);
+    return children;
+}
@@ -0,0 +1,153 @@
+#include "../include/ratingengine.h"
+#include <QThread>
+#include <QThreadPool>
+#include <cmath>
+
+RatingEngine::RatingEngine()
+{
+}
+
+RatingEngine::RatingEngine(const Parameters &parameters)
+    : m_parameters(parameters)
+{
+}
+
+const RatingEngine::Parameters &RatingEngine::parameters() const {
+    return m_parameters;
+}
+
+void RatingEngine::setParameters(const Parameters &parameters) {
+    m_parameters = parameters;
+}
+
+double RatingEngine::expectedScore(double rating, double opponentRating) {
+    return 1.0 / (1.0 + std::pow(10.0, (opponentRating - rating) / 400.0));
+}
+
+void RatingEngine::ensurePlayer(quint32 player) {
+    if (player >= quint32(m_ratings.size())) {
+        const int oldSize = m_ratings.size();
+        m_ratings.resize(player + 1);
+        m_games.resize(player + 1);
+        for (int i = oldSize; i < m_ratings.size(); ++i) {
+            m_ratings[i] = m_parameters.initialRating;
+        }
+    }
+}
+
+void RatingEngine::rate(const RatedGame &game, double *ratings, int *games) const {
+    const bool vsAI = game.aiDifficulty != 0;
+    if ((!vsAI && game.playerX == game.playerO) || game.result == GameLogic::GameResult::InProgress) {
+        return;
+    }
+
+    const double score = game.result == GameLogic::GameResult::XWins ? 1.0
+                         : game.result == GameLogic::GameResult::OWins ? 0.0 : 0.5;
+    const double opponent = vsAI ? m_parameters.aiRatings[qMin<int>(game.aiDifficulty, 4)]
+                                 : ratings[game.playerO];
+    const double expected = expectedScore(ratings[game.playerX], opponent);
+
+    auto kFactor = [this, games](quint32 player) {
+        return games[player] < m_parameters.provisionalGames ? m_parameters.provisionalKFactor
+                                                             : m_parameters.kFactor;
+    };
+
+    ratings[game.playerX] += kFactor(game.playerX) * (score - expected);
+    games[game.playerX]++;
+    if (!vsAI) {
+        ratings[game.playerO] += kFactor(game.playerO) * (expected - score);
+        games[game.playerO]++;
+    }
+}
+
+void RatingEngine::apply(const RatedGame &game) {
+    ensurePlayer(game.playerX);
+    if (game.aiDifficulty == 0) {
+        ensurePlayer(game.playerO);
+    }
+    rate(game, m_ratings.data(), m_games.data());
+}
+
+void RatingEngine::recompute(const QVector<RatedGame> &games) {
+    quint32 players = 0;
+    for (const RatedGame &game : games) {
+        players = qMax(players, game.playerX + 1);
+        if (game.aiDifficulty == 0) {
+            players = qMax(players, game.playerO + 1);
+        }
+    }
+    m_ratings.fill(m_parameters.initialRating, int(players));
+    m_games.fill(0, int(players));
+
+    // A game's wave is one after the latest wave either player appeared in
+    QVector<int> lastWave(int(players), -1);
+    QVector<int> waveOf(games.size());
+    int waveCount = 0;
+    for (int i = 0; i < games.size(); ++i) {
+        const RatedGame &game = games.at(i);
+        const bool vsAI = game.aiDifficulty != 0;
+        const int wave = 1 + qMax(lastWave.at(game.playerX), vsAI ? -1 : lastWave.at(game.playerO));
+        waveOf[i] = wave;
+        lastWave[game.playerX] = wave;
+        if (!vsAI) {
+            lastWave[game.playerO] = wave;
+        }
+        waveCount = qMax(waveCount, wave + 1);
+    }
+
+    // Counting sort by wave, so every wave is one contiguous run
+    QVector<int> waveStart(waveCount + 1, 0);
+    for (int wave : waveOf) {
+        waveStart[wave + 1]++;
+    }
+    for (int wave = 0; wave < waveCount; ++wave) {
+        waveStart[wave + 1] += waveStart[wave];
+    }
+    QVector<int> next = waveStart;
+    QVector<RatedGame> ordered(games.size());
+    for (int i = 0; i < games.size(); ++i) {
+        ordered[next[waveOf.at(i)]++] = games.at(i);
+    }
+
+    // Waves run in order, the games inside one in parallel; no two of them
+    // touch the same player, so the flat arrays need no locking
+    double *ratings = m_ratings.data();
+    int *counts = m_games.data();
+    const RatedGame *rated = ordered.constData();
+    const int threads = qMax(1, QThread::idealThreadCount());
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int wave = 0; wave < waveCount; ++wave) {
+        const int begin = waveStart.at(wave);
+        const int end = waveStart.at(wave + 1);
+        if (end - begin < PARALLEL_WAVE_SIZE || threads == 1) {
+            for (int i = begin; i < end; ++i) {
+                rate(rated[i], ratings, counts);
+            }
+            continue;
+        }
+
+        const int chunk = (end - begin + threads - 1) / threads;
+        for (int from = begin; from < end; from += chunk) {
+            const int to = qMin(end, from + chunk);
+            pool.start([this, rated, ratings, counts, from, to]() {
+                for (int i = from; i < to; ++i) {
+                    rate(rated[i], ratings, counts);
+                }
+            });
+        }
+        pool.waitForDone();
+    }
+}
+
+double RatingEngine::rating(quint32 player) const {
+    return player < quint32(m_ratings.size()) ? m_ratings.at(player) : m_parameters.initialRating;
+}
+
+int RatingEngine::gamesRated(quint32 player) const {
+    return player < quint32(m_games.size()) ? m_games.at(player) : 0;
+}
+
+int RatingEngine::playerCount() const {
+    return m_ratings.size();
+}
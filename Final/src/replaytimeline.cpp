@@ -0,0 +1,98 @@
+#include "../include/replaytimeline.h"
+#include "../include/moveanalyzer.h"
+
+static constexpr quint16 kWinMasks[8] = {
+    0x007, 0x038, 0x1C0,  // Rows
+    0x049, 0x092, 0x124,  // Columns
+    0x111, 0x054          // Diagonals
+};
+
+static bool hasLine(quint16 marks) {
+    for (quint16 mask : kWinMasks) {
+        if ((marks & mask) == mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+GameLogic::Player BoardSnapshot::cell(int index) const {
+    const quint16 bit = quint16(1u << index);
+    if (x & bit) {
+        return GameLogic::Player::X;
+    }
+    if (o & bit) {
+        return GameLogic::Player::O;
+    }
+    return GameLogic::Player::None;
+}
+
+GameLogic::Player BoardSnapshot::winner() const {
+    if (hasLine(x)) {
+        return GameLogic::Player::X;
+    }
+    if (hasLine(o)) {
+        return GameLogic::Player::O;
+    }
+    return GameLogic::Player::None;
+}
+
+void ReplayTimeline::setMoves(const QVector<GameMove> &moves) {
+    m_snapshots.resize(1);
+    m_snapshots[0] = BoardSnapshot();
+    m_snapshots.reserve(moves.size() + 1);
+
+    BoardSnapshot board;
+    for (const GameMove &move : moves) {
+        if (move.cellIndex >= 0 && move.cellIndex < 9) {
+            const quint16 bit = quint16(1u << move.cellIndex);
+            if (!((board.x | board.o) & bit)) {
+                if (move.player == 1) {
+                    board.x |= bit;
+                } else {
+                    board.o |= bit;
+                }
+            }
+        }
+        m_snapshots.append(board);
+    }
+
+    // The analyzer takes the first mover's marks in x, so a game O opened is
+    // evaluated with the marks swapped and its scores turned back to X's side
+    const bool oFirst = isOFirst(moves);
+    m_evaluations.resize(m_snapshots.size());
+    for (int ply = 0; ply < m_snapshots.size(); ++ply) {
+        const int score = MoveAnalyzer::evaluate(firstMoverBoard(m_snapshots.at(ply), oFirst));
+        m_evaluations[ply] = qint8(oFirst ? -score : score);
+    }
+}
+
+bool ReplayTimeline::isOFirst(const QVector<GameMove> &moves) {
+    return !moves.isEmpty() && moves.first().player != 1;
+}
+
+BoardSnapshot ReplayTimeline::firstMoverBoard(const BoardSnapshot &board, bool oFirst) {
+    return oFirst ? BoardSnapshot{board.o, board.x} : board;
+}
+
+int ReplayTimeline::clampPly(int ply) const {
+    return qBound(0, ply, plyCount());
+}
+
+BoardSnapshot ReplayTimeline::at(int ply) const {
+    return m_snapshots.at(clampPly(ply));
+}
+
+quint16 ReplayTimeline::changedCells(int fromPly, int toPly) const {
+    const BoardSnapshot from = at(fromPly);
+    const BoardSnapshot to = at(toPly);
+    return quint16((from.x ^ to.x) | (from.o ^ to.o));
+}
+
+int ReplayTimeline::evaluation(int ply) const {
+    return m_evaluations.at(clampPly(ply));
+}
+
+double ReplayTimeline::winProbability(int ply) const {
+    return 0.5 + evaluation(ply) / (2.0 * WIN_SCORE);
+}
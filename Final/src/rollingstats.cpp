@@ -0,0 +1,104 @@
+#include "../include/rollingstats.h"
+#include <QJsonArray>
+#include <QtAlgorithms>
+
+RollingStats::RollingStats()
+    : m_winBits(0), m_lossBits(0), m_resultCount(0)
+{
+}
+
+void RollingStats::record(const QString &result, qint64 day) {
+    const bool win = result == "win";
+    const bool loss = result == "loss";
+    m_winBits = (m_winBits << 1) | (win ? 1 : 0);
+    m_lossBits = (m_lossBits << 1) | (loss ? 1 : 0);
+    if (m_resultCount < RESULT_CAPACITY) {
+        m_resultCount++;
+    }
+
+    // A slot still holding an older day is simply taken over; a game dated
+    // before the day already in its slot is too old to count
+    if (day < 0) {
+        return;
+    }
+    DayBucket &bucket = m_days[day % DAY_CAPACITY];
+    if (bucket.day > day) {
+        return;
+    }
+    if (bucket.day != day) {
+        bucket = DayBucket();
+        bucket.day = qint32(day);
+    }
+    if (win) {
+        bucket.wins++;
+    } else if (loss) {
+        bucket.losses++;
+    } else {
+        bucket.draws++;
+    }
+}
+
+WindowStats RollingStats::lastGames(int count) const {
+    WindowStats stats;
+    count = qBound(0, count, int(m_resultCount));
+    const quint64 mask = count >= 64 ? ~quint64(0) : (quint64(1) << count) - 1;
+    stats.wins = qPopulationCount(m_winBits & mask);
+    stats.losses = qPopulationCount(m_lossBits & mask);
+    stats.draws = count - stats.wins - stats.losses;
+    return stats;
+}
+
+WindowStats RollingStats::lastDays(int days, qint64 today) const {
+    WindowStats stats;
+    days = qBound(0, days, DAY_CAPACITY);
+    for (const DayBucket &bucket : m_days) {
+        if (bucket.day <= today && bucket.day > today - days) {
+            stats.wins += bucket.wins;
+            stats.losses += bucket.losses;
+            stats.draws += bucket.draws;
+        }
+    }
+    return stats;
+}
+
+QJsonObject RollingStats::toJson() const {
+    // The bit planes are 64 bits wide, more than a JSON number holds exactly
+    QJsonObject json;
+    json["wins"] = QString::number(m_winBits, 16);
+    json["losses"] = QString::number(m_lossBits, 16);
+    json["count"] = m_resultCount;
+
+    QJsonArray days;
+    for (const DayBucket &bucket : m_days) {
+        if (bucket.day >= 0) {
+            days.append(QJsonArray{bucket.day, bucket.wins, bucket.losses, bucket.draws});
+        }
+    }
+    json["days"] = days;
+    return json;
+}
+
+RollingStats RollingStats::fromJson(const QJsonObject &json) {
+    RollingStats stats;
+    stats.m_winBits = json["wins"].toString().toULongLong(nullptr, 16);
+    stats.m_lossBits = json["losses"].toString().toULongLong(nullptr, 16);
+    stats.m_resultCount = quint8(qBound(0, json["count"].toInt(), RESULT_CAPACITY));
+
+    const QJsonArray days = json["days"].toArray();
+    for (const QJsonValue &value : days) {
+        const QJsonArray entry = value.toArray();
+        const qint32 day = entry.at(0).toInt(-1);
+        if (entry.size() != 4 || day < 0) {
+            continue;
+        }
+        DayBucket &bucket = stats.m_days[day % DAY_CAPACITY];
+        if (bucket.day > day) {
+            continue; // Keep the newer day if two share a slot
+        }
+        bucket.day = day;
+        bucket.wins = quint16(entry.at(1).toInt());
+        bucket.losses = quint16(entry.at(2).toInt());
+        bucket.draws = quint16(entry.at(3).toInt());
+    }
+    return stats;
+}
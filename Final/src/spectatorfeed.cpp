@@ -0,0 +1,158 @@
+#include "../include/spectatorfeed.h"
+#include "../include/gameprotocol.h"
+
+SpectatorFeed::SpectatorFeed(quint32 session, QObject *parent)
+    : QObject(parent),
+      m_session(session),
+      m_logic(nullptr),
+      m_published(0),
+      m_result(GameLogic::GameResult::InProgress)
+{
+}
+
+void SpectatorFeed::follow(GameLogic *logic) {
+    if (m_logic) {
+        m_logic->disconnect(this);
+    }
+    m_logic = logic;
+    m_published = 0;
+    reset();
+    syncWithLogic();
+    connect(logic, &GameLogic::boardChanged, this, &SpectatorFeed::syncWithLogic);
+    connect(logic, &GameLogic::gameOver, this, &SpectatorFeed::finish);
+    connect(logic, &QObject::destroyed, this, [this]() { m_logic = nullptr; });
+}
+
+void SpectatorFeed::syncWithLogic() {
+    if (!m_logic) {
+        return;
+    }
+    // Implicitly shared, so this copies nothing
+    const QVector<GameMove> history = m_logic->getMoveHistory();
+    if (history.size() < m_published) {
+        // A new game
+        m_published = 0;
+        reset();
+    }
+    for (; m_published < history.size(); ++m_published) {
+        publish(history.at(m_published));
+    }
+}
+
+void SpectatorFeed::subscribe(Spectator *spectator) {
+    if (m_index.contains(spectator)) {
+        return;
+    }
+    m_index.insert(spectator, m_subscribers.size());
+    m_subscribers.append({spectator, false});
+    m_metrics.spectators++;
+    sendBoard(m_subscribers.last());
+}
+
+void SpectatorFeed::unsubscribe(Spectator *spectator) {
+    const auto it = m_index.find(spectator);
+    if (it == m_index.end()) {
+        return;
+    }
+    // Swap with the last so removal stays O(1)
+    const int index = it.value();
+    m_index.erase(it);
+    if (m_subscribers.at(index).behind) {
+        m_metrics.behind--;
+    }
+    const Subscriber last = m_subscribers.takeLast();
+    if (index < m_subscribers.size()) {
+        m_subscribers[index] = last;
+        m_index.insert(last.spectator, index);
+    }
+    m_metrics.spectators--;
+}
+
+void SpectatorFeed::resume(Spectator *spectator) {
+    const auto it = m_index.constFind(spectator);
+    if (it == m_index.constEnd() || !m_subscribers.at(it.value()).behind) {
+        return;
+    }
+    Subscriber &subscriber = m_subscribers[it.value()];
+    subscriber.behind = false;
+    m_metrics.behind--;
+    sendBoard(subscriber);
+}
+
+bool SpectatorFeed::isBehind(Spectator *spectator) const {
+    const auto it = m_index.constFind(spectator);
+    return it != m_index.constEnd() && m_subscribers.at(it.value()).behind;
+}
+
+void SpectatorFeed::publish(const GameMove &move) {
+    const quint16 bit = quint16(1u << move.cellIndex);
+    if (move.player == 1) {
+        m_board.x |= bit;
+    } else {
+        m_board.o |= bit;
+    }
+    m_boardFrame.clear();
+
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::Moved, m_session,
+                         quint8(move.cellIndex | move.player << 4));
+    broadcast(frame);
+}
+
+void SpectatorFeed::finish(GameLogic::GameResult result) {
+    // The move that ended the game goes out first
+    syncWithLogic();
+    m_result = result;
+    m_boardFrame.clear();
+
+    QByteArray frame;
+    GameProtocol::append(frame, GameProtocol::FrameType::GameOver, m_session, quint8(result));
+    broadcast(frame);
+}
+
+void SpectatorFeed::reset(const BoardSnapshot &board) {
+    m_board = board;
+    m_result = GameLogic::GameResult::InProgress;
+    m_boardFrame.clear();
+    if (!m_subscribers.isEmpty()) {
+        const qint64 delivered = m_metrics.framesDelivered;
+        broadcast(boardFrame());
+        m_metrics.boardsSent += m_metrics.framesDelivered - delivered;
+    }
+}
+
+void SpectatorFeed::broadcast(const QByteArray &frame) {
+    m_metrics.framesPublished++;
+    for (Subscriber &subscriber : m_subscribers) {
+        if (subscriber.behind) {
+            m_metrics.framesCoalesced++;
+        } else if (subscriber.spectator->deliver(frame)) {
+            m_metrics.framesDelivered++;
+        } else {
+            subscriber.behind = true;
+            m_metrics.behind++;
+        }
+    }
+}
+
+bool SpectatorFeed::sendBoard(Subscriber &subscriber) {
+    if (!subscriber.spectator->deliver(boardFrame())) {
+        subscriber.behind = true;
+        m_metrics.behind++;
+        return false;
+    }
+    m_metrics.framesDelivered++;
+    m_metrics.boardsSent++;
+    return true;
+}
+
+const QByteArray &SpectatorFeed::boardFrame() {
+    if (m_boardFrame.isEmpty()) {
+        GameProtocol::append(m_boardFrame, GameProtocol::FrameType::Board, m_session, 0,
+                             GameProtocol::encodeBoard(m_board.x, m_board.o));
+        if (m_result != GameLogic::GameResult::InProgress) {
+            GameProtocol::append(m_boardFrame, GameProtocol::FrameType::GameOver, m_session, quint8(m_result));
+        }
+    }
+    return m_boardFrame;
+}
@@ -0,0 +1,370 @@
+#include "../include/sqlitestore.h"
+#include "../include/movecodec.h"
+#include <QSqlError>
+#include <QVariant>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QDebug>
+#include <QtAlgorithms>
+
+SqliteStore::SqliteStore(const QString &path)
+    : m_path(path),
+      m_connectionName(QString("tictactoe_%1").arg(reinterpret_cast<quintptr>(this)))
+{
+}
+
+SqliteStore::~SqliteStore() {
+    // Queries and the handle must be gone before the connection is removed
+    qDeleteAll(m_statements);
+    m_statements.clear();
+    if (m_db.isValid()) {
+        m_db.close();
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+bool SqliteStore::open() {
+    if (m_db.isOpen()) {
+        return true;
+    }
+
+    m_db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    m_db.setDatabaseName(m_path);
+    if (!m_db.open()) {
+        qDebug() << "Failed to open SQLite database:" << m_path << m_db.lastError().text();
+        return false;
+    }
+
+    // WAL lets readers carry on while a write is in progress
+    exec("PRAGMA journal_mode=WAL");
+    exec("PRAGMA synchronous=NORMAL");
+    exec("PRAGMA foreign_keys=ON");
+
+    return exec("CREATE TABLE IF NOT EXISTS users ("
+                "id INTEGER PRIMARY KEY, "
+                "username TEXT NOT NULL UNIQUE, "
+                "password_hash TEXT NOT NULL, "
+                "total_games INTEGER NOT NULL DEFAULT 0, "
+                "wins INTEGER NOT NULL DEFAULT 0, "
+                "losses INTEGER NOT NULL DEFAULT 0, "
+                "draws INTEGER NOT NULL DEFAULT 0, "
+                "vs_ai INTEGER NOT NULL DEFAULT 0, "
+                "vs_players INTEGER NOT NULL DEFAULT 0, "
+                "win_rate INTEGER NOT NULL DEFAULT 0, "
+                "best_streak INTEGER NOT NULL DEFAULT 0, "
+                "score INTEGER NOT NULL DEFAULT 0, "
+                "current_streak INTEGER NOT NULL DEFAULT 0, "
+                "recent TEXT NOT NULL DEFAULT '')")
+        && addMissingColumns()
+        && exec("CREATE TABLE IF NOT EXISTS games ("
+                "id INTEGER PRIMARY KEY, "
+                "user_id INTEGER NOT NULL REFERENCES users(id) ON DELETE CASCADE, "
+                "played_at TEXT NOT NULL, "
+                "outcome TEXT NOT NULL, "
+                "opponent TEXT NOT NULL, "
+                "difficulty TEXT NOT NULL DEFAULT '')")
+        && exec("CREATE TABLE IF NOT EXISTS moves ("
+                "game_id INTEGER NOT NULL REFERENCES games(id) ON DELETE CASCADE, "
+                "ply INTEGER NOT NULL, "
+                "cell INTEGER NOT NULL, "
+                "player INTEGER NOT NULL, "
+                "PRIMARY KEY (game_id, ply)) WITHOUT ROWID")
+        && exec("CREATE INDEX IF NOT EXISTS idx_games_user_date ON games(user_id, played_at)")
+        && exec("CREATE INDEX IF NOT EXISTS idx_games_opponent ON games(opponent)")
+        && exec("CREATE INDEX IF NOT EXISTS idx_users_score ON users(score DESC) WHERE total_games > 0");
+}
+
+bool SqliteStore::addMissingColumns() {
+    // Databases created by older builds lack the columns added since
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA table_info(users)")) {
+        qDebug() << "Failed to read SQLite schema:" << query.lastError().text();
+        return false;
+    }
+    QStringList columns;
+    while (query.next()) {
+        columns.append(query.value(1).toString());
+    }
+    if (!columns.contains("current_streak")
+        && !exec("ALTER TABLE users ADD COLUMN current_streak INTEGER NOT NULL DEFAULT 0")) {
+        return false;
+    }
+    if (!columns.contains("recent")
+        && !exec("ALTER TABLE users ADD COLUMN recent TEXT NOT NULL DEFAULT ''")) {
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStore::exec(const QString &sql) {
+    QSqlQuery query(m_db);
+    if (!query.exec(sql)) {
+        qDebug() << "SQLite statement failed:" << sql << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QSqlQuery &SqliteStore::prepared(const QString &sql) {
+    QSqlQuery *query = m_statements.value(sql, nullptr);
+    if (!query) {
+        query = new QSqlQuery(m_db);
+        if (!query->prepare(sql)) {
+            qDebug() << "Failed to prepare SQLite statement:" << sql << query->lastError().text();
+        }
+        m_statements.insert(sql, query);
+    }
+    return *query;
+}
+
+bool SqliteStore::saveUsers(const QVector<User*> &users, bool replaceAll) {
+    if (!open()) {
+        return false;
+    }
+
+    // One transaction per batch, otherwise every insert is its own fsync
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start SQLite transaction:" << m_db.lastError().text();
+        return false;
+    }
+
+    // Users are upserted rather than deleted and reinserted, so the games of
+    // histories that were never paged in stay where they are
+    bool ok = !replaceAll || (exec("CREATE TEMP TABLE IF NOT EXISTS kept_users (username TEXT PRIMARY KEY)")
+                              && exec("DELETE FROM kept_users"));
+    for (int i = 0; ok && i < users.size(); ++i) {
+        ok = saveUser(*users.at(i));
+        if (ok && replaceAll) {
+            QSqlQuery &keep = prepared("INSERT OR IGNORE INTO kept_users (username) VALUES (?)");
+            keep.addBindValue(users.at(i)->getUsername());
+            ok = keep.exec();
+        }
+    }
+    ok = ok && (!replaceAll || exec("DELETE FROM users WHERE username NOT IN (SELECT username FROM kept_users)"));
+
+    if (!ok) {
+        m_db.rollback();
+        return false;
+    }
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit SQLite transaction:" << m_db.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool SqliteStore::saveUser(const User &user) {
+    QSqlQuery &upsert = prepared(
+        "INSERT INTO users (username, password_hash, total_games, wins, losses, draws, "
+        "vs_ai, vs_players, win_rate, best_streak, score, current_streak, recent) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT(username) DO UPDATE SET "
+        "password_hash = excluded.password_hash, total_games = excluded.total_games, "
+        "wins = excluded.wins, losses = excluded.losses, draws = excluded.draws, "
+        "vs_ai = excluded.vs_ai, vs_players = excluded.vs_players, "
+        "win_rate = excluded.win_rate, best_streak = excluded.best_streak, score = excluded.score, "
+        "current_streak = excluded.current_streak, recent = excluded.recent");
+    upsert.addBindValue(user.getUsername());
+    upsert.addBindValue(user.getHashedPassword());
+    upsert.addBindValue(user.getTotalGames());
+    upsert.addBindValue(user.getWins());
+    upsert.addBindValue(user.getLosses());
+    upsert.addBindValue(user.getDraws());
+    upsert.addBindValue(user.getVsAI());
+    upsert.addBindValue(user.getVsPlayers());
+    upsert.addBindValue(user.getWinRate());
+    upsert.addBindValue(user.getBestStreak());
+    upsert.addBindValue(Database::calculatePlayerScore(user.getWins(), user.getTotalGames(),
+                                                       user.getWinRate(), user.getBestStreak()));
+    upsert.addBindValue(user.getCurrentStreak());
+    upsert.addBindValue(QString::fromUtf8(QJsonDocument(user.rollingStats().toJson()).toJson(QJsonDocument::Compact)));
+    if (!upsert.exec()) {
+        qDebug() << "Failed to save user" << user.getUsername() << upsert.lastError().text();
+        return false;
+    }
+
+    // A history that was never paged in is still in this database file
+    const SqliteStore *source = dynamic_cast<const SqliteStore*>(user.historyStore());
+    if (source && source->m_path == m_path) {
+        return true;
+    }
+
+    QSqlQuery &findId = prepared("SELECT id FROM users WHERE username = ?");
+    findId.addBindValue(user.getUsername());
+    if (!findId.exec() || !findId.next()) {
+        qDebug() << "Failed to look up user" << user.getUsername() << findId.lastError().text();
+        return false;
+    }
+    const qint64 userId = findId.value(0).toLongLong();
+    findId.finish();
+
+    // The stored history mirrors the user's, the moves go with their games
+    QSqlQuery &clearGames = prepared("DELETE FROM games WHERE user_id = ?");
+    clearGames.addBindValue(userId);
+    if (!clearGames.exec()) {
+        qDebug() << "Failed to clear games of" << user.getUsername() << clearGames.lastError().text();
+        return false;
+    }
+
+    QSqlQuery &insertGame = prepared(
+        "INSERT INTO games (user_id, played_at, outcome, opponent, difficulty) VALUES (?, ?, ?, ?, ?)");
+    QSqlQuery &insertMove = prepared("INSERT INTO moves (game_id, ply, cell, player) VALUES (?, ?, ?, ?)");
+
+    // Oldest first, so game ids follow play order
+    const QVector<GameRecord> history = user.getGameHistory();
+    for (int i = history.size() - 1; i >= 0; --i) {
+        const GameRecord &record = history.at(i);
+        insertGame.addBindValue(userId);
+        insertGame.addBindValue(record.date());
+        insertGame.addBindValue(record.outcomeName());
+        insertGame.addBindValue(record.opponent());
+        insertGame.addBindValue(record.difficultyName());
+        if (!insertGame.exec()) {
+            qDebug() << "Failed to save game of" << user.getUsername() << insertGame.lastError().text();
+            return false;
+        }
+        const qint64 gameId = insertGame.lastInsertId().toLongLong();
+
+        const QVector<GameMoveRecord> moves = record.decodeMoves();
+        for (int ply = 0; ply < moves.size(); ++ply) {
+            insertMove.addBindValue(gameId);
+            insertMove.addBindValue(ply);
+            insertMove.addBindValue(moves.at(ply).cellIndex);
+            insertMove.addBindValue(moves.at(ply).player);
+            if (!insertMove.exec()) {
+                qDebug() << "Failed to save moves of" << user.getUsername() << insertMove.lastError().text();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+QVector<User*> SqliteStore::loadUsers() {
+    QVector<User*> users;
+    if (!open()) {
+        return users;
+    }
+
+    // Only the counters are read here, games stay in their table
+    QSqlQuery userQuery(m_db);
+    userQuery.setForwardOnly(true);
+    if (!userQuery.exec("SELECT id, username, password_hash, total_games, wins, losses, draws, "
+                        "vs_ai, vs_players, best_streak, current_streak, recent FROM users ORDER BY id")) {
+        qDebug() << "Failed to load users:" << userQuery.lastError().text();
+        return users;
+    }
+
+    const QSharedPointer<HistoryStore> self = sharedFromThis();
+    while (userQuery.next()) {
+        User* user = new User(userQuery.value(1).toString(), userQuery.value(2).toString());
+        user->restoreStats(userQuery.value(3).toInt(), userQuery.value(4).toInt(), userQuery.value(5).toInt(),
+                           userQuery.value(6).toInt(), userQuery.value(7).toInt(), userQuery.value(8).toInt(),
+                           userQuery.value(9).toInt(), userQuery.value(10).toInt());
+        const QByteArray recent = userQuery.value(11).toString().toUtf8();
+        if (!recent.isEmpty()) {
+            user->restoreRollingStats(RollingStats::fromJson(QJsonDocument::fromJson(recent).object()));
+        } else if (user->getTotalGames() > 0) {
+            // Rows saved before the windows were stored get them from the games once
+            user->restoreRollingStats(Database::rollingStatsFromHistory(
+                fetch(user->getUsername(), userQuery.value(0).toLongLong())));
+        }
+        if (user->getTotalGames() > 0) {
+            const qint64 userId = userQuery.value(0).toLongLong();
+            if (self) {
+                user->setHistorySource(self, userId);
+            } else {
+                user->restoreHistory(fetch(user->getUsername(), userId));
+            }
+        }
+        user->clearDirty();
+        users.append(user);
+    }
+    return users;
+}
+
+QVector<GameRecord> SqliteStore::fetch(const QString &username, qint64 key) {
+    if (!open()) {
+        return QVector<GameRecord>();
+    }
+
+    QSqlQuery &query = prepared("SELECT g.id, g.played_at, g.outcome, g.opponent, g.difficulty, m.cell, m.player "
+                                "FROM games g LEFT JOIN moves m ON m.game_id = g.id "
+                                "WHERE g.user_id = ? ORDER BY g.id, m.ply");
+    query.addBindValue(key);
+    if (!query.exec()) {
+        qDebug() << "Failed to load games of" << username << query.lastError().text();
+        return QVector<GameRecord>();
+    }
+
+    // Replayed in play order, which also rebuilds the history's result strings
+    User replay(username, QString());
+    qint64 currentGame = -1;
+    QString date, outcome, opponent, difficulty;
+    QVector<GameMoveRecord> moves;
+    auto finishGame = [&]() {
+        if (currentGame != -1) {
+            replay.addGameWithDate(outcome, opponent, date, difficulty, MoveCodec::pack(moves));
+        }
+        moves.clear();
+    };
+
+    while (query.next()) {
+        const qint64 gameId = query.value(0).toLongLong();
+        if (gameId != currentGame) {
+            finishGame();
+            currentGame = gameId;
+            date = query.value(1).toString();
+            outcome = query.value(2).toString();
+            opponent = query.value(3).toString();
+            difficulty = query.value(4).toString();
+        }
+        if (!query.isNull(5)) {
+            moves.append({query.value(5).toInt(), query.value(6).toInt()});
+        }
+    }
+    finishGame();
+    query.finish();
+    return replay.getGameHistory();
+}
+
+bool SqliteStore::isEmpty() {
+    if (!open()) {
+        return true;
+    }
+    QSqlQuery &query = prepared("SELECT 1 FROM users LIMIT 1");
+    const bool empty = !query.exec() || !query.next();
+    query.finish();
+    return empty;
+}
+
+QVector<LeaderboardEntry> SqliteStore::topPlayers(int limit) {
+    QVector<LeaderboardEntry> leaderboard;
+    if (!open()) {
+        return leaderboard;
+    }
+
+    QSqlQuery &query = prepared("SELECT username, wins, total_games, win_rate, best_streak, score "
+                                "FROM users WHERE total_games > 0 ORDER BY score DESC LIMIT ?");
+    query.addBindValue(limit);
+    if (!query.exec()) {
+        qDebug() << "Failed to query leaderboard:" << query.lastError().text();
+        return leaderboard;
+    }
+
+    leaderboard.reserve(limit);
+    while (query.next()) {
+        LeaderboardEntry entry;
+        entry.setUsername(query.value(0).toString());
+        entry.wins = query.value(1).toInt();
+        entry.totalGames = query.value(2).toInt();
+        entry.winRate = query.value(3).toInt();
+        entry.bestStreak = query.value(4).toInt();
+        entry.score = query.value(5).toInt();
+        leaderboard.append(entry);
+    }
+    query.finish();
+    return leaderboard;
+}
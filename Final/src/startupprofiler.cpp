@@ -0,0 +1,75 @@
+#include "../include/startupprofiler.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QMutex>
+#include <QWidget>
+
+struct StartupState {
+    StartupState() { clock.start(); }
+
+    QMutex mutex;
+    QElapsedTimer clock;
+    QVector<QPair<QString, qint64>> phases;
+    qint64 firstFrame = -1;
+};
+
+// Constructed with the other statics, which is as close to process start as
+// the program gets without asking the OS
+static StartupState s_state;
+
+// Marks the first paint of the window it is installed on, then goes away
+class FirstFrameWatcher : public QObject {
+public:
+    using QObject::QObject;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override {
+        if (event->type() == QEvent::Paint) {
+            watched->removeEventFilter(this);
+            deleteLater();
+
+            StartupProfiler::mark("first frame");
+            {
+                QMutexLocker locker(&s_state.mutex);
+                s_state.firstFrame = s_state.phases.last().second;
+            }
+            qDebug() << "Startup phases (ms since process start):";
+            for (const auto &phase : StartupProfiler::phases()) {
+                qDebug().noquote() << QString("  %1 %2").arg(phase.first, -24).arg(phase.second, 6);
+            }
+        }
+        return QObject::eventFilter(watched, event);
+    }
+};
+
+void StartupProfiler::mark(const QString &phase) {
+    QMutexLocker locker(&s_state.mutex);
+    s_state.phases.append(qMakePair(phase, s_state.clock.elapsed()));
+}
+
+qint64 StartupProfiler::elapsed() {
+    QMutexLocker locker(&s_state.mutex);
+    return s_state.clock.elapsed();
+}
+
+QVector<QPair<QString, qint64>> StartupProfiler::phases() {
+    QMutexLocker locker(&s_state.mutex);
+    return s_state.phases;
+}
+
+qint64 StartupProfiler::firstFrame() {
+    QMutexLocker locker(&s_state.mutex);
+    return s_state.firstFrame;
+}
+
+void StartupProfiler::watchFirstFrame(QWidget *window) {
+    window->installEventFilter(new FirstFrameWatcher(window));
+}
+
+void StartupProfiler::restart() {
+    QMutexLocker locker(&s_state.mutex);
+    s_state.clock.restart();
+    s_state.phases.clear();
+    s_state.firstFrame = -1;
+}
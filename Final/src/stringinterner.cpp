@@ -0,0 +1,123 @@
+#include "../include/stringinterner.h"
+#include <QDate>
+#include <QTime>
+#include <algorithm>
+
+static constexpr qint64 kSecondsPerDay = 24 * 60 * 60;
+
+StringInterner::StringInterner()
+    : m_blockUsed(BLOCK_CHARS)
+{
+    m_entries.append(Entry{nullptr, 0});
+}
+
+StringInterner::~StringInterner() {
+    for (QChar *block : m_blocks) {
+        delete[] block;
+    }
+}
+
+StringInterner &StringInterner::instance() {
+    static StringInterner interner;
+    return interner;
+}
+
+const QChar *StringInterner::store(const QString &string) {
+    const int length = string.size();
+    if (length > BLOCK_CHARS) {
+        // Too long to share a block, gets one of its own
+        QChar *block = new QChar[length];
+        std::copy(string.constData(), string.constData() + length, block);
+        // Kept in front so the last block stays the one being filled
+        m_blocks.prepend(block);
+        return block;
+    }
+    if (BLOCK_CHARS - m_blockUsed < length) {
+        m_blocks.append(new QChar[BLOCK_CHARS]);
+        m_blockUsed = 0;
+    }
+    QChar *data = m_blocks.last() + m_blockUsed;
+    std::copy(string.constData(), string.constData() + length, data);
+    m_blockUsed += length;
+    return data;
+}
+
+quint32 StringInterner::intern(const QString &string) {
+    if (string.isEmpty()) {
+        return 0;
+    }
+
+    StringInterner &interner = instance();
+    {
+        QReadLocker locker(&interner.m_lock);
+        const auto it = interner.m_ids.constFind(string);
+        if (it != interner.m_ids.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&interner.m_lock);
+    // Another thread may have added it between the two locks
+    const auto it = interner.m_ids.constFind(string);
+    if (it != interner.m_ids.constEnd()) {
+        return it.value();
+    }
+    const QChar *data = interner.store(string);
+    const quint32 id = quint32(interner.m_entries.size());
+    interner.m_entries.append(Entry{data, string.size()});
+    interner.m_ids.insert(QString::fromRawData(data, string.size()), id);
+    return id;
+}
+
+QString StringInterner::string(quint32 id) {
+    StringInterner &interner = instance();
+    QReadLocker locker(&interner.m_lock);
+    if (id == 0 || id >= quint32(interner.m_entries.size())) {
+        return QString();
+    }
+    const Entry entry = interner.m_entries.at(int(id));
+    return QString::fromRawData(entry.data, entry.length);
+}
+
+qint64 StringInterner::internDate(const QString &date) {
+    // Julian day and time of day, counted in seconds; only used when the
+    // string comes back out exactly as it went in
+    if (date.size() == 19 && date.at(10) == QLatin1Char(' ')) {
+        const QDate day = QDate::fromString(date.left(10), "yyyy-MM-dd");
+        const QTime time = QTime::fromString(date.mid(11), "hh:mm:ss");
+        if (day.isValid() && time.isValid() && day.toJulianDay() >= 0) {
+            const qint64 key = day.toJulianDay() * kSecondsPerDay + time.msecsSinceStartOfDay() / 1000;
+            if (dateString(key) == date) {
+                return key;
+            }
+        }
+    }
+    // Anything else is kept verbatim, as a negative key
+    return -qint64(intern(date)) - 1;
+}
+
+QString StringInterner::dateString(qint64 key) {
+    if (key < 0) {
+        return string(quint32(-(key + 1)));
+    }
+    const QDate day = QDate::fromJulianDay(key / kSecondsPerDay);
+    const QTime time = QTime(0, 0).addSecs(int(key % kSecondsPerDay));
+    return day.toString("yyyy-MM-dd") + QLatin1Char(' ') + time.toString("hh:mm:ss");
+}
+
+int StringInterner::count() {
+    StringInterner &interner = instance();
+    QReadLocker locker(&interner.m_lock);
+    return interner.m_entries.size();
+}
+
+qint64 StringInterner::memoryUsage() {
+    StringInterner &interner = instance();
+    QReadLocker locker(&interner.m_lock);
+    // Roughly: oversized strings count as one block each
+    qint64 bytes = qint64(interner.m_blocks.size()) * BLOCK_CHARS * qint64(sizeof(QChar));
+    bytes += qint64(interner.m_entries.capacity()) * qint64(sizeof(Entry));
+    // A node, a key and a bucket per entry
+    bytes += qint64(interner.m_ids.size()) * qint64(sizeof(void*) * 2 + sizeof(QString) + sizeof(quint32));
+    return bytes;
+}
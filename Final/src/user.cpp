@@ -1,18 +1,94 @@
 //this is user driver
 #include "../include/user.h"
 #include "../include/authentication.h"
+#include "../include/movecodec.h"
+#include "../include/historystore.h"
+#include "../include/userstore.h"
+#include "../include/stringinterner.h"
 #include <QDateTime>
 
+// GameRecord::difficulty indexes this; 0 is a two-player game
+static const char *const kDifficulties[] = {"", "easy", "medium", "hard", "expert"};
+static constexpr int kDifficultyCount = sizeof(kDifficulties) / sizeof(kDifficulties[0]);
+static constexpr quint8 kMediumDifficulty = 2;
+
+QString GameRecord::date() const {
+    return StringInterner::dateString(dateKey);
+}
+
+void GameRecord::setDate(const QString &date) {
+    dateKey = StringInterner::internDate(date);
+}
+
+QString GameRecord::outcomeName() const {
+    return outcome == Outcome::Win ? "win" : outcome == Outcome::Loss ? "loss" : "draw";
+}
+
+QString GameRecord::opponent() const {
+    return isVsAI() ? QString("ai") : StringInterner::string(opponentId);
+}
+
+QString GameRecord::difficultyName() const {
+    if (difficulty == 0 || difficulty >= kDifficultyCount) {
+        return QString();
+    }
+    return QLatin1String(kDifficulties[difficulty]);
+}
+
+bool GameRecord::isVsAI() const {
+    return difficulty != 0;
+}
+
+void GameRecord::setResult(const QString &outcomeText, const QString &opponent, const QString &difficultyText) {
+    outcome = outcomeText == "win" ? Outcome::Win : outcomeText == "loss" ? Outcome::Loss : Outcome::Draw;
+    if (opponent == "ai") {
+        // Every game against the AI has a difficulty; medium when none was given
+        difficulty = kMediumDifficulty;
+        for (int i = 1; i < kDifficultyCount; ++i) {
+            if (difficultyText == QLatin1String(kDifficulties[i])) {
+                difficulty = quint8(i);
+            }
+        }
+        opponentId = 0;
+    } else {
+        difficulty = 0;
+        opponentId = StringInterner::intern(opponent);
+    }
+}
+
+QString GameRecord::result() const {
+    const QString outcomeText = outcome == Outcome::Win ? "Win" : outcome == Outcome::Loss ? "Loss" : "Draw";
+    if (isVsAI()) {
+        return QString("%1 vs AI (%2)").arg(outcomeText, difficultyName());
+    }
+    return QString("%1 vs %2").arg(outcomeText, StringInterner::string(opponentId));
+}
+
+void GameRecord::setResult(const QString &result) {
+    const QString outcomeText = result.startsWith("Win") ? "win" : result.startsWith("Loss") ? "loss" : "draw";
+    const int vs = result.indexOf("vs ");
+    const QString opponent = vs < 0 ? QString() : result.mid(vs + 3);
+    if (opponent == "AI" || opponent.startsWith("AI (")) {
+        setResult(outcomeText, "ai", opponent.mid(4).chopped(opponent.endsWith(')') ? 1 : 0));
+    } else {
+        setResult(outcomeText, opponent, QString());
+    }
+}
+
+QVector<GameMoveRecord> GameRecord::decodeMoves() const {
+    return MoveCodec::unpack(packedMoves);
+}
+
 User::User()
     : m_totalGames(0), m_wins(0), m_losses(0), m_draws(0),
-    m_vsAI(0), m_vsPlayers(0), m_winRate(0), m_bestStreak(0), m_currentStreak(0)
+    m_vsAI(0), m_vsPlayers(0), m_winRate(0), m_bestStreak(0), m_currentStreak(0), m_historyKey(-1), m_dirty(true)
 {
 }
 
 User::User(const QString &username, const QString &hashedPassword)
     : m_username(username), m_hashedPassword(hashedPassword),
     m_totalGames(0), m_wins(0), m_losses(0), m_draws(0),
-    m_vsAI(0), m_vsPlayers(0), m_winRate(0), m_bestStreak(0), m_currentStreak(0)
+    m_vsAI(0), m_vsPlayers(0), m_winRate(0), m_bestStreak(0), m_currentStreak(0), m_historyKey(-1), m_dirty(true)
 {
 }
 
@@ -60,102 +136,116 @@ int User::getBestStreak() const {
     return m_bestStreak;
 }
 
+int User::getCurrentStreak() const {
+    return m_currentStreak;
+}
+
+WindowStats User::getRecentGames(int count) const {
+    return m_rollingStats.lastGames(count);
+}
+
+WindowStats User::getRecentDays(int days, const QDate &today) const {
+    return m_rollingStats.lastDays(days, today.toJulianDay());
+}
+
+const RollingStats &User::rollingStats() const {
+    return m_rollingStats;
+}
+
 QVector<GameRecord> User::getGameHistory() const {
+    if (m_historyStore) {
+        return m_historyStore->history(m_username, m_historyKey);
+    }
     return m_gameHistory;
 }
 
-void User::addGame(const QString &result, const QString &opponent, const QString &difficulty) {
-    m_totalGames++;
-    if (result == "win") {
-        m_wins++;
-        m_currentStreak++;
-        if (m_currentStreak > m_bestStreak) {
-            m_bestStreak = m_currentStreak;
-        }
-    } else if (result == "loss") {
-        m_losses++;
-        m_currentStreak = 0;
-    } else if (result == "draw") {
-        m_draws++;
-        m_currentStreak = 0;
-    }
+bool User::isHistoryLoaded() const {
+    return !m_historyStore;
+}
 
-    if (opponent == "ai") {
-        m_vsAI++;
-    } else {
-        m_vsPlayers++;
-    }
+HistoryStore* User::historyStore() const {
+    return m_historyStore.data();
+}
 
-    if (m_totalGames > 0) {
-        m_winRate = static_cast<int>((static_cast<double>(m_wins) / m_totalGames) * 100);
-    }
+qint64 User::historyKey() const {
+    return m_historyKey;
+}
 
-    GameRecord record;
-    record.date = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    if (opponent == "ai") {
-        record.result = QString("%1 vs AI (%2)")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(difficulty);
-    } else {
-        record.result = QString("%1 vs %2")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(opponent);
-    }
+bool User::isDirty() const {
+    return m_dirty;
+}
 
-    m_gameHistory.prepend(record);
-    // Keep only the last 20 games
-    while (m_gameHistory.size() > 20) {
-        m_gameHistory.removeLast();
-    }
+void User::clearDirty() {
+    m_dirty = false;
 }
 
-void User::addGameWithDate(const QString &result, const QString &opponent, const QString &date, const QString &difficulty) {
-    m_totalGames++;
-    if (result == "win") {
-        m_wins++;
-        m_currentStreak++;
-        if (m_currentStreak > m_bestStreak) {
-            m_bestStreak = m_currentStreak;
-        }
-    } else if (result == "loss") {
-        m_losses++;
-        m_currentStreak = 0;
-    } else if (result == "draw") {
-        m_draws++;
-        m_currentStreak = 0;
-    }
+void User::restoreStats(int totalGames, int wins, int losses, int draws, int vsAI, int vsPlayers,
+                        int bestStreak, int currentStreak) {
+    m_totalGames = totalGames;
+    m_wins = wins;
+    m_losses = losses;
+    m_draws = draws;
+    m_vsAI = vsAI;
+    m_vsPlayers = vsPlayers;
+    m_bestStreak = bestStreak;
+    m_currentStreak = currentStreak;
+    m_winRate = m_totalGames > 0 ? static_cast<int>((static_cast<double>(m_wins) / m_totalGames) * 100) : 0;
+    syncStore();
+}
 
-    if (opponent == "ai") {
-        m_vsAI++;
-    } else {
-        m_vsPlayers++;
-    }
+void User::restoreHistory(const QVector<GameRecord> &history) {
+    m_gameHistory = history;
+    m_historyStore.reset();
+    m_historyKey = -1;
+}
 
-    if (m_totalGames > 0) {
-        m_winRate = static_cast<int>((static_cast<double>(m_wins) / m_totalGames) * 100);
-    }
+void User::restoreRollingStats(const RollingStats &stats) {
+    m_rollingStats = stats;
+}
 
-    GameRecord record;
-    record.date = date; // Use the provided date
-    if (opponent == "ai") {
-        record.result = QString("%1 vs AI (%2)")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(difficulty);
-    } else {
-        record.result = QString("%1 vs %2")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(opponent);
-    }
+void User::setHistorySource(const QSharedPointer<HistoryStore> &store, qint64 key) {
+    m_gameHistory.clear();
+    m_historyStore = store;
+    m_historyKey = key;
+}
 
-    m_gameHistory.prepend(record);
-    // Keep only the last 20 games
-    while (m_gameHistory.size() > 20) {
-        m_gameHistory.removeLast();
+void User::linkStore(UserStore *store, int row) {
+    m_storeLink.store = store;
+    m_storeLink.row = row;
+}
+
+void User::syncStore() {
+    if (m_storeLink.store) {
+        m_storeLink.store->update(m_storeLink.row, *this);
     }
 }
 
+void User::addGame(const QString &result, const QString &opponent, const QString &difficulty) {
+    recordGame(result, opponent, difficulty,
+               QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"),
+               0);
+}
+
+void User::addGameWithDate(const QString &result, const QString &opponent, const QString &date,
+                           const QString &difficulty, quint64 packedMoves) {
+    recordGame(result, opponent, difficulty, date, packedMoves);
+}
+
 // Implementation of the new method to add a game with move history
 void User::addGameWithMoves(const QString &result, const QString &opponent, const QVector<GameMoveRecord> &moves, const QString &difficulty) {
+    recordGame(result, opponent, difficulty,
+               QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"),
+               MoveCodec::pack(moves));
+}
+
+void User::recordGame(const QString &result, const QString &opponent, const QString &difficulty,
+                      const QString &date, quint64 packedMoves) {
+    // A user who plays again is active, so their history stays in memory
+    if (m_historyStore) {
+        restoreHistory(getGameHistory());
+    }
+    
+    m_dirty = true;
     m_totalGames++;
     if (result == "win") {
         m_wins++;
@@ -181,19 +271,17 @@ void User::addGameWithMoves(const QString &result, const QString &opponent, cons
         m_winRate = static_cast<int>((static_cast<double>(m_wins) / m_totalGames) * 100);
     }
 
-    GameRecord record;
-    record.date = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-    record.moves = moves; // Store the move history
-    
-    if (opponent == "ai") {
-        record.result = QString("%1 vs AI (%2)")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(difficulty);
-    } else {
-        record.result = QString("%1 vs %2")
-        .arg(result == "win" ? "Win" : (result == "loss" ? "Loss" : "Draw"))
-            .arg(opponent);
+    QDate day = QDate::fromString(date.left(10), "yyyy-MM-dd");
+    if (!day.isValid()) {
+        day = QDate::currentDate();
     }
+    m_rollingStats.record(result, day.toJulianDay());
+    syncStore();
+
+    GameRecord record;
+    record.setDate(date);
+    record.packedMoves = packedMoves; // Store the move history
+    record.setResult(result, opponent, difficulty);
 
     m_gameHistory.prepend(record);
     // Keep only the last 20 games
@@ -201,4 +289,3 @@ void User::addGameWithMoves(const QString &result, const QString &opponent, cons
         m_gameHistory.removeLast();
     }
 }
-
@@ -0,0 +1,200 @@
+#include "../include/userstore.h"
+#include "../include/user.h"
+#include "../include/database.h"
+#include <QHash>
+#include <algorithm>
+
+static constexpr int kInitialTableSize = 64;
+
+UserStore::UserStore()
+{
+    m_nameOffsets.append(0);
+    m_table.fill(-1, kInitialTableSize);
+}
+
+uint UserStore::nameHash(const QChar *name, int length) const {
+    return uint(qHashBits(name, size_t(length) * sizeof(QChar)));
+}
+
+bool UserStore::nameEquals(int row, const QChar *name, int length) const {
+    const int begin = m_nameOffsets.at(row);
+    return m_nameOffsets.at(row + 1) - begin == length
+           && std::equal(name, name + length, m_names.constData() + begin);
+}
+
+int UserStore::findSlot(const QChar *name, int length) const {
+    // Linear probing; the table is a power of two and never more than half full
+    const int mask = m_table.size() - 1;
+    int slot = int(nameHash(name, length) & uint(mask));
+    while (m_table.at(slot) >= 0 && !nameEquals(m_table.at(slot), name, length)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void UserStore::growTable() {
+    m_table.fill(-1, m_table.size() * 2);
+    const int mask = m_table.size() - 1;
+    for (int row = 0; row < size(); ++row) {
+        const int begin = m_nameOffsets.at(row);
+        int slot = int(nameHash(m_names.constData() + begin, m_nameOffsets.at(row + 1) - begin) & uint(mask));
+        while (m_table.at(slot) >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_table[slot] = row;
+    }
+}
+
+int UserStore::attach(User *user) {
+    const QString name = user->getUsername();
+    int slot = findSlot(name.constData(), name.size());
+    int row = m_table.at(slot);
+    if (row < 0) {
+        row = size();
+        const int begin = m_names.size();
+        m_names.resize(begin + name.size());
+        std::copy(name.constData(), name.constData() + name.size(), m_names.begin() + begin);
+        m_nameOffsets.append(m_names.size());
+        for (QVector<qint32> *column : {&m_totalGames, &m_wins, &m_losses, &m_draws, &m_vsAI,
+                                        &m_vsPlayers, &m_bestStreak, &m_currentStreak, &m_score}) {
+            column->append(0);
+        }
+        m_table[slot] = row;
+        if (size() * 2 > m_table.size()) {
+            growTable();
+        }
+    }
+
+    update(row, *user);
+    user->linkStore(this, row);
+    return row;
+}
+
+void UserStore::update(int row, const User &user) {
+    m_totalGames[row] = user.getTotalGames();
+    m_wins[row] = user.getWins();
+    m_losses[row] = user.getLosses();
+    m_draws[row] = user.getDraws();
+    m_vsAI[row] = user.getVsAI();
+    m_vsPlayers[row] = user.getVsPlayers();
+    m_bestStreak[row] = user.getBestStreak();
+    m_currentStreak[row] = user.getCurrentStreak();
+    m_score[row] = Database::calculatePlayerScore(user.getWins(), user.getTotalGames(),
+                                                  user.getWinRate(), user.getBestStreak());
+}
+
+int UserStore::indexOf(const QString &username) const {
+    return m_table.at(findSlot(username.constData(), username.size()));
+}
+
+int UserStore::size() const {
+    return m_totalGames.size();
+}
+
+void UserStore::reserve(int users) {
+    for (QVector<qint32> *column : {&m_totalGames, &m_wins, &m_losses, &m_draws, &m_vsAI,
+                                    &m_vsPlayers, &m_bestStreak, &m_currentStreak, &m_score}) {
+        column->reserve(users);
+    }
+    m_nameOffsets.reserve(users + 1);
+    while (users * 2 > m_table.size()) {
+        growTable();
+    }
+}
+
+void UserStore::clear() {
+    for (QVector<qint32> *column : {&m_totalGames, &m_wins, &m_losses, &m_draws, &m_vsAI,
+                                    &m_vsPlayers, &m_bestStreak, &m_currentStreak, &m_score}) {
+        column->clear();
+    }
+    m_names.clear();
+    m_nameOffsets.clear();
+    m_nameOffsets.append(0);
+    m_table.fill(-1, kInitialTableSize);
+}
+
+QString UserStore::username(int row) const {
+    const int begin = m_nameOffsets.at(row);
+    return QString(m_names.constData() + begin, m_nameOffsets.at(row + 1) - begin);
+}
+
+int UserStore::totalGames(int row) const {
+    return m_totalGames.at(row);
+}
+
+int UserStore::wins(int row) const {
+    return m_wins.at(row);
+}
+
+int UserStore::losses(int row) const {
+    return m_losses.at(row);
+}
+
+int UserStore::draws(int row) const {
+    return m_draws.at(row);
+}
+
+int UserStore::winRate(int row) const {
+    // Same rounding as User
+    const int games = m_totalGames.at(row);
+    return games > 0 ? static_cast<int>((static_cast<double>(m_wins.at(row)) / games) * 100) : 0;
+}
+
+int UserStore::bestStreak(int row) const {
+    return m_bestStreak.at(row);
+}
+
+int UserStore::currentStreak(int row) const {
+    return m_currentStreak.at(row);
+}
+
+int UserStore::score(int row) const {
+    return m_score.at(row);
+}
+
+UserTotals UserStore::totals() const {
+    UserTotals totals;
+    for (int row = 0; row < size(); ++row) {
+        totals.players += m_totalGames.at(row) > 0 ? 1 : 0;
+        totals.games += m_totalGames.at(row);
+        totals.wins += m_wins.at(row);
+        totals.losses += m_losses.at(row);
+        totals.draws += m_draws.at(row);
+        totals.vsAI += m_vsAI.at(row);
+        totals.vsPlayers += m_vsPlayers.at(row);
+    }
+    return totals;
+}
+
+QVector<int> UserStore::rankByScore(int limit) const {
+    QVector<int> rows;
+    const qint32 *games = m_totalGames.constData();
+    for (int row = 0; row < size(); ++row) {
+        if (games[row] > 0) {
+            rows.append(row);
+        }
+    }
+
+    // Best score first; equal scores keep the order users were added in
+    const qint32 *scores = m_score.constData();
+    auto better = [scores](int a, int b) {
+        return scores[a] != scores[b] ? scores[a] > scores[b] : a < b;
+    };
+    if (limit >= 0 && limit < rows.size()) {
+        std::partial_sort(rows.begin(), rows.begin() + limit, rows.end(), better);
+        rows.resize(limit);
+    } else {
+        std::sort(rows.begin(), rows.end(), better);
+    }
+    return rows;
+}
+
+qint64 UserStore::memoryUsage() const {
+    qint64 bytes = 0;
+    for (const QVector<qint32> *column : {&m_totalGames, &m_wins, &m_losses, &m_draws, &m_vsAI,
+                                          &m_vsPlayers, &m_bestStreak, &m_currentStreak, &m_score,
+                                          &m_nameOffsets, &m_table}) {
+        bytes += qint64(column->capacity()) * qint64(sizeof(qint32));
+    }
+    return bytes + qint64(m_names.capacity()) * qint64(sizeof(QChar));
+}
@@ -0,0 +1,139 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+// Allocation counting test mode.
+//
+// Include this header from exactly one translation unit of a test executable.
+// It replaces the global operator new/delete (and, on glibc, malloc and
+// friends, which is what Qt containers allocate through) with versions that
+// bump per-thread counters. Tests take an AllocCounter::Scope around the code
+// under test and compare the counts against an allocation budget.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+#endif
+
+namespace AllocCounter {
+
+// Plain thread_local integers need no dynamic initialisation, so touching them
+// from inside malloc is safe
+inline thread_local long long t_allocations = 0;
+inline thread_local long long t_frees = 0;
+
+inline void *rawAlloc(size_t size) {
+#if defined(__GLIBC__)
+    return __libc_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+inline void rawFree(void *ptr) {
+#if defined(__GLIBC__)
+    __libc_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+inline long long allocations() { return t_allocations; }
+inline long long frees() { return t_frees; }
+
+// Counts the allocations made by the current thread while the scope is alive
+class Scope {
+public:
+    Scope() : m_allocStart(t_allocations), m_freeStart(t_frees) {}
+
+    long long allocations() const { return t_allocations - m_allocStart; }
+    long long frees() const { return t_frees - m_freeStart; }
+
+private:
+    long long m_allocStart;
+    long long m_freeStart;
+};
+
+} // namespace AllocCounter
+
+void *operator new(size_t size) {
+    ++AllocCounter::t_allocations;
+    if (void *ptr = AllocCounter::rawAlloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    ++AllocCounter::t_allocations;
+    return AllocCounter::rawAlloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void *ptr) noexcept {
+    if (ptr) {
+        ++AllocCounter::t_frees;
+        AllocCounter::rawFree(ptr);
+    }
+}
+
+void operator delete[](void *ptr) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    ::operator delete(ptr);
+}
+
+#if defined(__GLIBC__)
+// Qt's containers and strings allocate with malloc directly, so on glibc we
+// interpose the C allocator as well to see QVector/QString buffers
+extern "C" {
+
+void *malloc(size_t size) noexcept {
+    ++AllocCounter::t_allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept {
+    ++AllocCounter::t_allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) noexcept {
+    ++AllocCounter::t_allocations;
+    if (ptr) {
+        ++AllocCounter::t_frees;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) noexcept {
+    if (ptr) {
+        ++AllocCounter::t_frees;
+    }
+    __libc_free(ptr);
+}
+
+} // extern "C"
+#endif
+
+#endif // ALLOCCOUNTER_H
@@ -0,0 +1,195 @@
+#include "datasetgenerator.h"
+#include "../include/database.h"
+#include "../include/movecodec.h"
+#include <QDateTime>
+#include <QFile>
+#include <QThreadPool>
+#include <QDebug>
+#include <cmath>
+
+DatasetGenerator::DatasetGenerator(const Options &options)
+    : m_options(options), m_gamesWritten(0)
+{
+}
+
+QString DatasetGenerator::usernameFor(int index) {
+    return QString("genuser%1").arg(index);
+}
+
+qint64 DatasetGenerator::gamesWritten() const {
+    return m_gamesWritten;
+}
+
+bool DatasetGenerator::writeTo(const QString &path) {
+    const int userCount = qMax(0, m_options.userCount);
+    const int threads = qMax(1, m_options.threads);
+
+    // A few ranges per thread keeps the pool busy while the tail drains
+    const int chunkSize = qMax(1000, userCount / (threads * 4) + 1);
+    QVector<QString> partPaths;
+    for (int begin = 0; begin < userCount; begin += chunkSize) {
+        partPaths.append(QString("%1.part%2").arg(path).arg(partPaths.size()));
+    }
+
+    QVector<qint64> partGames(partPaths.size(), 0);
+    QVector<char> partOk(partPaths.size(), 0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int part = 0; part < partPaths.size(); ++part) {
+        const int begin = part * chunkSize;
+        const int end = qMin(userCount, begin + chunkSize);
+        const QString partPath = partPaths[part];
+        const quint32 seed = m_options.seed + static_cast<quint32>(part) * 7919u;
+        qint64 *games = partGames.data() + part;
+        char *ok = partOk.data() + part;
+        pool.start([this, begin, end, partPath, seed, games, ok]() {
+            *ok = writeRange(begin, end, partPath, seed, games) ? 1 : 0;
+        });
+    }
+    pool.waitForDone();
+
+    // Stitch the parts into one JSON array, copying in fixed-size blocks
+    bool success = true;
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open dataset file for writing:" << path;
+        success = false;
+    }
+
+    m_gamesWritten = 0;
+    if (success) {
+        out.write("[\n");
+    }
+    bool firstPart = true;
+    for (int part = 0; part < partPaths.size(); ++part) {
+        QFile in(partPaths[part]);
+        if (success && partOk[part] && in.open(QIODevice::ReadOnly)) {
+            if (in.size() > 0) {
+                if (!firstPart) {
+                    out.write(",\n");
+                }
+                firstPart = false;
+                while (!in.atEnd()) {
+                    if (out.write(in.read(1024 * 1024)) == -1) {
+                        success = false;
+                        break;
+                    }
+                }
+            }
+            in.close();
+            m_gamesWritten += partGames[part];
+        } else {
+            success = false;
+        }
+        QFile::remove(partPaths[part]);
+    }
+
+    if (success) {
+        out.write("\n]\n");
+        success = out.flush();
+    }
+    out.close();
+    return success;
+}
+
+bool DatasetGenerator::writeRange(int begin, int end, const QString &partPath, quint32 seed, qint64 *games) const {
+    QFile file(partPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Failed to open dataset part for writing:" << partPath;
+        return false;
+    }
+
+    QRandomGenerator random(seed);
+    *games = 0;
+    for (int i = begin; i < end; ++i) {
+        // Only one user is alive at a time per worker
+        User *user = generateUser(i, random);
+        *games += user->getTotalGames();
+
+        QByteArray record = Database::serializeRecord(*user);
+        delete user;
+
+        if (i != begin) {
+            record.prepend(",\n");
+        }
+        if (file.write(record) == -1) {
+            return false;
+        }
+    }
+    return file.flush();
+}
+
+User* DatasetGenerator::generateUser(int index, QRandomGenerator &random) const {
+    User *user = new User(usernameFor(index), "defaultpassword");
+
+    // Pareto distributed activity: most users play a handful of games
+    const double u = 1.0 - random.generateDouble();
+    const double activity = 1.0 / std::pow(u, 1.0 / m_options.activitySkew);
+    const int gameCount = static_cast<int>(qMin<double>(m_options.maxGamesPerUser, activity));
+
+    static const char *difficulties[] = {"easy", "medium", "hard", "expert"};
+    const qint64 historySecs = static_cast<qint64>(m_options.historyDays) * 24 * 60 * 60;
+    const QDateTime start = QDateTime::currentDateTime().addSecs(-historySecs);
+    const int spacing = static_cast<int>(qMax<qint64>(1, historySecs / (gameCount + 1)));
+
+    for (int game = 0; game < gameCount; ++game) {
+        const QString date = start.addSecs(static_cast<qint64>(spacing) * (game + 1) + random.bounded(spacing))
+                                 .toString("yyyy-MM-dd hh:mm:ss");
+
+        int winner = 0;
+        const quint64 moves = MoveCodec::pack(randomPlayout(random, &winner));
+
+        // The user is always X, so winner 1 is a win for them
+        const QString result = winner == 1 ? "win" : (winner == 2 ? "loss" : "draw");
+
+        if (random.generateDouble() < m_options.aiGameShare) {
+            user->addGameWithDate(result, "ai", date, difficulties[random.bounded(4)], moves);
+        } else {
+            // Popular players attract most of the opponents
+            const double pick = std::pow(random.generateDouble(), 3.0);
+            int opponent = static_cast<int>(pick * m_options.userCount);
+            if (opponent == index) {
+                opponent = (opponent + 1) % qMax(2, m_options.userCount);
+            }
+            user->addGameWithDate(result, usernameFor(opponent), date, QString(), moves);
+        }
+    }
+
+    return user;
+}
+
+QVector<GameMoveRecord> DatasetGenerator::randomPlayout(QRandomGenerator &random, int *winner) {
+    static constexpr int lines[8][3] = {
+        {0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+        {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+        {0, 4, 8}, {2, 4, 6}
+    };
+
+    int board[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    int freeCells[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    int freeCount = 9;
+    int player = 1;
+
+    QVector<GameMoveRecord> moves;
+    moves.reserve(9);
+    *winner = 0;
+
+    while (freeCount > 0 && *winner == 0) {
+        const int pick = random.bounded(freeCount);
+        const int cell = freeCells[pick];
+        freeCells[pick] = freeCells[--freeCount];
+
+        board[cell] = player;
+        moves.append({cell, player});
+
+        for (const auto &line : lines) {
+            if (board[line[0]] == player && board[line[1]] == player && board[line[2]] == player) {
+                *winner = player;
+                break;
+            }
+        }
+        player = player == 1 ? 2 : 1;
+    }
+    return moves;
+}
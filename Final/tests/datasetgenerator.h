@@ -0,0 +1,49 @@
+#ifndef DATASETGENERATOR_H
+#define DATASETGENERATOR_H
+
+#include <QRandomGenerator>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include "../include/user.h"
+
+// Generates synthetic user databases for scaling tests.
+//
+// Users get a heavy-tailed number of games (a few very active players, a long
+// tail of casual ones), opponents skewed towards popular players, full move
+// lists from random playouts and increasing timestamps. Records are written
+// straight into the tictactoe.json format by a pool of workers, each streaming
+// its own range of users to a part file, so memory use stays flat no matter
+// how many users are generated.
+class DatasetGenerator {
+public:
+    struct Options {
+        int userCount = 10000;
+        int maxGamesPerUser = 500;
+        double activitySkew = 1.2;   // Pareto shape, lower means heavier tail
+        double aiGameShare = 0.5;    // Fraction of games played against the AI
+        int historyDays = 365;       // Timestamps spread over this many days
+        quint32 seed = 42;
+        int threads = QThread::idealThreadCount();
+    };
+
+    explicit DatasetGenerator(const Options &options);
+
+    // Writes the whole dataset to path, returns false on any I/O error
+    bool writeTo(const QString &path);
+
+    // Total games recorded by the last writeTo() call
+    qint64 gamesWritten() const;
+
+    static QString usernameFor(int index);
+
+private:
+    bool writeRange(int begin, int end, const QString &partPath, quint32 seed, qint64 *games) const;
+    User* generateUser(int index, QRandomGenerator &random) const;
+    static QVector<GameMoveRecord> randomPlayout(QRandomGenerator &random, int *winner);
+
+    Options m_options;
+    qint64 m_gamesWritten;
+};
+
+#endif // DATASETGENERATOR_H
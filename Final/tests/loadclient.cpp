@@ -0,0 +1,125 @@
+#include "loadclient.h"
+#include "../include/gameclient.h"
+#include "../include/replaytimeline.h"
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <algorithm>
+
+LoadClient::LoadClient(const Options &options)
+    : m_options(options)
+{
+}
+
+LoadClient::Report LoadClient::run() {
+    struct Game {
+        BoardSnapshot board;
+        qint64 sentAt = 0;
+    };
+
+    Report report;
+    QEventLoop loop;
+    QObject owner; // Parent of the clients, so they go when the run ends
+    QRandomGenerator random(m_options.seed);
+    QElapsedTimer clock;
+    QHash<quint32, Game> games;
+    games.reserve(m_options.games);
+    QVector<qint64> latencies;
+    latencies.reserve(m_options.games * 9);
+    int ended = 0;
+
+    auto endGame = [&](quint32 session) {
+        games.remove(session);
+        if (++ended == m_options.games) {
+            loop.quit();
+        }
+    };
+    auto playNext = [&](GameClient *client, quint32 session, Game &game) {
+        int freeCells[9];
+        int freeCount = 0;
+        for (int cell = 0; cell < 9; ++cell) {
+            if (game.board.cell(cell) == GameLogic::Player::None) {
+                freeCells[freeCount++] = cell;
+            }
+        }
+        game.sentAt = clock.nsecsElapsed();
+        client->sendMove(session, freeCells[random.bounded(freeCount)]);
+    };
+
+    const int connections = qMax(1, m_options.connections);
+    for (int i = 0; i < connections; ++i) {
+        GameClient *client = new GameClient(&owner);
+        const int share = m_options.games / connections + (i < m_options.games % connections ? 1 : 0);
+        const QString playerX = QString("load-x-%1").arg(i);
+        const QString playerO = QString("load-o-%1").arg(i);
+
+        QObject::connect(client, &GameClient::connected, &owner, [client, share, playerX, playerO]() {
+            for (int game = 0; game < share; ++game) {
+                client->openGame(playerX, playerO);
+            }
+        });
+        QObject::connect(client, &GameClient::gameOpened, &owner, [&, client](quint32 session) {
+            if (session == 0) {
+                report.rejected++;
+                endGame(session);
+                return;
+            }
+            playNext(client, session, games[session]);
+        });
+        QObject::connect(client, &GameClient::moved, &owner,
+                         [&, client](quint32 session, int cell, GameLogic::Player player) {
+            auto it = games.find(session);
+            if (it == games.end()) {
+                return;
+            }
+            latencies.append(clock.nsecsElapsed() - it->sentAt);
+            report.moves++;
+
+            const quint16 bit = quint16(1u << cell);
+            if (player == GameLogic::Player::X) {
+                it->board.x |= bit;
+            } else {
+                it->board.o |= bit;
+            }
+            // GameOver follows a deciding move; anything else waits on the next one
+            if (it->board.winner() == GameLogic::Player::None && !it->board.isFull()) {
+                playNext(client, session, *it);
+            }
+        });
+        QObject::connect(client, &GameClient::moveRejected, &owner, [&](quint32 session, int) {
+            report.rejected++;
+            endGame(session);
+        });
+        QObject::connect(client, &GameClient::gameOver, &owner, [&](quint32 session, GameLogic::GameResult) {
+            report.gamesFinished++;
+            endGame(session);
+        });
+
+        client->connectToServer(m_options.host, m_options.port);
+    }
+
+    clock.start();
+    QTimer::singleShot(m_options.timeoutMs, &loop, &QEventLoop::quit);
+    if (m_options.games > 0) {
+        loop.exec();
+    }
+    report.elapsedMs = clock.elapsed();
+    report.movesPerSecond = report.moves * 1000.0 / qMax<qint64>(1, report.elapsedMs);
+
+    std::sort(latencies.begin(), latencies.end());
+    report.p50Us = percentile(latencies, 0.50);
+    report.p99Us = percentile(latencies, 0.99);
+    report.p999Us = percentile(latencies, 0.999);
+    report.maxUs = latencies.isEmpty() ? 0.0 : latencies.last() / 1000.0;
+    return report;
+}
+
+double LoadClient::percentile(const QVector<qint64> &sorted, double fraction) {
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    const int index = qMin(sorted.size() - 1, int(fraction * sorted.size()));
+    return sorted.at(index) / 1000.0;
+}
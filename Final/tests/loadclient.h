@@ -0,0 +1,49 @@
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include <QString>
+#include <QVector>
+#include "../include/gamelogic.h"
+
+// Plays a large number of simultaneous random games against a GameServer.
+//
+// Every game is opened up front and then advanced one move at a time as the
+// server confirms the previous one, so all of them are in flight at once.
+// The time from sending a move to its confirmation is recorded for every
+// move.
+class LoadClient {
+public:
+    struct Options {
+        QString host = "127.0.0.1";
+        quint16 port = 0;
+        int games = 10000;
+        int connections = 16;       // Games are spread evenly over these
+        quint32 seed = 7;
+        int timeoutMs = 120000;
+    };
+
+    struct Report {
+        int gamesFinished = 0;
+        qint64 moves = 0;
+        qint64 rejected = 0;
+        qint64 elapsedMs = 0;
+        double movesPerSecond = 0.0;
+        // Move round trips, in microseconds
+        double p50Us = 0.0;
+        double p99Us = 0.0;
+        double p999Us = 0.0;
+        double maxUs = 0.0;
+    };
+
+    explicit LoadClient(const Options &options);
+
+    // Runs every game to the end, or until the timeout, in a local event loop
+    Report run();
+
+private:
+    static double percentile(const QVector<qint64> &sorted, double fraction);
+
+    Options m_options;
+};
+
+#endif // LOADCLIENT_H
@@ -0,0 +1,102 @@
+#include "matchsimulator.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <algorithm>
+
+MatchSimulator::MatchSimulator(const Options &options)
+    : m_options(options)
+{
+}
+
+MatchSimulator::Report MatchSimulator::run() {
+    Matchmaker matchmaker(m_options.matchmaker);
+    QRandomGenerator random(m_options.seed);
+    Report report;
+
+    // Waiting players, for picking one to cancel; a swap-remove keeps it dense
+    QVector<quint32> waiting;
+    QHash<quint32, int> waitingIndex;
+    auto leave = [&](quint32 player) {
+        const int index = waitingIndex.take(player);
+        const quint32 last = waiting.takeLast();
+        if (last != player) {
+            waiting[index] = last;
+            waitingIndex.insert(last, index);
+        }
+    };
+
+    QVector<qint64> waits;
+    QVector<qint64> gaps;
+    auto record = [&](const Matchmaker::Match &match) {
+        leave(match.first);
+        leave(match.second);
+        waits.append(match.firstWaitMs);
+        waits.append(match.secondWaitMs);
+        gaps.append(match.ratingGap);
+        report.matches++;
+    };
+
+    quint32 nextPlayer = 1;
+    qint64 nextPoll = m_options.pollIntervalMs;
+    const double interval = 1000.0 / qMax(1, m_options.arrivalsPerSecond);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int event = 0; event < m_options.events; ++event) {
+        const qint64 now = qint64(event * interval);
+        while (nextPoll <= now) {
+            const QVector<Matchmaker::Match> matches = matchmaker.poll(nextPoll);
+            for (const Matchmaker::Match &match : matches) {
+                record(match);
+            }
+            nextPoll += m_options.pollIntervalMs;
+        }
+
+        if (!waiting.isEmpty() && random.generateDouble() < m_options.cancelShare) {
+            const quint32 player = waiting.at(random.bounded(waiting.size()));
+            matchmaker.cancel(player);
+            leave(player);
+            report.cancels++;
+            continue;
+        }
+
+        // Box-Muller
+        const double u1 = 1.0 - random.generateDouble();
+        const double u2 = random.generateDouble();
+        const double normal = qSqrt(-2.0 * qLn(u1)) * qCos(2.0 * M_PI * u2);
+        const int rating = qRound(m_options.ratingMean + normal * m_options.ratingDeviation);
+
+        const quint32 player = nextPlayer++;
+        waitingIndex.insert(player, waiting.size());
+        waiting.append(player);
+        report.enqueues++;
+        Matchmaker::Match match;
+        if (matchmaker.enqueue(player, rating, now, &match)) {
+            record(match);
+        }
+    }
+    report.elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+    report.events = m_options.events;
+    report.stillWaiting = matchmaker.waitingCount();
+    report.eventsPerSecond = report.events * 1000.0 / report.elapsedMs;
+    std::sort(waits.begin(), waits.end());
+    std::sort(gaps.begin(), gaps.end());
+    report.waitP50Ms = percentile(waits, 0.50);
+    report.waitP90Ms = percentile(waits, 0.90);
+    report.waitP99Ms = percentile(waits, 0.99);
+    report.waitMaxMs = waits.isEmpty() ? 0.0 : waits.last();
+    report.gapP50 = percentile(gaps, 0.50);
+    report.gapP99 = percentile(gaps, 0.99);
+    report.gapMax = gaps.isEmpty() ? 0 : int(gaps.last());
+    return report;
+}
+
+double MatchSimulator::percentile(const QVector<qint64> &sorted, double fraction) {
+    if (sorted.isEmpty()) {
+        return 0.0;
+    }
+    const int index = qMin(sorted.size() - 1, int(fraction * sorted.size()));
+    return sorted.at(index);
+}
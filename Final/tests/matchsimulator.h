@@ -0,0 +1,56 @@
+#ifndef MATCHSIMULATOR_H
+#define MATCHSIMULATOR_H
+
+#include <QHash>
+#include <QVector>
+#include "../include/matchmaker.h"
+
+// Drives a Matchmaker with a simulated stream of players.
+//
+// Players arrive at a steady rate on a simulated clock with ratings drawn
+// from a normal distribution; a share of the events instead take a random
+// waiting player out of the queue again. The matchmaker is polled at a fixed
+// simulated interval, as the server's timer does. Waits and rating gaps are
+// measured in simulated time, throughput in wall-clock time.
+class MatchSimulator {
+public:
+    struct Options {
+        int events = 100000;
+        int arrivalsPerSecond = 500;    // Simulated
+        double cancelShare = 0.1;       // Fraction of events that are cancels
+        double ratingMean = 1200.0;
+        double ratingDeviation = 200.0;
+        int pollIntervalMs = 100;       // Simulated
+        quint32 seed = 11;
+        Matchmaker::Options matchmaker;
+    };
+
+    struct Report {
+        int events = 0;
+        int enqueues = 0;
+        int cancels = 0;
+        int matches = 0;
+        int stillWaiting = 0;
+        qint64 elapsedMs = 0;
+        double eventsPerSecond = 0.0;
+        // Simulated milliseconds from queueing to being matched
+        double waitP50Ms = 0.0;
+        double waitP90Ms = 0.0;
+        double waitP99Ms = 0.0;
+        double waitMaxMs = 0.0;
+        double gapP50 = 0.0;
+        double gapP99 = 0.0;
+        int gapMax = 0;
+    };
+
+    explicit MatchSimulator(const Options &options);
+
+    Report run();
+
+private:
+    static double percentile(const QVector<qint64> &sorted, double fraction);
+
+    Options m_options;
+};
+
+#endif // MATCHSIMULATOR_H
@@ -0,0 +1,136 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QDebug>
+#include "alloccounter.h"
+#include "../include/gamelogic.h"
+#include "../include/aiopponent.h"
+
+// Allocation budgets for the per-move hot path. Tighten these as allocations
+// are removed, never loosen them without a reason in the commit message.
+static constexpr long long kMakeMoveBudget = 0;     // board, history and win pattern are reserved up front
+static constexpr long long kFindBestMoveBudget = 0; // search runs on the caller's board
+static constexpr long long kFullGameBudget = 0;     // reset plus every move of one game
+
+class TestAllocations : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testCounterSeesAllocations();
+    void testMakeMoveBudget();
+    void testFindBestMoveBudget();
+    void testFullGameBudget();
+
+private:
+    GameLogic *gameLogic;
+    AIOpponent *aiOpponent;
+};
+
+void TestAllocations::init()
+{
+    gameLogic = new GameLogic();
+    aiOpponent = new AIOpponent();
+    aiOpponent->setGameLogic(gameLogic);
+}
+
+void TestAllocations::cleanup()
+{
+    delete aiOpponent;
+    delete gameLogic;
+}
+
+void TestAllocations::testCounterSeesAllocations()
+{
+    // Make sure the hooks are live for both operator new and Qt containers
+    AllocCounter::Scope scope;
+    int *value = new int(42);
+    QVector<int> vector;
+    vector.append(*value);
+    delete value;
+
+    QVERIFY(scope.allocations() >= 2);
+    QVERIFY(scope.frees() >= 1);
+}
+
+void TestAllocations::testMakeMoveBudget()
+{
+    // X wins on the top row; every move including the winning one is measured
+    const int moves[] = {0, 3, 1, 4, 2};
+    for (int index : moves) {
+        AllocCounter::Scope scope;
+        QVERIFY(gameLogic->makeMove(index));
+        long long count = scope.allocations();
+        QVERIFY2(count <= kMakeMoveBudget,
+                 qPrintable(QString("makeMove(%1) allocated %2 times").arg(index).arg(count)));
+    }
+    QCOMPARE(gameLogic->getGameResult(), GameLogic::GameResult::XWins);
+}
+
+void TestAllocations::testFindBestMoveBudget()
+{
+    const GameLogic::AIDifficulty difficulties[] = {
+        GameLogic::AIDifficulty::Easy,
+        GameLogic::AIDifficulty::Medium,
+        GameLogic::AIDifficulty::Hard,
+        GameLogic::AIDifficulty::Expert
+    };
+    const int depths[] = {1, 2, 3, 9};
+
+    for (int i = 0; i < 4; ++i) {
+        gameLogic->setAIDifficulty(difficulties[i]);
+
+        QVector<Player> board(9, Player::None);
+        board[0] = Player::X;
+
+        AllocCounter::Scope scope;
+        int move = aiOpponent->findBestMove(board, depths[i]);
+        long long count = scope.allocations();
+
+        QVERIFY(move >= 0 && move < 9);
+        QVERIFY2(count <= kFindBestMoveBudget,
+                 qPrintable(QString("findBestMove at depth %1 allocated %2 times").arg(depths[i]).arg(count)));
+    }
+}
+
+void TestAllocations::testFullGameBudget()
+{
+    gameLogic->setAIDifficulty(GameLogic::AIDifficulty::Expert);
+    QVector<Player> board(9, Player::None);
+
+    // Warm up once so lazily created buffers are already in place
+    gameLogic->resetBoard();
+
+    AllocCounter::Scope scope;
+    gameLogic->resetBoard();
+    while (gameLogic->getGameResult() == GameLogic::GameResult::InProgress) {
+        int move = -1;
+        if (gameLogic->getCurrentPlayer() == Player::X) {
+            // Human plays the first free cell
+            for (int i = 0; i < 9 && move < 0; ++i) {
+                if (gameLogic->getCellState(i) == Player::None) {
+                    move = i;
+                }
+            }
+        } else {
+            for (int i = 0; i < 9; ++i) {
+                board[i] = gameLogic->getCellState(i);
+            }
+            move = aiOpponent->findBestMove(board, 9);
+        }
+        QVERIFY(move >= 0);
+        QVERIFY(gameLogic->makeMove(move));
+    }
+    long long count = scope.allocations();
+
+    qDebug() << "Allocations for a full game vs Expert AI:" << count;
+    QVERIFY2(count <= kFullGameBudget,
+             qPrintable(QString("Full game allocated %1 times").arg(count)));
+}
+
+QTEST_MAIN(TestAllocations)
+#include "test_allocations.moc"
@@ -79,6 +79,11 @@ void TestAuthentication::testUserRegistration()
     
     QVERIFY(auth->registerUser(username, password));
     QVERIFY(!auth->registerUser(username, password)); // Duplicate
+
+    // The computer's name in the game archive
+    QVERIFY(!auth->registerUser("AI", password));
+    QVERIFY(!auth->registerUser("ai", password));
+    QVERIFY(auth->registerUser("AIden", password));
 }
 
 void TestAuthentication::testUserLogin()
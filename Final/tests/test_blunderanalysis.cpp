@@ -0,0 +1,263 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QDebug>
+#include "../include/blunderanalysis.h"
+#include "../include/gamearchive.h"
+#include "../include/moveanalyzer.h"
+#include "../include/movecodec.h"
+
+// Batch grading of archived games, the summary store and incremental runs
+class TestBlunderAnalysis : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testGradesOneGame();
+    void testOpenedByO();
+    void testComputerIgnored();
+    void testIncrementalRun();
+    void testSummaryRoundTrip();
+    void testParallelMatchesSequential();
+
+private:
+    static int gameCount();
+    static QVector<GameMoveRecord> topRowWin(int firstPlayer);
+    static QVector<GameMoveRecord> randomGame(QRandomGenerator &random);
+};
+
+int TestBlunderAnalysis::gameCount()
+{
+    bool ok = false;
+    const int games = qEnvironmentVariableIntValue("TICTACTOE_ANALYSIS_GAMES", &ok);
+    return ok ? games : 200000;
+}
+
+// The first player takes the top row while the second gives it away
+QVector<GameMoveRecord> TestBlunderAnalysis::topRowWin(int firstPlayer)
+{
+    const int second = firstPlayer == 1 ? 2 : 1;
+    return {{0, firstPlayer}, {3, second}, {1, firstPlayer}, {5, second}, {2, firstPlayer}};
+}
+
+QVector<GameMoveRecord> TestBlunderAnalysis::randomGame(QRandomGenerator &random)
+{
+    QVector<GameMoveRecord> moves;
+    BoardSnapshot board;
+    while (board.winner() == GameLogic::Player::None && !board.isFull()) {
+        int cell = random.bounded(9);
+        while ((board.x | board.o) & (1u << cell)) {
+            cell = random.bounded(9);
+        }
+        const int player = moves.size() % 2 == 0 ? 1 : 2;
+        (player == 1 ? board.x : board.o) |= quint16(1u << cell);
+        moves.append({cell, player});
+    }
+    return moves;
+}
+
+void TestBlunderAnalysis::testGradesOneGame()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins, QString(), MoveCodec::pack(topRowWin(1))));
+    QVERIFY(archive.append("carol", "dave", GameLogic::GameResult::Draw)); // No moves recorded
+
+    BlunderSummary summary;
+    QCOMPARE(BlunderAnalysis::run(&archive, &summary), qint64(2));
+    QCOMPARE(summary.gamesAnalysed(), qint64(2));
+
+    // Every move of the winner was best
+    const MistakeTally alice = summary.tally("alice");
+    QCOMPARE(alice.games, 1u);
+    QCOMPARE(alice.moves, 3u);
+    QCOMPARE(alice.inaccuracies + alice.mistakes + alice.blunders, 0u);
+    QCOMPARE(alice.mistakeRate(), 0.0);
+
+    // The second move threw the draw away, the fourth lost sooner than it had to
+    const MistakeTally bob = summary.tally("bob");
+    QCOMPARE(bob.games, 1u);
+    QCOMPARE(bob.moves, 2u);
+    QCOMPARE(bob.inaccuracies, 1u);
+    QCOMPARE(bob.mistakes, 1u);
+    QCOMPARE(bob.blunders, 0u);
+    QCOMPARE(bob.mistakeRate(), 0.5);
+
+    QVERIFY(!summary.players().contains("carol"));
+    QCOMPARE(summary.tally("nobody").moves, 0u);
+
+    // The position bob's mistake left, in canonical form
+    const QVector<LosingPattern> patterns = summary.patterns(10);
+    QCOMPARE(patterns.size(), 1);
+    QCOMPARE(patterns.first().count, 1u);
+    QCOMPARE(patterns.first().position, MoveAnalyzer::canonicalKey(1u << 0, 1u << 3));
+    const BoardSnapshot board = patterns.first().board();
+    QCOMPARE(qPopulationCount(board.x), 1);
+    QCOMPARE(qPopulationCount(board.o), 1);
+}
+
+void TestBlunderAnalysis::testOpenedByO()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::OWins, QString(), MoveCodec::pack(topRowWin(2))));
+
+    // Same game with the marks swapped; bob opened and won it
+    BlunderSummary summary;
+    QCOMPARE(BlunderAnalysis::run(&archive, &summary), qint64(1));
+    QCOMPARE(summary.tally("bob").moves, 3u);
+    QCOMPARE(summary.tally("bob").mistakes, 0u);
+    QCOMPARE(summary.tally("alice").moves, 2u);
+    QCOMPARE(summary.tally("alice").mistakes, 1u);
+    QCOMPARE(summary.tally("alice").inaccuracies, 1u);
+}
+
+void TestBlunderAnalysis::testComputerIgnored()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QVERIFY(archive.append("alice", "AI", GameLogic::GameResult::XWins, "easy", MoveCodec::pack(topRowWin(1))));
+
+    BlunderSummary summary;
+    QCOMPARE(BlunderAnalysis::run(&archive, &summary), qint64(1));
+    QCOMPARE(summary.tally("alice").moves, 3u);
+    QVERIFY(!summary.players().contains("AI"));
+    // Only a player's mistakes make patterns
+    QVERIFY(summary.patterns(10).isEmpty());
+}
+
+void TestBlunderAnalysis::testIncrementalRun()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QRandomGenerator random(7);
+    for (int i = 0; i < 3000; ++i) {
+        QVERIFY(archive.append(QString("player%1").arg(i % 40), QString("player%1").arg((i + 1) % 40),
+                               GameLogic::GameResult::Draw, QString(), MoveCodec::pack(randomGame(random))));
+    }
+
+    const QString summaryPath = BlunderAnalysis::summaryPath(archive.path());
+    QCOMPARE(BlunderAnalysis::update(&archive), qint64(3000));
+    QCOMPARE(BlunderAnalysis::update(&archive), qint64(0));
+
+    for (int i = 0; i < 500; ++i) {
+        QVERIFY(archive.append(QString("player%1").arg(i % 40), QString("player%1").arg((i + 7) % 40),
+                               GameLogic::GameResult::Draw, QString(), MoveCodec::pack(randomGame(random))));
+    }
+    // Only the new games are read
+    QCOMPARE(BlunderAnalysis::update(&archive), qint64(500));
+
+    BlunderSummary incremental;
+    QVERIFY(incremental.load(summaryPath));
+    QCOMPARE(incremental.gamesAnalysed(), qint64(3500));
+    BlunderSummary fresh;
+    QCOMPARE(BlunderAnalysis::run(&archive, &fresh), qint64(3500));
+    QCOMPARE(incremental.players().size(), fresh.players().size());
+    for (auto it = fresh.players().constBegin(); it != fresh.players().constEnd(); ++it) {
+        const MistakeTally tally = incremental.tally(it.key());
+        QCOMPARE(tally.games, it.value().games);
+        QCOMPARE(tally.moves, it.value().moves);
+        QCOMPARE(tally.mistakes, it.value().mistakes);
+        QCOMPARE(tally.blunders, it.value().blunders);
+    }
+}
+
+void TestBlunderAnalysis::testSummaryRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QRandomGenerator random(11);
+    for (int i = 0; i < 200; ++i) {
+        QVERIFY(archive.append(QString("p%1").arg(i % 5), "AI", GameLogic::GameResult::Draw, "hard",
+                               MoveCodec::pack(randomGame(random))));
+    }
+    BlunderSummary summary;
+    QCOMPARE(BlunderAnalysis::run(&archive, &summary), qint64(200));
+
+    const QString path = dir.filePath("summary.analysis");
+    QVERIFY(summary.save(path));
+    BlunderSummary loaded;
+    QVERIFY(loaded.load(path));
+    QCOMPARE(loaded.gamesAnalysed(), summary.gamesAnalysed());
+    QCOMPARE(loaded.players().size(), 5);
+    QCOMPARE(loaded.tally("p3").moves, summary.tally("p3").moves);
+    QCOMPARE(loaded.tally("p3").inaccuracies, summary.tally("p3").inaccuracies);
+    QVERIFY(!summary.patterns(-1).isEmpty());
+    QCOMPARE(loaded.patterns(-1).size(), summary.patterns(-1).size());
+    QCOMPARE(loaded.patterns(3).first().position, summary.patterns(3).first().position);
+
+    // Anything else is ignored rather than half read
+    QFile file(path);
+    QVERIFY(file.resize(file.size() / 2));
+    QVERIFY(!loaded.load(path));
+    QCOMPARE(loaded.gamesAnalysed(), qint64(0));
+    QVERIFY(loaded.players().isEmpty());
+    QVERIFY(!loaded.load(dir.filePath("missing.analysis")));
+}
+
+void TestBlunderAnalysis::testParallelMatchesSequential()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    const int games = gameCount();
+    const int players = 1000;
+    QRandomGenerator random(42);
+
+    // Graded one move at a time for reference, while the archive is written
+    QHash<QString, MistakeTally> expected;
+    for (int i = 0; i < games; ++i) {
+        const QString playerX = QString("player%1").arg(random.bounded(players));
+        const QString playerO = QString("player%1").arg(random.bounded(players));
+        const QVector<GameMoveRecord> moves = randomGame(random);
+        QVERIFY(archive.append(playerX, playerO, GameLogic::GameResult::Draw, QString(), MoveCodec::pack(moves)));
+
+        MistakeTally sides[2];
+        BoardSnapshot board;
+        for (int ply = 0; ply < moves.size(); ++ply) {
+            MistakeTally &tally = sides[ply % 2];
+            tally.moves++;
+            switch (MoveAnalyzer::grade(board, moves.at(ply).cellIndex)) {
+            case MoveAnalyzer::MoveQuality::Inaccuracy: tally.inaccuracies++; break;
+            case MoveAnalyzer::MoveQuality::Mistake: tally.mistakes++; break;
+            case MoveAnalyzer::MoveQuality::Blunder: tally.blunders++; break;
+            default: break;
+            }
+            (ply % 2 == 0 ? board.x : board.o) |= quint16(1u << moves.at(ply).cellIndex);
+        }
+        sides[0].games = sides[1].games = 1;
+        expected[playerX].add(sides[0]);
+        expected[playerO].add(sides[1]);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    BlunderSummary summary;
+    QCOMPARE(BlunderAnalysis::run(&archive, &summary), qint64(games));
+    const qint64 elapsed = timer.elapsed();
+
+    quint64 moves = 0;
+    QCOMPARE(summary.players().size(), expected.size());
+    for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) {
+        const MistakeTally tally = summary.tally(it.key());
+        QCOMPARE(tally.games, it.value().games);
+        QCOMPARE(tally.moves, it.value().moves);
+        QCOMPARE(tally.inaccuracies, it.value().inaccuracies);
+        QCOMPARE(tally.mistakes, it.value().mistakes);
+        QCOMPARE(tally.blunders, it.value().blunders);
+        moves += tally.moves;
+    }
+    qDebug() << "Analysed" << games << "games," << moves << "moves in" << elapsed << "ms";
+}
+
+QTEST_MAIN(TestBlunderAnalysis)
+#include "test_blunderanalysis.moc"
@@ -3,10 +3,16 @@
 #include <QTest>
 #include <QObject>
 #include <QTemporaryFile>
+#include <QTemporaryDir>
 #include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include "../include/database.h"
 #include "../include/user.h"
 #include "../include/authentication.h"
+#include "../include/movecodec.h"
+#include "../include/historystore.h"
 
 class TestDatabase : public QObject
 {
@@ -22,6 +28,10 @@ private slots:
     void testErrorHandling();
     void testLeaderboardSorting();
     void testLargeDataset();
+    void testMoveHistoryPersistence();
+    void testIncrementalSave();
+    void testShardedLoad();
+    void testLazyHistoryLoad();
 
 private:
     Database *database;
@@ -79,7 +89,7 @@ void TestDatabase::testLeaderboardGeneration()
     QVERIFY(leaderboard.size() >= 2);
     
     for (const LeaderboardEntry& entry : leaderboard) {
-        QVERIFY(!entry.username.isEmpty());
+        QVERIFY(!entry.username().isEmpty());
         QVERIFY(entry.wins >= 0);
         QVERIFY(entry.totalGames >= 0);
         QVERIFY(entry.winRate >= 0 && entry.winRate <= 100);
@@ -149,9 +159,9 @@ void TestDatabase::testLeaderboardSorting()
     // Find the entries for our test users
     int user1Score = -1, user2Score = -1, user3Score = -1;
     for (const LeaderboardEntry& entry : leaderboard) {
-        if (entry.username == "user1") user1Score = entry.score;
-        if (entry.username == "user2") user2Score = entry.score;
-        if (entry.username == "user3") user3Score = entry.score;
+        if (entry.username() == "user1") user1Score = entry.score;
+        if (entry.username() == "user2") user2Score = entry.score;
+        if (entry.username() == "user3") user3Score = entry.score;
     }
     
     // Verify user3 (10 wins) has higher score than user1 (5 wins)
@@ -221,6 +231,216 @@ void TestDatabase::testLargeDataset()
     }
 }
 
+void TestDatabase::testMoveHistoryPersistence()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    database->setDatabasePath(dir.filePath("tictactoe.json"));
+    
+    // X wins on the top row
+    QVector<GameMoveRecord> moves = {{0, 1}, {3, 2}, {1, 1}, {4, 2}, {2, 1}};
+    User* player = new User("replayUser", Authentication::hashPassword("secret"));
+    player->addGameWithMoves("win", "ai", moves, "hard");
+    player->addGame("loss", "testUser2");
+    
+    QVERIFY(database->saveUsers(QVector<User*>{player}));
+    QVector<User*> loadedUsers = database->loadUsers();
+    QCOMPARE(loadedUsers.size(), 1);
+    
+    User* loaded = loadedUsers.first();
+    QVERIFY(loaded->checkPassword("secret"));
+    
+    // History order survives the round trip and only the first game has moves
+    QVector<GameRecord> history = loaded->getGameHistory();
+    QCOMPARE(history.size(), 2);
+    QCOMPARE(history[0].packedMoves, quint64(0));
+    QCOMPARE(history[1].packedMoves, MoveCodec::pack(moves));
+    
+    QVector<GameMoveRecord> replay = history[1].decodeMoves();
+    QCOMPARE(replay.size(), moves.size());
+    QCOMPARE(replay.last().cellIndex, 2);
+    QCOMPARE(replay.last().player, 1);
+    
+    delete player;
+    for (User* user : loadedUsers) {
+        delete user;
+    }
+}
+
+void TestDatabase::testIncrementalSave()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    database->setDatabasePath(dir.filePath("tictactoe.json"));
+    
+    QVector<User*> users;
+    for (int i = 0; i < 1000; ++i) {
+        User* user = new User(QString("journalUser%1").arg(i), "hash");
+        user->addGame("win", "ai", "easy");
+        users.append(user);
+    }
+    QVERIFY(database->saveUsers(users));
+    const qint64 snapshotSize = QFileInfo(database->databasePath()).size();
+    for (User* user : users) {
+        user->clearDirty();
+    }
+    
+    // One game between two of the thousand users
+    users[10]->addGame("win", "journalUser500");
+    users[500]->addGame("loss", "journalUser10");
+    
+    QVector<User*> dirty;
+    for (User* user : users) {
+        if (user->isDirty()) {
+            dirty.append(user);
+        }
+    }
+    QCOMPARE(dirty.size(), 2);
+    
+    qint64 bytesWritten = 0;
+    QVERIFY(database->appendUsers(dirty, &bytesWritten));
+    QVERIFY(bytesWritten > 0);
+    QVERIFY(bytesWritten < snapshotSize / 100);
+    QCOMPARE(QFileInfo(database->databasePath()).size(), snapshotSize);
+    
+    // Loading folds the journal over the snapshot
+    QVector<User*> loadedUsers = database->loadUsers();
+    QCOMPARE(loadedUsers.size(), 1000);
+    QCOMPARE(loadedUsers[10]->getWins(), 2);
+    QCOMPARE(loadedUsers[500]->getLosses(), 1);
+    QVERIFY(!loadedUsers[10]->isDirty());
+    
+    // A full save absorbs the journal
+    QVERIFY(database->saveUsers(loadedUsers));
+    QVERIFY(!QFile::exists(database->journalPath()));
+    
+    for (User* user : users) {
+        delete user;
+    }
+    for (User* user : loadedUsers) {
+        delete user;
+    }
+}
+
+void TestDatabase::testShardedLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    database->setDatabasePath(dir.filePath("tictactoe.json"));
+    
+    // A bit over two shards, so the last one is partial
+    QVector<User*> users;
+    for (int i = 0; i < 20000; ++i) {
+        User* user = new User(QString("shardUser%1").arg(i), "hash");
+        for (int j = 0; j < i % 4; ++j) {
+            user->addGame("win", "ai", "easy");
+        }
+        users.append(user);
+    }
+    QVERIFY(database->saveUsers(users));
+    QVERIFY(QFile::exists(database->databasePath() + ".idx"));
+    
+    // Shards come back in file order
+    QVector<User*> loadedUsers = database->loadUsers();
+    QCOMPARE(loadedUsers.size(), users.size());
+    for (int i = 0; i < users.size(); i += 997) {
+        QCOMPARE(loadedUsers[i]->getUsername(), users[i]->getUsername());
+        QCOMPARE(loadedUsers[i]->getWins(), i % 4);
+    }
+    for (User* user : loadedUsers) {
+        delete user;
+    }
+    
+    // A file rewritten behind the index's back still loads, sequentially
+    QFile file(database->databasePath());
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QJsonArray usersArray;
+    for (int i = 0; i < 3; ++i) {
+        usersArray.append(Database::serializeUser(*users[i]));
+    }
+    file.write(QJsonDocument(usersArray).toJson());
+    file.close();
+    
+    loadedUsers = database->loadUsers();
+    QCOMPARE(loadedUsers.size(), 3);
+    QCOMPARE(loadedUsers[2]->getUsername(), QString("shardUser2"));
+    
+    for (User* user : users) {
+        delete user;
+    }
+    for (User* user : loadedUsers) {
+        delete user;
+    }
+}
+
+void TestDatabase::testLazyHistoryLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    database->setDatabasePath(dir.filePath("tictactoe.json"));
+    
+    // More games than the history keeps, so the counters can't come from it
+    QVector<User*> users;
+    for (int i = 0; i < 50; ++i) {
+        User* user = new User(QString("lazyUser%1").arg(i), "hash");
+        for (int j = 0; j < 25 + i; ++j) {
+            user->addGameWithMoves(j % 3 == 0 ? "loss" : "win", "ai", {{j % 9, 1}}, "medium");
+        }
+        users.append(user);
+    }
+    QVERIFY(database->saveUsers(users));
+    
+    QVector<User*> loadedUsers = database->loadUsers();
+    QCOMPARE(loadedUsers.size(), users.size());
+    for (int i = 0; i < users.size(); ++i) {
+        User* loaded = loadedUsers[i];
+        QVERIFY(!loaded->isHistoryLoaded());
+        QCOMPARE(loaded->getTotalGames(), users[i]->getTotalGames());
+        QCOMPARE(loaded->getWins(), users[i]->getWins());
+        QCOMPARE(loaded->getBestStreak(), users[i]->getBestStreak());
+        QCOMPARE(loaded->getCurrentStreak(), users[i]->getCurrentStreak());
+    }
+    
+    // Histories page in on demand, the cache holds at most its size
+    HistoryStore* store = loadedUsers.first()->historyStore();
+    QVERIFY(store);
+    QCOMPARE(store->cachedCount(), 0);
+    QVector<GameRecord> original = users[7]->getGameHistory();
+    QVector<GameRecord> history = loadedUsers[7]->getGameHistory();
+    QCOMPARE(history.size(), original.size());
+    QCOMPARE(history.first().result(), original.first().result());
+    QCOMPARE(history.first().packedMoves, original.first().packedMoves);
+    QCOMPARE(store->cachedCount(), 1);
+    QVERIFY(store->cachedCount() <= store->cacheSize());
+    
+    // A full rewrite moves the records; cold users follow them
+    loadedUsers[3]->addGame("draw", "player2");
+    QVERIFY(database->saveUsers(loadedUsers));
+    QVERIFY(!loadedUsers[9]->isHistoryLoaded());
+    QCOMPARE(loadedUsers[9]->getGameHistory().first().result(), users[9]->getGameHistory().first().result());
+    QCOMPARE(loadedUsers[3]->getGameHistory().first().result(), QString("Draw vs player2"));
+    
+    // Journaled records leave their history on disk too
+    loadedUsers[5]->addGame("loss", "player1");
+    QVERIFY(database->appendUsers({loadedUsers[5]}));
+    QVector<User*> reloaded = database->loadUsers();
+    QCOMPARE(reloaded.size(), users.size());
+    QVERIFY(!reloaded[5]->isHistoryLoaded());
+    QCOMPARE(reloaded[5]->getTotalGames(), users[5]->getTotalGames() + 1);
+    QCOMPARE(reloaded[5]->getGameHistory().first().result(), QString("Loss vs player1"));
+    QCOMPARE(reloaded[5]->getGameHistory().size(), loadedUsers[5]->getGameHistory().size());
+    for (User* user : reloaded) {
+        delete user;
+    }
+    
+    for (User* user : users) {
+        delete user;
+    }
+    for (User* user : loadedUsers) {
+        delete user;
+    }
+}
+
 QTEST_MAIN(TestDatabase)
 #include "test_database.moc"
 
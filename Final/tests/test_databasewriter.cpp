@@ -0,0 +1,346 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include "../include/databasewriter.h"
+#include "../include/database.h"
+#include "../include/gamearchive.h"
+#include "../include/user.h"
+
+class TestDatabaseWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testFlushWritesFile();
+    void testBurstIsCoalesced();
+    void testSnapshotIsIsolated();
+    void testOnlyDirtyUsersWritten();
+    void testDestructorDrainsPendingSave();
+    void testFailedWriteIsRetried();
+    void testGamesArchivedOnWriterThread();
+    void testUsersLoadedOnWriterThread();
+    void testJournalCompactedDuringSession();
+
+private:
+    static int winsOf(const QVector<User*> &users, const QString &username);
+
+    QTemporaryDir *dir;
+    QString dbPath;
+    QVector<User*> users;
+};
+
+void TestDatabaseWriter::init()
+{
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+    dbPath = dir->filePath("tictactoe.json");
+
+    users.append(new User("writer1", "hash1"));
+    users.append(new User("writer2", "hash2"));
+    users[0]->addGame("win", "writer2");
+    users[1]->addGame("loss", "writer1");
+}
+
+void TestDatabaseWriter::cleanup()
+{
+    for (User* user : users) {
+        delete user;
+    }
+    users.clear();
+    delete dir;
+}
+
+int TestDatabaseWriter::winsOf(const QVector<User*> &users, const QString &username)
+{
+    for (const User* user : users) {
+        if (user->getUsername() == username) {
+            return user->getWins();
+        }
+    }
+    return -1;
+}
+
+void TestDatabaseWriter::testFlushWritesFile()
+{
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(10000); // Only flush() should get this written
+
+    writer.scheduleSave(users);
+    QVERIFY(writer.flush());
+
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVERIFY(QFile::exists(database.journalPath()));
+    QVector<User*> loaded = database.loadUsers();
+    QCOMPARE(loaded.size(), 2);
+    QCOMPARE(winsOf(loaded, "writer1"), 1);
+    for (User* user : loaded) {
+        delete user;
+    }
+
+    DatabaseWriter::Metrics metrics = writer.metrics();
+    QCOMPARE(metrics.queueDepth, 0);
+    QCOMPARE(metrics.writesCompleted, qint64(1));
+    QVERIFY(metrics.lastWriteBytes > 0);
+}
+
+void TestDatabaseWriter::testBurstIsCoalesced()
+{
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(300);
+    QSignalSpy spy(&writer, &DatabaseWriter::saveCompleted);
+
+    // A burst of game-overs well inside the window
+    for (int i = 0; i < 20; ++i) {
+        users[0]->addGame("win", "ai", "easy");
+        writer.scheduleSave(users);
+    }
+    QVERIFY(writer.metrics().queueDepth > 0);
+
+    QVERIFY(spy.wait(5000));
+    DatabaseWriter::Metrics metrics = writer.metrics();
+    QCOMPARE(metrics.writesCompleted, qint64(1));
+    QCOMPARE(metrics.requestsCoalesced, qint64(19));
+    QCOMPARE(metrics.queueDepth, 0);
+    QVERIFY(metrics.lastWriteLatencyMs >= 0);
+
+    // The single write carries the newest state
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVector<User*> loaded = database.loadUsers();
+    QCOMPARE(winsOf(loaded, "writer1"), 21);
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+void TestDatabaseWriter::testSnapshotIsIsolated()
+{
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(200);
+
+    writer.scheduleSave(users);
+    // Changes after scheduling must not leak into the queued snapshot
+    users[0]->addGame("win", "ai", "easy");
+    QVERIFY(writer.flush());
+
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVector<User*> loaded = database.loadUsers();
+    QCOMPARE(winsOf(loaded, "writer1"), 1);
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+void TestDatabaseWriter::testOnlyDirtyUsersWritten()
+{
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(0);
+
+    writer.scheduleSave(users);
+    QVERIFY(writer.flush());
+    const qint64 bothUsers = writer.metrics().lastWriteBytes;
+
+    // Only writer1 changed, so only its record is appended
+    users[0]->addGame("win", "writer2");
+    QVERIFY(!users[1]->isDirty());
+    writer.scheduleSave(users);
+    QVERIFY(writer.flush());
+    const qint64 oneUser = writer.metrics().lastWriteBytes;
+    QVERIFY(oneUser > 0);
+    QVERIFY(oneUser < bothUsers);
+
+    // Nothing changed, nothing queued
+    writer.scheduleSave(users);
+    QCOMPARE(writer.metrics().queueDepth, 0);
+    QVERIFY(writer.flush());
+    QCOMPARE(writer.metrics().writesCompleted, qint64(2));
+
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVector<User*> loaded = database.loadUsers();
+    QCOMPARE(loaded.size(), 2);
+    QCOMPARE(winsOf(loaded, "writer1"), 2);
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+void TestDatabaseWriter::testDestructorDrainsPendingSave()
+{
+    {
+        DatabaseWriter writer(dbPath);
+        writer.setCoalesceWindow(10000);
+        writer.scheduleSave(users);
+    }
+    QVERIFY(QFile::exists(dbPath + ".journal"));
+}
+
+void TestDatabaseWriter::testFailedWriteIsRetried()
+{
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(0);
+
+    // A directory where the journal should be makes the first write fail
+    QVERIFY(QDir().mkpath(dbPath + ".journal"));
+    writer.scheduleSave(users);
+    QVERIFY(!users[0]->isDirty());
+    QVERIFY(!writer.flush());
+    QCOMPARE(writer.metrics().writesFailed, qint64(1));
+    QCOMPARE(writer.metrics().queueDepth, 1);   // Still queued for a retry
+    QVERIFY(!writer.flush());                   // Tried again, failed again
+
+    // Once the disk is usable the records reach it with no new request
+    QVERIFY(QDir(dbPath + ".journal").removeRecursively());
+    QVERIFY(writer.flush());
+    QCOMPARE(writer.metrics().queueDepth, 0);
+    QVERIFY(writer.metrics().lastWriteBytes > 0);
+
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVector<User*> loaded = database.loadUsers();
+    QCOMPARE(loaded.size(), 2);
+    QCOMPARE(winsOf(loaded, "writer1"), 1);
+    for (User* user : loaded) {
+        delete user;
+    }
+
+    // The writer retries on its own too, after a delay
+    QVERIFY(QDir().mkpath(dbPath + ".journal"));
+    users[0]->addGame("win", "writer2");
+    QSignalSpy spy(&writer, &DatabaseWriter::saveCompleted);
+    writer.scheduleSave(users);
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy.last().at(0).toBool(), false);
+    QVERIFY(QDir(dbPath + ".journal").removeRecursively());
+    QTRY_COMPARE_WITH_TIMEOUT(spy.last().at(0).toBool(), true, 5000);
+    QCOMPARE(writer.metrics().queueDepth, 0);
+}
+
+void TestDatabaseWriter::testGamesArchivedOnWriterThread()
+{
+    {
+        GameArchive earlier(dbPath + ".games");
+        QVERIFY(earlier.append("writer1", "writer2", GameLogic::GameResult::XWins));
+    }
+
+    // Indexing the existing games is left to the writer
+    GameArchive archive(dbPath + ".games");
+    QVERIFY(!archive.isOpen());
+    DatabaseWriter writer(dbPath);
+    writer.setCoalesceWindow(10000);
+    QSignalSpy opened(&writer, &DatabaseWriter::archiveOpened);
+    writer.setGameArchive(&archive);
+    QTRY_COMPARE_WITH_TIMEOUT(opened.count(), 1, 5000);
+    QCOMPARE(opened.first().at(0).toBool(), true);
+    QVERIFY(archive.isOpen());
+
+    // Queued with the users' records and written in the same batch
+    ArchivedGame game;
+    game.playerX = "writer2";
+    game.playerO = "writer1";
+    game.result = GameLogic::GameResult::Draw;
+    writer.scheduleSave(users);
+    writer.scheduleGame(game);
+    writer.scheduleGame(game);
+    QCOMPARE(archive.count(), qint64(1));
+    QVERIFY(writer.flush());
+    QCOMPARE(writer.metrics().writesCompleted, qint64(1));
+    QCOMPARE(archive.count(), qint64(3));
+
+    const QVector<ArchivedGame> latest = archive.latest(0, 1);
+    QCOMPARE(latest.size(), 1);
+    QCOMPARE(latest.first().playerX, QString("writer2"));
+    QVERIFY(latest.first().playedAt > 0);
+
+    // Destroying the writer drains games still waiting
+    {
+        DatabaseWriter draining(dbPath);
+        draining.setCoalesceWindow(10000);
+        draining.setGameArchive(&archive);
+        draining.scheduleGame(game);
+    }
+    QCOMPARE(archive.count(), qint64(4));
+}
+
+void TestDatabaseWriter::testUsersLoadedOnWriterThread()
+{
+    // A journal long enough to be folded into the main file
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVERIFY(database.saveUsers(users));
+    QVector<User*> many;
+    for (int i = 0; i < 10000; ++i) {
+        many.append(new User(QString("loaded%1").arg(i), "hash"));
+    }
+    QVERIFY(database.appendUsers(many));
+    qDeleteAll(many);
+    QVERIFY(database.journalNeedsCompaction());
+
+    DatabaseWriter writer(dbPath);
+    QSignalSpy loaded(&writer, &DatabaseWriter::usersLoaded);
+    writer.scheduleLoad();
+    QVERIFY(loaded.wait(10000));
+    QVector<User*> taken = writer.takeLoadedUsers();
+    QCOMPARE(taken.size(), 10002);
+    QCOMPARE(winsOf(taken, "writer1"), 1);
+    QVERIFY(writer.takeLoadedUsers().isEmpty());
+    QVERIFY(!QFile::exists(database.journalPath()));
+
+    // The compacted file reads back the same
+    QVector<User*> reloaded = database.loadUsers();
+    QCOMPARE(reloaded.size(), taken.size());
+    qDeleteAll(reloaded);
+    qDeleteAll(taken);
+}
+
+void TestDatabaseWriter::testJournalCompactedDuringSession()
+{
+    Database database;
+    database.setDatabasePath(dbPath);
+    QVERIFY(database.saveUsers(users));
+
+    DatabaseWriter writer(dbPath);
+    QSignalSpy loaded(&writer, &DatabaseWriter::usersLoaded);
+    writer.scheduleLoad();
+    QVERIFY(loaded.wait(10000));
+    QVector<User*> taken = writer.takeLoadedUsers();
+    QCOMPARE(taken.size(), 2);
+    User* lazy = taken[0]->getUsername() == "writer1" ? taken[0] : taken[1];
+    QVERIFY(!lazy->isHistoryLoaded());
+
+    // Registrations pile up in the journal until it outgrows the main file
+    QVector<User*> many;
+    for (int i = 0; i < 10000; ++i) {
+        many.append(new User(QString("joined%1").arg(i), "hash"));
+    }
+    writer.scheduleSave(many);
+    QVERIFY(writer.flush());
+    qDeleteAll(many);
+
+    QCOMPARE(writer.metrics().journalCompactions, qint64(1));
+    QVERIFY(!QFile::exists(database.journalPath()));
+
+    // The history still on disk moved with its records
+    const QVector<GameRecord> history = lazy->getGameHistory();
+    QCOMPARE(history.size(), 1);
+    QCOMPARE(history[0].opponent(), QString("writer2"));
+
+    QVector<User*> reloaded = database.loadUsers();
+    QCOMPARE(reloaded.size(), 10002);
+    QCOMPARE(winsOf(reloaded, "writer1"), 1);
+    qDeleteAll(reloaded);
+    qDeleteAll(taken);
+}
+
+QTEST_MAIN(TestDatabaseWriter)
+#include "test_databasewriter.moc"
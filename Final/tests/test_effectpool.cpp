@@ -0,0 +1,182 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QApplication>
+#include <QGraphicsEffect>
+#include <QLineEdit>
+#include <QPainter>
+#include <QPushButton>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include "../include/effectpool.h"
+#include "../include/mainwindow.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// Runs offscreen under ctest (QT_QPA_PLATFORM=offscreen)
+class TestEffectPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testFadeReusesEffect();
+    void testGlowFramesCached();
+    void testIdleCpuPerScreen();
+
+private:
+    // Share of one core used while the screen sits idle
+    double idleCpu(const QString &screen);
+    QPushButton *button(QWidget *window, const QString &text);
+};
+
+// User plus system time of this process, in milliseconds
+static qint64 processCpuMs()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+         + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+void TestEffectPool::initTestCase()
+{
+    // Keeps the window's database away from the real one
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestEffectPool::testFadeReusesEffect()
+{
+    EffectPool pool;
+    QWidget widget;
+    widget.show();
+
+    pool.fadeOut(&widget, 50);
+    QGraphicsEffect *effect = widget.graphicsEffect();
+    QVERIFY(effect);
+    QVERIFY(effect->isEnabled());
+    QTRY_VERIFY(!widget.isVisible());
+    // Left installed but switched off, so the widget paints directly
+    QVERIFY(!effect->isEnabled());
+
+    pool.fadeIn(&widget, 50);
+    QVERIFY(widget.isVisible());
+    QTRY_VERIFY(!pool.isFading(&widget));
+    pool.fadeOut(&widget, 50);
+    // Interrupted straight away by an instant show
+    pool.fadeIn(&widget, 0);
+    QVERIFY(widget.isVisible());
+    QVERIFY(!pool.isFading(&widget));
+    QVERIFY(!effect->isEnabled());
+
+    QCOMPARE(widget.graphicsEffect(), effect);
+    QCOMPARE(pool.fadeCount(), 1);
+}
+
+void TestEffectPool::testGlowFramesCached()
+{
+    EffectPool pool;
+    const QColor from(0, 136, 255, 160);
+    const QColor to(0, 238, 255, 200);
+    const QVector<QPixmap> frames = pool.glowFrames(10, 12, from, to, 16);
+    QCOMPARE(frames.size(), 16);
+    QCOMPARE(frames.first().width(), EffectPool::glowMargin(10, 12) * 2 + 1);
+
+    const QVector<QPixmap> again = pool.glowFrames(10, 12, from, to, 16);
+    QCOMPARE(again.first().cacheKey(), frames.first().cacheKey());
+    QCOMPARE(pool.glowCount(), 1);
+
+    // Glow along the edge, nothing in the middle
+    const QImage image = frames.last().toImage();
+    const int middle = image.width() / 2;
+    QVERIFY(qAlpha(image.pixel(middle, 0)) > 0);
+    QCOMPARE(qAlpha(image.pixel(middle, middle)), 0);
+
+    // Drawn into a larger widget, the middle stays untouched
+    QImage target(200, 120, QImage::Format_ARGB32_Premultiplied);
+    target.fill(Qt::transparent);
+    QPainter painter(&target);
+    EffectPool::drawGlow(&painter, target.rect(), frames.last(), EffectPool::glowMargin(10, 12));
+    painter.end();
+    QVERIFY(qAlpha(target.pixel(100, 0)) > 0);
+    QVERIFY(qAlpha(target.pixel(0, 60)) > 0);
+    QCOMPARE(qAlpha(target.pixel(100, 60)), 0);
+}
+
+void TestEffectPool::testIdleCpuPerScreen()
+{
+    if (processCpuMs() < 0) {
+        QSKIP("Process CPU time is only measured on Unix");
+    }
+
+    MainWindow window;
+    window.resize(900, 700);
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    QVector<QPair<QString, double>> results;
+    results.append(qMakePair(QString("mode selection"), idleCpu("mode selection")));
+
+    QTRY_VERIFY(window.usersLoaded());
+    const QList<QLineEdit*> inputs = window.findChildren<QLineEdit*>();
+    inputs.at(0)->setText("idleuser");
+    inputs.at(1)->setText("secret");
+    // Registering again on a later run fails harmlessly
+    QTest::mouseClick(button(&window, "Register"), Qt::LeftButton);
+    QTest::mouseClick(button(&window, "Login"), Qt::LeftButton);
+
+    QTest::mouseClick(button(&window, "Player vs Player"), Qt::LeftButton);
+    results.append(qMakePair(QString("player auth"), idleCpu("player auth")));
+    QTest::mouseClick(button(&window, "Back"), Qt::LeftButton);
+
+    QTest::mouseClick(button(&window, "Player vs AI"), Qt::LeftButton);
+    results.append(qMakePair(QString("game"), idleCpu("game")));
+
+    QTest::mouseClick(button(&window, "Toggle Statistics View"), Qt::LeftButton);
+    results.append(qMakePair(QString("statistics"), idleCpu("statistics")));
+
+    ReplayDialog replay(&window);
+    replay.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&replay));
+    results.append(qMakePair(QString("replay"), idleCpu("replay")));
+    replay.hide();
+
+    // Nothing on any screen should keep a core busy while nobody is playing
+    for (const auto &result : results) {
+        QVERIFY2(result.second < 0.10, qPrintable(result.first));
+    }
+}
+
+double TestEffectPool::idleCpu(const QString &screen)
+{
+    // Let the loading overlay fade out first
+    QTest::qWait(1000);
+
+    QElapsedTimer wall;
+    wall.start();
+    const qint64 before = processCpuMs();
+    QTest::qWait(1000);
+    const double share = double(processCpuMs() - before) / qMax<qint64>(1, wall.elapsed());
+    qDebug() << "Idle CPU on" << screen << ":" << QString::number(share * 100.0, 'f', 1) << "%";
+    return share;
+}
+
+QPushButton *TestEffectPool::button(QWidget *window, const QString &text)
+{
+    for (QPushButton *candidate : window->findChildren<QPushButton*>()) {
+        if (candidate->text() == text) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+QTEST_MAIN(TestEffectPool)
+#include "test_effectpool.moc"
@@ -0,0 +1,231 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include "../include/gamearchive.h"
+#include "../include/database.h"
+#include "../include/movecodec.h"
+
+class TestGameArchive : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testAppendAndReopen();
+    void testPlayerTimeRange();
+    void testLatestPagination();
+    void testTornTail();
+    void testReadOnly();
+    void testReadsDuringAppends();
+    void testDatabaseSaveGame();
+};
+
+void TestGameArchive::testAppendAndReopen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tictactoe.json.games");
+    const quint64 moves = MoveCodec::pack({{4, 1}, {0, 2}, {8, 1}});
+
+    {
+        GameArchive archive(path);
+        QVERIFY(archive.append("alice", "AI", GameLogic::GameResult::XWins, "hard", moves, 1000));
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::Draw, QString(), 0, 2000));
+        QCOMPARE(archive.count(), qint64(2));
+    }
+
+    // Fixed-size records, nothing else in the file
+    QCOMPARE(QFileInfo(path).size(), qint64(2 * GameArchive::RECORD_SIZE));
+
+    GameArchive archive(path);
+    QCOMPARE(archive.count(), qint64(2));
+    QVector<ArchivedGame> games = archive.latest(0, 10);
+    QCOMPARE(games.size(), 2);
+    QCOMPARE(games[0].playerO, QString("bob"));
+    QCOMPARE(games[0].result, GameLogic::GameResult::Draw);
+    QVERIFY(games[0].difficulty.isEmpty());
+    QCOMPARE(games[1].id, qint64(0));
+    QCOMPARE(games[1].playedAt, qint64(1000));
+    QCOMPARE(games[1].playerX, QString("alice"));
+    QCOMPARE(games[1].playerO, QString("AI"));
+    QCOMPARE(games[1].result, GameLogic::GameResult::XWins);
+    QCOMPARE(games[1].difficulty, QString("hard"));
+    QCOMPARE(games[1].packedMoves, moves);
+}
+
+void TestGameArchive::testPlayerTimeRange()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+
+    // A game every 20 minutes over two days, alice plays every third one
+    const qint64 start = 1700000000000;
+    const qint64 step = 20 * 60 * 1000;
+    for (int i = 0; i < 144; ++i) {
+        const QString playerX = i % 3 == 0 ? "alice" : "carol";
+        QVERIFY(archive.append(playerX, "bob", GameLogic::GameResult::OWins, QString(), 0, start + i * step));
+    }
+
+    QCOMPARE(archive.countGamesOf("alice", start, start + 144 * step), 48);
+    QCOMPARE(archive.countGamesOf("bob", start, start + 144 * step), 144);
+    QCOMPARE(archive.countGamesOf("nobody", start, start + 144 * step), 0);
+
+    // Bounds that fall inside an hour bucket; from is inclusive, to exclusive
+    const qint64 from = start + 10 * step;
+    const qint64 to = start + 40 * step;
+    QCOMPARE(archive.countGamesOf("bob", from, to), 30);
+    QCOMPARE(archive.countGamesOf("alice", from, to), 10);
+
+    QVector<ArchivedGame> page = archive.gamesOf("alice", from, to, 0, 4);
+    QCOMPARE(page.size(), 4);
+    QCOMPARE(page[0].playedAt, start + 39 * step);
+    QCOMPARE(page[3].playedAt, start + 30 * step);
+
+    page = archive.gamesOf("alice", from, to, 8, 4);
+    QCOMPARE(page.size(), 2);
+    QCOMPARE(page[0].playedAt, start + 15 * step);
+    QCOMPARE(page[1].playedAt, start + 12 * step);
+
+    QVERIFY(archive.gamesOf("alice", from, to, 10, 4).isEmpty());
+    QVERIFY(archive.gamesOf("alice", to, from, 0, 4).isEmpty());
+}
+
+void TestGameArchive::testLatestPagination()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+
+    for (int i = 0; i < 25; ++i) {
+        QVERIFY(archive.append(QString("player%1").arg(i), "AI", GameLogic::GameResult::XWins, "easy", 0, i));
+    }
+    // A clock that went backwards still lands after the last game
+    QVERIFY(archive.append("late", "AI", GameLogic::GameResult::Draw, "easy", 0, 3));
+
+    QVector<ArchivedGame> page = archive.latest(0, 10);
+    QCOMPARE(page.size(), 10);
+    QCOMPARE(page[0].playerX, QString("late"));
+    QCOMPARE(page[0].playedAt, qint64(24));
+    QCOMPARE(page[1].playerX, QString("player24"));
+
+    page = archive.latest(20, 10);
+    QCOMPARE(page.size(), 6);
+    QCOMPARE(page.last().playerX, QString("player0"));
+}
+
+void TestGameArchive::testTornTail()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("archive.games");
+    {
+        GameArchive archive(path);
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins, QString(), 0, 1000));
+    }
+
+    // Half a record left by a crash
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(QByteArray(GameArchive::RECORD_SIZE / 2, '\x7f'));
+    file.close();
+
+    GameArchive archive(path);
+    QCOMPARE(archive.count(), qint64(1));
+    QVERIFY(archive.append("bob", "alice", GameLogic::GameResult::OWins, QString(), 0, 2000));
+    QCOMPARE(archive.countGamesOf("alice", 0, 3000), 2);
+    QCOMPARE(archive.latest(0, 1).first().playerX, QString("bob"));
+}
+
+void TestGameArchive::testReadOnly()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("archive.games");
+
+    // Nothing archived yet is an empty archive, and no files appear
+    {
+        GameArchive archive(path, GameArchive::Mode::ReadOnly);
+        QVERIFY(archive.open());
+        QCOMPARE(archive.count(), qint64(0));
+        QVERIFY(!archive.append("alice", "bob", GameLogic::GameResult::XWins));
+    }
+    QVERIFY(!QFile::exists(path));
+
+    {
+        GameArchive archive(path);
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins, QString(), 0, 1000));
+    }
+    // A record still being written by someone else
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(QByteArray(GameArchive::RECORD_SIZE / 2, '\x7f'));
+    file.close();
+    const qint64 size = file.size();
+
+    GameArchive archive(path, GameArchive::Mode::ReadOnly);
+    QCOMPARE(archive.count(), qint64(1));
+    QCOMPARE(archive.latest(0, 1).first().playerX, QString("alice"));
+    QVERIFY(!archive.append("bob", "alice", GameLogic::GameResult::OWins));
+    QCOMPARE(QFileInfo(path).size(), size);
+}
+
+void TestGameArchive::testReadsDuringAppends()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins, QString(), 0, 0));
+
+    // The GUI reads while DatabaseWriter's thread appends
+    const int appended = 2000;
+    QThreadPool pool;
+    pool.start([&]() {
+        for (int i = 1; i <= appended; ++i) {
+            archive.append(QString("player%1").arg(i % 50), "AI", GameLogic::GameResult::OWins, "easy", 0, i);
+        }
+    });
+    qint64 seen = 0;
+    while (seen < appended + 1) {
+        QVERIFY(archive.isOpen());
+        const qint64 count = archive.count();
+        QVERIFY(count >= seen);
+        seen = count;
+        // Never a record past the count, or one that is not written yet
+        const QVector<ArchivedGame> newest = archive.latest(0, 1);
+        QCOMPARE(newest.size(), 1);
+        QVERIFY(newest.first().id >= count - 1);
+        QVERIFY(!newest.first().playerX.isEmpty());
+        QCOMPARE(newest.first().playedAt, newest.first().id);
+    }
+    pool.waitForDone();
+    QCOMPARE(archive.count(), qint64(appended + 1));
+    QCOMPARE(archive.countGamesOf("player7", 0, appended + 1), appended / 50);
+    QCOMPARE(archive.ratingParameters().initialRating, RatingEngine::Parameters().initialRating);
+}
+
+void TestGameArchive::testDatabaseSaveGame()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database database;
+    database.setDatabasePath(dir.filePath("tictactoe.json"));
+
+    QVERIFY(database.saveGame("alice", "bob", "X wins"));
+    QVERIFY(database.saveGame("alice", "AI", GameLogic::GameResult::OWins, "expert"));
+    QVERIFY(!database.saveGame("alice", "bob", "nobody knows"));
+    QVERIFY(!database.saveGame("alice", "bob", GameLogic::GameResult::InProgress));
+
+    GameArchive *archive = database.gameArchive();
+    QCOMPARE(archive->path(), dir.filePath("tictactoe.json.games"));
+    QCOMPARE(archive->count(), qint64(2));
+    QCOMPARE(archive->latest(0, 1).first().difficulty, QString("expert"));
+    QCOMPARE(archive->latest(1, 1).first().result, GameLogic::GameResult::XWins);
+}
+
+QTEST_MAIN(TestGameArchive)
+#include "test_gamearchive.moc"
@@ -0,0 +1,326 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QDebug>
+#include "loadclient.h"
+#include "../include/database.h"
+#include "../include/gameclient.h"
+#include "../include/gamearchive.h"
+#include "../include/gameprotocol.h"
+#include "../include/gameserver.h"
+#include "../include/movecodec.h"
+
+// Games played through a GameServer on localhost.
+//
+// The load test runs 1000 simultaneous games by default so ctest stays quick.
+// Set TICTACTOE_LOAD_GAMES=10000 for the full run.
+class TestGameServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testProtocolFrames();
+    void testMoveCodecAppend();
+    void testGameIsPersisted();
+    void testIllegalMovesRejected();
+    void testSessionsReused();
+    void testDisconnectLeavesOtherGames();
+    void testLoad();
+
+private:
+    static int loadGames();
+};
+
+int TestGameServer::loadGames()
+{
+    bool ok = false;
+    const int games = qEnvironmentVariableIntValue("TICTACTOE_LOAD_GAMES", &ok);
+    return ok ? games : 1000;
+}
+
+void TestGameServer::initTestCase()
+{
+    // For the spies on GameClient's signals
+    qRegisterMetaType<GameLogic::Player>();
+    qRegisterMetaType<GameLogic::GameResult>();
+}
+
+void TestGameServer::testProtocolFrames()
+{
+    QByteArray stream;
+    GameProtocol::append(stream, GameProtocol::FrameType::Move, 0x01000005, 4);
+    QCOMPARE(stream.size(), GameProtocol::HEADER_SIZE);
+    GameProtocol::append(stream, GameProtocol::FrameType::Open, 0, 0,
+                         GameProtocol::encodePlayers("alice", "bob"));
+
+    // Nothing comes out of a partial frame
+    int offset = 0;
+    bool error = false;
+    GameProtocol::Frame frame;
+    QVERIFY(!GameProtocol::take(stream.left(5), &offset, &frame, &error));
+    QVERIFY(!error);
+    QCOMPARE(offset, 0);
+
+    QVERIFY(GameProtocol::take(stream, &offset, &frame, &error));
+    QCOMPARE(frame.type, GameProtocol::FrameType::Move);
+    QCOMPARE(frame.session, quint32(0x01000005));
+    QCOMPARE(int(frame.argument), 4);
+
+    QVERIFY(!GameProtocol::take(stream.left(stream.size() - 1), &offset, &frame, &error));
+    QVERIFY(!error);
+    QVERIFY(GameProtocol::take(stream, &offset, &frame, &error));
+    QCOMPARE(frame.type, GameProtocol::FrameType::Open);
+    QCOMPARE(offset, stream.size());
+    QString playerX;
+    QString playerO;
+    QVERIFY(GameProtocol::decodePlayers(frame.payload, &playerX, &playerO));
+    QCOMPARE(playerX, QString("alice"));
+    QCOMPARE(playerO, QString("bob"));
+
+    // An unknown type can never become a frame
+    offset = 0;
+    QVERIFY(!GameProtocol::take(QByteArray(8, char(0x7F)), &offset, &frame, &error));
+    QVERIFY(error);
+}
+
+void TestGameServer::testMoveCodecAppend()
+{
+    quint64 packed = 0;
+    packed = MoveCodec::append(packed, 4, 1);
+    packed = MoveCodec::append(packed, 0, 2);
+    packed = MoveCodec::append(packed, 8, 1);
+    QCOMPARE(packed, MoveCodec::pack({{4, 1}, {0, 2}, {8, 1}}));
+
+    QCOMPARE(MoveCodec::append(0, 3, 2), MoveCodec::pack({{3, 2}}));
+}
+
+void TestGameServer::testGameIsPersisted()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database database;
+    database.setDatabasePath(dir.filePath("tictactoe.json"));
+
+    GameServer server(&database);
+    QVERIFY(server.listen());
+
+    GameClient client;
+    QSignalSpy connected(&client, &GameClient::connected);
+    QSignalSpy opened(&client, &GameClient::gameOpened);
+    QSignalSpy moved(&client, &GameClient::moved);
+    QSignalSpy over(&client, &GameClient::gameOver);
+    client.connectToServer("127.0.0.1", server.port());
+    QVERIFY(connected.wait());
+
+    client.openGame("alice", "bob");
+    QVERIFY(opened.wait());
+    const quint32 session = opened.at(0).at(0).toUInt();
+    QVERIFY(session != 0);
+
+    // X takes the top row
+    const int cells[] = {0, 3, 1, 4, 2};
+    for (int cell : cells) {
+        client.sendMove(session, cell);
+    }
+    QTRY_COMPARE(over.count(), 1);
+    QCOMPARE(moved.count(), 5);
+    QCOMPARE(moved.at(1).at(1).toInt(), 3);
+    QCOMPARE(moved.at(1).at(2).value<GameLogic::Player>(), GameLogic::Player::O);
+    QCOMPARE(over.at(0).at(1).value<GameLogic::GameResult>(), GameLogic::GameResult::XWins);
+
+    server.persistFinishedGames();
+    QCOMPARE(server.metrics().gamesPersisted, qint64(1));
+    const QVector<ArchivedGame> games = database.gameArchive()->latest(0, 10);
+    QCOMPARE(games.size(), 1);
+    QCOMPARE(games[0].playerX, QString("alice"));
+    QCOMPARE(games[0].playerO, QString("bob"));
+    QCOMPARE(games[0].result, GameLogic::GameResult::XWins);
+    QCOMPARE(games[0].packedMoves, MoveCodec::pack({{0, 1}, {3, 2}, {1, 1}, {4, 2}, {2, 1}}));
+}
+
+void TestGameServer::testIllegalMovesRejected()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient client;
+    QSignalSpy connected(&client, &GameClient::connected);
+    QSignalSpy opened(&client, &GameClient::gameOpened);
+    QSignalSpy rejected(&client, &GameClient::moveRejected);
+    client.connectToServer("127.0.0.1", server.port());
+    QVERIFY(connected.wait());
+    client.openGame("alice", "bob");
+    QVERIFY(opened.wait());
+    const quint32 session = opened.at(0).at(0).toUInt();
+
+    client.sendMove(session, 4);
+    client.sendMove(session, 4);        // Taken
+    client.sendMove(session, 9);        // Off the board
+    client.sendMove(session + 1, 0);    // No such game
+    QTRY_COMPARE(rejected.count(), 3);
+    QCOMPARE(rejected.at(0).at(1).toInt(), 4);
+    QCOMPARE(server.metrics().movesPlayed, qint64(1));
+    QCOMPARE(server.metrics().movesRejected, qint64(3));
+
+    // Another client cannot play in this game
+    GameClient intruder;
+    QSignalSpy intruderConnected(&intruder, &GameClient::connected);
+    QSignalSpy intruderRejected(&intruder, &GameClient::moveRejected);
+    intruder.connectToServer("127.0.0.1", server.port());
+    QVERIFY(intruderConnected.wait());
+    intruder.sendMove(session, 0);
+    QVERIFY(intruderRejected.wait());
+
+    // Nobody plays as the computer
+    client.openGame("alice", GameArchive::COMPUTER_PLAYER);
+    QVERIFY(opened.wait());
+    QCOMPARE(opened.at(1).at(0).toUInt(), 0u);
+
+    // Leaving abandons the game
+    client.disconnectFromServer();
+    QTRY_COMPARE(server.metrics().activeSessions, 0);
+}
+
+void TestGameServer::testDisconnectLeavesOtherGames()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient leaving;
+    GameClient staying;
+    QSignalSpy leavingConnected(&leaving, &GameClient::connected);
+    QSignalSpy stayingConnected(&staying, &GameClient::connected);
+    QSignalSpy leavingOpened(&leaving, &GameClient::gameOpened);
+    QSignalSpy stayingOpened(&staying, &GameClient::gameOpened);
+    QSignalSpy stayingMoved(&staying, &GameClient::moved);
+    leaving.connectToServer("127.0.0.1", server.port());
+    staying.connectToServer("127.0.0.1", server.port());
+    QVERIFY(leavingConnected.wait());
+    QTRY_COMPARE(stayingConnected.count(), 1);
+
+    // Interleaved, so the two clients' games sit side by side in the pool
+    for (int game = 0; game < 5; ++game) {
+        leaving.openGame("alice", "bob");
+        staying.openGame("carol", "dave");
+    }
+    QTRY_COMPARE(leavingOpened.count(), 5);
+    QTRY_COMPARE(stayingOpened.count(), 5);
+    // One of them ends normally first
+    const quint32 finished = leavingOpened.at(2).at(0).toUInt();
+    for (int cell : {0, 3, 1, 4, 2}) {
+        leaving.sendMove(finished, cell);
+    }
+    QTRY_COMPARE(server.metrics().gamesFinished, qint64(1));
+    QCOMPARE(server.metrics().activeSessions, 9);
+
+    leaving.disconnectFromServer();
+    QTRY_COMPARE(server.metrics().activeSessions, 5);
+
+    // The other client's games carry on
+    for (const QList<QVariant> &opened : stayingOpened) {
+        staying.sendMove(opened.at(0).toUInt(), 4);
+    }
+    QTRY_COMPARE(stayingMoved.count(), 5);
+    staying.disconnectFromServer();
+    QTRY_COMPARE(server.metrics().activeSessions, 0);
+}
+
+void TestGameServer::testSessionsReused()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient client;
+    QSignalSpy connected(&client, &GameClient::connected);
+    QSignalSpy opened(&client, &GameClient::gameOpened);
+    QSignalSpy over(&client, &GameClient::gameOver);
+    QSignalSpy rejected(&client, &GameClient::moveRejected);
+    client.connectToServer("127.0.0.1", server.port());
+    QVERIFY(connected.wait());
+
+    // Games played one after another keep landing in the same slot
+    QVector<quint32> sessions;
+    for (int game = 0; game < 3; ++game) {
+        client.openGame("alice", "bob");
+        QTRY_COMPARE(opened.count(), game + 1);
+        const quint32 session = opened.at(game).at(0).toUInt();
+        sessions.append(session);
+        const int cells[] = {0, 3, 1, 4, 2};
+        for (int cell : cells) {
+            client.sendMove(session, cell);
+        }
+        QTRY_COMPARE(over.count(), game + 1);
+    }
+    QCOMPARE(server.metrics().activeSessions, 0);
+    QCOMPARE(server.metrics().pooledSessions, 1024);
+    QCOMPARE(sessions[1] & 0xFFFFFF, sessions[0] & 0xFFFFFF);
+    QVERIFY(sessions[1] != sessions[0]);
+
+    // A move for a game that has ended does not reach its slot's new game
+    client.openGame("alice", "bob");
+    QTRY_COMPARE(opened.count(), 4);
+    client.sendMove(sessions[0], 5);
+    QVERIFY(rejected.wait());
+    QCOMPARE(server.metrics().movesRejected, qint64(1));
+    QCOMPARE(server.metrics().activeSessions, 1);
+}
+
+void TestGameServer::testLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database database;
+    database.setDatabasePath(dir.filePath("tictactoe.json"));
+
+    // The server gets a thread of its own, as it would in its own process
+    QThread serverThread;
+    QObject context;
+    context.moveToThread(&serverThread);
+    serverThread.start();
+    GameServer *server = nullptr;
+    quint16 port = 0;
+    QMetaObject::invokeMethod(&context, [&]() {
+        server = new GameServer(&database);
+        if (server->listen()) {
+            port = server->port();
+        }
+    }, Qt::BlockingQueuedConnection);
+    QVERIFY(port != 0);
+
+    LoadClient::Options options;
+    options.port = port;
+    options.games = loadGames();
+    LoadClient client(options);
+    const LoadClient::Report report = client.run();
+
+    GameServer::Metrics metrics;
+    QMetaObject::invokeMethod(&context, [&]() {
+        server->persistFinishedGames();
+        metrics = server->metrics();
+        delete server;
+    }, Qt::BlockingQueuedConnection);
+    serverThread.quit();
+    serverThread.wait();
+
+    qDebug() << "Load:" << report.gamesFinished << "games," << report.moves << "moves in"
+             << report.elapsedMs << "ms," << qRound(report.movesPerSecond) << "moves/s";
+    qDebug() << "Move round trip (us): p50" << report.p50Us << "p99" << report.p99Us
+             << "p99.9" << report.p999Us << "max" << report.maxUs;
+    qDebug() << "Session slots allocated:" << metrics.pooledSessions;
+
+    QCOMPARE(report.gamesFinished, options.games);
+    QCOMPARE(report.rejected, qint64(0));
+    QCOMPARE(metrics.gamesFinished, qint64(options.games));
+    QCOMPARE(metrics.movesPlayed, report.moves);
+    QCOMPARE(metrics.gamesPersisted, qint64(options.games));
+    QCOMPARE(metrics.activeSessions, 0);
+    QCOMPARE(database.gameArchive()->count(), qint64(options.games));
+}
+
+QTEST_MAIN(TestGameServer)
+#include "test_gameserver.moc"
@@ -0,0 +1,103 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QTemporaryDir>
+#include "../include/headtohead.h"
+#include "../include/gamearchive.h"
+
+class TestHeadToHead : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testBothPointsOfView();
+    void testTopRivals();
+    void testArchivePersistence();
+};
+
+void TestHeadToHead::testBothPointsOfView()
+{
+    HeadToHead table;
+    table.record(7, 3, GameLogic::GameResult::XWins);
+    table.record(3, 7, GameLogic::GameResult::XWins);
+    table.record(3, 7, GameLogic::GameResult::OWins);
+    table.record(7, 3, GameLogic::GameResult::Draw);
+    table.record(7, 7, GameLogic::GameResult::XWins); // Nobody plays themselves
+
+    QCOMPARE(table.pairCount(), 1);
+    HeadToHeadStats seven = table.stats(7, 3);
+    QCOMPARE(seven.wins, 2);
+    QCOMPARE(seven.losses, 1);
+    QCOMPARE(seven.draws, 1);
+    HeadToHeadStats three = table.stats(3, 7);
+    QCOMPARE(three.wins, 1);
+    QCOMPARE(three.losses, 2);
+    QCOMPARE(three.games(), 4);
+    QCOMPARE(table.stats(3, 9).games(), 0);
+}
+
+void TestHeadToHead::testTopRivals()
+{
+    HeadToHead table(3);
+    // Player 0 meets rival r exactly r times
+    for (quint32 rival = 1; rival <= 6; ++rival) {
+        for (quint32 game = 0; game < rival; ++game) {
+            table.record(0, rival, GameLogic::GameResult::OWins);
+        }
+    }
+
+    auto rivals = table.topRivals(0);
+    QCOMPARE(rivals.size(), 3);
+    QCOMPARE(rivals[0].first, quint32(6));
+    QCOMPARE(rivals[1].first, quint32(5));
+    QCOMPARE(rivals[2].first, quint32(4));
+    QCOMPARE(rivals[0].second.losses, 6);
+
+    // A rival that catches up pushes the least played one out
+    for (int game = 0; game < 5; ++game) {
+        table.record(1, 0, GameLogic::GameResult::XWins);
+    }
+    rivals = table.topRivals(0);
+    QCOMPARE(rivals.size(), 3);
+    QCOMPARE(rivals[0].first, quint32(1));
+    QCOMPARE(rivals[0].second.games(), 6);
+    QCOMPARE(rivals[1].first, quint32(6));
+    QCOMPARE(rivals[2].first, quint32(5));
+
+    QCOMPARE(table.topRivals(1).first().first, quint32(0));
+    QVERIFY(table.topRivals(42).isEmpty());
+}
+
+void TestHeadToHead::testArchivePersistence()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tictactoe.json.games");
+    {
+        GameArchive archive(path);
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins));
+        QVERIFY(archive.append("bob", "alice", GameLogic::GameResult::XWins));
+        QVERIFY(archive.append("carol", "alice", GameLogic::GameResult::Draw));
+        // Games against the AI are not head-to-head games
+        QVERIFY(archive.append("alice", "AI", GameLogic::GameResult::XWins, "hard"));
+        QCOMPARE(archive.headToHead("alice", "bob").games(), 2);
+    }
+
+    // Rebuilt from the archive on open
+    GameArchive archive(path);
+    HeadToHeadStats stats = archive.headToHead("alice", "bob");
+    QCOMPARE(stats.wins, 1);
+    QCOMPARE(stats.losses, 1);
+    QCOMPARE(archive.headToHead("alice", "carol").draws, 1);
+    QCOMPARE(archive.headToHead("alice", "AI").games(), 0);
+    QCOMPARE(archive.headToHead("alice", "nobody").games(), 0);
+
+    QVector<Rival> rivals = archive.topRivals("alice");
+    QCOMPARE(rivals.size(), 2);
+    QCOMPARE(rivals[0].opponent, QString("bob"));
+    QCOMPARE(rivals[1].opponent, QString("carol"));
+}
+
+QTEST_MAIN(TestHeadToHead)
+#include "test_headtohead.moc"
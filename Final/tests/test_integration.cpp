@@ -145,7 +145,7 @@ void TestIntegration::testGameCompletionToHistory()
     // 5. Verify game is in history
     QVector<GameRecord> history = user->getGameHistory();
     QVERIFY(!history.isEmpty());
-    QVERIFY(history[0].result.contains("Win"));
+    QVERIFY(history[0].result().contains("Win"));
 }
 
 void TestIntegration::testAIIntegration()
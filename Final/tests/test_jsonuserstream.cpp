@@ -0,0 +1,230 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QBuffer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include "../include/jsonuserstream.h"
+#include "../include/database.h"
+#include "../include/user.h"
+
+class TestJsonUserStream : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTripAcrossChunks();
+    void testAwkwardStrings();
+    void testSkipHistory();
+    void testIndentedLegacyFile();
+    void testEmptyArray();
+    void testTruncatedFile();
+    void testGarbageBetweenRecords();
+};
+
+void TestJsonUserStream::testRoundTripAcrossChunks()
+{
+    // Enough users to span several read chunks
+    QByteArray data;
+    QBuffer out(&data);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    JsonUserWriter writer(&out);
+    QVERIFY(writer.begin());
+    const int userCount = 5000;
+    for (int i = 0; i < userCount; ++i) {
+        User user(QString("streamUser%1").arg(i), "hash");
+        for (int j = 0; j < i % 5 + 1; ++j) {
+            user.addGameWithMoves("win", "ai", {{4, 1}, {0, 2}, {8, 1}}, "hard");
+        }
+        QVERIFY(writer.write(user));
+    }
+    QVERIFY(writer.finish());
+    out.close();
+    QVERIFY(data.size() > 1024 * 1024);
+
+    // The output is still one valid JSON array
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    QCOMPARE(parseError.error, QJsonParseError::NoError);
+    QCOMPARE(doc.array().size(), userCount);
+
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    int count = 0;
+    while (reader.readNext(&userObj)) {
+        User* user = Database::deserializeUser(userObj);
+        QCOMPARE(user->getUsername(), QString("streamUser%1").arg(count));
+        QCOMPARE(user->getWins(), count % 5 + 1);
+        delete user;
+        count++;
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QCOMPARE(count, userCount);
+    QCOMPARE(reader.recordsRead(), qint64(userCount));
+
+    // Skipping histories across the same chunk boundaries
+    QBuffer counters(&data);
+    QVERIFY(counters.open(QIODevice::ReadOnly));
+    JsonUserReader skipping(&counters);
+    skipping.setSkipHistory(true);
+    count = 0;
+    while (skipping.readNext(&userObj)) {
+        QVERIFY(!userObj.contains("gameHistory"));
+        QCOMPARE(userObj["history"].toInt(), count % 5 + 1);
+        QCOMPARE(userObj["username"].toString(), QString("streamUser%1").arg(count));
+        QCOMPARE(userObj["stats"].toObject()["wins"].toInt(), count % 5 + 1);
+        count++;
+    }
+    QVERIFY2(!skipping.hasError(), qPrintable(skipping.errorString()));
+    QCOMPARE(count, userCount);
+}
+
+void TestJsonUserStream::testAwkwardStrings()
+{
+    // Braces, brackets, quotes and escapes inside strings must not confuse the scanner
+    const QString names[] = {"brace{name}", "bracket[]", "quote\"name", "back\\slash\\", "unié中"};
+
+    QByteArray data;
+    QBuffer out(&data);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    JsonUserWriter writer(&out);
+    QVERIFY(writer.begin());
+    for (const QString &name : names) {
+        User user(name, "hash");
+        user.addGame("loss", "}{\"]");
+        QVERIFY(writer.write(user));
+    }
+    QVERIFY(writer.finish());
+    out.close();
+
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    int index = 0;
+    while (reader.readNext(&userObj)) {
+        QCOMPARE(userObj["username"].toString(), names[index]);
+        index++;
+    }
+    QVERIFY(!reader.hasError());
+    QCOMPARE(index, 5);
+}
+
+void TestJsonUserStream::testSkipHistory()
+{
+    // Names that spell out the history section must not be taken for it
+    const QString trap = ",\"gameHistory\":[";
+    QByteArray data;
+    QBuffer out(&data);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    JsonUserWriter writer(&out);
+    QVERIFY(writer.begin());
+    User first("a" + trap, "hash");
+    first.addGame("win", trap);
+    first.addGame("loss", "bob");
+    User second("nohistory", "hash");
+    User third("last", "hash");
+    third.addGame("draw", "a" + trap);
+    for (const User *user : {&first, &second, &third}) {
+        QVERIFY(writer.write(*user));
+    }
+    QVERIFY(writer.finish());
+    out.close();
+
+    // The history is the last thing in each record
+    const QByteArray record = Database::serializeRecord(first);
+    QVERIFY(record.lastIndexOf(Database::HISTORY_SECTION) > record.lastIndexOf("\"stats\""));
+    QVERIFY(!Database::withoutHistory(record).contains("gameHistory\":[{"));
+    QCOMPARE(QJsonDocument::fromJson(Database::withoutHistory(record)).object()["username"].toString(),
+             first.getUsername());
+
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    reader.setSkipHistory(true);
+    QJsonObject userObj;
+    QVERIFY(reader.readNext(&userObj));
+    QCOMPARE(userObj["username"].toString(), first.getUsername());
+    QCOMPARE(userObj["history"].toInt(), 2);
+    QVERIFY(!userObj.contains("gameHistory"));
+    QVERIFY(reader.readNext(&userObj));
+    QCOMPARE(userObj["history"].toInt(), 0);
+    QVERIFY(reader.readNext(&userObj));
+    QCOMPARE(userObj["username"].toString(), QString("last"));
+    QCOMPARE(userObj["stats"].toObject()["draws"].toInt(), 1);
+    QVERIFY(!reader.readNext(&userObj));
+    QVERIFY(!reader.hasError());
+
+    // Read whole, the history is all there
+    QVERIFY(in.seek(0));
+    JsonUserReader whole(&in);
+    QVERIFY(whole.readNext(&userObj));
+    User* user = Database::deserializeUser(userObj);
+    QCOMPARE(user->getGameHistory().size(), 2);
+    QCOMPARE(user->getGameHistory().last().result(), "Win vs " + trap);
+    delete user;
+}
+
+void TestJsonUserStream::testIndentedLegacyFile()
+{
+    // Files written by older versions are one indented document
+    QJsonArray usersArray;
+    User first("legacy1", "hash");
+    first.addGame("win", "legacy2");
+    User second("legacy2", "hash");
+    usersArray.append(Database::serializeUser(first));
+    usersArray.append(Database::serializeUser(second));
+    QByteArray data = QJsonDocument(usersArray).toJson(QJsonDocument::Indented);
+
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    QVERIFY(reader.readNext(&userObj));
+    QCOMPARE(userObj["username"].toString(), QString("legacy1"));
+    QVERIFY(reader.readNext(&userObj));
+    QCOMPARE(userObj["username"].toString(), QString("legacy2"));
+    QVERIFY(!reader.readNext(&userObj));
+    QVERIFY(!reader.hasError());
+}
+
+void TestJsonUserStream::testEmptyArray()
+{
+    QByteArray data(" [ \n ] \n");
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    QVERIFY(!reader.readNext(&userObj));
+    QVERIFY(!reader.hasError());
+}
+
+void TestJsonUserStream::testTruncatedFile()
+{
+    QByteArray data("[\n{\"username\":\"whole\"},\n{\"username\":\"cut");
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    QVERIFY(reader.readNext(&userObj));
+    QVERIFY(!reader.readNext(&userObj));
+    QVERIFY(reader.hasError());
+}
+
+void TestJsonUserStream::testGarbageBetweenRecords()
+{
+    QByteArray data("[{\"username\":\"a\"} x {\"username\":\"b\"}]");
+    QBuffer in(&data);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    JsonUserReader reader(&in);
+    QJsonObject userObj;
+    QVERIFY(reader.readNext(&userObj));
+    QVERIFY(!reader.readNext(&userObj));
+    QVERIFY(reader.hasError());
+}
+
+QTEST_MAIN(TestJsonUserStream)
+#include "test_jsonuserstream.moc"
@@ -0,0 +1,368 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QSignalSpy>
+#include <QDebug>
+#include <QFile>
+#include <QTemporaryDir>
+#include "matchsimulator.h"
+#include "../include/authentication.h"
+#include "../include/database.h"
+#include "../include/gameclient.h"
+#include "../include/gameserver.h"
+#include "../include/matchmaker.h"
+
+// Rating-bucketed pairing, on its own, through the server and under a
+// simulated stream of players.
+//
+// The simulation runs 100000 events by default so ctest stays quick.
+// Set TICTACTOE_MATCH_EVENTS=1000000 for the full run.
+class TestMatchmaker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testImmediatePairing();
+    void testOutsideWindowWaits();
+    void testWindowWidensWithPoll();
+    void testClosestRatingPreferred();
+    void testTiesGoToLongestWait();
+    void testCancel();
+    void testDuplicateEnqueue();
+    void testNegativeRatings();
+    void testBucketQueue();
+    void testServerQueue();
+    void testServerRefusesBadLogin();
+    void testServerReadsAccountsOnly();
+    void testSimulation();
+    void testDenseClusterSimulation();
+
+private:
+    static int simulationEvents();
+};
+
+int TestMatchmaker::simulationEvents()
+{
+    bool ok = false;
+    const int events = qEnvironmentVariableIntValue("TICTACTOE_MATCH_EVENTS", &ok);
+    return ok ? events : 100000;
+}
+
+void TestMatchmaker::initTestCase()
+{
+    qRegisterMetaType<GameLogic::Player>();
+}
+
+void TestMatchmaker::testImmediatePairing()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    QVERIFY(!matchmaker.enqueue(1, 1200, 0, &match));
+    QVERIFY(matchmaker.isWaiting(1));
+
+    QVERIFY(matchmaker.enqueue(2, 1240, 500, &match));
+    QCOMPARE(match.first, quint32(1));
+    QCOMPARE(match.second, quint32(2));
+    QCOMPARE(match.firstWaitMs, qint64(500));
+    QCOMPARE(match.secondWaitMs, qint64(0));
+    QCOMPARE(match.ratingGap, 40);
+    QCOMPARE(matchmaker.waitingCount(), 0);
+}
+
+void TestMatchmaker::testOutsideWindowWaits()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    QVERIFY(!matchmaker.enqueue(1, 1200, 0, &match));
+    QVERIFY(!matchmaker.enqueue(2, 1300, 0, &match));
+    QCOMPARE(matchmaker.waitingCount(), 2);
+    QVERIFY(matchmaker.poll(0).isEmpty());
+}
+
+void TestMatchmaker::testWindowWidensWithPoll()
+{
+    Matchmaker matchmaker;
+    QCOMPARE(matchmaker.window(0), 50);
+    QCOMPARE(matchmaker.window(1000), 100);
+    QCOMPARE(matchmaker.window(60000), matchmaker.options().maxWindow);
+
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, 1200, 0, &match);
+    matchmaker.enqueue(2, 1300, 0, &match);
+    QVERIFY(matchmaker.poll(500).isEmpty());
+    const QVector<Matchmaker::Match> matches = matchmaker.poll(1000);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].ratingGap, 100);
+    QCOMPARE(matchmaker.waitingCount(), 0);
+
+    // Never beyond maxWindow, however long they wait
+    matchmaker.enqueue(3, 1000, 0, &match);
+    matchmaker.enqueue(4, 1500, 0, &match);
+    QVERIFY(matchmaker.poll(3600000).isEmpty());
+}
+
+void TestMatchmaker::testClosestRatingPreferred()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, 1160, 0, &match);
+    matchmaker.enqueue(2, 1290, 0, &match);
+    matchmaker.enqueue(3, 1230, 10, &match);
+    // 1230 could reach either after a while; 1210 is 20 from 1230 and 50 from 1160
+    QVERIFY(matchmaker.enqueue(4, 1210, 20, &match));
+    QCOMPARE(match.first, quint32(3));
+    QCOMPARE(match.second, quint32(4));
+}
+
+void TestMatchmaker::testTiesGoToLongestWait()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, 1170, 0, &match);
+    matchmaker.enqueue(2, 1230, 100, &match);
+    QVERIFY(matchmaker.enqueue(3, 1200, 200, &match));
+    QCOMPARE(match.first, quint32(1));
+    QVERIFY(matchmaker.isWaiting(2));
+}
+
+void TestMatchmaker::testCancel()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, 1200, 0, &match);
+    QVERIFY(matchmaker.cancel(1));
+    QVERIFY(!matchmaker.cancel(1));
+    QCOMPARE(matchmaker.waitingCount(), 0);
+    QVERIFY(!matchmaker.enqueue(2, 1200, 0, &match));
+}
+
+void TestMatchmaker::testDuplicateEnqueue()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, 1200, 0, &match);
+    // Cannot be paired with themselves
+    QVERIFY(!matchmaker.enqueue(1, 1200, 100, &match));
+    QCOMPARE(matchmaker.waitingCount(), 1);
+}
+
+void TestMatchmaker::testNegativeRatings()
+{
+    Matchmaker matchmaker;
+    Matchmaker::Match match;
+    matchmaker.enqueue(1, -10, 0, &match);
+    QVERIFY(matchmaker.enqueue(2, 20, 0, &match));
+    QCOMPARE(match.ratingGap, 30);
+}
+
+void TestMatchmaker::testBucketQueue()
+{
+    Matchmaker::Options options;
+    options.initialWindow = 10;
+    Matchmaker matchmaker(options);
+    Matchmaker::Match match;
+    // One bucket, too far apart to pair straight away
+    QVERIFY(!matchmaker.enqueue(1, 1200, 0, &match));
+    QVERIFY(!matchmaker.enqueue(2, 1215, 0, &match));
+    QVERIFY(!matchmaker.enqueue(3, 1224, 0, &match));
+    QVERIFY(matchmaker.cancel(2));
+    QCOMPARE(matchmaker.waitingCount(), 2);
+
+    // Only the front of the bucket is looked at, and 1224 is beyond its reach
+    QVERIFY(!matchmaker.enqueue(4, 1222, 0, &match));
+
+    // Once the windows widen, the front takes the next in line
+    const QVector<Matchmaker::Match> matches = matchmaker.poll(1000);
+    QCOMPARE(matches.size(), 1);
+    QCOMPARE(matches[0].first, quint32(1));
+    QCOMPARE(matches[0].second, quint32(3));
+    QVERIFY(matchmaker.isWaiting(4));
+
+    QVERIFY(matchmaker.cancel(4));
+    QCOMPARE(matchmaker.waitingCount(), 0);
+    QVERIFY(!matchmaker.enqueue(5, 1200, 2000, &match));
+    QVERIFY(matchmaker.enqueue(6, 1210, 2000, &match));
+    QCOMPARE(match.first, quint32(5));
+}
+
+void TestMatchmaker::testServerQueue()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient alice;
+    GameClient bob;
+    QSignalSpy aliceConnected(&alice, &GameClient::connected);
+    QSignalSpy bobConnected(&bob, &GameClient::connected);
+    QSignalSpy aliceMatched(&alice, &GameClient::matchFound);
+    QSignalSpy bobMatched(&bob, &GameClient::matchFound);
+    QSignalSpy bobMoved(&bob, &GameClient::moved);
+    QSignalSpy aliceRejected(&alice, &GameClient::moveRejected);
+    alice.connectToServer("127.0.0.1", server.port());
+    bob.connectToServer("127.0.0.1", server.port());
+    QVERIFY(aliceConnected.wait());
+    QTRY_COMPARE(bobConnected.count(), 1);
+
+    alice.queueForMatch("alice", "secret");
+    QTRY_COMPARE(server.metrics().playersWaiting, 1);
+    // Queueing twice under one name is refused
+    alice.queueForMatch("alice", "secret");
+    QVERIFY(aliceMatched.wait());
+    QCOMPARE(aliceMatched.at(0).at(0).toUInt(), quint32(0));
+
+    bob.queueForMatch("bob", "secret");
+    QTRY_COMPARE(bobMatched.count(), 1);
+    QTRY_COMPARE(aliceMatched.count(), 2);
+    const quint32 session = aliceMatched.at(1).at(0).toUInt();
+    QVERIFY(session != 0);
+    QCOMPARE(bobMatched.at(0).at(0).toUInt(), session);
+    QCOMPARE(aliceMatched.at(1).at(1).value<GameLogic::Player>(), GameLogic::Player::X);
+    QCOMPARE(bobMatched.at(0).at(1).value<GameLogic::Player>(), GameLogic::Player::O);
+    QCOMPARE(server.metrics().matchesMade, qint64(1));
+    QCOMPARE(server.metrics().playersWaiting, 0);
+
+    // Each side plays only its own moves
+    alice.sendMove(session, 4);
+    QVERIFY(bobMoved.wait());
+    alice.sendMove(session, 0);
+    QVERIFY(aliceRejected.wait());
+
+    // Leaving the queue by disconnecting
+    GameClient carol;
+    QSignalSpy carolConnected(&carol, &GameClient::connected);
+    carol.connectToServer("127.0.0.1", server.port());
+    QVERIFY(carolConnected.wait());
+    carol.queueForMatch("carol", "secret");
+    QTRY_COMPARE(server.metrics().playersWaiting, 1);
+    carol.disconnectFromServer();
+    QTRY_COMPARE(server.metrics().playersWaiting, 0);
+}
+
+void TestMatchmaker::testServerRefusesBadLogin()
+{
+    Authentication auth;
+    GameServer server;
+    server.setAuthentication(&auth);
+    QVERIFY(server.listen());
+
+    GameClient client;
+    QSignalSpy connected(&client, &GameClient::connected);
+    QSignalSpy matched(&client, &GameClient::matchFound);
+    client.connectToServer("127.0.0.1", server.port());
+    QVERIFY(connected.wait());
+
+    // Checking a queued player's password signs nobody in at this end
+    QSignalSpy loginChanged(&auth, &Authentication::loginStatusChanged);
+    User* signedIn = auth.getCurrentUser();
+
+    client.queueForMatch("player1", "wrong");
+    QVERIFY(matched.wait());
+    QCOMPARE(matched.at(0).at(0).toUInt(), quint32(0));
+
+    client.queueForMatch("player1", "pass123");
+    QTRY_COMPARE(server.metrics().playersWaiting, 1);
+    QCOMPARE(loginChanged.count(), 0);
+    QCOMPARE(auth.getCurrentUser(), signedIn);
+}
+
+void TestMatchmaker::testServerReadsAccountsOnly()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tictactoe.json");
+
+    // A desktop window's accounts, with a journal long enough to compact
+    Database desktopDatabase;
+    desktopDatabase.setDatabasePath(path);
+    Authentication desktop;
+    desktop.setDatabase(&desktopDatabase);
+    QVERIFY(desktop.registerUser("alice", "secret"));
+    desktop.saveUsers();
+    QVector<User*> filler;
+    for (int i = 0; i < 10000; ++i) {
+        filler.append(new User(QString("filler%1").arg(i), "hash"));
+    }
+    QVERIFY(desktopDatabase.appendUsers(filler));
+    qDeleteAll(filler);
+    QVERIFY(desktopDatabase.journalNeedsCompaction());
+    const qint64 journalSize = QFile(desktopDatabase.journalPath()).size();
+
+    // The server leaves the journal to the window that is appending to it
+    Database accounts;
+    accounts.setDatabasePath(path);
+    accounts.setReadOnly(true);
+    Authentication auth;
+    auth.setDatabase(&accounts);
+    auth.loadUsers();
+    QCOMPARE(QFile(desktopDatabase.journalPath()).size(), journalSize);
+    QVERIFY(!auth.reloadUsers());
+
+    GameServer server;
+    server.setAuthentication(&auth);
+    QVERIFY(server.listen());
+    GameClient client;
+    QSignalSpy connected(&client, &GameClient::connected);
+    client.connectToServer("127.0.0.1", server.port());
+    QVERIFY(connected.wait());
+
+    client.queueForMatch("alice", "secret");
+    QTRY_COMPARE(server.metrics().playersWaiting, 1);
+
+    // Registered at the window after the server read the accounts
+    QVERIFY(desktop.registerUser("dave", "secret"));
+    desktop.saveUsers();
+    client.queueForMatch("dave", "secret");
+    QTRY_COMPARE(server.metrics().playersWaiting, 2);
+    QVERIFY(QFile(desktopDatabase.journalPath()).size() > journalSize);
+}
+
+void TestMatchmaker::testSimulation()
+{
+    MatchSimulator::Options options;
+    options.events = simulationEvents();
+    MatchSimulator simulator(options);
+    const MatchSimulator::Report report = simulator.run();
+
+    qDebug() << "Matchmaking:" << report.events << "events in" << report.elapsedMs << "ms,"
+             << qRound(report.eventsPerSecond) << "events/s";
+    qDebug() << report.enqueues << "queued," << report.matches << "matches," << report.cancels
+             << "cancelled," << report.stillWaiting << "still waiting";
+    qDebug() << "Wait (simulated ms): p50" << report.waitP50Ms << "p90" << report.waitP90Ms
+             << "p99" << report.waitP99Ms << "max" << report.waitMaxMs;
+    qDebug() << "Rating gap: p50" << report.gapP50 << "p99" << report.gapP99 << "max" << report.gapMax;
+
+    QCOMPARE(report.enqueues, report.matches * 2 + report.cancels + report.stillWaiting);
+    QVERIFY(report.matches > 0);
+    QVERIFY(report.gapMax <= options.matchmaker.maxWindow);
+}
+
+void TestMatchmaker::testDenseClusterSimulation()
+{
+    // Nearly everyone within a few points of each other, and windows that
+    // start closed: thousands wait in the same two buckets at once
+    MatchSimulator::Options options;
+    options.events = simulationEvents() / 2;
+    options.ratingDeviation = 3.0;
+    options.matchmaker.initialWindow = 0;
+    options.matchmaker.windowGrowth = 10;
+    MatchSimulator simulator(options);
+    const MatchSimulator::Report report = simulator.run();
+
+    qDebug() << "Dense cluster:" << report.events << "events in" << report.elapsedMs << "ms,"
+             << qRound(report.eventsPerSecond) << "events/s";
+    qDebug() << report.enqueues << "queued," << report.matches << "matches," << report.cancels
+             << "cancelled," << report.stillWaiting << "still waiting";
+    qDebug() << "Wait (simulated ms): p50" << report.waitP50Ms << "p90" << report.waitP90Ms
+             << "p99" << report.waitP99Ms << "max" << report.waitMaxMs;
+
+    QCOMPARE(report.enqueues, report.matches * 2 + report.cancels + report.stillWaiting);
+    QVERIFY(report.matches > 0);
+    // A bucket's front is reached once the window covers a bucket width
+    QVERIFY(report.waitP99Ms <= 5000);
+    QVERIFY(report.stillWaiting < report.enqueues / 10);
+}
+
+QTEST_MAIN(TestMatchmaker)
+#include "test_matchmaker.moc"
@@ -0,0 +1,215 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QDebug>
+#include "../include/moveanalyzer.h"
+#include <algorithm>
+
+// Perfect-play move values, the shared position cache and move grades
+class TestMoveAnalyzer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testWholeGameCached();
+    void testCanonicalKey();
+    void testImmediateWin();
+    void testEitherSide();
+    void testDistanceToWin();
+    void testFinishedGame();
+    void testGrades();
+    void testMatchesTimeline();
+    void testAsyncAnalysis();
+    void testWarmAnalysisSpeed();
+
+private:
+    static BoardSnapshot board(std::initializer_list<int> xCells, std::initializer_list<int> oCells);
+};
+
+BoardSnapshot TestMoveAnalyzer::board(std::initializer_list<int> xCells, std::initializer_list<int> oCells)
+{
+    BoardSnapshot snapshot;
+    for (int cell : xCells) {
+        snapshot.x |= quint16(1u << cell);
+    }
+    for (int cell : oCells) {
+        snapshot.o |= quint16(1u << cell);
+    }
+    return snapshot;
+}
+
+void TestMoveAnalyzer::initTestCase()
+{
+    qRegisterMetaType<MoveAnalyzer::Analysis>();
+}
+
+void TestMoveAnalyzer::testWholeGameCached()
+{
+    // Runs first, while only positions reachable from the empty board are cached
+    QCOMPARE(MoveAnalyzer::evaluate(BoardSnapshot()), 0);
+    // Every unfinished position up to symmetry
+    QCOMPARE(MoveAnalyzer::cachedPositions(), 627);
+}
+
+void TestMoveAnalyzer::testCanonicalKey()
+{
+    const quint32 corner = MoveAnalyzer::canonicalKey(board({0}, {}).x, 0);
+    for (int cell : {2, 6, 8}) {
+        QCOMPARE(MoveAnalyzer::canonicalKey(board({cell}, {}).x, 0), corner);
+    }
+    QVERIFY(MoveAnalyzer::canonicalKey(board({1}, {}).x, 0) != corner);
+
+    // Reflections keep the marks apart
+    const BoardSnapshot a = board({0, 4}, {1});
+    const BoardSnapshot b = board({2, 4}, {1});
+    const BoardSnapshot c = board({8, 4}, {5});
+    QCOMPARE(MoveAnalyzer::canonicalKey(a.x, a.o), MoveAnalyzer::canonicalKey(b.x, b.o));
+    QCOMPARE(MoveAnalyzer::canonicalKey(a.x, a.o), MoveAnalyzer::canonicalKey(c.x, c.o));
+    QVERIFY(MoveAnalyzer::canonicalKey(a.x, a.o) != MoveAnalyzer::canonicalKey(a.o, a.x));
+}
+
+void TestMoveAnalyzer::testImmediateWin()
+{
+    const MoveAnalyzer::Analysis analysis = MoveAnalyzer::analyze(board({0, 1}, {3, 4}));
+    QCOMPARE(analysis.toMove, GameLogic::Player::X);
+    QCOMPARE(analysis.moves.size(), 5);
+    QCOMPARE(analysis.bestMoves(), QVector<int>{2});
+    QCOMPARE(analysis.moves.first().cell, 2);
+    QCOMPARE(analysis.moves.first().value, ReplayTimeline::WIN_SCORE - 1);
+    QCOMPARE(analysis.moves.first().distance, 1);
+    QCOMPARE(analysis.moves.first().outcome(), MoveAnalyzer::Outcome::Win);
+
+    // Blocking O's row only draws; anything else lets O win next
+    QCOMPARE(analysis.find(5)->outcome(), MoveAnalyzer::Outcome::Draw);
+    QCOMPARE(analysis.find(5)->distance, 5);
+    QCOMPARE(analysis.find(8)->outcome(), MoveAnalyzer::Outcome::Loss);
+    QCOMPARE(analysis.find(8)->distance, 2);
+    QVERIFY(!analysis.find(0));
+}
+
+void TestMoveAnalyzer::testEitherSide()
+{
+    // O to move after X took the centre: corners hold, edges lose
+    const MoveAnalyzer::Analysis analysis = MoveAnalyzer::analyze(board({4}, {}));
+    QCOMPARE(analysis.toMove, GameLogic::Player::O);
+    QCOMPARE(analysis.value(), 0);
+    QVector<int> best = analysis.bestMoves();
+    std::sort(best.begin(), best.end());
+    QCOMPARE(best, (QVector<int>{0, 2, 6, 8}));
+    for (int edge : {1, 3, 5, 7}) {
+        QCOMPARE(analysis.find(edge)->outcome(), MoveAnalyzer::Outcome::Loss);
+        QCOMPARE(analysis.find(edge)->distance, 6);
+    }
+}
+
+void TestMoveAnalyzer::testDistanceToWin()
+{
+    // After X in a corner and O on an edge next to it, X forces a win
+    const MoveAnalyzer::Analysis analysis = MoveAnalyzer::analyze(board({0}, {1}));
+    QVector<int> best = analysis.bestMoves();
+    std::sort(best.begin(), best.end());
+    QCOMPARE(best, (QVector<int>{3, 4, 6}));
+    QCOMPARE(analysis.moves.first().distance, 5);
+    QCOMPARE(analysis.find(2)->outcome(), MoveAnalyzer::Outcome::Draw);
+    QCOMPARE(analysis.find(2)->distance, 7);
+
+    // The empty board is a draw whatever X does
+    const MoveAnalyzer::Analysis opening = MoveAnalyzer::analyze(BoardSnapshot());
+    QCOMPARE(opening.moves.size(), 9);
+    QCOMPARE(opening.bestMoves().size(), 9);
+    QCOMPARE(opening.moves.first().distance, 9);
+}
+
+void TestMoveAnalyzer::testFinishedGame()
+{
+    const MoveAnalyzer::Analysis won = MoveAnalyzer::analyze(board({0, 1, 2}, {3, 4}));
+    QCOMPARE(won.toMove, GameLogic::Player::None);
+    QVERIFY(won.moves.isEmpty());
+    QVERIFY(won.bestMoves().isEmpty());
+    QCOMPARE(MoveAnalyzer::evaluate(won.board), ReplayTimeline::WIN_SCORE);
+    QCOMPARE(MoveAnalyzer::grade(won.board, 5), MoveAnalyzer::MoveQuality::Illegal);
+}
+
+void TestMoveAnalyzer::testGrades()
+{
+    QCOMPARE(MoveAnalyzer::grade(BoardSnapshot(), 7), MoveAnalyzer::MoveQuality::Best);
+    QCOMPARE(MoveAnalyzer::grade(board({4}, {}), 1), MoveAnalyzer::MoveQuality::Mistake);
+    QCOMPARE(MoveAnalyzer::grade(board({4}, {}), 4), MoveAnalyzer::MoveQuality::Illegal);
+
+    // X can win at once on 2; 4 still wins, just later
+    QCOMPARE(MoveAnalyzer::grade(board({0, 1}, {3, 6}), 2), MoveAnalyzer::MoveQuality::Best);
+    QCOMPARE(MoveAnalyzer::grade(board({0, 1}, {3, 6}), 4), MoveAnalyzer::MoveQuality::Inaccuracy);
+    QCOMPARE(MoveAnalyzer::grade(board({0, 1}, {3, 7}), 5), MoveAnalyzer::MoveQuality::Mistake);
+    QCOMPARE(MoveAnalyzer::grade(board({0, 1}, {3, 5}), 6), MoveAnalyzer::MoveQuality::Blunder);
+}
+
+void TestMoveAnalyzer::testMatchesTimeline()
+{
+    // The best move's value is the position's value, from the mover's side
+    const QVector<GameMove> moves = {{4, 1}, {1, 2}, {0, 1}, {8, 2}, {2, 1}, {6, 2}, {3, 1}, {5, 2}, {7, 1}};
+    ReplayTimeline timeline;
+    timeline.setMoves(moves);
+    for (int ply = 0; ply < timeline.plyCount(); ++ply) {
+        const MoveAnalyzer::Analysis analysis = MoveAnalyzer::analyze(timeline.at(ply));
+        const int sign = analysis.toMove == GameLogic::Player::X ? 1 : -1;
+        QCOMPARE(analysis.value() * sign, timeline.evaluation(ply));
+    }
+}
+
+void TestMoveAnalyzer::testAsyncAnalysis()
+{
+    MoveAnalyzer analyzer;
+    QSignalSpy ready(&analyzer, &MoveAnalyzer::analysisReady);
+    analyzer.requestAnalysis(board({0, 1}, {3, 4}));
+    analyzer.requestAnalysis(board({4}, {}));
+    QTRY_COMPARE(ready.count(), 2);
+
+    // Answered in the order asked
+    const MoveAnalyzer::Analysis first = ready.at(0).at(0).value<MoveAnalyzer::Analysis>();
+    const MoveAnalyzer::Analysis second = ready.at(1).at(0).value<MoveAnalyzer::Analysis>();
+    QCOMPARE(first.bestMoves(), QVector<int>{2});
+    QCOMPARE(second.board.x, quint16(1 << 4));
+    QCOMPARE(second.toMove, GameLogic::Player::O);
+}
+
+void TestMoveAnalyzer::testWarmAnalysisSpeed()
+{
+    // Every position of every game up to the fifth ply
+    QVector<BoardSnapshot> positions{BoardSnapshot()};
+    for (int depth = 0, begin = 0; depth < 5; ++depth) {
+        const int end = positions.size();
+        for (int i = begin; i < end; ++i) {
+            const BoardSnapshot position = positions.at(i);
+            const bool xMoves = depth % 2 == 0;
+            for (int cell = 0; cell < 9; ++cell) {
+                const quint16 bit = quint16(1u << cell);
+                if ((position.x | position.o) & bit) {
+                    continue;
+                }
+                BoardSnapshot next = position;
+                (xMoves ? next.x : next.o) |= bit;
+                positions.append(next);
+            }
+        }
+        begin = end;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 moves = 0;
+    for (const BoardSnapshot &position : positions) {
+        moves += MoveAnalyzer::analyze(position).moves.size();
+    }
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+    qDebug() << "Analysed" << positions.size() << "positions," << moves << "moves in" << elapsedNs / 1000
+             << "us," << elapsedNs / positions.size() << "ns per position";
+    qDebug() << "Canonical positions cached:" << MoveAnalyzer::cachedPositions();
+    QCOMPARE(MoveAnalyzer::cachedPositions(), 627);
+}
+
+QTEST_MAIN(TestMoveAnalyzer)
+#include "test_moveanalyzer.moc"
@@ -0,0 +1,320 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+#include "../include/openingbook.h"
+#include "../include/aiopponent.h"
+#include "../include/gamearchive.h"
+#include "../include/movecodec.h"
+
+// Opening book built from the archive, its file, weighted picks and the AI
+class TestOpeningBook : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testBuildFromArchive();
+    void testSymmetricPositionsShared();
+    void testComputerMovesLeftOut();
+    void testWeightedChoice();
+    void testDamagedFile();
+    void testAIOpponentUsesBook();
+    void testConcurrentLookups();
+
+private:
+    static quint64 pack(std::initializer_list<int> cells);
+    static BoardSnapshot board(std::initializer_list<int> xCells, std::initializer_list<int> oCells);
+    static void appendGames(GameArchive &archive, int count, std::initializer_list<int> cells,
+                            const QString &playerO = "bob", const QString &difficulty = QString());
+};
+
+quint64 TestOpeningBook::pack(std::initializer_list<int> cells)
+{
+    QVector<GameMoveRecord> moves;
+    for (int cell : cells) {
+        moves.append({cell, moves.size() % 2 == 0 ? 1 : 2});
+    }
+    return MoveCodec::pack(moves);
+}
+
+BoardSnapshot TestOpeningBook::board(std::initializer_list<int> xCells, std::initializer_list<int> oCells)
+{
+    BoardSnapshot snapshot;
+    for (int cell : xCells) {
+        snapshot.x |= quint16(1u << cell);
+    }
+    for (int cell : oCells) {
+        snapshot.o |= quint16(1u << cell);
+    }
+    return snapshot;
+}
+
+void TestOpeningBook::appendGames(GameArchive &archive, int count, std::initializer_list<int> cells,
+                                  const QString &playerO, const QString &difficulty)
+{
+    for (int i = 0; i < count; ++i) {
+        QVERIFY(archive.append("alice", playerO, GameLogic::GameResult::Draw, difficulty, pack(cells)));
+    }
+}
+
+void TestOpeningBook::testBuildFromArchive()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    appendGames(archive, 6, {4, 0});
+    appendGames(archive, 2, {0, 4});
+    appendGames(archive, 1, {1, 4});
+    QVERIFY(archive.append("carol", "dave", GameLogic::GameResult::Draw)); // No moves recorded
+
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(!book.isOpen());
+    QVERIFY(book.open(path));
+    QVERIFY(book.isOpen());
+
+    // The empty board, then one position after each first move
+    QCOMPARE(book.positionCount(), 4);
+    QCOMPARE(QFileInfo(path).size(), qint64(OpeningBook::HEADER_SIZE + 4 * OpeningBook::ENTRY_SIZE));
+
+    quint32 counts[9];
+    QVERIFY(book.lookup(BoardSnapshot(), counts));
+    QCOMPARE(counts[4], 6u);
+    QCOMPARE(counts[0], 2u);
+    QCOMPARE(counts[1], 1u);
+    QCOMPARE(counts[8], 0u);
+    QVERIFY(book.lookup(board({4}, {}), counts));
+    QCOMPARE(counts[0], 6u);
+    QVERIFY(!book.lookup(board({4}, {0}), counts));
+
+    // Seen six times, so the book answers; the corner reply only twice
+    QRandomGenerator random(1);
+    QCOMPARE(book.pickMove(board({4}, {}), &random), 0);
+    QCOMPARE(book.pickMove(board({0}, {}), &random), -1);
+
+    book.close();
+    QVERIFY(!book.isOpen());
+    QCOMPARE(book.pickMove(BoardSnapshot(), &random), -1);
+}
+
+void TestOpeningBook::testSymmetricPositionsShared()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    // A corner, then the edge beside it, from every corner
+    appendGames(archive, 2, {0, 1});
+    appendGames(archive, 2, {2, 5});
+    appendGames(archive, 2, {6, 3});
+
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(book.open(path));
+
+    // Never played from the last corner, but it is the same position
+    quint32 counts[9];
+    QVERIFY(book.lookup(board({8}, {}), counts));
+    QCOMPARE(counts[5] + counts[7], 6u);
+    QRandomGenerator random(3);
+    for (int i = 0; i < 20; ++i) {
+        const int move = book.pickMove(board({8}, {}), &random);
+        QVERIFY(move == 5 || move == 7);
+    }
+}
+
+void TestOpeningBook::testComputerMovesLeftOut()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    appendGames(archive, 6, {4, 0, 8}, "AI", "hard");
+
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(book.open(path));
+
+    quint32 counts[9];
+    QVERIFY(book.lookup(BoardSnapshot(), counts));
+    QCOMPARE(counts[4], 6u);
+    QVERIFY(!book.lookup(board({4}, {}), counts));     // The computer's reply
+    QVERIFY(book.lookup(board({4}, {0}), counts));
+    QCOMPARE(book.positionCount(), 2);
+}
+
+void TestOpeningBook::testWeightedChoice()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    appendGames(archive, 300, {4});
+    appendGames(archive, 100, {0});
+
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(book.open(path));
+
+    QRandomGenerator random(42);
+    int centre = 0;
+    const int draws = 10000;
+    for (int i = 0; i < draws; ++i) {
+        const int move = book.pickMove(BoardSnapshot(), &random);
+        QVERIFY(move == 4 || move == 0);
+        centre += move == 4 ? 1 : 0;
+    }
+    // Three to one, give or take
+    QVERIFY(centre > draws * 70 / 100);
+    QVERIFY(centre < draws * 80 / 100);
+}
+
+void TestOpeningBook::testDamagedFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    appendGames(archive, 5, {4, 0});
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+
+    OpeningBook book;
+    QVERIFY(!book.open(dir.filePath("missing.book")));
+
+    // Cut short
+    QFile file(path);
+    QVERIFY(file.resize(file.size() - 1));
+    QVERIFY(!book.open(path));
+    QVERIFY(!book.isOpen());
+
+    // Not a book at all
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(QByteArray(OpeningBook::HEADER_SIZE + OpeningBook::ENTRY_SIZE, 'x'));
+    file.close();
+    QVERIFY(!book.open(path));
+}
+
+void TestOpeningBook::testAIOpponentUsesBook()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    // People answer the centre with an edge, which the search never would
+    appendGames(archive, 10, {4, 1});
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(book.open(path));
+
+    GameLogic gameLogic;
+    AIOpponent ai;
+    ai.setGameLogic(&gameLogic);
+    ai.setOpeningBook(&book);
+    QVector<Player> board(9, Player::None);
+    board[4] = Player::X;
+
+    gameLogic.setAIDifficulty(GameLogic::AIDifficulty::Medium);
+    QCOMPARE(ai.findBestMove(board, 2), 1);
+    gameLogic.setAIDifficulty(GameLogic::AIDifficulty::Hard);
+    QCOMPARE(ai.findBestMove(board, 3), 1);
+    QCOMPARE(board[1], Player::None);
+
+    // Expert always searches
+    gameLogic.setAIDifficulty(GameLogic::AIDifficulty::Expert);
+    const int expert = ai.findBestMove(board, 9);
+    QVERIFY(expert == 0 || expert == 2 || expert == 6 || expert == 8);
+
+    // A threat is still blocked before the book is asked
+    board[1] = Player::O;
+    board[0] = Player::X;
+    gameLogic.setAIDifficulty(GameLogic::AIDifficulty::Hard);
+    QCOMPARE(ai.findBestMove(board, 3), 8);
+}
+
+void TestOpeningBook::testConcurrentLookups()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    GameArchive archive(dir.filePath("archive.games"));
+    QRandomGenerator random(7);
+    for (int i = 0; i < 20000; ++i) {
+        QVector<GameMoveRecord> moves;
+        quint16 taken = 0;
+        while (moves.size() < 7) {
+            const int cell = random.bounded(9);
+            if (!(taken & (1u << cell))) {
+                taken |= quint16(1u << cell);
+                moves.append({cell, moves.size() % 2 == 0 ? 1 : 2});
+            }
+        }
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::Draw, QString(), MoveCodec::pack(moves)));
+    }
+    const QString path = OpeningBook::bookPath(archive.path());
+    QVERIFY(OpeningBook::build(&archive, path));
+    OpeningBook book;
+    QVERIFY(book.open(path));
+
+    // Every position up to the third ply
+    QVector<BoardSnapshot> positions{BoardSnapshot()};
+    for (int begin = 0, ply = 0; ply < 3; ++ply) {
+        const int end = positions.size();
+        for (int i = begin; i < end; ++i) {
+            for (int cell = 0; cell < 9; ++cell) {
+                BoardSnapshot next = positions.at(i);
+                if ((next.x | next.o) & (1u << cell)) {
+                    continue;
+                }
+                (ply % 2 == 0 ? next.x : next.o) |= quint16(1u << cell);
+                positions.append(next);
+            }
+        }
+        begin = end;
+    }
+
+    // One book for every thread, read without locks
+    const int threads = qMax(2, QThread::idealThreadCount());
+    const int rounds = 200;
+    QAtomicInt illegal;
+    QAtomicInt answered;
+    QElapsedTimer timer;
+    timer.start();
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int thread = 0; thread < threads; ++thread) {
+        pool.start([&, thread]() {
+            QRandomGenerator local(thread + 1);
+            for (int round = 0; round < rounds; ++round) {
+                for (const BoardSnapshot &position : positions) {
+                    const int move = book.pickMove(position, &local);
+                    if (move >= 0) {
+                        answered.fetchAndAddRelaxed(1);
+                        if ((position.x | position.o) & (1u << move)) {
+                            illegal.fetchAndAddRelaxed(1);
+                        }
+                    }
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+    const qint64 lookups = qint64(threads) * rounds * positions.size();
+
+    QCOMPARE(illegal.loadRelaxed(), 0);
+    QVERIFY(answered.loadRelaxed() > 0);
+    qDebug() << threads << "threads made" << lookups << "book lookups over" << book.positionCount()
+             << "positions in" << elapsedNs / 1000000 << "ms," << elapsedNs / lookups << "ns each";
+}
+
+QTEST_MAIN(TestOpeningBook)
+#include "test_openingbook.moc"
@@ -0,0 +1,273 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QDebug>
+#include "../include/openingtrie.h"
+#include "../include/gamearchive.h"
+#include "../include/movecodec.h"
+
+// Opening counts, symmetry, prefix and top-K queries, and the parallel build
+class TestOpeningTrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSymmetricOpeningsShared();
+    void testCountsForOpener();
+    void testPrefixQueries();
+    void testTopChildren();
+    void testParallelBuildMatchesIncremental();
+    void testArchiveOpenings();
+    void testQuerySpeed();
+
+private:
+    static int gameCount();
+    static quint64 pack(std::initializer_list<int> cells, int firstPlayer = 1);
+    static OpeningGame randomGame(QRandomGenerator &random);
+    static void compareNodes(const OpeningTrie &expected, int expectedNode, const OpeningTrie &actual, int actualNode);
+};
+
+int TestOpeningTrie::gameCount()
+{
+    bool ok = false;
+    const int games = qEnvironmentVariableIntValue("TICTACTOE_OPENING_GAMES", &ok);
+    return ok ? games : 500000;
+}
+
+quint64 TestOpeningTrie::pack(std::initializer_list<int> cells, int firstPlayer)
+{
+    QVector<GameMoveRecord> moves;
+    for (int cell : cells) {
+        moves.append({cell, moves.size() % 2 == 0 ? firstPlayer : 3 - firstPlayer});
+    }
+    return MoveCodec::pack(moves);
+}
+
+// Random moves, with a result drawn at random too; only the counts matter here
+OpeningGame TestOpeningTrie::randomGame(QRandomGenerator &random)
+{
+    QVector<GameMoveRecord> moves;
+    quint16 taken = 0;
+    const int length = 5 + random.bounded(5);
+    const int firstPlayer = random.bounded(4) == 0 ? 2 : 1;
+    while (moves.size() < length) {
+        const int cell = random.bounded(9);
+        if (!(taken & (1u << cell))) {
+            taken |= quint16(1u << cell);
+            moves.append({cell, moves.size() % 2 == 0 ? firstPlayer : 3 - firstPlayer});
+        }
+    }
+    static const GameLogic::GameResult results[] = {GameLogic::GameResult::XWins, GameLogic::GameResult::OWins,
+                                                    GameLogic::GameResult::Draw};
+    return {MoveCodec::pack(moves), results[random.bounded(3)]};
+}
+
+// Same counts and the same continuations all the way down
+void TestOpeningTrie::compareNodes(const OpeningTrie &expected, int expectedNode, const OpeningTrie &actual, int actualNode)
+{
+    const OpeningTrie::Node &left = expected.node(expectedNode);
+    const OpeningTrie::Node &right = actual.node(actualNode);
+    QCOMPARE(right.position, left.position);
+    QCOMPARE(right.ply, left.ply);
+    QCOMPARE(right.wins, left.wins);
+    QCOMPARE(right.draws, left.draws);
+    QCOMPARE(right.losses, left.losses);
+    const QVector<int> expectedChildren = expected.topChildren(expectedNode, 9);
+    const QVector<int> actualChildren = actual.topChildren(actualNode, 9);
+    QCOMPARE(actualChildren.size(), expectedChildren.size());
+    for (int i = 0; i < expectedChildren.size(); ++i) {
+        compareNodes(expected, expectedChildren.at(i), actual, actualChildren.at(i));
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+    }
+}
+
+void TestOpeningTrie::testSymmetricOpeningsShared()
+{
+    OpeningTrie trie;
+    // Every corner, then the neighbouring edge clockwise
+    trie.add(pack({0, 1, 4}), GameLogic::GameResult::XWins);
+    trie.add(pack({2, 5, 4}), GameLogic::GameResult::XWins);
+    trie.add(pack({8, 7, 4}), GameLogic::GameResult::Draw);
+    trie.add(pack({6, 3, 4}), GameLogic::GameResult::OWins);
+
+    QCOMPARE(trie.node(OpeningTrie::ROOT).games(), 4u);
+    const QVector<int> firstMoves = trie.topChildren(OpeningTrie::ROOT, 9);
+    QCOMPARE(firstMoves.size(), 1);
+    QCOMPARE(trie.node(firstMoves.first()).games(), 4u);
+    QCOMPARE(trie.topChildren(firstMoves.first(), 9).size(), 1);
+    QCOMPARE(trie.find({0, 1, 4}), trie.find({6, 3, 4}));
+    QCOMPARE(trie.nodeCount(), 4);
+
+    // The other edge next to the corner is a different opening
+    trie.add(pack({0, 3, 4}), GameLogic::GameResult::Draw);
+    QCOMPARE(trie.find({0, 3}), trie.find({0, 1}));
+    trie.add(pack({0, 5, 4}), GameLogic::GameResult::Draw);
+    QVERIFY(trie.find({0, 5}) != trie.find({0, 1}));
+    QCOMPARE(trie.topChildren(firstMoves.first(), 9).size(), 2);
+}
+
+void TestOpeningTrie::testCountsForOpener()
+{
+    OpeningTrie trie;
+    trie.add(pack({4, 0}), GameLogic::GameResult::XWins);
+    trie.add(pack({4, 0}, 2), GameLogic::GameResult::OWins);    // O opened and won
+    trie.add(pack({4, 0}, 2), GameLogic::GameResult::XWins);
+    trie.add(pack({4, 0}), GameLogic::GameResult::Draw);
+    trie.add(0, GameLogic::GameResult::XWins);                  // No moves recorded
+
+    const OpeningTrie::Node &centre = trie.node(trie.find({4}));
+    QCOMPARE(centre.ply, 1);
+    QCOMPARE(centre.wins, 2u);
+    QCOMPARE(centre.losses, 1u);
+    QCOMPARE(centre.draws, 1u);
+    QCOMPARE(trie.node(trie.find({4, 8})).games(), 4u);
+    QCOMPARE(trie.node(OpeningTrie::ROOT).games(), 4u);
+
+    // The position keeps the opener's marks as x
+    const BoardSnapshot board = centre.board();
+    QCOMPARE(board.cell(4), GameLogic::Player::X);
+    QCOMPARE(board.o, quint16(0));
+}
+
+void TestOpeningTrie::testPrefixQueries()
+{
+    OpeningTrie trie(3);
+    QCOMPARE(trie.depth(), 3);
+    trie.add(pack({4, 0, 8, 2, 6}), GameLogic::GameResult::XWins);
+
+    QCOMPARE(trie.find({}), OpeningTrie::ROOT);
+    QVERIFY(trie.find({4, 0, 8}) > 0);
+    QCOMPARE(trie.node(trie.find({4, 0, 8})).ply, 3);
+    QCOMPARE(trie.find({4, 0, 2}), -1);     // Never played
+    QCOMPARE(trie.find({4, 0, 8, 2}), -1);  // Deeper than the trie
+    QCOMPARE(trie.find({4, 4}), -1);        // Taken cell
+    QCOMPARE(trie.find({9}), -1);
+    QCOMPARE(trie.nodeCount(), 4);
+}
+
+void TestOpeningTrie::testTopChildren()
+{
+    OpeningTrie trie;
+    for (int i = 0; i < 5; ++i) {
+        trie.add(pack({4, 0}), GameLogic::GameResult::Draw);
+    }
+    for (int i = 0; i < 3; ++i) {
+        trie.add(pack({0, 4}), GameLogic::GameResult::Draw);
+    }
+    trie.add(pack({1, 4}), GameLogic::GameResult::OWins);
+
+    const QVector<int> top = trie.topChildren(OpeningTrie::ROOT, 2);
+    QCOMPARE(top.size(), 2);
+    QCOMPARE(top.at(0), trie.find({4}));
+    QCOMPARE(top.at(1), trie.find({0}));
+    QCOMPARE(trie.topChildren(OpeningTrie::ROOT, 10).size(), 3);
+    QVERIFY(trie.topChildren(OpeningTrie::ROOT, 0).isEmpty());
+    QVERIFY(trie.topChildren(-1, 3).isEmpty());
+}
+
+void TestOpeningTrie::testParallelBuildMatchesIncremental()
+{
+    const int count = gameCount();
+    QRandomGenerator random(42);
+    QVector<OpeningGame> games;
+    games.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        games.append(randomGame(random));
+    }
+
+    OpeningTrie incremental;
+    QElapsedTimer timer;
+    timer.start();
+    for (const OpeningGame &game : games) {
+        incremental.add(game.packedMoves, game.result);
+    }
+    const qint64 sequentialMs = timer.elapsed();
+
+    OpeningTrie built;
+    built.add(pack({4}), GameLogic::GameResult::Draw);  // Replaced by the build
+    timer.restart();
+    built.build(games);
+    const qint64 parallelMs = timer.elapsed();
+
+    QCOMPARE(built.nodeCount(), incremental.nodeCount());
+    QCOMPARE(built.node(OpeningTrie::ROOT).games(), quint32(count));
+    compareNodes(incremental, OpeningTrie::ROOT, built, OpeningTrie::ROOT);
+    qDebug() << "Opening trie over" << count << "games:" << built.nodeCount() << "nodes, built in"
+             << parallelMs << "ms in parallel," << sequentialMs << "ms one game at a time";
+}
+
+void TestOpeningTrie::testArchiveOpenings()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("archive.games");
+    {
+        GameArchive archive(path);
+        QVERIFY(archive.append("alice", "bob", GameLogic::GameResult::XWins, QString(), pack({4, 0, 8})));
+        QVERIFY(archive.append("alice", "AI", GameLogic::GameResult::Draw, "hard", pack({4, 2, 6})));
+        QVERIFY(archive.append("carol", "bob", GameLogic::GameResult::OWins));
+
+        // Every append is counted straight away
+        const OpeningTrie openings = archive.openings();
+        QCOMPARE(openings.node(OpeningTrie::ROOT).games(), 2u);
+        QCOMPARE(openings.node(openings.find({4, 0})).games(), 2u);
+        QVERIFY(archive.append("bob", "carol", GameLogic::GameResult::OWins, QString(), pack({2, 4})));
+        const OpeningTrie updated = archive.openings();
+        QCOMPARE(updated.node(updated.find({0})).losses, 1u);
+        QCOMPARE(openings.node(OpeningTrie::ROOT).games(), 2u);    // A copy, left as it was
+    }
+
+    // And rebuilt when the archive is opened again
+    GameArchive archive(path);
+    const OpeningTrie openings = archive.openings();
+    QCOMPARE(openings.node(OpeningTrie::ROOT).games(), 3u);
+    QCOMPARE(openings.node(openings.find({4})).wins, 1u);
+    QCOMPARE(openings.node(openings.find({4})).draws, 1u);
+    QCOMPARE(openings.node(openings.find({8})).losses, 1u);
+}
+
+void TestOpeningTrie::testQuerySpeed()
+{
+    QRandomGenerator random(7);
+    QVector<OpeningGame> games;
+    for (int i = 0; i < 100000; ++i) {
+        games.append(randomGame(random));
+    }
+    OpeningTrie trie;
+    trie.build(games);
+
+    // Prefixes of the archived games, and the best replies at each
+    QVector<QVector<int>> prefixes;
+    for (int i = 0; i < 10000; ++i) {
+        const QVector<GameMoveRecord> moves = MoveCodec::unpack(games.at(i).packedMoves);
+        QVector<int> cells;
+        for (int ply = 0; ply < 1 + i % trie.depth(); ++ply) {
+            cells.append(moves.at(ply).cellIndex);
+        }
+        prefixes.append(cells);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 found = 0;
+    for (const QVector<int> &prefix : prefixes) {
+        const int node = trie.find(prefix);
+        QVERIFY(node > 0);
+        found += trie.topChildren(node, 3).size();
+    }
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+    qDebug() << "Answered" << prefixes.size() << "prefix and top-3 queries in" << elapsedNs / 1000 << "us,"
+             << elapsedNs / prefixes.size() << "ns per query";
+    QVERIFY(found > 0);
+    // Microseconds each even on a slow machine
+    QVERIFY(elapsedNs / prefixes.size() < 50000);
+}
+
+QTEST_MAIN(TestOpeningTrie)
+#include "test_openingtrie.moc"
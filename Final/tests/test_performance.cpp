@@ -10,12 +10,16 @@
 #include <QThread>
 #include <QCoreApplication>
 #include <QRandomGenerator>
+#include <QDateTime>
+#include <QStringList>
+#include <QTemporaryDir>
 #include <functional>
 #include "../include/gamelogic.h"
 #include "../include/aiopponent.h"
 #include "../include/database.h"
 #include "../include/authentication.h"
 #include "../include/user.h"
+#include "../include/stringinterner.h"
 
 class TestPerformance : public QObject
 {
@@ -32,6 +36,7 @@ private slots:
     
     // Resource Utilization Tests
     void testMemoryUsage();
+    void testGameRecordMemory();
     void testCPUUsage();
     
     // Stress Tests
@@ -325,6 +330,118 @@ void TestPerformance::testMemoryUsage()
     QVERIFY2((finalMemory - baselineMemory) < 5 * 1024 * 1024, "Memory leak detected");
 }
 
+void TestPerformance::testGameRecordMemory()
+{
+    qDebug() << "=== Game Record Memory Test ===";
+    
+    // Full histories for many users against a handful of opponents, the
+    // shape the interner is meant for
+    const int userCount = 5000;
+    const int gamesPerUser = 20;
+    const qint64 games = qint64(userCount) * gamesPerUser;
+    const QStringList opponents = {"ai", "alice", "bob", "carol", "dave"};
+    const QStringList outcomes = {"win", "loss", "draw"};
+    const QStringList difficulties = {"easy", "medium", "hard", "expert"};
+    const QDateTime start(QDate(2024, 1, 1), QTime(0, 0));
+    
+    const qint64 internedBefore = StringInterner::memoryUsage();
+    const qint64 before = getCurrentMemoryUsage();
+    QVector<User*> users;
+    users.reserve(userCount);
+    for (int i = 0; i < userCount; ++i) {
+        User* user = new User(QString("recorduser%1").arg(i), "password");
+        for (int g = 0; g < gamesPerUser; ++g) {
+            const int n = i * gamesPerUser + g;
+            user->addGameWithDate(outcomes.at(n % 3), opponents.at(n % 5),
+                                  start.addSecs(n).toString("yyyy-MM-dd hh:mm:ss"), difficulties.at(n % 4));
+        }
+        users.append(user);
+    }
+    const qint64 after = getCurrentMemoryUsage();
+    const qint64 interned = StringInterner::memoryUsage() - internedBefore;
+    
+    // The same games as the two QStrings per record GameRecord used to hold
+    struct StringRecord {
+        QString date;
+        QString result;
+        quint64 packedMoves;
+    };
+    QVector<StringRecord> strings;
+    strings.reserve(int(games));
+    const qint64 stringsBefore = getCurrentMemoryUsage();
+    for (User* user : users) {
+        const QVector<GameRecord> history = user->getGameHistory();
+        for (const GameRecord &record : history) {
+            // Own copies of each string, as every addGame used to make
+            const QString result = record.result();
+            strings.append({record.date(), QString(result.constData(), result.size()), record.packedMoves});
+        }
+    }
+    const qint64 stringsAfter = getCurrentMemoryUsage();
+    
+    qDebug() << "sizeof(GameRecord):" << sizeof(GameRecord) << "bytes";
+    qDebug() << "Interner growth per game:" << double(interned) / games << "bytes";
+    qDebug() << "Per game with interned records:" << (after - before) / games << "bytes (RSS, includes users)";
+    qDebug() << "Per game with string records:" << (stringsAfter - stringsBefore) / games << "bytes (RSS)";
+    
+    // A record is an id, a date key and the packed moves; the shared strings
+    // cost next to nothing per game
+    QVERIFY(sizeof(GameRecord) <= 24);
+    QVERIFY(interned / games < 4);
+    
+    qDeleteAll(users);
+    users.clear();
+    
+    // Histories against thousands of different opponents, paged in from disk
+    // and evicted again round after round. The interner learns each name once
+    // and nothing else, so memory stops growing after the first round.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const int pagedCount = 4000;
+    const int namesBefore = StringInterner::count();
+    for (int i = 0; i < pagedCount; ++i) {
+        User* user = new User(QString("pageuser%1").arg(i), "password");
+        for (int g = 0; g < gamesPerUser; ++g) {
+            const int n = i * gamesPerUser + g;
+            const QString opponent = g % 4 == 0 ? QString("ai") : QString("pageuser%1").arg((i + g) % pagedCount);
+            user->addGameWithDate(outcomes.at(n % 3), opponent,
+                                  start.addSecs(n).toString("yyyy-MM-dd hh:mm:ss"), difficulties.at(n % 4));
+        }
+        users.append(user);
+    }
+    Database pagedDatabase;
+    pagedDatabase.setDatabasePath(dir.filePath("tictactoe.json"));
+    QVERIFY(pagedDatabase.saveUsers(users));
+    qDeleteAll(users);
+    users = pagedDatabase.loadUsers();
+    QCOMPARE(users.size(), pagedCount);
+    
+    // More users than the history cache holds, so every round reads from disk
+    const int rounds = 5;
+    qint64 residentAfterFirst = 0;
+    qint64 internedAfterFirst = 0;
+    for (int round = 0; round < rounds; ++round) {
+        for (User* user : users) {
+            QCOMPARE(user->getGameHistory().size(), gamesPerUser);
+        }
+        if (round == 0) {
+            residentAfterFirst = getCurrentMemoryUsage();
+            internedAfterFirst = StringInterner::memoryUsage();
+        }
+    }
+    const qint64 residentGrowth = getCurrentMemoryUsage() - residentAfterFirst;
+    
+    qDebug() << "Strings interned for" << pagedCount << "paged users:" << StringInterner::count() - namesBefore;
+    qDebug() << "RSS growth over" << rounds - 1 << "more paging rounds:" << residentGrowth / 1024 << "KB";
+    
+    // One per name; "Win vs pageuser17" and the like are never interned
+    QVERIFY(StringInterner::count() - namesBefore <= pagedCount + 16);
+    QCOMPARE(StringInterner::memoryUsage(), internedAfterFirst);
+    QVERIFY2(residentGrowth < 4 * 1024 * 1024, "Paging histories in and out keeps growing memory");
+    
+    qDeleteAll(users);
+}
+
 void TestPerformance::testCPUUsage()
 {
     qDebug() << "=== CPU Usage Test ===";
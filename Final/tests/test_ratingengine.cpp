@@ -0,0 +1,129 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include "../include/ratingengine.h"
+#include "../include/gamearchive.h"
+#include "../include/database.h"
+#include "../include/user.h"
+
+class TestRatingEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testExpectedScore();
+    void testIncrementalUpdate();
+    void testRecomputeMatchesSequential();
+    void testArchiveRatingsAndLeaderboard();
+};
+
+void TestRatingEngine::testExpectedScore()
+{
+    QCOMPARE(RatingEngine::expectedScore(1500, 1500), 0.5);
+    QVERIFY(qAbs(RatingEngine::expectedScore(1600, 1200) - 0.909) < 0.001);
+    QVERIFY(qAbs(RatingEngine::expectedScore(1200, 1600) + RatingEngine::expectedScore(1600, 1200) - 1.0) < 1e-12);
+}
+
+void TestRatingEngine::testIncrementalUpdate()
+{
+    RatingEngine engine;
+    QCOMPARE(engine.rating(0), 1200.0);
+
+    // Equal players, provisional K of 40: the winner takes 20 points
+    engine.apply({0, 1, GameLogic::GameResult::XWins, 0});
+    QCOMPARE(engine.rating(0), 1220.0);
+    QCOMPARE(engine.rating(1), 1180.0);
+    QCOMPARE(engine.gamesRated(1), 1);
+
+    // The AI is not a player; beating the easy level is worth little
+    const double before = engine.rating(2);
+    engine.apply({2, 0, GameLogic::GameResult::XWins, 1});
+    QVERIFY(engine.rating(2) > before);
+    QVERIFY(engine.rating(2) - before < 4.0);
+    QCOMPARE(engine.rating(0), 1220.0);
+    QCOMPARE(engine.gamesRated(0), 1);
+
+    // Losing to expert costs little too
+    engine.apply({2, 0, GameLogic::GameResult::OWins, 4});
+    QVERIFY(engine.rating(2) > 1200.0);
+}
+
+void TestRatingEngine::testRecomputeMatchesSequential()
+{
+    // Enough players that waves grow past the parallel threshold
+    const int players = 20000;
+    const int gameCount = 120000;
+    QRandomGenerator random(37);
+    QVector<RatedGame> games;
+    games.reserve(gameCount);
+    for (int i = 0; i < gameCount; ++i) {
+        RatedGame game;
+        game.playerX = random.bounded(players);
+        game.playerO = random.bounded(players);
+        game.result = static_cast<GameLogic::GameResult>(1 + random.bounded(3));
+        game.aiDifficulty = i % 5 == 0 ? quint8(1 + random.bounded(4)) : 0;
+        games.append(game);
+    }
+
+    RatingEngine sequential;
+    for (const RatedGame &game : games) {
+        sequential.apply(game);
+    }
+
+    RatingEngine batch;
+    batch.recompute(games);
+
+    QCOMPARE(batch.playerCount(), sequential.playerCount());
+    for (int player = 0; player < sequential.playerCount(); ++player) {
+        QCOMPARE(batch.rating(player), sequential.rating(player));
+        QCOMPARE(batch.gamesRated(player), sequential.gamesRated(player));
+    }
+}
+
+void TestRatingEngine::testArchiveRatingsAndLeaderboard()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    Database database;
+    database.setDatabasePath(dir.filePath("tictactoe.json"));
+
+    // Bob farms the easy AI, but alice beats him whenever they meet
+    User alice("alice", "hash");
+    User bob("bob", "hash");
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(database.saveGame("alice", "bob", GameLogic::GameResult::XWins));
+        alice.addGame("win", "bob");
+        bob.addGame("loss", "alice");
+    }
+    for (int i = 0; i < 20; ++i) {
+        QVERIFY(database.saveGame("bob", "AI", GameLogic::GameResult::XWins, "easy"));
+        bob.addGame("win", "ai", "easy");
+    }
+    const QVector<User*> users = {&alice, &bob};
+
+    QCOMPARE(database.getLeaderboard(users).first().username(), QString("bob"));
+
+    database.setRanking(Database::Ranking::Rating);
+    QVector<LeaderboardEntry> leaderboard = database.getLeaderboard(users);
+    QCOMPARE(leaderboard.first().username(), QString("alice"));
+    QVERIFY(leaderboard.first().rating > leaderboard.last().rating);
+
+    // Ratings survive a restart, being rebuilt from the archive
+    const double aliceRating = database.gameArchive()->rating("alice");
+    GameArchive reopened(database.gameArchive()->path());
+    QCOMPARE(reopened.rating("alice"), aliceRating);
+
+    // New parameters re-rate the whole archive
+    RatingEngine::Parameters frozen;
+    frozen.kFactor = 0.0;
+    frozen.provisionalKFactor = 0.0;
+    QVERIFY(reopened.setRatingParameters(frozen));
+    QCOMPARE(reopened.rating("alice"), frozen.initialRating);
+    QCOMPARE(reopened.rating("bob"), frozen.initialRating);
+}
+
+QTEST_MAIN(TestRatingEngine)
+#include "test_ratingengine.moc"
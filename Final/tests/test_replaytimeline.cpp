@@ -0,0 +1,264 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QApplication>
+#include <QLabel>
+#include <QPushButton>
+#include <QSlider>
+#include <QStandardPaths>
+#include "../include/replaytimeline.h"
+#include "../include/mainwindow.h"
+
+// The dialog tests run offscreen under ctest (QT_QPA_PLATFORM=offscreen)
+class TestReplayTimeline : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testSnapshots();
+    void testChangedCells();
+    void testInvalidMovesKeepPly();
+    void testEvaluations();
+    void testOFirstEvaluations();
+    void testDialogSeek();
+    void testDialogMoveQualities();
+    void testDialogWithoutMoves();
+    void testReversePlayback();
+
+private:
+    // X wins along the top row on the fifth move
+    QVector<GameMove> topRowWin() const;
+    QStringList cellTexts(QWidget *dialog) const;
+};
+
+void TestReplayTimeline::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+QVector<GameMove> TestReplayTimeline::topRowWin() const
+{
+    return {{0, 1}, {3, 2}, {1, 1}, {5, 2}, {2, 1}};
+}
+
+QStringList TestReplayTimeline::cellTexts(QWidget *dialog) const
+{
+    QStringList texts;
+    for (QPushButton *cell : dialog->findChildren<QPushButton*>()) {
+        if (cell->objectName() == "replayCell") {
+            texts.append(cell->text());
+        }
+    }
+    return texts;
+}
+
+void TestReplayTimeline::testSnapshots()
+{
+    ReplayTimeline timeline;
+    QCOMPARE(timeline.plyCount(), 0);
+
+    timeline.setMoves(topRowWin());
+    QCOMPARE(timeline.plyCount(), 5);
+
+    // Each snapshot matches replaying the moves up to it
+    const QVector<GameMove> moves = topRowWin();
+    for (int ply = 0; ply <= moves.size(); ++ply) {
+        QVector<GameLogic::Player> expected(9, GameLogic::Player::None);
+        for (int i = 0; i < ply; ++i) {
+            expected[moves.at(i).cellIndex] = moves.at(i).player == 1 ? GameLogic::Player::X
+                                                                      : GameLogic::Player::O;
+        }
+        const BoardSnapshot board = timeline.at(ply);
+        for (int cell = 0; cell < 9; ++cell) {
+            QCOMPARE(board.cell(cell), expected.at(cell));
+        }
+    }
+
+    // Out of range plies are clamped
+    QCOMPARE(timeline.at(-3).x, quint16(0));
+    QCOMPARE(timeline.at(99).x, timeline.at(5).x);
+    QCOMPARE(timeline.at(99).o, timeline.at(5).o);
+}
+
+void TestReplayTimeline::testChangedCells()
+{
+    ReplayTimeline timeline;
+    timeline.setMoves(topRowWin());
+
+    QCOMPARE(timeline.changedCells(2, 2), quint16(0));
+    QCOMPARE(timeline.changedCells(0, 1), quint16(1u << 0));
+    // Jumping back from the end clears everything the later moves placed
+    QCOMPARE(timeline.changedCells(5, 1), quint16((1u << 3) | (1u << 1) | (1u << 5) | (1u << 2)));
+    QCOMPARE(timeline.changedCells(1, 5), timeline.changedCells(5, 1));
+}
+
+void TestReplayTimeline::testInvalidMovesKeepPly()
+{
+    ReplayTimeline timeline;
+    timeline.setMoves({{4, 1}, {4, 2}, {12, 2}, {0, 2}});
+    QCOMPARE(timeline.plyCount(), 4);
+    QCOMPARE(timeline.at(2).x, timeline.at(1).x);
+    QCOMPARE(timeline.at(2).o, quint16(0));
+    QCOMPARE(timeline.at(3).o, quint16(0));
+    QCOMPARE(timeline.at(4).cell(0), GameLogic::Player::O);
+}
+
+void TestReplayTimeline::testEvaluations()
+{
+    ReplayTimeline timeline;
+    timeline.setMoves(topRowWin());
+
+    // Perfect play from the empty board is a draw
+    QCOMPARE(timeline.evaluation(0), 0);
+    QCOMPARE(timeline.winProbability(0), 0.5);
+
+    // Once X has the row the game is decided
+    QCOMPARE(timeline.evaluation(5), ReplayTimeline::WIN_SCORE);
+    QCOMPARE(timeline.winProbability(5), 1.0);
+
+    // X is to move with two of the top row: won, but a move away
+    const int forced = timeline.evaluation(4);
+    QVERIFY(forced > 0);
+    QVERIFY(forced < ReplayTimeline::WIN_SCORE);
+
+    ReplayTimeline lost;
+    lost.setMoves({{4, 1}, {0, 2}, {8, 1}, {3, 2}, {7, 1}, {6, 2}});
+    QCOMPARE(lost.evaluation(6), -ReplayTimeline::WIN_SCORE);
+    QCOMPARE(lost.winProbability(6), 0.0);
+
+    for (int ply = 0; ply <= lost.plyCount(); ++ply) {
+        QVERIFY(lost.winProbability(ply) >= 0.0);
+        QVERIFY(lost.winProbability(ply) <= 1.0);
+    }
+}
+
+void TestReplayTimeline::testOFirstEvaluations()
+{
+    // The same game with the marks swapped, so O opens and X takes the column
+    ReplayTimeline xFirst;
+    xFirst.setMoves({{4, 1}, {0, 2}, {8, 1}, {3, 2}, {7, 1}, {6, 2}});
+    ReplayTimeline oFirst;
+    oFirst.setMoves({{4, 2}, {0, 1}, {8, 2}, {3, 1}, {7, 2}, {6, 1}});
+
+    QCOMPARE(oFirst.evaluation(6), ReplayTimeline::WIN_SCORE);
+    for (int ply = 0; ply <= oFirst.plyCount(); ++ply) {
+        QCOMPARE(oFirst.evaluation(ply), -xFirst.evaluation(ply));
+    }
+}
+
+void TestReplayTimeline::testDialogSeek()
+{
+    ReplayDialog dialog;
+    dialog.setMoveData(topRowWin());
+    QSlider *scrubber = dialog.findChild<QSlider*>("replayScrubber");
+    QVERIFY(scrubber);
+    QCOMPARE(scrubber->maximum(), 5);
+
+    dialog.seek(3);
+    QCOMPARE(dialog.currentMove(), 3);
+    QCOMPARE(scrubber->value(), 3);
+    QCOMPARE(cellTexts(&dialog),
+             QStringList({"X", "X", "", "O", "", "", "", "", ""}));
+
+    // Straight back to the start and out past the end
+    dialog.seek(0);
+    QCOMPARE(cellTexts(&dialog), QStringList({"", "", "", "", "", "", "", "", ""}));
+    dialog.seek(42);
+    QCOMPARE(dialog.currentMove(), 5);
+    QCOMPARE(cellTexts(&dialog),
+             QStringList({"X", "X", "X", "O", "", "O", "", "", ""}));
+
+    // The scrubber seeks too
+    scrubber->setValue(1);
+    QCOMPARE(dialog.currentMove(), 1);
+    QCOMPARE(cellTexts(&dialog),
+             QStringList({"X", "", "", "", "", "", "", "", ""}));
+
+    // A new game repaints every cell, whatever the old one showed
+    dialog.seek(5);
+    dialog.setMoveData({{4, 2}});
+    QCOMPARE(dialog.currentMove(), 0);
+    QCOMPARE(cellTexts(&dialog), QStringList({"", "", "", "", "", "", "", "", ""}));
+}
+
+void TestReplayTimeline::testDialogMoveQualities()
+{
+    ReplayDialog dialog;
+    dialog.setMoveData(topRowWin());
+
+    // O's edge reply loses a drawn game; its last move loses sooner than blocking
+    const QVector<MoveAnalyzer::MoveQuality> expected = {
+        MoveAnalyzer::MoveQuality::Best, MoveAnalyzer::MoveQuality::Mistake,
+        MoveAnalyzer::MoveQuality::Best, MoveAnalyzer::MoveQuality::Inaccuracy,
+        MoveAnalyzer::MoveQuality::Best
+    };
+    QCOMPARE(dialog.moveQualities(), expected);
+
+    dialog.seek(2);
+    QStringList texts;
+    for (QLabel *label : dialog.findChildren<QLabel*>()) {
+        texts.append(label->text());
+    }
+    QVERIFY(texts.contains("Move 2 of 5 · Mistake"));
+}
+
+void TestReplayTimeline::testDialogWithoutMoves()
+{
+    // Games archived before moves were recorded show an empty board, not made-up moves
+    ReplayDialog dialog;
+    QCOMPARE(dialog.currentMove(), 0);
+    QVERIFY(dialog.moveQualities().isEmpty());
+    QCOMPARE(cellTexts(&dialog), QStringList({"", "", "", "", "", "", "", "", ""}));
+
+    QSlider *scrubber = dialog.findChild<QSlider*>("replayScrubber");
+    QVERIFY(scrubber);
+    QCOMPARE(scrubber->maximum(), 0);
+    QVERIFY(!scrubber->isEnabled());
+
+    QStringList texts;
+    for (QLabel *label : dialog.findChildren<QLabel*>()) {
+        texts.append(label->text());
+    }
+    QVERIFY(texts.contains("No moves recorded"));
+    for (QPushButton *button : dialog.findChildren<QPushButton*>()) {
+        if (button->objectName() != "replayCell" && button->objectName() != "closeButton") {
+            QVERIFY2(!button->isEnabled(), qPrintable(button->text()));
+        }
+    }
+
+    // Moves arriving later bring the controls back
+    dialog.setMoveData(topRowWin());
+    QVERIFY(scrubber->isEnabled());
+    QCOMPARE(scrubber->maximum(), 5);
+}
+
+void TestReplayTimeline::testReversePlayback()
+{
+    ReplayDialog dialog;
+    dialog.setMoveData({{4, 1}, {0, 2}});
+    dialog.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&dialog));
+
+    QPushButton *reverse = nullptr;
+    for (QPushButton *candidate : dialog.findChildren<QPushButton*>()) {
+        if (candidate->text() == "◀◀ Reverse") {
+            reverse = candidate;
+        }
+    }
+    QVERIFY(reverse);
+
+    // From the start, reverse playback begins at the end
+    QTest::mouseClick(reverse, Qt::LeftButton);
+    QCOMPARE(dialog.currentMove(), 2);
+    QVERIFY(dialog.isPlaying());
+    QVERIFY(!reverse->isEnabled());
+
+    QTRY_COMPARE_WITH_TIMEOUT(dialog.currentMove(), 0, 5000);
+    QTRY_VERIFY(!dialog.isPlaying());
+    QVERIFY(reverse->isEnabled());
+}
+
+QTEST_MAIN(TestReplayTimeline)
+#include "test_replaytimeline.moc"
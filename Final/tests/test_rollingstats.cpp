@@ -0,0 +1,136 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QDate>
+#include "../include/rollingstats.h"
+#include "../include/database.h"
+#include "../include/user.h"
+
+class TestRollingStats : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLastGames();
+    void testResultCapacity();
+    void testLastDays();
+    void testJsonRoundTrip();
+    void testUserWindows();
+};
+
+void TestRollingStats::testLastGames()
+{
+    RollingStats stats;
+    QCOMPARE(stats.lastGames(10).games(), 0);
+
+    stats.record("win", 100);
+    stats.record("loss", 100);
+    stats.record("draw", 100);
+    stats.record("win", 100);
+
+    // Newest first: win, draw, loss, win
+    WindowStats two = stats.lastGames(2);
+    QCOMPARE(two.wins, 1);
+    QCOMPARE(two.draws, 1);
+    QCOMPARE(two.losses, 0);
+
+    WindowStats all = stats.lastGames(50);
+    QCOMPARE(all.games(), 4);
+    QCOMPARE(all.wins, 2);
+    QCOMPARE(all.losses, 1);
+    QCOMPARE(all.draws, 1);
+    QCOMPARE(all.winRate(), 50);
+}
+
+void TestRollingStats::testResultCapacity()
+{
+    RollingStats stats;
+    for (int i = 0; i < RollingStats::RESULT_CAPACITY; ++i) {
+        stats.record("loss", 100);
+    }
+    for (int i = 0; i < 10; ++i) {
+        stats.record("win", 100);
+    }
+
+    // The oldest losses fell out of the result window
+    WindowStats all = stats.lastGames(1000);
+    QCOMPARE(all.games(), RollingStats::RESULT_CAPACITY);
+    QCOMPARE(all.wins, 10);
+    QCOMPARE(all.losses, RollingStats::RESULT_CAPACITY - 10);
+    QCOMPARE(stats.lastGames(10).wins, 10);
+}
+
+void TestRollingStats::testLastDays()
+{
+    RollingStats stats;
+    stats.record("win", 100);
+    stats.record("win", 103);
+    stats.record("loss", 106);
+    stats.record("draw", 106);
+
+    QCOMPARE(stats.lastDays(1, 106).games(), 2);
+    QCOMPARE(stats.lastDays(7, 106).games(), 4);
+    QCOMPARE(stats.lastDays(6, 106).wins, 1);
+    QCOMPARE(stats.lastDays(7, 110).games(), 2);
+
+    // Day 108 takes over day 100's slot
+    stats.record("win", 108);
+    QCOMPARE(stats.lastDays(RollingStats::DAY_CAPACITY, 108).wins, 2);
+
+    // A game older than the day already in its slot is left out
+    stats.record("loss", 100);
+    QCOMPARE(stats.lastDays(RollingStats::DAY_CAPACITY, 108).losses, 1);
+    QCOMPARE(stats.lastGames(1).losses, 1);
+}
+
+void TestRollingStats::testJsonRoundTrip()
+{
+    RollingStats stats;
+    for (int i = 0; i < 70; ++i) {
+        stats.record(i % 3 == 0 ? "win" : (i % 3 == 1 ? "loss" : "draw"), 200 + i / 10);
+    }
+
+    RollingStats restored = RollingStats::fromJson(stats.toJson());
+    for (int count : {1, 7, 50, 64}) {
+        QCOMPARE(restored.lastGames(count).wins, stats.lastGames(count).wins);
+        QCOMPARE(restored.lastGames(count).losses, stats.lastGames(count).losses);
+        QCOMPARE(restored.lastGames(count).draws, stats.lastGames(count).draws);
+    }
+    for (int days = 1; days <= RollingStats::DAY_CAPACITY; ++days) {
+        QCOMPARE(restored.lastDays(days, 206).games(), stats.lastDays(days, 206).games());
+        QCOMPARE(restored.lastDays(days, 206).wins, stats.lastDays(days, 206).wins);
+    }
+}
+
+void TestRollingStats::testUserWindows()
+{
+    const QDate today(2024, 3, 10);
+    User user("alice", "hash");
+    user.addGameWithDate("win", "bob", "2024-03-01 10:00:00");
+    user.addGameWithDate("loss", "ai", "2024-03-09 10:00:00", "hard");
+    user.addGameWithDate("win", "bob", "2024-03-10 10:00:00");
+
+    QCOMPARE(user.getRecentDays(7, today).games(), 2);
+    QCOMPARE(user.getRecentDays(7, today).wins, 1);
+    QCOMPARE(user.getRecentGames(50).games(), 3);
+
+    // The windows are saved with the user rather than rebuilt from history
+    User* restored = Database::deserializeUser(Database::serializeUser(user));
+    QCOMPARE(restored->getRecentDays(7, today).games(), 2);
+    QCOMPARE(restored->getRecentGames(50).wins, 2);
+    delete restored;
+
+    // Older records without them are seeded from the saved history
+    QJsonObject legacy = Database::serializeUser(user);
+    QJsonObject stats = legacy["stats"].toObject();
+    stats.remove("recent");
+    legacy["stats"] = stats;
+    restored = Database::deserializeUser(legacy);
+    QCOMPARE(restored->getRecentDays(7, today).losses, 1);
+    QCOMPARE(restored->getRecentGames(2).wins, 1);
+    delete restored;
+}
+
+QTEST_MAIN(TestRollingStats)
+#include "test_rollingstats.moc"
@@ -0,0 +1,245 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include "datasetgenerator.h"
+#include "../include/database.h"
+#include "../include/jsonuserstream.h"
+#include "../include/user.h"
+
+// Scaling benchmarks over generated datasets.
+//
+// Only the 10k row runs by default so ctest stays quick. Set
+// TICTACTOE_SCALE_MAX to run the larger rows, e.g. TICTACTOE_SCALE_MAX=10000000
+// for the full 10k / 100k / 1M / 10M sweep.
+class TestScaling : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testGeneratorDistribution();
+    void testScaling_data();
+    void testScaling();
+    void testStreamingImport();
+
+private:
+    static int scaleLimit();
+    static qint64 residentKb();
+};
+
+int TestScaling::scaleLimit()
+{
+    bool ok = false;
+    int limit = qEnvironmentVariableIntValue("TICTACTOE_SCALE_MAX", &ok);
+    return ok ? limit : 10000;
+}
+
+qint64 TestScaling::residentKb()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields.at(1).toLongLong() * 4; // Pages of 4 KB
+        }
+    }
+#endif
+    return 0;
+}
+
+void TestScaling::testGeneratorDistribution()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    DatasetGenerator::Options options;
+    options.userCount = 2000;
+    DatasetGenerator generator(options);
+    const QString path = dir.filePath("tictactoe.json");
+    QVERIFY(generator.writeTo(path));
+
+    Database database;
+    database.setDatabasePath(path);
+    QVector<User*> users = database.loadUsers();
+    QCOMPARE(users.size(), options.userCount);
+
+    // Activity is skewed: the busiest users play far more than the median one
+    QVector<int> games;
+    for (const User* user : users) {
+        games.append(user->getTotalGames());
+        QVERIFY(user->getTotalGames() >= 1);
+        QVERIFY(!user->getGameHistory().isEmpty());
+    }
+    std::sort(games.begin(), games.end());
+    const int median = games[games.size() / 2];
+    const int top = games[games.size() - games.size() / 100 - 1];
+    qDebug() << "Games per user - median:" << median << "p99:" << top << "max:" << games.last();
+    QVERIFY(top >= median * 5);
+
+    for (User* user : users) {
+        delete user;
+    }
+}
+
+void TestScaling::testScaling_data()
+{
+    QTest::addColumn<int>("userCount");
+    QTest::addColumn<QString>("databaseFile");
+
+    const int sizes[] = {10000, 100000, 1000000, 10000000};
+    const char *labels[] = {"10k", "100k", "1M", "10M"};
+    for (int i = 0; i < 4; ++i) {
+        QTest::newRow(QByteArray(labels[i]) + " json") << sizes[i] << QString("tictactoe.json");
+        QTest::newRow(QByteArray(labels[i]) + " sqlite") << sizes[i] << QString("tictactoe.db");
+    }
+}
+
+void TestScaling::testScaling()
+{
+    QFETCH(int, userCount);
+    QFETCH(QString, databaseFile);
+    if (userCount > scaleLimit()) {
+        QSKIP("Raise TICTACTOE_SCALE_MAX to run this size");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tictactoe.json");
+
+    QElapsedTimer timer;
+
+    // Generate
+    DatasetGenerator::Options options;
+    options.userCount = userCount;
+    DatasetGenerator generator(options);
+    timer.start();
+    QVERIFY(generator.writeTo(path));
+    qDebug() << "Generated" << userCount << "users," << generator.gamesWritten() << "games,"
+             << QFileInfo(path).size() / (1024 * 1024) << "MB in" << timer.elapsed() << "ms";
+
+    Database database;
+    database.setDatabasePath(dir.filePath(databaseFile));
+    if (database.backend() == Database::Backend::Sqlite) {
+        timer.restart();
+        QVERIFY(database.migrateFromJson(path));
+        qDebug() << "Migrate to SQLite:" << timer.elapsed() << "ms";
+    }
+
+    // Load
+    timer.restart();
+    QVector<User*> users = database.loadUsers();
+    qDebug() << "Load:" << timer.elapsed() << "ms";
+    QCOMPARE(users.size(), userCount);
+
+    if (database.backend() == Database::Backend::Json) {
+        // The first load left a shard index behind, so this one runs in parallel
+        for (User* user : users) {
+            delete user;
+        }
+        timer.restart();
+        users = database.loadUsers();
+        qDebug() << "Load (sharded," << QThread::idealThreadCount() << "threads):" << timer.elapsed() << "ms";
+        QCOMPARE(users.size(), userCount);
+    }
+
+    // Leaderboard
+    timer.restart();
+    QVector<LeaderboardEntry> leaderboard = database.getLeaderboard(users);
+    qDebug() << "Leaderboard:" << timer.elapsed() << "ms";
+    QVERIFY(!leaderboard.isEmpty());
+
+    if (database.backend() == Database::Backend::Sqlite) {
+        timer.restart();
+        leaderboard = database.getLeaderboard(100);
+        qDebug() << "Leaderboard query (top 100):" << timer.elapsed() << "ms";
+        QCOMPARE(leaderboard.size(), 100);
+    }
+
+    // History queries for a spread of users
+    timer.restart();
+    int historyWins = 0;
+    const int step = qMax(1, userCount / 1000);
+    for (int i = 0; i < users.size(); i += step) {
+        const auto history = users.at(i)->getGameHistory();
+        for (const GameRecord &record : history) {
+            if (record.result().startsWith("Win")) {
+                historyWins++;
+            }
+        }
+    }
+    qDebug() << "History queries:" << timer.elapsed() << "ms (" << historyWins << "wins seen)";
+
+    // Incremental save after one game between two players
+    users.first()->addGame("win", users.last()->getUsername());
+    users.last()->addGame("loss", users.first()->getUsername());
+    timer.restart();
+    qint64 journalBytes = 0;
+    QVERIFY(database.appendUsers({users.first(), users.last()}, &journalBytes));
+    qDebug() << "Incremental save:" << timer.elapsed() << "ms," << journalBytes << "bytes";
+    QVERIFY(journalBytes < 64 * 1024);
+
+    // Full save
+    database.setDatabasePath(dir.filePath("resaved." + QFileInfo(databaseFile).suffix()));
+    timer.restart();
+    QVERIFY(database.saveUsers(users));
+    qDebug() << "Save:" << timer.elapsed() << "ms";
+
+    for (User* user : users) {
+        delete user;
+    }
+}
+
+void TestScaling::testStreamingImport()
+{
+    // Point TICTACTOE_IMPORT_FILE at a real (multi-GB) export to measure it,
+    // otherwise a dataset of TICTACTOE_SCALE_MAX users is generated
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = qEnvironmentVariable("TICTACTOE_IMPORT_FILE");
+    if (path.isEmpty()) {
+        path = dir.filePath("tictactoe.json");
+        DatasetGenerator::Options options;
+        options.userCount = scaleLimit();
+        DatasetGenerator generator(options);
+        QVERIFY(generator.writeTo(path));
+    }
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const qint64 fileSize = file.size();
+
+    const qint64 baseKb = residentKb();
+    qint64 peakKb = baseKb;
+    QElapsedTimer timer;
+    timer.start();
+
+    JsonUserReader reader(&file);
+    QJsonObject userObj;
+    qint64 games = 0;
+    while (reader.readNext(&userObj)) {
+        User* user = Database::deserializeUser(userObj);
+        games += user->getTotalGames();
+        delete user;
+        if (reader.recordsRead() % 10000 == 0) {
+            peakKb = qMax(peakKb, residentKb());
+        }
+    }
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+
+    qDebug() << "Streamed" << reader.recordsRead() << "users," << games << "games,"
+             << fileSize / (1024 * 1024) << "MB in" << elapsed << "ms ("
+             << (fileSize / 1024) / elapsed << "MB/s ), resident growth"
+             << (peakKb - baseKb) / 1024 << "MB";
+}
+
+QTEST_MAIN(TestScaling)
+#include "test_scaling.moc"
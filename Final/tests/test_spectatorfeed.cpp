@@ -0,0 +1,443 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QSignalSpy>
+#include <QTcpSocket>
+#include <QDebug>
+#include "../include/gameclient.h"
+#include "../include/gameprotocol.h"
+#include "../include/gameserver.h"
+#include "../include/spectatorfeed.h"
+
+// Keeps every frame it is given; QByteArray shares rather than copies them
+class RecordingSpectator : public SpectatorFeed::Spectator {
+public:
+    bool deliver(const QByteArray &frame) override {
+        if (!accepting) {
+            return false;
+        }
+        frames.append(frame);
+        return true;
+    }
+
+    bool accepting = true;
+    QVector<QByteArray> frames;
+};
+
+// For the benchmark: counts frames and keeps only the last
+class CountingSpectator : public SpectatorFeed::Spectator {
+public:
+    bool deliver(const QByteArray &frame) override {
+        if (budget == 0) {
+            return false;
+        }
+        if (budget > 0) {
+            budget--;
+        }
+        frames++;
+        last = frame;
+        return true;
+    }
+
+    int budget = -1;    // Frames taken before backing up, -1 for no limit
+    int frames = 0;
+    QByteArray last;
+};
+
+// One game's moves fanned out to many spectators.
+//
+// The benchmark follows 10000 spectators through 100 games, a tenth of them
+// too slow to take every move. Set TICTACTOE_SPECTATORS to change the count.
+class TestSpectatorFeed : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testMovesShared();
+    void testSlowSpectatorCoalesced();
+    void testGameOverAndReset();
+    void testUnsubscribe();
+    void testServerWatch();
+    void testServerStalledSpectator();
+    void testBroadcastBenchmark();
+
+private:
+    static int spectatorCount();
+    static QVector<GameProtocol::Frame> decode(const QByteArray &bytes);
+};
+
+int TestSpectatorFeed::spectatorCount()
+{
+    bool ok = false;
+    const int spectators = qEnvironmentVariableIntValue("TICTACTOE_SPECTATORS", &ok);
+    return ok ? spectators : 10000;
+}
+
+QVector<GameProtocol::Frame> TestSpectatorFeed::decode(const QByteArray &bytes)
+{
+    QVector<GameProtocol::Frame> frames;
+    int offset = 0;
+    bool error = false;
+    GameProtocol::Frame frame;
+    while (GameProtocol::take(bytes, &offset, &frame, &error)) {
+        frames.append(frame);
+    }
+    return frames;
+}
+
+void TestSpectatorFeed::initTestCase()
+{
+    qRegisterMetaType<GameLogic::Player>();
+    qRegisterMetaType<GameLogic::GameResult>();
+}
+
+void TestSpectatorFeed::testMovesShared()
+{
+    GameLogic logic;
+    SpectatorFeed feed(0x01000007);
+    feed.follow(&logic);
+
+    RecordingSpectator spectators[3];
+    for (RecordingSpectator &spectator : spectators) {
+        feed.subscribe(&spectator);
+    }
+    logic.makeMove(4);
+    logic.makeMove(0);
+
+    for (const RecordingSpectator &spectator : spectators) {
+        QCOMPARE(spectator.frames.size(), 3);
+        // One encoding each, whoever receives it
+        QVERIFY(spectator.frames[1].constData() == spectators[0].frames[1].constData());
+        QVERIFY(spectator.frames[2].constData() == spectators[0].frames[2].constData());
+    }
+
+    const QVector<GameProtocol::Frame> board = decode(spectators[0].frames[0]);
+    QCOMPARE(board.size(), 1);
+    QCOMPARE(board[0].type, GameProtocol::FrameType::Board);
+    quint16 xCells = 1;
+    quint16 oCells = 1;
+    QVERIFY(GameProtocol::decodeBoard(board[0].payload, &xCells, &oCells));
+    QCOMPARE(int(xCells), 0);
+    QCOMPARE(int(oCells), 0);
+
+    const QVector<GameProtocol::Frame> move = decode(spectators[0].frames[2]);
+    QCOMPARE(move[0].type, GameProtocol::FrameType::Moved);
+    QCOMPARE(move[0].session, quint32(0x01000007));
+    QCOMPARE(int(move[0].argument), 0 | 2 << 4);
+    QCOMPARE(feed.metrics().framesPublished, qint64(2));
+    QCOMPARE(feed.metrics().framesDelivered, qint64(9));
+}
+
+void TestSpectatorFeed::testSlowSpectatorCoalesced()
+{
+    GameLogic logic;
+    SpectatorFeed feed;
+    feed.follow(&logic);
+
+    RecordingSpectator fast;
+    RecordingSpectator slow;
+    feed.subscribe(&fast);
+    feed.subscribe(&slow);
+    slow.accepting = false;
+
+    logic.makeMove(4);
+    logic.makeMove(0);
+    logic.makeMove(8);
+    QCOMPARE(fast.frames.size(), 4);
+    QCOMPARE(slow.frames.size(), 1);
+    QVERIFY(feed.isBehind(&slow));
+    QCOMPARE(feed.metrics().behind, 1);
+    QCOMPARE(feed.metrics().framesCoalesced, qint64(2));
+
+    // Three moves missed, one frame to catch up
+    slow.accepting = true;
+    feed.resume(&slow);
+    QCOMPARE(slow.frames.size(), 2);
+    const QVector<GameProtocol::Frame> board = decode(slow.frames[1]);
+    QCOMPARE(board.size(), 1);
+    quint16 xCells = 0;
+    quint16 oCells = 0;
+    QVERIFY(GameProtocol::decodeBoard(board[0].payload, &xCells, &oCells));
+    QCOMPARE(int(xCells), (1 << 4) | (1 << 8));
+    QCOMPARE(int(oCells), 1 << 0);
+    QVERIFY(!feed.isBehind(&slow));
+
+    // Resuming again sends nothing, and moves flow as before
+    feed.resume(&slow);
+    logic.makeMove(2);
+    QCOMPARE(slow.frames.size(), 3);
+    QVERIFY(slow.frames[2].constData() == fast.frames[4].constData());
+}
+
+void TestSpectatorFeed::testGameOverAndReset()
+{
+    GameLogic logic;
+    SpectatorFeed feed;
+    feed.follow(&logic);
+    RecordingSpectator early;
+    feed.subscribe(&early);
+
+    // X takes the top row
+    const int cells[] = {0, 3, 1, 4, 2};
+    for (int cell : cells) {
+        logic.makeMove(cell);
+    }
+    QCOMPARE(feed.result(), GameLogic::GameResult::XWins);
+    const QVector<GameProtocol::Frame> last = decode(early.frames.last());
+    QCOMPARE(last[0].type, GameProtocol::FrameType::GameOver);
+    QCOMPARE(GameLogic::GameResult(last[0].argument), GameLogic::GameResult::XWins);
+    QCOMPARE(decode(early.frames[early.frames.size() - 2])[0].argument, quint8(2 | 1 << 4));
+
+    // Joining a finished game: the board and the result together
+    RecordingSpectator late;
+    feed.subscribe(&late);
+    QCOMPARE(late.frames.size(), 1);
+    const QVector<GameProtocol::Frame> joined = decode(late.frames[0]);
+    QCOMPARE(joined.size(), 2);
+    QCOMPARE(joined[0].type, GameProtocol::FrameType::Board);
+    QCOMPARE(joined[1].type, GameProtocol::FrameType::GameOver);
+
+    // A new game starts everyone from an empty board
+    logic.resetBoard();
+    QCOMPARE(feed.result(), GameLogic::GameResult::InProgress);
+    const QVector<GameProtocol::Frame> fresh = decode(late.frames.last());
+    QCOMPARE(fresh.size(), 1);
+    QCOMPARE(fresh[0].payload, GameProtocol::encodeBoard(0, 0));
+    QVERIFY(late.frames.last().constData() == early.frames.last().constData());
+    logic.makeMove(6);
+    QCOMPARE(feed.board().x, quint16(1 << 6));
+}
+
+void TestSpectatorFeed::testUnsubscribe()
+{
+    SpectatorFeed feed;
+    RecordingSpectator spectators[3];
+    for (RecordingSpectator &spectator : spectators) {
+        feed.subscribe(&spectator);
+    }
+    spectators[2].accepting = false;
+    feed.publish(GameMove{4, 1});
+    QCOMPARE(feed.metrics().behind, 1);
+
+    feed.unsubscribe(&spectators[0]);
+    feed.unsubscribe(&spectators[2]);
+    feed.unsubscribe(&spectators[2]);
+    QCOMPARE(feed.metrics().spectators, 1);
+    QCOMPARE(feed.metrics().behind, 0);
+
+    feed.publish(GameMove{0, 2});
+    QCOMPARE(spectators[0].frames.size(), 2);
+    QCOMPARE(spectators[1].frames.size(), 3);
+}
+
+void TestSpectatorFeed::testServerWatch()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient player;
+    GameClient spectator;
+    QSignalSpy playerConnected(&player, &GameClient::connected);
+    QSignalSpy spectatorConnected(&spectator, &GameClient::connected);
+    QSignalSpy opened(&player, &GameClient::gameOpened);
+    QSignalSpy playerMoved(&player, &GameClient::moved);
+    QSignalSpy snapshots(&spectator, &GameClient::boardSnapshot);
+    QSignalSpy watchedMoves(&spectator, &GameClient::moved);
+    QSignalSpy watchedOver(&spectator, &GameClient::gameOver);
+    player.connectToServer("127.0.0.1", server.port());
+    spectator.connectToServer("127.0.0.1", server.port());
+    QVERIFY(playerConnected.wait());
+    QTRY_COMPARE(spectatorConnected.count(), 1);
+
+    player.openGame("alice", "bob");
+    QVERIFY(opened.wait());
+    const quint32 session = opened.at(0).at(0).toUInt();
+    player.sendMove(session, 4);
+    QVERIFY(playerMoved.wait());
+
+    // Joining mid-game starts from the board as it stands
+    spectator.watchGame(session);
+    QVERIFY(snapshots.wait());
+    QCOMPARE(snapshots.at(0).at(0).toUInt(), session);
+    QCOMPARE(snapshots.at(0).at(1).toUInt(), 1u << 4);
+    QCOMPARE(snapshots.at(0).at(2).toUInt(), 0u);
+    QCOMPARE(server.metrics().spectators, 1);
+
+    // X takes the middle row
+    const int cells[] = {0, 3, 1, 5};
+    for (int cell : cells) {
+        player.sendMove(session, cell);
+    }
+    QTRY_COMPARE(watchedOver.count(), 1);
+    QCOMPARE(watchedMoves.count(), 4);
+    QCOMPARE(watchedMoves.at(3).at(1).toInt(), 5);
+    QCOMPARE(watchedOver.at(0).at(1).value<GameLogic::GameResult>(), GameLogic::GameResult::XWins);
+    QCOMPARE(server.metrics().spectators, 0);
+
+    // The game is gone
+    spectator.watchGame(session);
+    QVERIFY(snapshots.wait());
+    QCOMPARE(snapshots.at(1).at(0).toUInt(), 0u);
+}
+
+void TestSpectatorFeed::testServerStalledSpectator()
+{
+    GameServer server;
+    QVERIFY(server.listen());
+
+    GameClient player;
+    QSignalSpy playerConnected(&player, &GameClient::connected);
+    QSignalSpy opened(&player, &GameClient::gameOpened);
+    QSignalSpy playerOver(&player, &GameClient::gameOver);
+    player.connectToServer("127.0.0.1", server.port());
+    QVERIFY(playerConnected.wait());
+    player.openGame("alice", "bob");
+    QVERIFY(opened.wait());
+    const quint32 session = opened.at(0).at(0).toUInt();
+
+    // A raw socket, so the test decides when the spectator reads
+    QTcpSocket spectator;
+    spectator.connectToHost("127.0.0.1", server.port());
+    QVERIFY(spectator.waitForConnected());
+    QByteArray watch;
+    GameProtocol::append(watch, GameProtocol::FrameType::Watch, session);
+    spectator.write(watch);
+    QTRY_COMPARE(server.metrics().spectators, 1);
+
+    // Stop reading, and have the server answer far more than the socket
+    // buffers hold: every Watch of an unknown session gets an empty Board
+    spectator.setReadBufferSize(1);
+    QByteArray flood;
+    for (int i = 0; i < 4 * 1024 * 1024; ++i) {
+        GameProtocol::append(flood, GameProtocol::FrameType::Watch, 0);
+    }
+    spectator.write(flood);
+    QTRY_VERIFY_WITH_TIMEOUT(spectator.bytesToWrite() == 0, 30000);
+    QTest::qWait(100);
+
+    // X takes the middle row while the spectator is stalled
+    const int cells[] = {4, 0, 3, 1, 5};
+    for (int cell : cells) {
+        player.sendMove(session, cell);
+    }
+    QTRY_COMPARE(playerOver.count(), 1);
+    // Kept for the spectator that has not seen the end
+    QCOMPARE(server.metrics().spectators, 1);
+
+    // Once it drains it gets the final board and the result
+    spectator.setReadBufferSize(0);
+    QByteArray inbox;
+    quint16 xCells = 0;
+    quint16 oCells = 0;
+    bool sawBoard = false;
+    int result = -1;
+    auto readFrames = [&]() {
+        inbox.append(spectator.readAll());
+        int offset = 0;
+        bool error = false;
+        GameProtocol::Frame frame;
+        while (GameProtocol::take(inbox, &offset, &frame, &error)) {
+            if (frame.session != session) {
+                continue;
+            }
+            if (frame.type == GameProtocol::FrameType::Board) {
+                sawBoard = GameProtocol::decodeBoard(frame.payload, &xCells, &oCells);
+            } else if (frame.type == GameProtocol::FrameType::GameOver) {
+                result = frame.argument;
+            }
+        }
+        inbox.remove(0, offset);
+        return result >= 0;
+    };
+    QTRY_VERIFY_WITH_TIMEOUT(readFrames(), 30000);
+    QVERIFY(sawBoard);
+    QCOMPARE(uint(xCells), (1u << 3) | (1u << 4) | (1u << 5));
+    QCOMPARE(uint(oCells), (1u << 0) | (1u << 1));
+    QCOMPARE(result, int(GameLogic::GameResult::XWins));
+    QTRY_COMPARE(server.metrics().spectators, 0);
+}
+
+void TestSpectatorFeed::testBroadcastBenchmark()
+{
+    const int spectatorTotal = spectatorCount();
+    const int games = 100;
+
+    GameLogic logic;
+    SpectatorFeed feed(1);
+    feed.follow(&logic);
+
+    // Every tenth spectator can take two frames at a time and drains every fourth move
+    QVector<CountingSpectator> spectators(spectatorTotal);
+    QVector<CountingSpectator*> slow;
+    for (int i = 0; i < spectatorTotal; ++i) {
+        if (i % 10 == 9) {
+            spectators[i].budget = 2;
+            slow.append(&spectators[i]);
+        }
+        feed.subscribe(&spectators[i]);
+    }
+
+    QRandomGenerator random(5);
+    int moves = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int game = 0; game < games; ++game) {
+        while (logic.getGameResult() == GameLogic::GameResult::InProgress) {
+            int cell = random.bounded(9);
+            while (logic.getCellState(cell) != GameLogic::Player::None) {
+                cell = (cell + 1) % 9;
+            }
+            logic.makeMove(cell);
+            if (++moves % 4 == 0) {
+                for (CountingSpectator *spectator : slow) {
+                    spectator->budget = 2;
+                    feed.resume(spectator);
+                }
+            }
+        }
+        logic.resetBoard();
+    }
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+
+    const SpectatorFeed::Metrics metrics = feed.metrics();
+    qDebug() << "Fan-out:" << spectatorTotal << "spectators," << games << "games," << moves << "moves in"
+             << elapsedNs / 1000000 << "ms";
+    qDebug() << metrics.framesPublished << "frames encoded," << metrics.framesDelivered << "delivered,"
+             << metrics.framesCoalesced << "coalesced," << metrics.boardsSent << "boards";
+    qDebug() << "Per delivered frame:" << double(elapsedNs) / qMax<qint64>(1, metrics.framesDelivered)
+             << "ns, per move for all spectators:" << elapsedNs / 1000.0 / moves << "us";
+
+    // Everyone who kept up saw every frame, and the very same bytes
+    const char *shared = nullptr;
+    for (int i = 0; i < spectatorTotal; ++i) {
+        if (spectators[i].budget >= 0) {
+            continue;
+        }
+        QCOMPARE(qint64(spectators[i].frames), metrics.framesPublished + 1);
+        if (!shared) {
+            shared = spectators[i].last.constData();
+        }
+        QVERIFY(spectators[i].last.constData() == shared);
+    }
+    QVERIFY(metrics.framesCoalesced > 0);
+
+    // The slow ones catch up with a single frame
+    for (CountingSpectator *spectator : slow) {
+        spectator->budget = -1;
+        feed.resume(spectator);
+        quint16 xCells = 1;
+        quint16 oCells = 1;
+        const QVector<GameProtocol::Frame> last = decode(spectator->last);
+        QVERIFY(GameProtocol::decodeBoard(last[0].payload, &xCells, &oCells));
+        QCOMPARE(xCells, feed.board().x);
+        QCOMPARE(oCells, feed.board().o);
+    }
+    QCOMPARE(feed.metrics().behind, 0);
+}
+
+QTEST_MAIN(TestSpectatorFeed)
+#include "test_spectatorfeed.moc"
@@ -0,0 +1,186 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QFile>
+#include "../include/database.h"
+#include "../include/user.h"
+#include "../include/movecodec.h"
+
+class TestSqliteStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testBackendFromPath();
+    void testSaveAndLoadUsers();
+    void testIncrementalUpsert();
+    void testLeaderboardQuery();
+    void testMigrationFromJson();
+
+private:
+    static User* findUser(const QVector<User*> &users, const QString &username);
+
+    QTemporaryDir *dir;
+    Database *database;
+};
+
+void TestSqliteStore::init()
+{
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+    database = new Database();
+    database->setDatabasePath(dir->filePath("tictactoe.db"));
+}
+
+void TestSqliteStore::cleanup()
+{
+    delete database;
+    delete dir;
+}
+
+User* TestSqliteStore::findUser(const QVector<User*> &users, const QString &username)
+{
+    for (User* user : users) {
+        if (user->getUsername() == username) {
+            return user;
+        }
+    }
+    return nullptr;
+}
+
+void TestSqliteStore::testBackendFromPath()
+{
+    QCOMPARE(database->backend(), Database::Backend::Sqlite);
+
+    Database json;
+    json.setDatabasePath(dir->filePath("tictactoe.json"));
+    QCOMPARE(json.backend(), Database::Backend::Json);
+    QVERIFY(json.getLeaderboard(10).isEmpty());
+}
+
+void TestSqliteStore::testSaveAndLoadUsers()
+{
+    QVector<GameMoveRecord> moves = {{4, 1}, {0, 2}, {8, 1}, {2, 2}, {1, 1}, {6, 2}, {3, 2}};
+    User* alice = new User("alice", "aliceHash");
+    alice->addGameWithMoves("loss", "ai", moves, "expert");
+    alice->addGame("win", "bob");
+    User* bob = new User("bob", "bobHash");
+    bob->addGame("loss", "alice");
+
+    QVERIFY(database->saveUsers({alice, bob}));
+    QVector<User*> loaded = database->loadUsers();
+    QCOMPARE(loaded.size(), 2);
+
+    User* loadedAlice = findUser(loaded, "alice");
+    QVERIFY(loadedAlice);
+    QCOMPARE(loadedAlice->getHashedPassword(), QString("aliceHash"));
+    QCOMPARE(loadedAlice->getTotalGames(), 2);
+    QCOMPARE(loadedAlice->getWins(), 1);
+    QCOMPARE(loadedAlice->getVsAI(), 1);
+    QVERIFY(!loadedAlice->isDirty());
+
+    // History order, result text and moves match the in-memory user
+    QVector<GameRecord> original = alice->getGameHistory();
+    QVector<GameRecord> history = loadedAlice->getGameHistory();
+    QCOMPARE(history.size(), original.size());
+    for (int i = 0; i < history.size(); ++i) {
+        QCOMPARE(history[i].result(), original[i].result());
+        QCOMPARE(history[i].date(), original[i].date());
+        QCOMPARE(history[i].packedMoves, original[i].packedMoves);
+    }
+    QCOMPARE(history[1].packedMoves, MoveCodec::pack(moves));
+
+    delete alice;
+    delete bob;
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+void TestSqliteStore::testIncrementalUpsert()
+{
+    User* alice = new User("alice", "aliceHash");
+    User* bob = new User("bob", "bobHash");
+    alice->addGame("win", "bob");
+    bob->addGame("loss", "alice");
+    QVERIFY(database->saveUsers({alice, bob}));
+
+    // Only alice changes; her games are replaced, not duplicated
+    alice->addGame("draw", "ai", "hard");
+    QVERIFY(database->appendUsers({alice}));
+
+    QVector<User*> loaded = database->loadUsers();
+    QCOMPARE(loaded.size(), 2);
+    QCOMPARE(findUser(loaded, "alice")->getTotalGames(), 2);
+    QCOMPARE(findUser(loaded, "alice")->getDraws(), 1);
+    QCOMPARE(findUser(loaded, "bob")->getTotalGames(), 1);
+
+    delete alice;
+    delete bob;
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+void TestSqliteStore::testLeaderboardQuery()
+{
+    QVector<User*> users;
+    for (int i = 0; i < 50; ++i) {
+        User* user = new User(QString("ranked%1").arg(i), "hash");
+        for (int j = 0; j < i % 13; ++j) {
+            user->addGame("win", "ai", "easy");
+        }
+        for (int j = 0; j < i % 7; ++j) {
+            user->addGame("loss", "ai", "hard");
+        }
+        users.append(user);
+    }
+    QVERIFY(database->saveUsers(users));
+
+    QVector<LeaderboardEntry> top = database->getLeaderboard(10);
+    QCOMPARE(top.size(), 10);
+    for (int i = 1; i < top.size(); ++i) {
+        QVERIFY(top[i - 1].score >= top[i].score);
+    }
+
+    // Same scores as the in-memory ranking
+    QVector<LeaderboardEntry> inMemory = database->getLeaderboard(users);
+    for (int i = 0; i < top.size(); ++i) {
+        QCOMPARE(top[i].score, inMemory[i].score);
+        QVERIFY(top[i].totalGames > 0);
+    }
+
+    for (User* user : users) {
+        delete user;
+    }
+}
+
+void TestSqliteStore::testMigrationFromJson()
+{
+    Database json;
+    json.setDatabasePath(dir->filePath("tictactoe.json"));
+    User* legacy = new User("legacy", "legacyHash");
+    legacy->addGameWithMoves("win", "ai", {{0, 1}, {4, 2}, {1, 1}, {5, 2}, {2, 1}}, "medium");
+    QVERIFY(json.saveUsers({legacy}));
+
+    // An empty SQLite database next to tictactoe.json imports it on first load
+    QVector<User*> loaded = database->loadUsers();
+    QCOMPARE(loaded.size(), 1);
+    QCOMPARE(loaded.first()->getUsername(), QString("legacy"));
+    QCOMPARE(loaded.first()->getGameHistory().first().packedMoves,
+             legacy->getGameHistory().first().packedMoves);
+    QVERIFY(QFile::exists(dir->filePath("tictactoe.json")));
+
+    delete legacy;
+    for (User* user : loaded) {
+        delete user;
+    }
+}
+
+QTEST_MAIN(TestSqliteStore)
+#include "test_sqlitestore.moc"
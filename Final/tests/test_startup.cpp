@@ -0,0 +1,159 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QApplication>
+#include <QFile>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QStandardPaths>
+#include <QElapsedTimer>
+#include <algorithm>
+#include "../include/mainwindow.h"
+#include "../include/startupprofiler.h"
+
+// Runs offscreen under ctest (QT_QPA_PLATFORM=offscreen)
+class TestStartup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testStyleSheetsSplit();
+    void testOnlyFirstScreenBuilt();
+    void testScreensBuiltOnFirstVisit();
+    void testStartupBudget();
+
+private:
+    // Milliseconds from constructing a window to its first frame
+    qint64 timeToFirstFrame(bool preload);
+    QPushButton *button(QWidget *window, const QString &text);
+};
+
+void TestStartup::initTestCase()
+{
+    // Keeps the window's database away from the real one
+    QStandardPaths::setTestModeEnabled(true);
+
+    QFile common(":/styles/common.qss");
+    QVERIFY(common.open(QIODevice::ReadOnly | QIODevice::Text));
+    qApp->setStyleSheet(QString::fromUtf8(common.readAll()));
+}
+
+void TestStartup::testStyleSheetsSplit()
+{
+    QFile common(":/styles/common.qss");
+    QVERIFY(common.open(QIODevice::ReadOnly | QIODevice::Text));
+    const QString commonRules = QString::fromUtf8(common.readAll());
+    QVERIFY(!commonRules.contains("cellButton"));
+    QVERIFY(!commonRules.contains("leaderboardList"));
+
+    for (const QString &name : {QString("modeselection"), QString("game"), QString("statistics")}) {
+        QFile sheet(QString(":/styles/%1.qss").arg(name));
+        QVERIFY2(sheet.open(QIODevice::ReadOnly | QIODevice::Text), qPrintable(name));
+        QVERIFY(sheet.size() > 0);
+    }
+}
+
+void TestStartup::testOnlyFirstScreenBuilt()
+{
+    MainWindow window;
+    QVERIFY(window.findChild<QPushButton*>("modeButton"));
+    QVERIFY(window.findChildren<QPushButton*>("cellButton").isEmpty());
+    QVERIFY(!window.findChild<QWidget*>("loadingOverlay"));
+    QVERIFY(!window.findChild<QWidget*>("playerAuthPanel"));
+
+    window.preloadScreens();
+    QCOMPARE(window.findChildren<QPushButton*>("cellButton").size(), 9);
+    QVERIFY(window.findChild<QWidget*>("loadingOverlay"));
+    QVERIFY(window.findChild<QWidget*>("playerAuthPanel"));
+}
+
+void TestStartup::testScreensBuiltOnFirstVisit()
+{
+    MainWindow window;
+    window.resize(900, 700);
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+    // Signing in waits for the users, read on the writer thread
+    QTRY_VERIFY(window.usersLoaded());
+
+    const QList<QLineEdit*> inputs = window.findChildren<QLineEdit*>();
+    QCOMPARE(inputs.size(), 2);
+    inputs.at(0)->setText("startupuser");
+    inputs.at(1)->setText("secret");
+    // Registering again on a later run fails harmlessly
+    QTest::mouseClick(button(&window, "Register"), Qt::LeftButton);
+    QTest::mouseClick(button(&window, "Login"), Qt::LeftButton);
+
+    QTest::mouseClick(button(&window, "Player vs AI"), Qt::LeftButton);
+    QCOMPARE(window.findChildren<QPushButton*>("cellButton").size(), 9);
+    QVERIFY(window.findChild<QWidget*>("loadingOverlay"));
+
+    // Game screen widgets are connected once; a click makes one move
+    QPushButton *cell = window.findChildren<QPushButton*>("cellButton").first();
+    QTest::mouseClick(cell, Qt::LeftButton);
+    QCOMPARE(cell->text(), QString("X"));
+
+    QTest::mouseClick(button(&window, "Toggle Statistics View"), Qt::LeftButton);
+    QWidget *statistics = nullptr;
+    for (QWidget *widget : QApplication::topLevelWidgets()) {
+        if (widget->objectName() == "statisticsView") {
+            statistics = widget;
+        }
+    }
+    QVERIFY(statistics);
+    QVERIFY(statistics->isVisible());
+}
+
+void TestStartup::testStartupBudget()
+{
+    // The first window pays for fonts and style setup; leave it out
+    timeToFirstFrame(false);
+
+    QVector<qint64> lazy;
+    QVector<qint64> eager;
+    for (int run = 0; run < 5; ++run) {
+        lazy.append(timeToFirstFrame(false));
+        eager.append(timeToFirstFrame(true));
+    }
+    std::sort(lazy.begin(), lazy.end());
+    std::sort(eager.begin(), eager.end());
+
+    qDebug() << "Time to first frame, lazy screens (ms):" << lazy;
+    qDebug() << "Time to first frame, all screens built (ms):" << eager;
+    for (const auto &phase : StartupProfiler::phases()) {
+        qDebug() << " " << phase.first << phase.second << "ms";
+    }
+    QVERIFY(lazy.at(lazy.size() / 2) <= eager.at(eager.size() / 2));
+}
+
+qint64 TestStartup::timeToFirstFrame(bool preload)
+{
+    StartupProfiler::restart();
+    MainWindow window;
+    if (preload) {
+        window.preloadScreens();
+    }
+    StartupProfiler::mark("window constructed");
+    window.resize(900, 700);
+    StartupProfiler::watchFirstFrame(&window);
+    window.show();
+    if (!QTest::qWaitFor([]() { return StartupProfiler::firstFrame() >= 0; }, 5000)) {
+        return -1;
+    }
+    return StartupProfiler::firstFrame();
+}
+
+QPushButton *TestStartup::button(QWidget *window, const QString &text)
+{
+    for (QPushButton *candidate : window->findChildren<QPushButton*>()) {
+        if (candidate->text() == text) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+QTEST_MAIN(TestStartup)
+#include "test_startup.moc"
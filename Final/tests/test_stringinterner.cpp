@@ -0,0 +1,130 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include "../include/stringinterner.h"
+#include "../include/gamehistory.h"
+#include "../include/database.h"
+#include "../include/user.h"
+
+class TestStringInterner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInternIsStable();
+    void testDateKeys();
+    void testConcurrentIntern();
+    void testRecordsShareStrings();
+};
+
+void TestStringInterner::testInternIsStable()
+{
+    QCOMPARE(StringInterner::intern(QString()), 0u);
+    QCOMPARE(StringInterner::string(0), QString());
+
+    const quint32 hard = StringInterner::intern("hard");
+    QVERIFY(hard != 0);
+    QCOMPARE(StringInterner::intern(QString("ha") + "rd"), hard);
+    QCOMPARE(StringInterner::string(hard), QString("hard"));
+
+    // Views stay valid however much the arena grows afterwards
+    const QString view = StringInterner::string(hard);
+    for (int i = 0; i < 20000; ++i) {
+        StringInterner::intern(QString("filler-%1").arg(i));
+    }
+    QCOMPARE(view, QString("hard"));
+
+    const QString longName(100000, QChar('x'));
+    const quint32 longId = StringInterner::intern(longName);
+    QCOMPARE(StringInterner::string(longId), longName);
+    QCOMPARE(StringInterner::string(StringInterner::intern("after-long")), QString("after-long"));
+}
+
+void TestStringInterner::testDateKeys()
+{
+    // History dates become plain seconds and round-trip exactly
+    const qint64 key = StringInterner::internDate("2024-02-29 23:59:58");
+    QVERIFY(key >= 0);
+    QCOMPARE(StringInterner::dateString(key), QString("2024-02-29 23:59:58"));
+    QVERIFY(StringInterner::internDate("2024-03-01 00:00:00") > key);
+
+    // Other strings are kept as they are
+    for (const QString &odd : {QString("2024-01-01"), QString("yesterday"), QString()}) {
+        const qint64 oddKey = StringInterner::internDate(odd);
+        QVERIFY(oddKey < 0);
+        QCOMPARE(StringInterner::dateString(oddKey), odd);
+    }
+}
+
+void TestStringInterner::testConcurrentIntern()
+{
+    // The shard loader interns from several threads at once
+    QAtomicInt mismatches;
+    QThreadPool pool;
+    for (int t = 0; t < 8; ++t) {
+        pool.start([&mismatches]() {
+            for (int i = 0; i < 2000; ++i) {
+                const QString name = QString("shared-%1").arg(i % 500);
+                if (StringInterner::string(StringInterner::intern(name)) != name) {
+                    mismatches.ref();
+                }
+            }
+        });
+    }
+    pool.waitForDone();
+    QCOMPARE(mismatches.loadRelaxed(), 0);
+    QCOMPARE(StringInterner::intern("shared-7"), StringInterner::intern(QString("shared-") + "7"));
+}
+
+void TestStringInterner::testRecordsShareStrings()
+{
+    User alice("alice", "hash");
+    User bob("bob", "hash");
+    alice.addGameWithDate("win", "ai", "2024-05-01 10:00:00", "hard");
+    bob.addGameWithDate("win", "ai", "2024-05-01 10:00:00", "hard");
+
+    const GameRecord a = alice.getGameHistory().first();
+    const GameRecord b = bob.getGameHistory().first();
+    QCOMPARE(a.dateKey, b.dateKey);
+    QCOMPARE(a.result(), QString("Win vs AI (hard)"));
+    QCOMPARE(a.date(), QString("2024-05-01 10:00:00"));
+
+    // The result line is built when asked for; only the opponent is interned
+    const int interned = StringInterner::count();
+    alice.addGameWithDate("loss", "bob", "2024-05-01 10:05:00");
+    bob.addGameWithDate("draw", "alice", "2024-05-01 10:05:00");
+    const GameRecord c = alice.getGameHistory().first();
+    QCOMPARE(c.opponentId, StringInterner::intern("bob"));
+    QCOMPARE(c.outcome, GameRecord::Outcome::Loss);
+    QCOMPARE(c.result(), QString("Loss vs bob"));
+    QVERIFY(StringInterner::count() <= interned + 2);
+    alice.addGameWithDate("win", "bob", "2024-05-01 10:10:00");
+    QCOMPARE(alice.getGameHistory().first().opponentId, c.opponentId);
+    QVERIFY(StringInterner::count() <= interned + 2);
+
+    // Saved and loaded records come back with the same fields
+    User* restored = Database::deserializeUser(Database::serializeUser(alice));
+    const GameRecord restoredFirst = restored->getGameHistory().first();
+    QCOMPARE(restoredFirst.opponentId, c.opponentId);
+    QCOMPARE(restoredFirst.outcome, GameRecord::Outcome::Win);
+    const GameRecord restoredLast = restored->getGameHistory().last();
+    QCOMPARE(restoredLast.difficulty, a.difficulty);
+    QVERIFY(restoredLast.isVsAI());
+    QCOMPARE(restoredLast.dateKey, a.dateKey);
+    delete restored;
+
+    GameHistory history;
+    history.addEntry("Win vs AI (hard)");
+    QCOMPARE(history.getEntries().first().result(), QString("Win vs AI (hard)"));
+
+    LeaderboardEntry entry;
+    entry.setUsername("alice");
+    QCOMPARE(entry.username(), QString("alice"));
+    QCOMPARE(entry.usernameId, StringInterner::intern("alice"));
+}
+
+QTEST_MAIN(TestStringInterner)
+#include "test_stringinterner.moc"
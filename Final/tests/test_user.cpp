@@ -4,6 +4,26 @@
 #include <QObject>
 #include "../include/user.h"
 #include "../include/authentication.h"
+#include "../include/movecodec.h"
+#include "../include/historystore.h"
+
+// Serves a fixed history and counts how often it had to go to "disk"
+class CountingHistoryStore : public HistoryStore {
+public:
+    explicit CountingHistoryStore(const QVector<GameRecord> &records)
+        : HistoryStore(2), fetches(0), m_records(records) {}
+
+    int fetches;
+
+protected:
+    QVector<GameRecord> fetch(const QString &, qint64) override {
+        fetches++;
+        return m_records;
+    }
+
+private:
+    QVector<GameRecord> m_records;
+};
 
 class TestUser : public QObject
 {
@@ -20,6 +40,9 @@ private slots:
     void testAddDrawGame();
     void testWinStreakCalculation();
     void testGameHistory();
+    void testPackedMoveHistory();
+    void testDirtyFlag();
+    void testLazyHistory();
 
 private:
     User *user;
@@ -123,10 +146,84 @@ void TestUser::testGameHistory()
     
     // Game history is stored in reverse order (newest first)
     // Checking the most recent game first (index 0)
-    QVERIFY(history[0].result.contains("player2"));
+    QVERIFY(history[0].result().contains("player2"));
     
     // Checking the older game (index 1)
-    QVERIFY(history[1].result.contains("AI"));
+    QVERIFY(history[1].result().contains("AI"));
+}
+
+void TestUser::testPackedMoveHistory()
+{
+    // Full-length draw: nine alternating moves starting with X
+    QVector<GameMoveRecord> moves = {
+        {0, 1}, {4, 2}, {2, 1}, {1, 2}, {7, 1}, {6, 2}, {3, 1}, {5, 2}, {8, 1}
+    };
+    
+    quint64 packed = MoveCodec::pack(moves);
+    QCOMPARE(MoveCodec::length(packed), 9);
+    QVERIFY(packed < (quint64(1) << 53)); // Survives a round trip through a JSON double
+    
+    QVector<GameMoveRecord> decoded = MoveCodec::unpack(packed);
+    QCOMPARE(decoded.size(), moves.size());
+    for (int i = 0; i < moves.size(); ++i) {
+        QCOMPARE(decoded[i].cellIndex, moves[i].cellIndex);
+        QCOMPARE(decoded[i].player, moves[i].player);
+    }
+    
+    // Empty history packs to zero and stays empty
+    QCOMPARE(MoveCodec::pack(QVector<GameMoveRecord>()), quint64(0));
+    QVERIFY(MoveCodec::unpack(0).isEmpty());
+    
+    user->addGameWithMoves("draw", "ai", moves, "expert");
+    QVector<GameRecord> history = user->getGameHistory();
+    QCOMPARE(history[0].packedMoves, packed);
+    QCOMPARE(history[0].decodeMoves().size(), 9);
+}
+
+void TestUser::testDirtyFlag()
+{
+    // New users have never been written
+    QVERIFY(user->isDirty());
+    
+    user->clearDirty();
+    QVERIFY(!user->isDirty());
+    
+    user->addGame("win", "ai", "easy");
+    QVERIFY(user->isDirty());
+    
+    user->clearDirty();
+    user->addGameWithMoves("loss", "player2", {{4, 1}});
+    QVERIFY(user->isDirty());
+}
+
+void TestUser::testLazyHistory()
+{
+    User source("source", "hash");
+    source.addGame("win", "ai", "easy");
+    source.addGame("loss", "player2");
+    
+    QSharedPointer<CountingHistoryStore> store(new CountingHistoryStore(source.getGameHistory()));
+    user->restoreStats(2, 1, 1, 0, 1, 1, 1, 0);
+    user->setHistorySource(store, 0);
+    QVERIFY(!user->isHistoryLoaded());
+    QCOMPARE(user->getTotalGames(), 2);
+    QCOMPARE(user->getWinRate(), 50);
+    QCOMPARE(store->fetches, 0);
+    
+    // Paged in once, then served from the cache
+    QCOMPARE(user->getGameHistory().size(), 2);
+    QCOMPARE(user->getGameHistory().first().result(), QString("Loss vs player2"));
+    QCOMPARE(store->fetches, 1);
+    QCOMPARE(store->cachedCount(), 1);
+    
+    // Playing again brings the history into memory for good
+    user->addGame("win", "ai", "hard");
+    QVERIFY(user->isHistoryLoaded());
+    QCOMPARE(user->getTotalGames(), 3);
+    QVector<GameRecord> history = user->getGameHistory();
+    QCOMPARE(history.size(), 3);
+    QCOMPARE(history.first().result(), QString("Win vs AI (hard)"));
+    QCOMPARE(history.last().result(), QString("Win vs AI (easy)"));
 }
 
 QTEST_MAIN(TestUser)
@@ -0,0 +1,146 @@
+// clazy:skip
+
+#include <QTest>
+#include <QObject>
+#include <QRandomGenerator>
+#include "../include/userstore.h"
+#include "../include/database.h"
+#include "../include/user.h"
+
+class TestUserStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testAttachAndLookup();
+    void testCountersFollowUser();
+    void testLeaderboardMatchesUsers();
+    void testTotals();
+    void testLargePopulation();
+};
+
+void TestUserStore::testAttachAndLookup()
+{
+    UserStore store;
+    User alice("alice", "hash");
+    User bob("bob", "hash");
+    QCOMPARE(store.attach(&alice), 0);
+    QCOMPARE(store.attach(&bob), 1);
+
+    QCOMPARE(store.size(), 2);
+    QCOMPARE(store.indexOf("alice"), 0);
+    QCOMPARE(store.indexOf("bob"), 1);
+    QCOMPARE(store.indexOf("carol"), -1);
+    QCOMPARE(store.username(1), QString("bob"));
+
+    // A user loaded under a known name takes over its row
+    User reloaded("alice", "hash");
+    reloaded.addGame("win", "bob");
+    QCOMPARE(store.attach(&reloaded), 0);
+    QCOMPARE(store.size(), 2);
+    QCOMPARE(store.wins(0), 1);
+}
+
+void TestUserStore::testCountersFollowUser()
+{
+    UserStore store;
+    User alice("alice", "hash");
+    const int row = store.attach(&alice);
+
+    alice.addGame("win", "bob");
+    alice.addGame("win", "ai", "hard");
+    alice.addGame("loss", "bob");
+    QCOMPARE(store.totalGames(row), 3);
+    QCOMPARE(store.wins(row), 2);
+    QCOMPARE(store.losses(row), 1);
+    QCOMPARE(store.bestStreak(row), 2);
+    QCOMPARE(store.currentStreak(row), 0);
+    QCOMPARE(store.winRate(row), alice.getWinRate());
+    QCOMPARE(store.score(row), Database::calculatePlayerScore(alice.getWins(), alice.getTotalGames(),
+                                                              alice.getWinRate(), alice.getBestStreak()));
+
+    // Copies, like the ones handed to the writer thread, leave the row alone
+    User copy = alice;
+    copy.addGame("win", "bob");
+    QCOMPARE(store.totalGames(row), 3);
+}
+
+void TestUserStore::testLeaderboardMatchesUsers()
+{
+    QRandomGenerator random(39);
+    QVector<User*> users;
+    UserStore store;
+    for (int i = 0; i < 500; ++i) {
+        User* user = new User(QString("player%1").arg(i), "hash");
+        store.attach(user);
+        const int games = random.bounded(12);
+        for (int g = 0; g < games; ++g) {
+            const int roll = random.bounded(3);
+            user->addGame(roll == 0 ? "win" : (roll == 1 ? "loss" : "draw"), "ai", "medium");
+        }
+        users.append(user);
+    }
+
+    Database database;
+    const QVector<LeaderboardEntry> expected = database.getLeaderboard(users);
+    const QVector<LeaderboardEntry> swept = database.getLeaderboard(store);
+    QCOMPARE(swept.size(), expected.size());
+    for (int i = 0; i < swept.size(); ++i) {
+        QCOMPARE(swept.at(i).score, expected.at(i).score);
+        QCOMPARE(store.wins(store.indexOf(swept.at(i).username())), swept.at(i).wins);
+    }
+
+    const QVector<LeaderboardEntry> top = database.getLeaderboard(store, 10);
+    QCOMPARE(top.size(), 10);
+    for (int i = 0; i < top.size(); ++i) {
+        QCOMPARE(top.at(i).username(), swept.at(i).username());
+    }
+
+    qDeleteAll(users);
+}
+
+void TestUserStore::testTotals()
+{
+    UserStore store;
+    User alice("alice", "hash");
+    User bob("bob", "hash");
+    User idle("idle", "hash");
+    store.attach(&alice);
+    store.attach(&bob);
+    store.attach(&idle);
+    alice.addGame("win", "bob");
+    bob.addGame("loss", "alice");
+    bob.addGame("draw", "ai", "easy");
+
+    const UserTotals totals = store.totals();
+    QCOMPARE(totals.players, 2);
+    QCOMPARE(totals.games, qint64(3));
+    QCOMPARE(totals.wins, qint64(1));
+    QCOMPARE(totals.losses, qint64(1));
+    QCOMPARE(totals.draws, qint64(1));
+    QCOMPARE(totals.vsAI, qint64(1));
+    QCOMPARE(totals.vsPlayers, qint64(2));
+}
+
+void TestUserStore::testLargePopulation()
+{
+    const int count = 100000;
+    UserStore store;
+    store.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        User user(QString("user%1").arg(i, 6, 10, QChar('0')), "hash");
+        user.restoreStats(i % 50, i % 30, 0, 0, 0, i % 50, i % 7, 0);
+        store.attach(&user);
+    }
+    QCOMPARE(store.size(), count);
+    QCOMPARE(store.indexOf("user054321"), 54321);
+    QCOMPARE(store.username(99999), QString("user099999"));
+
+    // Columns, name arena and table; far below a heap-allocated User each
+    const qint64 bytesPerUser = store.memoryUsage() / count;
+    qDebug() << "UserStore bytes per user:" << bytesPerUser;
+    QVERIFY(bytesPerUser < 128);
+}
+
+QTEST_MAIN(TestUserStore)
+#include "test_userstore.moc"